@@ -46,8 +46,10 @@
 // High Level drivers
 
 #include "sapi_parser.h"
+#include "sapi_matcher.h"
 #include "sapi_convert.h"
 #include "sapi_delay.h"
+#include "sapi_soft_timer.h"
 
 // External Peripheral Drivers
 
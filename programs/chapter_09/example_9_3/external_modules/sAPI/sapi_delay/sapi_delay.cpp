@@ -81,6 +81,7 @@ void delayInit( delay_t * delay, tick_t duration_ms )
 {
    delay->duration = duration_ms / tickRateMS;
    delay->running = 0;
+   softTimerInit( &(delay->timer), NULL, NULL );
 }
 
 bool delayRead( delay_t * delay )
@@ -90,8 +91,13 @@ bool delayRead( delay_t * delay )
    if( !delay->running ) {
       delay->startTime = tickRead();
       delay->running = 1;
+      softTimerArmAt( &(delay->timer), delay->startTime + delay->duration );
    } else {
-      if ( (tick_t)(tickRead() - delay->startTime) >= delay->duration ) {
+      // Compared against the tick, so a read does not walk the wheel. The
+      // timer only gives the idle loop its next deadline.
+      if ( softTimerExpiredRead( &(delay->timer) ) ||
+           tickRead() >= delay->startTime + delay->duration ) {
+         softTimerCancel( &(delay->timer) );
          timeArrived = 1;
          delay->running = 0;
       }
@@ -103,6 +109,9 @@ bool delayRead( delay_t * delay )
 void delayWrite( delay_t * delay, tick_t duration_ms )
 {
    delay->duration = duration_ms / tickRateMS;
+   if ( delay->running ) {
+      softTimerArmAt( &(delay->timer), delay->startTime + delay->duration );
+   }
 }
 
 //==================[end of file]==============================================
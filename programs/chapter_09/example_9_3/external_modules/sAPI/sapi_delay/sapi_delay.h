@@ -38,6 +38,7 @@
 //==================[inclusions]===============================================
 
 #include <sapi_tick.h>
+#include <sapi_soft_timer.h>
 
 //==================[macros]===================================================
 
@@ -50,10 +51,14 @@
 
 //==================[typedef]==================================================
 
+// Backed by a soft timer, so polling a delay does not depend on how many
+// delays are running. Like the timers, a delay must be zero initialized
+// (static storage) before the first delayInit().
 typedef struct{
    tick_t startTime;
    tick_t duration;
    bool running;
+   softTimer_t timer;
 } delay_t;
 
 //==================[external functions declaration]===========================
@@ -0,0 +1,136 @@
+//=====[Libraries]=============================================================
+
+#include <sapi_matcher.h>
+
+//=====[Declaration of private defines]========================================
+
+#define MATCHER_ROOT   0
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration and initialization of private global variables]============
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool matcherTrieBuild( matcher_t* matcher, char const* const* patterns,
+                              int numberOfPatterns );
+static void matcherTransitionsBuild( matcher_t* matcher );
+
+//=====[Implementations of public functions]===================================
+
+bool matcherInit( matcher_t* matcher, char const* const* patterns,
+                  int numberOfPatterns )
+{
+   int i;
+
+   memset( matcher->charClass, 0, sizeof(matcher->charClass) );
+   memset( matcher->next, MATCHER_ROOT, sizeof(matcher->next) );
+   for( i = 0; i < MATCHER_MAX_STATES; i++ ) {
+      matcher->output[i] = MATCHER_NO_MATCH;
+   }
+   matcher->numberOfStates = 1;
+   matcher->numberOfClasses = 1;
+   matcher->state = MATCHER_ROOT;
+
+   if( numberOfPatterns > 127 ||
+       !matcherTrieBuild( matcher, patterns, numberOfPatterns ) ) {
+      matcher->numberOfStates = 1;
+      memset( matcher->next, MATCHER_ROOT, sizeof(matcher->next) );
+      return false;
+   }
+   matcherTransitionsBuild( matcher );
+   return true;
+}
+
+void matcherReset( matcher_t* matcher )
+{
+   matcher->state = MATCHER_ROOT;
+}
+
+int matcherUpdate( matcher_t* matcher, char const receivedChar )
+{
+   matcher->state = matcher->next[matcher->state]
+                                 [matcher->charClass[(uint8_t) receivedChar]];
+   return matcher->output[matcher->state];
+}
+
+//=====[Implementations of private functions]==================================
+
+// Each pattern character gets a class and each pattern a path from the
+// root. Only the trie edges are set, the root is never an edge target.
+static bool matcherTrieBuild( matcher_t* matcher, char const* const* patterns,
+                              int numberOfPatterns )
+{
+   char const* c;
+   uint8_t charClass;
+   uint8_t state;
+   int i;
+
+   for( i = 0; i < numberOfPatterns; i++ ) {
+      if( patterns[i][0] == '\0' ) {
+         return false;
+      }
+      state = MATCHER_ROOT;
+      for( c = patterns[i]; *c != '\0'; c++ ) {
+         charClass = matcher->charClass[(uint8_t) *c];
+         if( charClass == 0 ) {
+            if( matcher->numberOfClasses >= MATCHER_MAX_CLASSES ) {
+               return false;
+            }
+            charClass = matcher->numberOfClasses++;
+            matcher->charClass[(uint8_t) *c] = charClass;
+         }
+         if( matcher->next[state][charClass] == MATCHER_ROOT ) {
+            if( matcher->numberOfStates >= MATCHER_MAX_STATES ) {
+               return false;
+            }
+            matcher->next[state][charClass] = matcher->numberOfStates++;
+         }
+         state = matcher->next[state][charClass];
+      }
+      if( matcher->output[state] == MATCHER_NO_MATCH ) {
+         matcher->output[state] = i;
+      }
+   }
+   return true;
+}
+
+// States are visited breadth first, so the failure state of a state, which
+// is always shallower, already has its complete row. A missing edge then
+// takes the transition of the failure state, and a state with no pattern
+// of its own reports the one of its failure state.
+static void matcherTransitionsBuild( matcher_t* matcher )
+{
+   uint8_t fail[MATCHER_MAX_STATES];
+   uint8_t queue[MATCHER_MAX_STATES];
+   int queueHead = 0;
+   int queueTail = 0;
+   uint8_t state;
+   uint8_t child;
+   int charClass;
+
+   for( charClass = 0; charClass < matcher->numberOfClasses; charClass++ ) {
+      child = matcher->next[MATCHER_ROOT][charClass];
+      if( child != MATCHER_ROOT ) {
+         fail[child] = MATCHER_ROOT;
+         queue[queueTail++] = child;
+      }
+   }
+
+   while( queueHead < queueTail ) {
+      state = queue[queueHead++];
+      for( charClass = 0; charClass < matcher->numberOfClasses; charClass++ ) {
+         child = matcher->next[state][charClass];
+         if( child == MATCHER_ROOT ) {
+            matcher->next[state][charClass] =
+               matcher->next[fail[state]][charClass];
+            continue;
+         }
+         fail[child] = matcher->next[fail[state]][charClass];
+         if( matcher->output[child] == MATCHER_NO_MATCH ) {
+            matcher->output[child] = matcher->output[fail[child]];
+         }
+         queue[queueTail++] = child;
+      }
+   }
+}
@@ -0,0 +1,47 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SAPI_MATCHER_H_
+#define _SAPI_MATCHER_H_
+
+//=====[Libraries]=============================================================
+
+#include <sapi_datatypes.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define MATCHER_MAX_STATES    96   // Pattern characters + 1
+#define MATCHER_MAX_CLASSES   40   // Different pattern characters + 1
+#define MATCHER_NO_MATCH      -1
+
+//=====[Declaration of public data types]======================================
+
+// Aho-Corasick automaton that watches several patterns at once. The goto
+// and failure functions are folded into a single transition table, so each
+// received byte costs two table reads whatever the number of patterns.
+// Bytes that appear in no pattern share character class 0.
+typedef struct matcher{
+   uint8_t charClass[256];
+   uint8_t next[MATCHER_MAX_STATES][MATCHER_MAX_CLASSES];
+   int8_t output[MATCHER_MAX_STATES];   // Pattern that ends in each state
+   uint8_t numberOfStates;
+   uint8_t numberOfClasses;
+   uint8_t state;
+} matcher_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Builds the tables, returns false if the patterns do not fit. Up to 127
+// patterns, none of them empty.
+bool matcherInit( matcher_t* matcher, char const* const* patterns,
+                  int numberOfPatterns );
+
+// Forget the bytes received so far
+void matcherReset( matcher_t* matcher );
+
+// Index of the pattern that ends with this byte or MATCHER_NO_MATCH. If
+// several patterns end with the same byte the longest one is reported.
+int matcherUpdate( matcher_t* matcher, char const receivedChar );
+
+//=====[#include guards - end]=================================================
+
+#endif
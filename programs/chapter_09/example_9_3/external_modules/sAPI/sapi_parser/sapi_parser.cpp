@@ -38,6 +38,8 @@
 
 //==================[internal functions declaration]===========================
 
+static uint16_t parserNextIndex( parser_t* instance, char const receivedChar );
+
 //==================[external functions definition]============================
 
 // Initialize parser
@@ -54,18 +56,20 @@ void parserInit( parser_t* instance,
     instance->stringIndex = 0;
 }
 
-// Check for Receive a given pattern
+// Check for Receive a given pattern, '\0' means that nothing was received.
+// The pattern must be received contiguously.
 parserStatus_t parserUpdate( parser_t* instance, char const receivedChar )
 {
    switch( instance->state ) {
 
    // Initial state
    case PARSER_RECEIVING:
-      if( (instance->stringPattern)[(instance->stringIndex)] == receivedChar ) {
+      if( receivedChar != '\0' ) {
+         instance->stringIndex = parserNextIndex( instance, receivedChar );
          if( (instance->stringIndex) == (instance->stringPatternLen) ) {
             instance->state = PARSER_PATTERN_MATCH;
+            break;
          }
-         (instance->stringIndex)++;
       }
       if( delayRead( &(instance->delay) ) ) {
          instance->state = PARSER_TIMEOUT;
@@ -84,4 +88,24 @@ parserStatus_t parserUpdate( parser_t* instance, char const receivedChar )
 
 //==================[internal functions definition]============================
 
+// Length of the longest pattern prefix that ends the received characters.
+// On a mismatch the shorter prefixes are tried, so "OOK" still matches "OK".
+static uint16_t parserNextIndex( parser_t* instance, char const receivedChar )
+{
+   char const* pattern = instance->stringPattern;
+   uint16_t index = instance->stringIndex;
+   uint16_t length;
+
+   if( index < instance->stringPatternLen && pattern[index] == receivedChar ) {
+      return index + 1;
+   }
+   for( length = index; length > 0; length-- ) {
+      if( pattern[length - 1] == receivedChar &&
+          memcmp( pattern, pattern + index - length + 1, length - 1 ) == 0 ) {
+         return length;
+      }
+   }
+   return 0;
+}
+
 //==================[end of file]==============================================
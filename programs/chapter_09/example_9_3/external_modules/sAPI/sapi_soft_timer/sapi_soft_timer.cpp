@@ -0,0 +1,289 @@
+//=====[Libraries]=============================================================
+
+#include <sapi_soft_timer.h>
+
+//=====[Declaration of private defines]========================================
+
+#define SOFT_TIMER_LEVELS       4
+#define SOFT_TIMER_SLOT_BITS    6
+#define SOFT_TIMER_SLOTS        ( 1 << SOFT_TIMER_SLOT_BITS )
+#define SOFT_TIMER_SLOT_MASK    ( SOFT_TIMER_SLOTS - 1 )
+
+// Farthest expiry the wheel can hold, later timers are parked in the last
+// level and placed again when they are cascaded
+#define SOFT_TIMER_MAX_DELTA    ( ( (tick_t) 1 << ( SOFT_TIMER_LEVELS * \
+                                    SOFT_TIMER_SLOT_BITS ) ) - 1 )
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration of external public global variables]=======================
+
+extern tick_t tickRateMS;
+
+//=====[Declaration and initialization of private global variables]============
+
+static softTimerLink_t wheel[SOFT_TIMER_LEVELS][SOFT_TIMER_SLOTS];
+
+// One bit per non empty slot
+static uint64_t wheelOccupancy[SOFT_TIMER_LEVELS];
+
+// Next tick to be processed, every timer that expires before it has fired
+static tick_t wheelTick = 0;
+
+static bool wheelInitialized = false;
+static int numberOfArmedTimers = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void softTimerWheelInit( void );
+static void softTimerInsert( softTimer_t* timer );
+static void softTimerUnlink( softTimer_t* timer );
+static void softTimerCascade( void );
+static void softTimerSlotExpire( int slot );
+static bool softTimerSlotIsEmpty( int level, int slot );
+
+//=====[Implementations of public functions]===================================
+
+void softTimerInit( softTimer_t* timer, callBackFuncPtr_t callback,
+                    void* callbackParams )
+{
+   if( timer->armed ) {
+      softTimerCancel( timer );
+   }
+   timer->link.next = NULL;
+   timer->link.prev = NULL;
+   timer->expiry = 0;
+   timer->callback = callback;
+   timer->callbackParams = callbackParams;
+   timer->armed = false;
+   timer->expired = false;
+}
+
+void softTimerArm( softTimer_t* timer, tick_t duration )
+{
+   if( duration == 0 ) {
+      duration = 1;
+   }
+   softTimerArmAt( timer, tickRead() + duration );
+}
+
+// Rounded up to the first tick that starts after the delay, so the timer
+// never expires early
+void softTimerArmUs( softTimer_t* timer, uint64_t delayUs )
+{
+   uint64_t tickUs = tickRateMS * 1000;
+
+   softTimerArmAt( timer, ( tickReadUs() + delayUs + tickUs - 1 ) / tickUs );
+}
+
+void softTimerArmAt( softTimer_t* timer, tick_t expiry )
+{
+   softTimerWheelInit();
+
+   if( timer->armed ) {
+      softTimerUnlink( timer );
+   } else {
+      numberOfArmedTimers++;
+   }
+   // An expiry already in the past fires on the next update
+   if( expiry < wheelTick ) {
+      expiry = wheelTick;
+   }
+   timer->expiry = expiry;
+   timer->armed = true;
+   timer->expired = false;
+   softTimerInsert( timer );
+}
+
+void softTimerCancel( softTimer_t* timer )
+{
+   if( timer->armed ) {
+      softTimerUnlink( timer );
+      timer->armed = false;
+      numberOfArmedTimers--;
+   }
+   timer->expired = false;
+}
+
+bool softTimerIsArmed( softTimer_t* timer )
+{
+   return timer->armed;
+}
+
+bool softTimerExpiredRead( softTimer_t* timer )
+{
+   return timer->expired;
+}
+
+void softTimerUpdate( void )
+{
+   tick_t currentTick = tickRead();
+   tick_t nextTick;
+   uint64_t pending;
+   int slot;
+
+   softTimerWheelInit();
+
+   while( wheelTick <= currentTick ) {
+      slot = (int)( wheelTick & SOFT_TIMER_SLOT_MASK );
+      if( slot == 0 ) {
+         softTimerCascade();
+      }
+
+      // Jump straight to the next non empty slot of this lap
+      pending = wheelOccupancy[0] >> slot;
+      if( pending == 0 ) {
+         nextTick = ( wheelTick | SOFT_TIMER_SLOT_MASK ) + 1;
+      } else if( ( pending & 1 ) == 0 ) {
+         nextTick = wheelTick + __builtin_ctzll( pending );
+      } else {
+         softTimerSlotExpire( slot );
+         continue;
+      }
+      wheelTick = nextTick <= currentTick ? nextTick : currentTick + 1;
+   }
+}
+
+tick_t softTimerNextDeadlineRead( void )
+{
+   uint64_t pending;
+   int slot;
+
+   if( numberOfArmedTimers == 0 ) {
+      return SOFT_TIMER_NO_DEADLINE;
+   }
+   slot = (int)( wheelTick & SOFT_TIMER_SLOT_MASK );
+   pending = wheelOccupancy[0] >> slot;
+   if( pending != 0 ) {
+      return wheelTick + __builtin_ctzll( pending );
+   }
+   // The next timer is in a higher level, wake up for the cascade
+   return ( wheelTick | SOFT_TIMER_SLOT_MASK ) + 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void softTimerWheelInit( void )
+{
+   int level;
+   int slot;
+
+   if( wheelInitialized ) {
+      return;
+   }
+   for( level = 0; level < SOFT_TIMER_LEVELS; level++ ) {
+      for( slot = 0; slot < SOFT_TIMER_SLOTS; slot++ ) {
+         wheel[level][slot].next = &wheel[level][slot];
+         wheel[level][slot].prev = &wheel[level][slot];
+      }
+      wheelOccupancy[level] = 0;
+   }
+   wheelTick = tickRead();
+   wheelInitialized = true;
+}
+
+// The level is chosen from the distance to the expiry and the slot from the
+// expiry bits of that level, so a timer is cascaded exactly when its slot
+// of the lower level comes around
+static void softTimerInsert( softTimer_t* timer )
+{
+   tick_t expiry = timer->expiry;
+   tick_t delta = expiry - wheelTick;
+   softTimerLink_t* head;
+   int level = 0;
+
+   if( delta > SOFT_TIMER_MAX_DELTA ) {
+      delta = SOFT_TIMER_MAX_DELTA;
+      expiry = wheelTick + delta;
+   }
+   while( delta >> ( ( level + 1 ) * SOFT_TIMER_SLOT_BITS ) ) {
+      level++;
+   }
+   timer->level = level;
+   timer->slot = ( expiry >> ( level * SOFT_TIMER_SLOT_BITS ) ) &
+                 SOFT_TIMER_SLOT_MASK;
+
+   head = &wheel[level][timer->slot];
+   timer->link.next = head;
+   timer->link.prev = head->prev;
+   head->prev->next = &timer->link;
+   head->prev = &timer->link;
+   wheelOccupancy[level] |= (uint64_t) 1 << timer->slot;
+}
+
+static void softTimerUnlink( softTimer_t* timer )
+{
+   timer->link.prev->next = timer->link.next;
+   timer->link.next->prev = timer->link.prev;
+   timer->link.next = NULL;
+   timer->link.prev = NULL;
+   if( softTimerSlotIsEmpty( timer->level, timer->slot ) ) {
+      wheelOccupancy[timer->level] &= ~( (uint64_t) 1 << timer->slot );
+   }
+}
+
+// Moves the timers of the current slot of each higher level one level down,
+// going up only while the lower level wrapped around
+static void softTimerCascade( void )
+{
+   softTimerLink_t* head;
+   softTimer_t* timer;
+   int level;
+   int slot;
+
+   for( level = 1; level < SOFT_TIMER_LEVELS; level++ ) {
+      slot = (int)( ( wheelTick >> ( level * SOFT_TIMER_SLOT_BITS ) ) &
+                    SOFT_TIMER_SLOT_MASK );
+      head = &wheel[level][slot];
+      while( head->next != head ) {
+         timer = (softTimer_t*) head->next;
+         softTimerUnlink( timer );
+         softTimerInsert( timer );
+      }
+      if( slot != 0 ) {
+         break;
+      }
+   }
+}
+
+// The slot is emptied and the tick advanced before the callbacks run, so a
+// callback can re-arm or cancel any timer
+static void softTimerSlotExpire( int slot )
+{
+   softTimerLink_t expired;
+   softTimerLink_t* head = &wheel[0][slot];
+   softTimer_t* timer;
+
+   expired.next = head->next;
+   expired.prev = head->prev;
+   expired.next->prev = &expired;
+   expired.prev->next = &expired;
+   head->next = head;
+   head->prev = head;
+   wheelOccupancy[0] &= ~( (uint64_t) 1 << slot );
+   wheelTick++;
+
+   while( expired.next != &expired ) {
+      timer = (softTimer_t*) expired.next;
+      timer->link.prev->next = timer->link.next;
+      timer->link.next->prev = timer->link.prev;
+      timer->link.next = NULL;
+      timer->link.prev = NULL;
+      // A parked timer that is still too far away goes back to the wheel
+      if( timer->expiry >= wheelTick ) {
+         softTimerInsert( timer );
+         continue;
+      }
+      timer->armed = false;
+      timer->expired = true;
+      numberOfArmedTimers--;
+      if( timer->callback != NULL ) {
+         (* timer->callback )( timer->callbackParams );
+      }
+   }
+}
+
+static bool softTimerSlotIsEmpty( int level, int slot )
+{
+   return wheel[level][slot].next == &wheel[level][slot];
+}
@@ -0,0 +1,61 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SAPI_SOFT_TIMER_H_
+#define _SAPI_SOFT_TIMER_H_
+
+//=====[Libraries]=============================================================
+
+#include <sapi_datatypes.h>
+#include <sapi_tick.h>
+
+//=====[Declaration of public defines]=========================================
+
+#define SOFT_TIMER_NO_DEADLINE   UINT64_MAX
+
+//=====[Declaration of public data types]======================================
+
+typedef struct softTimerLink{
+   struct softTimerLink* next;
+   struct softTimerLink* prev;
+} softTimerLink_t;
+
+// Timers live in the slots of a hierarchical timer wheel, so arming and
+// cancelling are O(1) and only the slot of the current tick is visited.
+// A timer must be zero initialized (static storage or softTimerInit())
+// before it is armed for the first time.
+typedef struct softTimer{
+   softTimerLink_t link;   // Must be the first member
+   tick_t expiry;
+   callBackFuncPtr_t callback;
+   void* callbackParams;
+   uint8_t level;
+   uint8_t slot;
+   bool armed;
+   bool expired;
+} softTimer_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// The callback can be NULL, the expired flag is set anyway
+void softTimerInit( softTimer_t* timer, callBackFuncPtr_t callback,
+                    void* callbackParams );
+
+// Arm (or re-arm) the timer, duration and expiry are given in ticks
+void softTimerArm( softTimer_t* timer, tick_t duration );
+void softTimerArmUs( softTimer_t* timer, uint64_t delayUs );
+void softTimerArmAt( softTimer_t* timer, tick_t expiry );
+void softTimerCancel( softTimer_t* timer );
+
+bool softTimerIsArmed( softTimer_t* timer );
+bool softTimerExpiredRead( softTimer_t* timer );
+
+// Expire the timers up to the current tick and run their callbacks, must be
+// called from the main loop, never from an interrupt
+void softTimerUpdate( void );
+
+// Lower bound of the next expiry, SOFT_TIMER_NO_DEADLINE if none is armed
+tick_t softTimerNextDeadlineRead( void );
+
+//=====[#include guards - end]=================================================
+
+#endif
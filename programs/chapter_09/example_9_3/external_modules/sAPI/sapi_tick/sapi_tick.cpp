@@ -40,6 +40,8 @@
 
 //=====[Declaration of private defines]========================================
 
+#define TICK_SLEEP_MAX_US   1000000 // Longest sleep, keeps the Timeout in range
+
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of public global objects]===============
@@ -47,6 +49,7 @@
 //=====[Declaration and initialization of private global objects]==============
 
 static Ticker ticker;
+static Timeout wakeUpTimeout;
 
 //=====[Declaration of external public global variables]=======================
 
@@ -56,15 +59,32 @@ tick_t tickRateMS = 1; // Used by sapi_delay!!! Default 1ms
 
 //=====[Declaration and initialization of private global variables]============
 
-// This global variable holds the tick count
-static volatile tick_t tickCounter;
+// The ticks are derived from the free running microsecond timer, tickWrite()
+// only moves this offset
+static uint64_t tickOffsetUs = 0;
+
+static bool tickPowered = false;
 
 static callBackFuncPtr_t tickHookFunction = NULL;
 static void* callBackFuncParams = NULL;
 
+// Set from interrupts that have work for the main loop, so a sleep that was
+// about to start is skipped
+static volatile bool wakeUpRequested = false;
+
+// Called on every wake up request, lets a thread that waits on an RTOS
+// object instead of tickSleepUntil() be woken up too
+static callBackFuncPtr_t wakeUpHookFunction = NULL;
+static void* wakeUpHookParams = NULL;
+
+static uint64_t sleepTimeUs = 0;
+static uint32_t sleepWakeUps = 0;
+static uint64_t sleepStatsStartUs = 0;
+
 //=====[Declarations (prototypes) of private functions]========================
 
 static void tickerCallback( void );
+static void wakeUpCallback( void );
 
 //=====[Implementations of public functions]===================================
 
@@ -76,26 +96,35 @@ bool tickInit( tick_t tickRateMSvalue )
     return true;  
 }
 
-// Enable or disable the peripheral energy and clock
+// Enable or disable the peripheral energy and clock. The periodic Ticker is
+// only needed to call the tick hook, time is kept by the microsecond timer.
 void tickPowerSet( bool power )
 {
-    if( power ) {
-        ticker.attach( tickerCallback, ((float) tickRateMS) / 1000.0 );
+    tickPowered = power;
+    if( power && ( tickHookFunction != NULL ) ) {
+        ticker.attach_us( tickerCallback, tickRateMS * 1000 );
     } else {
         ticker.detach();
     }
 }
 
+// Read the 64 bit microsecond clock, it never wraps
+uint64_t tickReadUs( void )
+{
+    return ticker_read_us( get_us_ticker_data() ) + tickOffsetUs;
+}
+
 // Read Tick Counter
 tick_t tickRead( void )
 {
-    return tickCounter;
+    return tickReadUs() / ( tickRateMS * 1000 );
 }
 
 // Write Tick Counter
 void tickWrite( tick_t ticks )
 {
-    tickCounter = ticks;
+    tickOffsetUs = ticks * tickRateMS * 1000 -
+                   ticker_read_us( get_us_ticker_data() );
 }
 
 // Tick interrupt callback
@@ -114,17 +143,89 @@ bool tickCallbackSet( callBackFuncPtr_t tickCallback, void* tickCallbackParams )
     } else {
         retVal &= false;
     }
+
+    tickPowerSet( tickPowered );
     return retVal;
 }
 
+// Tickless idle: the CPU sleeps until the deadline (in ticks) or until any
+// interrupt. Nothing has to be compensated on wake up since no periodic
+// interrupt keeps the time.
+void tickSleepUntil( tick_t deadline )
+{
+    uint64_t currentUs = tickReadUs();
+    uint64_t deadlineUs = deadline * tickRateMS * 1000;
+    uint64_t sleepUs;
+
+    if ( deadlineUs <= currentUs ) {
+        return;
+    }
+    sleepUs = deadlineUs - currentUs;
+    if ( sleepUs > TICK_SLEEP_MAX_US ) {
+        sleepUs = TICK_SLEEP_MAX_US;
+    }
+
+    core_util_critical_section_enter();
+    if ( wakeUpRequested ) {
+        wakeUpRequested = false;
+        core_util_critical_section_exit();
+        return;
+    }
+    wakeUpTimeout.attach_us( wakeUpCallback, (us_timestamp_t) sleepUs );
+
+    // A pending interrupt ends the sleep at once even inside the critical
+    // section, the handler runs as soon as it is left
+    sleep();
+
+    wakeUpTimeout.detach();
+    core_util_critical_section_exit();
+
+    sleepTimeUs = sleepTimeUs + ( tickReadUs() - currentUs );
+    sleepWakeUps++;
+}
+
+// Called from interrupt handlers that leave work for the main loop
+void tickWakeUpRequest( void )
+{
+    wakeUpRequested = true;
+    if( wakeUpHookFunction != NULL ) {
+        (* wakeUpHookFunction )( wakeUpHookParams );
+    }
+}
+
+void tickWakeUpCallbackSet( callBackFuncPtr_t wakeUpCallback,
+                            void* wakeUpCallbackParams )
+{
+    wakeUpHookFunction = wakeUpCallback;
+    wakeUpHookParams = wakeUpCallbackParams;
+}
+
+// Time slept and number of wake ups since the last reset
+void tickSleepStatsRead( tickSleepStats_t* stats )
+{
+    stats->elapsedMs = ( tickReadUs() - sleepStatsStartUs ) / 1000;
+    stats->sleepTimeUs = sleepTimeUs;
+    stats->wakeUps = sleepWakeUps;
+}
+
+void tickSleepStatsReset( void )
+{
+    sleepStatsStartUs = tickReadUs();
+    sleepTimeUs = 0;
+    sleepWakeUps = 0;
+}
+
 //=====[Implementations of private functions]==================================
 
 static void tickerCallback( void )   // Before SysTick_Handler
 {
-   // Increment Tick counters
-   tickCounter++;
    // Execute Tick Hook function if pointer is not NULL
    if( (tickHookFunction != NULL) ) {
       (* tickHookFunction )( callBackFuncParams );
    }
+}
+
+static void wakeUpCallback( void )
+{
+   // Only ends the sleep
 }
\ No newline at end of file
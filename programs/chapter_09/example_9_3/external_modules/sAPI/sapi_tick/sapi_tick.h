@@ -43,11 +43,22 @@
 
 #include <sapi_datatypes.h>
 
+//=====[Declaration of public data types]======================================
+
+typedef struct{
+   tick_t elapsedMs;
+   uint64_t sleepTimeUs;
+   uint32_t wakeUps;
+} tickSleepStats_t;
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 // Tick Initialization and rate configuration from 1 to 1000 ms
 bool tickInit( tick_t tickRateMSvalue );
 
+// Read the 64 bit monotonic microsecond clock
+uint64_t tickReadUs( void );
+
 // Read Tick Counter
 tick_t tickRead( void );
 
@@ -60,6 +71,20 @@ bool tickCallbackSet( callBackFuncPtr_t tickCallback, void* tickCallbackParams )
 // Enable or disable the peripheral energy and clock
 void tickPowerSet( bool power );
 
+// Sleep until the deadline tick or until an interrupt, whatever comes first
+void tickSleepUntil( tick_t deadline );
+
+// Skip the next sleep, safe to call from interrupt handlers
+void tickWakeUpRequest( void );
+
+// Called from tickWakeUpRequest(), in interrupt context
+void tickWakeUpCallbackSet( callBackFuncPtr_t wakeUpCallback,
+                            void* wakeUpCallbackParams );
+
+// Sleep statistics since the last reset
+void tickSleepStatsRead( tickSleepStats_t* stats );
+void tickSleepStatsReset( void );
+
 //=====[#include guards - end]=================================================
 
 #endif
\ No newline at end of file
@@ -0,0 +1,294 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "smart_home_system.h"
+#include "siren.h"
+
+#include "host_benchmark.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define DISPLAY_BENCHMARK_SD_CARD_DIR      "display_benchmark_sd"
+
+#define DISPLAY_BENCHMARK_REPORT_US        5000000ULL
+#define DISPLAY_BENCHMARK_ALARM_US         20000000ULL
+#define DISPLAY_BENCHMARK_QUICK_ALARM_US   2000000ULL
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct displayBenchmarkPhase {
+    const char* name;
+    uint64_t maxIterationUs;
+    uint64_t maxSpiUs;
+} displayBenchmarkPhase_t;
+
+//=====[Declaration of external public global variables]=======================
+
+// Defined in GLCD_fire_alarm.h, which user_interface.cpp includes
+extern uint8_t GLCD_fire_alarm_0[];
+
+//=====[Declaration and initialization of private global objects]==============
+
+// The bus of the display, the host SPI takes the time of each word
+static SPI blockingSpi( SPI_MOSI, SPI_MISO, SPI_SCK );
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static uint64_t blockingDisplayInit();
+static uint64_t blockingReportStateInit();
+static uint64_t blockingAlarmStateInit();
+static uint64_t blockingBitmapWrite( const uint8_t* bitmap );
+static void blockingModeWrite( bool graphic );
+static void blockingCommandWrite( uint8_t command );
+static void blockingDataWrite( uint8_t data );
+static void blockingStringWrite( const char* str );
+static void displayBenchmarkPhaseRun( displayBenchmarkPhase_t* phase,
+                                      uint64_t us );
+static void displayBenchmarkDirectoryClear( const std::string& path );
+
+//=====[Main function, the program entry point]================================
+
+// The longest time the main loop is held by the display. Before, with the
+// blocking driver of the first firmware replayed on the host SPI: each call
+// of the display task, timed on its own. After, with the whole system: the
+// longest loop iteration, without its sleep, and the longest time on the
+// display SPI in one iteration, while the system boots, shows the report
+// screen and then the alarm animation. The loop also waits on the blocking
+// UART writes of the other modules, the SPI time is that of the display
+// alone. All times are simulated.
+int main( int argc, char* argv[] )
+{
+    uint64_t alarmUs = hostBenchmarkQuickRead( argc, argv ) ?
+                       DISPLAY_BENCHMARK_QUICK_ALARM_US :
+                       DISPLAY_BENCHMARK_ALARM_US;
+    displayBenchmarkPhase_t boot = { "Boot", 0, 0 };
+    displayBenchmarkPhase_t report = { "Report screen", 0, 0 };
+    displayBenchmarkPhase_t alarm = { "Alarm animation", 0, 0 };
+    uint64_t initUs;
+    uint64_t reportUs;
+    uint64_t alarmInitUs;
+    uint64_t frameUs;
+
+    blockingSpi.format( 8, 3 );
+    blockingSpi.frequency( 1000000 );
+    initUs = blockingDisplayInit() + blockingReportStateInit();
+    reportUs = blockingReportStateInit();
+    alarmInitUs = blockingAlarmStateInit();
+    frameUs = blockingBitmapWrite( GLCD_fire_alarm_0 );
+
+    printf( "Blocking driver, display task call:        Loop stall ms\n" );
+    printf( "  Boot, init and report screen             %13.1f\n",
+            initUs / 1000.0 );
+    printf( "  Back to the report screen                %13.1f\n",
+            reportUs / 1000.0 );
+    printf( "  Into the alarm screen                    %13.1f\n",
+            alarmInitUs / 1000.0 );
+    printf( "  Each alarm frame                         %13.1f\n",
+            frameUs / 1000.0 );
+
+    displayBenchmarkDirectoryClear( DISPLAY_BENCHMARK_SD_CARD_DIR );
+    mkdir( DISPLAY_BENCHMARK_SD_CARD_DIR, 0777 );
+    hostSdCardDirectorySet( DISPLAY_BENCHMARK_SD_CARD_DIR );
+
+    smartHomeSystemInit();
+    displayBenchmarkPhaseRun( &boot, 1000000 );
+    displayBenchmarkPhaseRun( &report, DISPLAY_BENCHMARK_REPORT_US );
+    // Gas, the siren goes on and the display task starts the animation
+    hostPinWrite( D2, 1 );
+    displayBenchmarkPhaseRun( &alarm, alarmUs );
+
+    printf( "Queued driver, whole system:   Longest loop ms  "
+            "Longest SPI ms\n" );
+    printf( "  %-16s              %15.1f  %14.1f\n", boot.name,
+            boot.maxIterationUs / 1000.0, boot.maxSpiUs / 1000.0 );
+    printf( "  %-16s              %15.1f  %14.1f\n", report.name,
+            report.maxIterationUs / 1000.0, report.maxSpiUs / 1000.0 );
+    printf( "  %-16s              %15.1f  %14.1f\n", alarm.name,
+            alarm.maxIterationUs / 1000.0, alarm.maxSpiUs / 1000.0 );
+
+    return sirenStateRead() ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+// displayInit() of the first firmware, its delay() calls waited as long as
+// they asked for
+static uint64_t blockingDisplayInit()
+{
+    uint64_t startUs = hostClockUsRead();
+
+    wait_us( 10000 );
+    wait_us( 50000 );
+    blockingCommandWrite( 0x30 );
+    wait_us( 110 );
+    blockingCommandWrite( 0x30 );
+    wait_us( 40 );
+    blockingCommandWrite( 0x08 );
+    wait_us( 110 );
+    blockingCommandWrite( 0x01 );
+    wait_us( 12000 );
+    blockingCommandWrite( 0x06 );
+    wait_us( 1000 );
+    blockingCommandWrite( 0x0C );
+    wait_us( 3000 );
+    blockingCommandWrite( 0x02 );
+    wait_us( 3000 );
+    return hostClockUsRead() - startUs;
+}
+
+// userInterfaceDisplayReportStateInit() and its first update, with the
+// delay(2) after the clear
+static uint64_t blockingReportStateInit()
+{
+    uint64_t startUs = hostClockUsRead();
+
+    blockingModeWrite( false );
+    blockingCommandWrite( 0x01 );
+    wait_us( 2000 );
+    blockingCommandWrite( 0x80 );
+    blockingStringWrite( "Temperature:" );
+    blockingCommandWrite( 0x90 );
+    blockingStringWrite( "Gas:" );
+    blockingCommandWrite( 0x88 );
+    blockingStringWrite( "Alarm:" );
+    blockingCommandWrite( 0x86 );
+    blockingStringWrite( "25" );
+    blockingCommandWrite( 0x87 );
+    blockingStringWrite( "'C" );
+    blockingCommandWrite( 0x92 );
+    blockingStringWrite( "Not Detected" );
+    blockingCommandWrite( 0x8B );
+    blockingStringWrite( "OFF" );
+    return hostClockUsRead() - startUs;
+}
+
+// The last report update and userInterfaceDisplayAlarmStateInit()
+static uint64_t blockingAlarmStateInit()
+{
+    uint64_t startUs = hostClockUsRead();
+
+    blockingCommandWrite( 0x92 );
+    blockingStringWrite( "Detected    " );
+    blockingCommandWrite( 0x8B );
+    blockingStringWrite( "OFF" );
+    blockingCommandWrite( 0x01 );
+    wait_us( 2000 );
+    blockingModeWrite( true );
+    return hostClockUsRead() - startUs;
+}
+
+// Every word of the screen with its coordinates, as displayBitmapWrite() of
+// the first firmware
+static uint64_t blockingBitmapWrite( const uint8_t* bitmap )
+{
+    uint64_t startUs = hostClockUsRead();
+    uint8_t x, y;
+
+    for ( y = 0; y < 64; y++ ) {
+        for ( x = 0; x < 8; x++ ) {
+            if ( y < 32 ) {
+                blockingCommandWrite( 0x80 | y );
+                blockingCommandWrite( 0x80 | x );
+            } else {
+                blockingCommandWrite( 0x80 | ( y - 32 ) );
+                blockingCommandWrite( 0x88 | x );
+            }
+            blockingDataWrite( bitmap[2 * x + 16 * y] );
+            blockingDataWrite( bitmap[2 * x + 1 + 16 * y] );
+        }
+    }
+    return hostClockUsRead() - startUs;
+}
+
+static void blockingModeWrite( bool graphic )
+{
+    blockingCommandWrite( 0x30 );
+    wait_us( 1000 );
+    if ( graphic ) {
+        blockingCommandWrite( 0x34 );
+        wait_us( 1000 );
+        blockingCommandWrite( 0x36 );
+        wait_us( 1000 );
+    }
+}
+
+static void blockingCommandWrite( uint8_t command )
+{
+    blockingSpi.write( 0xf8 );
+    blockingSpi.write( command & 0xf0 );
+    blockingSpi.write( ( command << 4 ) & 0xf0 );
+}
+
+static void blockingDataWrite( uint8_t data )
+{
+    blockingSpi.write( 0xf8 + ( 1 << 1 ) );
+    blockingSpi.write( data & 0xf0 );
+    blockingSpi.write( ( data << 4 ) & 0xf0 );
+}
+
+static void blockingStringWrite( const char* str )
+{
+    while ( *str != '\0' ) {
+        blockingDataWrite( *str++ );
+    }
+}
+
+static void displayBenchmarkPhaseRun( displayBenchmarkPhase_t* phase,
+                                      uint64_t us )
+{
+    tickSleepStats_t sleepStats;
+    uint64_t endUs = hostClockUsRead() + us;
+    uint64_t sleepUs;
+    uint64_t spiUs;
+    uint64_t iterationUs;
+
+    while ( hostClockUsRead() < endUs ) {
+        tickSleepStatsRead( &sleepStats );
+        sleepUs = sleepStats.sleepTimeUs;
+        spiUs = hostSpiBusyUsRead();
+        iterationUs = hostClockUsRead();
+        smartHomeSystemUpdate();
+        tickSleepStatsRead( &sleepStats );
+        iterationUs = hostClockUsRead() - iterationUs -
+                      ( sleepStats.sleepTimeUs - sleepUs );
+        spiUs = hostSpiBusyUsRead() - spiUs;
+        if ( iterationUs > phase->maxIterationUs ) {
+            phase->maxIterationUs = iterationUs;
+        }
+        if ( spiUs > phase->maxSpiUs ) {
+            phase->maxSpiUs = spiUs;
+        }
+    }
+}
+
+// The directory belongs to the benchmark, the files and the directories of
+// the previous run are removed
+static void displayBenchmarkDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            displayBenchmarkDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
@@ -0,0 +1,120 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "event_log.h"
+#include "ring_buffer.h"
+
+#include "host_benchmark.h"
+
+//=====[Declaration of private defines]========================================
+
+#define EVENT_LOG_BENCHMARK_READS          10000000
+#define EVENT_LOG_BENCHMARK_QUICK_READS    100000
+
+//=====[Declaration of private data types]=====================================
+
+// The stored event of the first firmware, the text was built when the event
+// was written and kept in RAM. time_t is 64 bit on the board as on the host.
+typedef struct textEvent {
+    time_t seconds;
+    char typeOfEvent[EVENT_LOG_NAME_MAX_LENGTH];
+} textEvent_t;
+
+// The stored event now, as systemEvent_t in event_log.cpp
+typedef MBED_PACKED(struct) packedEvent {
+    uint32_t seconds;
+    uint8_t elementId;
+    uint8_t flags;
+} packedEvent_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static RingBuffer<textEvent_t, EVENT_LOG_MAX_STORAGE> textEvents;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void textEventRead( int index, char* str );
+
+//=====[Main function, the program entry point]================================
+
+// The RAM of the stored events and the CPU time of eventLogRead() with the
+// name kept in each event, as the first firmware did, and with the packed
+// records that only get their name when read. Both logs hold the same
+// events and format them the same way, ctime() is most of the read.
+int main( int argc, char* argv[] )
+{
+    int reads = hostBenchmarkQuickRead( argc, argv ) ?
+                EVENT_LOG_BENCHMARK_QUICK_READS : EVENT_LOG_BENCHMARK_READS;
+    char str[EVENT_STR_LENGTH];
+    char name[EVENT_LOG_NAME_MAX_LENGTH];
+    hostBenchmarkTime_t start;
+    textEvent_t event;
+    size_t textBytes = sizeof(textEvent_t) * EVENT_LOG_MAX_STORAGE;
+    size_t packedBytes = sizeof(packedEvent_t) * EVENT_LOG_MAX_STORAGE;
+    double textNs;
+    double packedNs;
+    int i;
+
+    set_time( 1780000000 );
+    for ( i = 0; i < EVENT_LOG_MAX_STORAGE; i++ ) {
+        eventLogWrite( i % 2, (eventLogElement_t)
+                              ( i % EVENT_LOG_NUMBER_OF_ELEMENTS ) );
+        event.seconds = time( NULL );
+        eventLogEventNameToString( i % EVENT_LOG_NUMBER_OF_ELEMENTS, i % 2,
+                                   event.typeOfEvent );
+        textEvents.push( event );
+    }
+
+    printf( "Stored events, %d of them:\n", EVENT_LOG_MAX_STORAGE );
+    printf( "  Text:    %2zu bytes per event, %5zu bytes\n",
+            sizeof(textEvent_t), textBytes );
+    printf( "  Packed:  %2zu bytes per event, %5zu bytes, %zu bytes saved, "
+            "%zu events in the same RAM\n",
+            sizeof(packedEvent_t), packedBytes, textBytes - packedBytes,
+            textBytes / sizeof(packedEvent_t) );
+
+    start = hostBenchmarkNow();
+    for ( i = 0; i < reads; i++ ) {
+        textEventRead( i % EVENT_LOG_MAX_STORAGE, str );
+        hostBenchmarkKeep( str );
+    }
+    textNs = hostBenchmarkSecondsSince( start ) * 1e9 / reads;
+
+    start = hostBenchmarkNow();
+    for ( i = 0; i < reads; i++ ) {
+        eventLogRead( i % EVENT_LOG_MAX_STORAGE, str );
+        hostBenchmarkKeep( str );
+    }
+    packedNs = hostBenchmarkSecondsSince( start ) * 1e9 / reads;
+
+    printf( "eventLogRead(), %d reads:\n", reads );
+    printf( "  Text:    %7.1f ns per read\n", textNs );
+    printf( "  Packed:  %7.1f ns per read, %+.1f ns to build the name\n",
+            packedNs, packedNs - textNs );
+
+    start = hostBenchmarkNow();
+    for ( i = 0; i < reads; i++ ) {
+        eventLogEventNameToString( i % EVENT_LOG_NUMBER_OF_ELEMENTS, i % 2,
+                                   name );
+        hostBenchmarkKeep( name );
+    }
+    printf( "  Name alone: %4.1f ns per read\n",
+            hostBenchmarkSecondsSince( start ) * 1e9 / reads );
+
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+// eventLogRead() of the first firmware, with the name kept in the event, and
+// the formatting of eventLogEventToString()
+static void textEventRead( int index, char* str )
+{
+    const textEvent_t& event = textEvents[index];
+    time_t seconds = event.seconds;
+
+    snprintf( str, EVENT_STR_LENGTH, "Event = %s\r\nDate and Time = %s\r\n",
+              event.typeOfEvent, ctime(&seconds) );
+}
@@ -0,0 +1,226 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "event_journal.h"
+#include "event_store.h"
+#include "event_log.h"
+#include "sd_card.h"
+#include "date_and_time.h"
+
+#include "SDBlockDevice.h"
+#include "SlicingBlockDevice.h"
+
+#include "host_benchmark.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+//=====[Declaration of private defines]========================================
+
+#define EVENT_STORE_BENCHMARK_FLUSHES          2000
+#define EVENT_STORE_BENCHMARK_QUICK_FLUSHES    20
+
+// As MBED_CONF_APP_EVENT_STORE_RAW_SIZE of the raw store configuration
+#define EVENT_STORE_BENCHMARK_RAW_SIZE         ( 8 * 1024 * 1024 )
+
+#define EVENT_STORE_BENCHMARK_SD_CARD_DIR      "event_store_benchmark_sd"
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    EVENT_STORE_BENCHMARK_FAT,
+    EVENT_STORE_BENCHMARK_RAW,
+} eventStoreBenchmarkPath_t;
+
+//=====[Declaration of external public global variables]=======================
+
+extern SDBlockDevice sd;
+
+//=====[Declaration and initialization of private global variables]============
+
+// One event per flush, the flush of event_log once 32 are pending and all
+// the events the log can hold
+static const int eventStoreBenchmarkPendingEvents[] = { 1, 32, 100 };
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool eventStoreBenchmarkRun( eventStoreBenchmarkPath_t path,
+                                    int pendingEvents, int flushes );
+static bool eventStoreBenchmarkFatFlush();
+static bool eventStoreBenchmarkRawFlush();
+static void eventStoreBenchmarkDirectoryClear( const std::string& path );
+
+//=====[Main function, the program entry point]================================
+
+// The same stream of events written back to back through the FAT journal
+// and through the raw event store, which programs sectors of the last
+// EVENT_STORE_BENCHMARK_RAW_SIZE bytes of the card straight through
+// SDBlockDevice. The events per second are the sustained rate of each path,
+// the latency is that of each flush. Every run has its own process and an
+// empty card, all times are simulated and come from the host card timing.
+int main( int argc, char* argv[] )
+{
+    int flushes = hostBenchmarkQuickRead( argc, argv ) ?
+                  EVENT_STORE_BENCHMARK_QUICK_FLUSHES :
+                  EVENT_STORE_BENCHMARK_FLUSHES;
+    eventStoreBenchmarkPath_t path;
+    pid_t child;
+    int status;
+    int failures = 0;
+    int i;
+
+    printf( "%d flushes of each size, back to back:\n", flushes );
+    printf( "  Path  Pending  Events/s  Flush ms p50 / p99 / max\n" );
+    fflush( stdout );
+
+    for ( i = 0; i < (int)( sizeof(eventStoreBenchmarkPendingEvents) /
+                            sizeof(eventStoreBenchmarkPendingEvents[0]) );
+          i++ ) {
+        for ( path = EVENT_STORE_BENCHMARK_FAT; ;
+              path = EVENT_STORE_BENCHMARK_RAW ) {
+            child = fork();
+            if ( child == 0 ) {
+                status = eventStoreBenchmarkRun( path,
+                             eventStoreBenchmarkPendingEvents[i],
+                             flushes ) ? 0 : 1;
+                fflush( stdout );
+                _exit( status );
+            }
+            if ( ( child < 0 ) || ( waitpid( child, &status, 0 ) != child ) ||
+                 !WIFEXITED( status ) || ( WEXITSTATUS( status ) != 0 ) ) {
+                printf( "  Run failed\n" );
+                failures++;
+            }
+            if ( path == EVENT_STORE_BENCHMARK_RAW ) {
+                break;
+            }
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+// The events are one second apart, so the FAT journal also goes through
+// its part and day changes
+static bool eventStoreBenchmarkRun( eventStoreBenchmarkPath_t path,
+                                    int pendingEvents, int flushes )
+{
+    static SlicingBlockDevice rawPartition( &sd,
+                                            -EVENT_STORE_BENCHMARK_RAW_SIZE );
+    std::vector<uint64_t> flushUs;
+    uint32_t seconds = (uint32_t) dateAndTimeToSeconds( 2026, 6, 1,
+                                                        0, 0, 0 );
+    uint32_t sequence = 0;
+    uint64_t startUs;
+    uint64_t totalUs = 0;
+    int flush;
+    int i;
+
+    eventStoreBenchmarkDirectoryClear( EVENT_STORE_BENCHMARK_SD_CARD_DIR );
+    unlink( EVENT_STORE_BENCHMARK_SD_CARD_DIR ".img" );
+    hostSdCardDirectorySet( EVENT_STORE_BENCHMARK_SD_CARD_DIR );
+    set_time( seconds );
+    if ( !sdCardInit() ) {
+        return false;
+    }
+    if ( ( path == EVENT_STORE_BENCHMARK_RAW ) &&
+         ( ( rawPartition.init() != 0 ) ||
+           !eventStoreInit( &rawPartition ) ) ) {
+        return false;
+    }
+
+    for ( flush = 0; flush < flushes; flush++ ) {
+        eventJournalBufferReset();
+        for ( i = 0; i < pendingEvents; i++ ) {
+            eventJournalBufferAppend( sequence, seconds,
+                                      sequence % EVENT_LOG_NUMBER_OF_ELEMENTS,
+                                      sequence % 2 );
+            sequence++;
+            seconds++;
+        }
+
+        startUs = hostClockUsRead();
+        if ( !( path == EVENT_STORE_BENCHMARK_FAT ?
+                eventStoreBenchmarkFatFlush() :
+                eventStoreBenchmarkRawFlush() ) ) {
+            return false;
+        }
+        flushUs.push_back( hostClockUsRead() - startUs );
+        totalUs = totalUs + flushUs.back();
+    }
+
+    std::sort( flushUs.begin(), flushUs.end() );
+    printf( "  %-4s  %7d  %8.0f  %8.1f / %5.1f / %5.1f\n",
+            path == EVENT_STORE_BENCHMARK_FAT ? "FAT" : "Raw", pendingEvents,
+            totalUs > 0 ? (double) sequence * 1e6 / totalUs : 0.0,
+            flushUs[flushUs.size() / 2] / 1000.0,
+            flushUs[flushUs.size() * 99 / 100] / 1000.0,
+            flushUs.back() / 1000.0 );
+    return true;
+}
+
+static bool eventStoreBenchmarkFatFlush()
+{
+    eventJournalFlushStatus_t status;
+
+    if ( !eventJournalFlushStart() ) {
+        return false;
+    }
+    do {
+        status = eventJournalFlushStep();
+    } while ( status == EVENT_JOURNAL_FLUSH_IN_PROGRESS );
+    return status == EVENT_JOURNAL_FLUSH_COMPLETE;
+}
+
+// As the raw store flush of the journal, one sector of records at a time
+static bool eventStoreBenchmarkRawFlush()
+{
+    int numberOfRecords = eventJournalBufferNumberOfRecords();
+    int firstRecord;
+    int sectorRecords;
+
+    for ( firstRecord = 0; firstRecord < numberOfRecords;
+          firstRecord = firstRecord + sectorRecords ) {
+        sectorRecords = numberOfRecords - firstRecord;
+        if ( sectorRecords > (int) EVENT_STORE_RECORDS_PER_SECTOR ) {
+            sectorRecords = EVENT_STORE_RECORDS_PER_SECTOR;
+        }
+        if ( !eventStoreSectorAppend(
+                 eventJournalBufferRecordRead( firstRecord ),
+                 sectorRecords ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The directory belongs to the benchmark, the files and the directories of
+// the previous run are removed
+static void eventStoreBenchmarkDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            eventStoreBenchmarkDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
@@ -0,0 +1,44 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _HOST_BENCHMARK_H_
+#define _HOST_BENCHMARK_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+#include <string.h>
+
+#include <chrono>
+
+//=====[Declaration of public data types]======================================
+
+typedef std::chrono::steady_clock::time_point hostBenchmarkTime_t;
+
+//=====[Implementations of public functions]===================================
+
+static inline hostBenchmarkTime_t hostBenchmarkNow()
+{
+    return std::chrono::steady_clock::now();
+}
+
+static inline double hostBenchmarkSecondsSince( hostBenchmarkTime_t start )
+{
+    return std::chrono::duration<double>( hostBenchmarkNow() - start ).count();
+}
+
+// ctest runs the benchmarks with --quick, only to keep them working
+static inline bool hostBenchmarkQuickRead( int argc, char* argv[] )
+{
+    return ( argc > 1 ) && ( strcmp( argv[1], "--quick" ) == 0 );
+}
+
+// Keeps the compiler from dropping a result that is not used otherwise
+template <typename T>
+static inline void hostBenchmarkKeep( const T& value )
+{
+    asm volatile( "" : : "g"( &value ) : "memory" );
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _HOST_BENCHMARK_H_
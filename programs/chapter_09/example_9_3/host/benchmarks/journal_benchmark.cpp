@@ -0,0 +1,240 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "event_journal.h"
+#include "event_log.h"
+#include "sd_card.h"
+#include "date_and_time.h"
+
+#include "host_benchmark.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define JOURNAL_BENCHMARK_FLUSHES          100
+#define JOURNAL_BENCHMARK_QUICK_FLUSHES    3
+
+// As the event_log flush age, so every flush of the per event path gets a
+// file of its own as it did
+#define JOURNAL_BENCHMARK_FLUSH_PERIOD_US  60000000ULL
+
+#define JOURNAL_BENCHMARK_SD_CARD_DIR      "journal_benchmark_sd"
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct journalBenchmarkStats {
+    uint32_t events;
+    uint32_t errors;
+    uint64_t flushUs;
+    uint64_t maxFlushUs;
+    uint64_t maxStepUs;
+} journalBenchmarkStats_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+// Up to EVENT_LOG_MAX_STORAGE, all the events the log can hold
+static const int journalBenchmarkPendingEvents[] = { 1, 10, 32, 100 };
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool journalBenchmarkRun( int pendingEvents, int flushes );
+static void journalBenchmarkPerEventFlush( uint32_t firstSeconds,
+                                           int pendingEvents,
+                                           journalBenchmarkStats_t* stats );
+static void journalBenchmarkJournalFlush( uint32_t firstSeconds,
+                                          int pendingEvents,
+                                          journalBenchmarkStats_t* stats );
+static void journalBenchmarkFlushCount( uint64_t flushUs,
+                                        journalBenchmarkStats_t* stats );
+static void journalBenchmarkDirectoryClear( const std::string& path );
+
+//=====[Main function, the program entry point]================================
+
+// The same pending events flushed to the SD card by the per event path of
+// the first firmware, one open/append/close of a text file per event, and
+// by the journal, one sector aligned write of binary records per flush. Each
+// size runs in its own process on an empty card, all times are simulated
+// and come from the host card timing.
+int main( int argc, char* argv[] )
+{
+    int flushes = hostBenchmarkQuickRead( argc, argv ) ?
+                  JOURNAL_BENCHMARK_QUICK_FLUSHES : JOURNAL_BENCHMARK_FLUSHES;
+    pid_t child;
+    int status;
+    int failures = 0;
+    int i;
+
+    printf( "%d flushes of each size, one every %llu s:\n", flushes,
+            JOURNAL_BENCHMARK_FLUSH_PERIOD_US / 1000000 );
+    printf( "  Pending   Per event: events/s  worst flush ms"
+            "   Journal: events/s  worst flush ms  longest step ms\n" );
+    fflush( stdout );
+
+    for ( i = 0; i < (int)( sizeof(journalBenchmarkPendingEvents) /
+                            sizeof(journalBenchmarkPendingEvents[0]) ); i++ ) {
+        child = fork();
+        if ( child == 0 ) {
+            status = journalBenchmarkRun( journalBenchmarkPendingEvents[i],
+                                          flushes ) ? 0 : 1;
+            fflush( stdout );
+            _exit( status );
+        }
+        if ( ( child < 0 ) || ( waitpid( child, &status, 0 ) != child ) ||
+             !WIFEXITED( status ) || ( WEXITSTATUS( status ) != 0 ) ) {
+            printf( "  Run failed\n" );
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Both paths write to the same card, the per event files go to the root
+// and the journal to its month directory, as on a card that was used by
+// both firmwares
+static bool journalBenchmarkRun( int pendingEvents, int flushes )
+{
+    static journalBenchmarkStats_t perEvent;
+    static journalBenchmarkStats_t journal;
+    uint32_t startSeconds = (uint32_t) dateAndTimeToSeconds( 2026, 6, 1,
+                                                             0, 0, 0 );
+    uint32_t firstSeconds;
+    int flush;
+
+    journalBenchmarkDirectoryClear( JOURNAL_BENCHMARK_SD_CARD_DIR );
+    hostSdCardDirectorySet( JOURNAL_BENCHMARK_SD_CARD_DIR );
+    set_time( startSeconds );
+    if ( !sdCardInit() ) {
+        return false;
+    }
+
+    memset( &perEvent, 0, sizeof(perEvent) );
+    memset( &journal, 0, sizeof(journal) );
+    for ( flush = 0; flush < flushes; flush++ ) {
+        hostClockAdvance( JOURNAL_BENCHMARK_FLUSH_PERIOD_US );
+        firstSeconds = (uint32_t) time( NULL ) - pendingEvents;
+        journalBenchmarkPerEventFlush( firstSeconds, pendingEvents,
+                                       &perEvent );
+        journalBenchmarkJournalFlush( firstSeconds, pendingEvents, &journal );
+    }
+
+    printf( "  %7d  %19.0f  %14.1f  %18.0f  %14.1f  %15.1f",
+            pendingEvents,
+            perEvent.flushUs > 0 ? perEvent.events * 1e6 / perEvent.flushUs :
+                                   0.0,
+            perEvent.maxFlushUs / 1000.0,
+            journal.flushUs > 0 ? journal.events * 1e6 / journal.flushUs :
+                                  0.0,
+            journal.maxFlushUs / 1000.0, journal.maxStepUs / 1000.0 );
+    if ( perEvent.errors + journal.errors > 0 ) {
+        printf( "  %u errors", perEvent.errors + journal.errors );
+    }
+    printf( "\n" );
+    return true;
+}
+
+// eventLogSaveToSdCard() of the first firmware: one text file per flush,
+// named after the flush time, and an open/append/close for each event. The
+// report it printed on the UART for each event is left out.
+static void journalBenchmarkPerEventFlush( uint32_t firstSeconds,
+                                           int pendingEvents,
+                                           journalBenchmarkStats_t* stats )
+{
+    char fileName[SD_CARD_FILENAME_MAX_LENGTH];
+    char eventStr[EVENT_STR_LENGTH];
+    time_t seconds = time( NULL );
+    uint64_t startUs = hostClockUsRead();
+    sdCardFile_t file;
+    int i;
+
+    strftime( fileName, sizeof(fileName), "%Y_%m_%d_%H_%M_%S.txt",
+              localtime( &seconds ) );
+    for ( i = 0; i < pendingEvents; i++ ) {
+        eventLogEventToString( (time_t)( firstSeconds + i ),
+                               i % EVENT_LOG_NUMBER_OF_ELEMENTS, i % 2,
+                               eventStr );
+        if ( !sdCardFileOpen( &file, fileName, "a" ) ) {
+            stats->errors++;
+            continue;
+        }
+        sdCardFileWrite( &file, eventStr, strlen( eventStr ) );
+        sdCardFileClose( &file );
+        stats->events++;
+    }
+    journalBenchmarkFlushCount( hostClockUsRead() - startUs, stats );
+}
+
+static void journalBenchmarkJournalFlush( uint32_t firstSeconds,
+                                          int pendingEvents,
+                                          journalBenchmarkStats_t* stats )
+{
+    static uint32_t sequence = 0;
+    eventJournalFlushStatus_t status = EVENT_JOURNAL_FLUSH_ERROR;
+    uint64_t startUs;
+    uint64_t stepStartUs;
+    int i;
+
+    eventJournalBufferReset();
+    for ( i = 0; i < pendingEvents; i++ ) {
+        eventJournalBufferAppend( sequence, firstSeconds + i,
+                                  i % EVENT_LOG_NUMBER_OF_ELEMENTS, i % 2 );
+        sequence++;
+    }
+
+    startUs = hostClockUsRead();
+    if ( eventJournalFlushStart() ) {
+        do {
+            stepStartUs = hostClockUsRead();
+            status = eventJournalFlushStep();
+            if ( hostClockUsRead() - stepStartUs > stats->maxStepUs ) {
+                stats->maxStepUs = hostClockUsRead() - stepStartUs;
+            }
+        } while ( status == EVENT_JOURNAL_FLUSH_IN_PROGRESS );
+    }
+    if ( status != EVENT_JOURNAL_FLUSH_COMPLETE ) {
+        stats->errors++;
+        return;
+    }
+    stats->events = stats->events + pendingEvents;
+    journalBenchmarkFlushCount( hostClockUsRead() - startUs, stats );
+}
+
+static void journalBenchmarkFlushCount( uint64_t flushUs,
+                                        journalBenchmarkStats_t* stats )
+{
+    stats->flushUs = stats->flushUs + flushUs;
+    if ( flushUs > stats->maxFlushUs ) {
+        stats->maxFlushUs = flushUs;
+    }
+}
+
+// The directory belongs to the benchmark, the files and the directories of
+// the previous run are removed
+static void journalBenchmarkDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            journalBenchmarkDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
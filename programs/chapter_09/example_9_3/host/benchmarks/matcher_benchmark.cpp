@@ -0,0 +1,152 @@
+//=====[Libraries]=============================================================
+
+#include "sapi.h"
+
+#include "host_benchmark.h"
+
+#include <random>
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define MATCHER_BENCHMARK_RESPONSES   9
+
+//=====[Declaration and initialization of private global variables]============
+
+// As wifi_module, in the order of its responses
+static char const* const esp8266Responses[MATCHER_BENCHMARK_RESPONSES] = {
+    "OK", "ERROR", "FAIL", "ready", "+CWJAP:", "STATUS:", "+CIFSR:STAIP,",
+    "+CIPSTATUS:", "+IPD,",
+};
+
+// What the module sends while it connects and serves the web page
+static const char* const esp8266Traffic =
+    "AT+CWJAP=\"ssid\",\"password\"\r\nWIFI CONNECTED\r\nWIFI GOT IP\r\n\r\n"
+    "OK\r\nAT+CIFSR\r\n+CIFSR:STAIP,\"192.168.1.7\"\r\n"
+    "+CIFSR:STAMAC,\"5c:cf:7f:00:00:01\"\r\n\r\nOK\r\n"
+    "AT+CIPSTATUS\r\nSTATUS:3\r\n"
+    "+CIPSTATUS:0,\"TCP\",\"192.168.1.20\",50412,80,1\r\n\r\nOK\r\n"
+    "0,CONNECT\r\n\r\n+IPD,0,380:GET / HTTP/1.1\r\nHost: 192.168.1.7\r\n"
+    "Connection: keep-alive\r\nUser-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate\r\nAccept-Language: en-US,en;q=0.9\r\n"
+    "\r\nOK\r\n> \r\nRecv 1024 bytes\r\n\r\nSEND OK\r\n0,CLOSED\r\n";
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static double matcherBenchmark( const std::string& stream );
+static double parserBenchmark( const std::string& stream );
+static double naiveBenchmark( const std::string& stream );
+
+//=====[Main function, the program entry point]================================
+
+// The matcher against one sAPI parser per response, as wifi_module did
+// before, and against comparing every response at every byte
+int main( int argc, char* argv[] )
+{
+    static const char* const pieces[] = {
+        "O", "OOK", "ERRO", "FAI", "rea", "+CWJA", "STATU", "+CIFSR:STA",
+        "+CIPSTATUS", "+CIPS", "+IPD", "+CI", "\r\n",
+    };
+    size_t bytes = hostBenchmarkQuickRead( argc, argv ) ? 200000 : 20000000;
+    std::mt19937 random( 21 );
+    std::string traffic;
+    std::string adversarial;
+
+    tickInit( 1 );
+    while ( traffic.size() < bytes ) {
+        traffic += esp8266Traffic;
+    }
+    while ( adversarial.size() < bytes ) {
+        adversarial += pieces[random() % ( sizeof( pieces ) /
+                                           sizeof( pieces[0] ) )];
+    }
+
+    printf( "ESP8266 traffic:\n" );
+    printf( "  Matcher:               %8.1f MB/s\n",
+            matcherBenchmark( traffic ) );
+    printf( "  One parser per pattern:%8.1f MB/s\n",
+            parserBenchmark( traffic ) );
+    printf( "  Naive search:          %8.1f MB/s\n",
+            naiveBenchmark( traffic ) );
+    printf( "Near misses only:\n" );
+    printf( "  Matcher:               %8.1f MB/s\n",
+            matcherBenchmark( adversarial ) );
+    printf( "  One parser per pattern:%8.1f MB/s\n",
+            parserBenchmark( adversarial ) );
+    printf( "  Naive search:          %8.1f MB/s\n",
+            naiveBenchmark( adversarial ) );
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static double matcherBenchmark( const std::string& stream )
+{
+    static matcher_t matcher;
+    hostBenchmarkTime_t start;
+    uint32_t matches = 0;
+    size_t i;
+
+    matcherInit( &matcher, esp8266Responses, MATCHER_BENCHMARK_RESPONSES );
+    start = hostBenchmarkNow();
+    for ( i = 0; i < stream.size(); i++ ) {
+        if ( matcherUpdate( &matcher, stream[i] ) != MATCHER_NO_MATCH ) {
+            matches++;
+        }
+    }
+    hostBenchmarkKeep( matches );
+    return stream.size() / hostBenchmarkSecondsSince( start ) / 1e6;
+}
+
+static double parserBenchmark( const std::string& stream )
+{
+    static parser_t parsers[MATCHER_BENCHMARK_RESPONSES];
+    hostBenchmarkTime_t start;
+    uint32_t matches = 0;
+    size_t i;
+    int j;
+
+    for ( j = 0; j < MATCHER_BENCHMARK_RESPONSES; j++ ) {
+        parserInit( &parsers[j], esp8266Responses[j],
+                    strlen( esp8266Responses[j] ), 10000 );
+    }
+    start = hostBenchmarkNow();
+    for ( i = 0; i < stream.size(); i++ ) {
+        for ( j = 0; j < MATCHER_BENCHMARK_RESPONSES; j++ ) {
+            if ( parserUpdate( &parsers[j], stream[i] ) ==
+                 PARSER_PATTERN_MATCH ) {
+                matches++;
+                parserInit( &parsers[j], esp8266Responses[j],
+                            strlen( esp8266Responses[j] ), 10000 );
+            }
+        }
+    }
+    hostBenchmarkKeep( matches );
+    return stream.size() / hostBenchmarkSecondsSince( start ) / 1e6;
+}
+
+static double naiveBenchmark( const std::string& stream )
+{
+    static size_t lengths[MATCHER_BENCHMARK_RESPONSES];
+    hostBenchmarkTime_t start;
+    uint32_t matches = 0;
+    size_t i;
+    int j;
+
+    for ( j = 0; j < MATCHER_BENCHMARK_RESPONSES; j++ ) {
+        lengths[j] = strlen( esp8266Responses[j] );
+    }
+    start = hostBenchmarkNow();
+    for ( i = 1; i <= stream.size(); i++ ) {
+        for ( j = 0; j < MATCHER_BENCHMARK_RESPONSES; j++ ) {
+            if ( lengths[j] <= i &&
+                 memcmp( stream.data() + i - lengths[j], esp8266Responses[j],
+                         lengths[j] ) == 0 ) {
+                matches++;
+            }
+        }
+    }
+    hostBenchmarkKeep( matches );
+    return stream.size() / hostBenchmarkSecondsSince( start ) / 1e6;
+}
@@ -0,0 +1,319 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "event_journal.h"
+#include "sd_card.h"
+#include "date_and_time.h"
+
+#include "host_benchmark.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define RETENTION_BENCHMARK_DAYS              365
+#define RETENTION_BENCHMARK_QUICK_DAYS        3
+#define RETENTION_BENCHMARK_REPORT_DAYS       30
+
+// A flapping input, one event every 2 s all year long, so the journal
+// reaches EVENT_JOURNAL_MAX_TOTAL_SIZE after about three months
+#define RETENTION_BENCHMARK_EVENT_US          2000000ULL
+
+// As event_log
+#define RETENTION_BENCHMARK_FLUSH_EVENTS      32
+#define RETENTION_BENCHMARK_FLUSH_AGE_US      60000000ULL
+#define RETENTION_BENCHMARK_RETENTION_US      3600000000ULL
+
+#define RETENTION_BENCHMARK_DAY_US            86400000000ULL
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct retentionBenchmarkStats {
+    uint32_t flushes;
+    uint32_t flushErrors;
+    uint64_t flushUs;
+    uint64_t maxFlushUs;
+    uint64_t maxFlushStepUs;
+    uint64_t maxRetentionStepUs;
+    uint64_t sdCardBusyUs;
+} retentionBenchmarkStats_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool retentionBenchmarkRun( bool retention, int days );
+static void retentionBenchmarkReport( int day, uint64_t periodUs,
+                                      const retentionBenchmarkStats_t* stats );
+static void retentionBenchmarkDirectoryClear( const std::string& path );
+static uint32_t retentionBenchmarkEventSeconds( uint32_t startSeconds,
+                                                uint32_t event );
+
+//=====[Main function, the program entry point]================================
+
+// A year of events through the SD card journal as event_log writes them,
+// with the hourly retention pass and without it. Each run has its own
+// directory in the working directory and its own process, so the journal
+// state of one does not leak into the other. All times are simulated, the
+// SD card costs come from the host card timing.
+int main( int argc, char* argv[] )
+{
+    int days = hostBenchmarkQuickRead( argc, argv ) ?
+               RETENTION_BENCHMARK_QUICK_DAYS : RETENTION_BENCHMARK_DAYS;
+    bool retention;
+    pid_t child;
+    int status;
+    int failures = 0;
+
+    for ( retention = true; ; retention = false ) {
+        printf( "%s retention, %d days, one event every %llu s:\n",
+                retention ? "With" : "Without", days,
+                RETENTION_BENCHMARK_EVENT_US / 1000000 );
+        printf( "  Day  Files      MiB  Listing ms  Append ms mean/max"
+                "  Longest step ms  SD busy\n" );
+        fflush( stdout );
+        child = fork();
+        if ( child == 0 ) {
+            status = retentionBenchmarkRun( retention, days ) ? 0 : 1;
+            fflush( stdout );
+            _exit( status );
+        }
+        if ( ( child < 0 ) || ( waitpid( child, &status, 0 ) != child ) ||
+             !WIFEXITED( status ) || ( WEXITSTATUS( status ) != 0 ) ) {
+            printf( "  Run failed\n" );
+            failures++;
+        }
+        if ( !retention ) {
+            break;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Mirrors the event_log policy: a flush once RETENTION_BENCHMARK_FLUSH_EVENTS
+// events are pending or the oldest one waited RETENTION_BENCHMARK_FLUSH_AGE_US,
+// a retention pass every hour and its steps only while no flush runs
+static bool retentionBenchmarkRun( bool retention, int days )
+{
+    static retentionBenchmarkStats_t stats;
+    const char* directory = retention ? "retention_benchmark_sd" :
+                                        "retention_benchmark_no_retention_sd";
+    uint32_t startSeconds = (uint32_t) dateAndTimeToSeconds( 2025, 1, 1,
+                                                             0, 0, 0 );
+    eventJournalFlushStatus_t flushStatus;
+    uint64_t startUs;
+    uint64_t endUs;
+    uint64_t nowUs;
+    uint64_t stepStartUs;
+    uint64_t stepUs;
+    uint64_t flushStartUs = 0;
+    uint64_t nextRetentionUs;
+    uint64_t nextReportUs;
+    uint64_t periodStartUs;
+    uint64_t nextEventUs;
+    uint32_t nextEvent = 0;
+    uint32_t pendingEvent = 0;
+    uint32_t flushedEvents = 0;
+    uint32_t event;
+    bool flushing = false;
+    bool retentionRunning = false;
+    int day = 0;
+
+    retentionBenchmarkDirectoryClear( directory );
+    hostSdCardDirectorySet( directory );
+    set_time( startSeconds );
+    if ( !sdCardInit() ) {
+        return false;
+    }
+
+    memset( &stats, 0, sizeof(stats) );
+    stats.sdCardBusyUs = hostSdCardBusyUsRead();
+    startUs = hostClockUsRead();
+    periodStartUs = startUs;
+    endUs = startUs + days * RETENTION_BENCHMARK_DAY_US;
+    nextRetentionUs = startUs;
+    nextReportUs = startUs + RETENTION_BENCHMARK_REPORT_DAYS *
+                             RETENTION_BENCHMARK_DAY_US;
+    if ( nextReportUs > endUs ) {
+        nextReportUs = endUs;
+    }
+
+    while ( true ) {
+        nowUs = hostClockUsRead();
+        while ( startUs + nextEvent * RETENTION_BENCHMARK_EVENT_US <= nowUs ) {
+            nextEvent++;
+        }
+
+        if ( flushing ) {
+            stepStartUs = hostClockUsRead();
+            flushStatus = eventJournalFlushStep();
+            stepUs = hostClockUsRead() - stepStartUs;
+            if ( stepUs > stats.maxFlushStepUs ) {
+                stats.maxFlushStepUs = stepUs;
+            }
+            if ( flushStatus == EVENT_JOURNAL_FLUSH_IN_PROGRESS ) {
+                continue;
+            }
+            flushing = false;
+            if ( flushStatus != EVENT_JOURNAL_FLUSH_COMPLETE ) {
+                stats.flushErrors++;
+                continue;
+            }
+            pendingEvent = pendingEvent + flushedEvents;
+            stepUs = hostClockUsRead() - flushStartUs;
+            stats.flushes++;
+            stats.flushUs = stats.flushUs + stepUs;
+            if ( stepUs > stats.maxFlushUs ) {
+                stats.maxFlushUs = stepUs;
+            }
+        } else if ( ( nextEvent - pendingEvent >=
+                      RETENTION_BENCHMARK_FLUSH_EVENTS ) ||
+                    ( ( nextEvent > pendingEvent ) &&
+                      ( nowUs - ( startUs + pendingEvent *
+                                  RETENTION_BENCHMARK_EVENT_US ) >=
+                        RETENTION_BENCHMARK_FLUSH_AGE_US ) ) ) {
+            eventJournalBufferReset();
+            for ( event = pendingEvent; ( event < nextEvent ) &&
+                  ( event - pendingEvent < RETENTION_BENCHMARK_FLUSH_EVENTS );
+                  event++ ) {
+                if ( !eventJournalBufferAppend( event,
+                         retentionBenchmarkEventSeconds( startSeconds, event ),
+                         event % 5, event % 2 ) ) {
+                    break;
+                }
+            }
+            flushedEvents = event - pendingEvent;
+            flushStartUs = hostClockUsRead();
+            flushing = eventJournalFlushStart();
+            if ( !flushing ) {
+                stats.flushErrors++;
+                pendingEvent = pendingEvent + flushedEvents;
+            }
+        } else if ( retentionRunning ) {
+            stepStartUs = hostClockUsRead();
+            retentionRunning = eventJournalRetentionStep();
+            stepUs = hostClockUsRead() - stepStartUs;
+            if ( stepUs > stats.maxRetentionStepUs ) {
+                stats.maxRetentionStepUs = stepUs;
+            }
+        } else if ( retention && ( nowUs >= nextRetentionUs ) ) {
+            nextRetentionUs = nextRetentionUs + RETENTION_BENCHMARK_RETENTION_US;
+            eventJournalRetentionStart();
+            retentionRunning = true;
+        } else if ( nowUs >= nextReportUs ) {
+            day = (int)( ( nextReportUs - startUs ) /
+                         RETENTION_BENCHMARK_DAY_US );
+            stats.sdCardBusyUs = hostSdCardBusyUsRead() - stats.sdCardBusyUs;
+            retentionBenchmarkReport( day, nowUs - periodStartUs, &stats );
+            if ( nextReportUs >= endUs ) {
+                break;
+            }
+            memset( &stats, 0, sizeof(stats) );
+            stats.sdCardBusyUs = hostSdCardBusyUsRead();
+            periodStartUs = hostClockUsRead();
+            nextReportUs = nextReportUs + RETENTION_BENCHMARK_REPORT_DAYS *
+                                          RETENTION_BENCHMARK_DAY_US;
+            if ( nextReportUs > endUs ) {
+                nextReportUs = endUs;
+            }
+        } else {
+            nextEventUs = startUs + nextEvent * RETENTION_BENCHMARK_EVENT_US;
+            if ( retention && ( nextRetentionUs < nextEventUs ) ) {
+                nextEventUs = nextRetentionUs;
+            }
+            if ( nextReportUs < nextEventUs ) {
+                nextEventUs = nextReportUs;
+            }
+            hostClockAdvance( nextEventUs - nowUs );
+        }
+    }
+
+    printf( "  %u files removed by retention\n",
+            eventJournalRetentionRemovedFilesRead() );
+    return true;
+}
+
+// Lists the root and its directories as a retention pass does, the listing
+// time is the one of a pass that finds nothing to remove
+static void retentionBenchmarkReport( int day, uint64_t periodUs,
+                                      const retentionBenchmarkStats_t* stats )
+{
+    static sdCardDir_t dir;
+    static sdCardDir_t subdir;
+    static sdCardDirEntry_t entry;
+    static sdCardDirEntry_t subdirEntry;
+    uint64_t listingStartUs = hostClockUsRead();
+    uint64_t listingUs;
+    uint64_t bytes = 0;
+    uint32_t files = 0;
+
+    if ( sdCardDirOpen( &dir, "" ) ) {
+        while ( sdCardDirNext( &dir, &entry ) ) {
+            if ( !entry.isDirectory ) {
+                files++;
+                bytes = bytes + entry.size;
+                continue;
+            }
+            if ( !sdCardDirOpen( &subdir, entry.name ) ) {
+                continue;
+            }
+            while ( sdCardDirNext( &subdir, &subdirEntry ) ) {
+                files++;
+                bytes = bytes + subdirEntry.size;
+            }
+            sdCardDirClose( &subdir );
+        }
+        sdCardDirClose( &dir );
+    }
+    listingUs = hostClockUsRead() - listingStartUs;
+
+    printf( "  %3d  %5u  %7.1f  %10.1f  %8.1f / %6.1f  %15.1f  %6.2f%%",
+            day, files, bytes / 1048576.0, listingUs / 1000.0,
+            stats->flushes > 0 ? stats->flushUs / 1000.0 / stats->flushes :
+                                 0.0,
+            stats->maxFlushUs / 1000.0,
+            ( stats->maxFlushStepUs > stats->maxRetentionStepUs ?
+              stats->maxFlushStepUs : stats->maxRetentionStepUs ) / 1000.0,
+            periodUs > 0 ? 100.0 * stats->sdCardBusyUs / periodUs : 0.0 );
+    if ( stats->flushErrors > 0 ) {
+        printf( "  %u flush errors", stats->flushErrors );
+    }
+    printf( "\n" );
+    fflush( stdout );
+}
+
+// The directory belongs to the benchmark, the files and the directories of
+// the previous run are removed
+static void retentionBenchmarkDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            retentionBenchmarkDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
+
+static uint32_t retentionBenchmarkEventSeconds( uint32_t startSeconds,
+                                                uint32_t event )
+{
+    return startSeconds +
+           (uint32_t)( event * RETENTION_BENCHMARK_EVENT_US / 1000000 );
+}
@@ -0,0 +1,97 @@
+//=====[Libraries]=============================================================
+
+#include "ring_buffer.h"
+
+#include "host_benchmark.h"
+
+//=====[Declaration of private defines]========================================
+
+#define RING_BUFFER_BENCHMARK_SIZE   100   // as EVENT_LOG_MAX_STORAGE
+#define SPSC_BENCHMARK_SIZE          256
+
+//=====[Declaration of private data types]=====================================
+
+// The size of an event log entry
+typedef struct benchmarkEvent {
+    uint32_t seconds;
+    uint32_t sequence;
+    uint8_t states[8];
+} benchmarkEvent_t;
+
+//=====[Main function, the program entry point]================================
+
+int main( int argc, char* argv[] )
+{
+    static RingBuffer<benchmarkEvent_t, RING_BUFFER_BENCHMARK_SIZE> events;
+    static SpscRingBuffer<char, SPSC_BENCHMARK_SIZE> bytes;
+    uint64_t items = hostBenchmarkQuickRead( argc, argv ) ? 1000000 :
+                                                            100000000;
+    uint64_t passes = items / RING_BUFFER_BENCHMARK_SIZE;
+    benchmarkEvent_t event = { 0, 0, { 0 } };
+    hostBenchmarkTime_t start;
+    uint32_t sum = 0;
+    uint64_t i;
+    uint32_t position;
+    uint32_t length;
+    const char* data;
+    char c;
+
+    start = hostBenchmarkNow();
+    for ( i = 0; i < items; i++ ) {
+        event.sequence = (uint32_t) i;
+        events.push( event );
+    }
+    printf( "RingBuffer push:              %6.2f ns per item\n",
+            hostBenchmarkSecondsSince( start ) * 1e9 / items );
+
+    start = hostBenchmarkNow();
+    for ( i = 0; i < passes; i++ ) {
+        for ( const benchmarkEvent_t& stored : events ) {
+            sum = sum + stored.sequence;
+        }
+        hostBenchmarkKeep( sum );
+    }
+    printf( "RingBuffer iteration:         %6.2f ns per item\n",
+            hostBenchmarkSecondsSince( start ) * 1e9 /
+            ( passes * RING_BUFFER_BENCHMARK_SIZE ) );
+
+    start = hostBenchmarkNow();
+    for ( i = 0; i < passes; i++ ) {
+        for ( position = 0; position < events.size(); position++ ) {
+            sum = sum + events[position].sequence;
+        }
+        hostBenchmarkKeep( sum );
+    }
+    printf( "RingBuffer indexed read:      %6.2f ns per item\n",
+            hostBenchmarkSecondsSince( start ) * 1e9 /
+            ( passes * RING_BUFFER_BENCHMARK_SIZE ) );
+
+    start = hostBenchmarkNow();
+    for ( i = 0; i < items; i++ ) {
+        bytes.push( (char) i );
+        bytes.pop( c );
+        hostBenchmarkKeep( c );
+    }
+    printf( "SpscRingBuffer push and pop:  %6.2f ns per item\n",
+            hostBenchmarkSecondsSince( start ) * 1e9 / items );
+
+    // Filled and then read in place, as the Wi-Fi module reads its frames
+    start = hostBenchmarkNow();
+    for ( i = 0; i < passes; i++ ) {
+        for ( position = 0; position < RING_BUFFER_BENCHMARK_SIZE; position++ ) {
+            bytes.push( (char) position );
+        }
+        while ( ( length = bytes.contiguousSize() ) > 0 ) {
+            data = bytes.peek();
+            for ( position = 0; position < length; position++ ) {
+                sum = sum + data[position];
+            }
+            bytes.release( length );
+        }
+        hostBenchmarkKeep( sum );
+    }
+    printf( "SpscRingBuffer push and peek: %6.2f ns per item\n",
+            hostBenchmarkSecondsSince( start ) * 1e9 /
+            ( passes * RING_BUFFER_BENCHMARK_SIZE ) );
+    return 0;
+}
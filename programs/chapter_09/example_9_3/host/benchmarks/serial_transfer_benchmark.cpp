@@ -0,0 +1,306 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "smart_home_system.h"
+#include "pc_serial_com.h"
+#include "event_journal.h"
+#include "event_log.h"
+#include "sd_card.h"
+#include "date_and_time.h"
+
+#include "host_benchmark.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define SERIAL_TRANSFER_BENCHMARK_FILE_SIZE          ( 64 * 1024 )
+#define SERIAL_TRANSFER_BENCHMARK_QUICK_FILE_SIZE    ( 4 * 1024 )
+#define SERIAL_TRANSFER_BENCHMARK_EVENTS             1000
+#define SERIAL_TRANSFER_BENCHMARK_QUICK_EVENTS       50
+
+#define SERIAL_TRANSFER_BENCHMARK_SD_CARD_DIR  "serial_transfer_benchmark_sd"
+#define SERIAL_TRANSFER_BENCHMARK_FILE_NAME    "transfer.txt"
+
+// The file starts and ends with them, the query ends with the message
+#define SERIAL_TRANSFER_BENCHMARK_FILE_START   "<start>"
+#define SERIAL_TRANSFER_BENCHMARK_FILE_END     "<end>"
+#define SERIAL_TRANSFER_BENCHMARK_QUERY_END    "Query completed"
+
+#define SERIAL_TRANSFER_BENCHMARK_TIMEOUT_US   600000000ULL
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct serialTransferBenchmarkMatch {
+    const char* pattern;
+    int matched;
+    uint64_t us;
+    uint64_t txBytes;
+} serialTransferBenchmarkMatch_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static serialTransferBenchmarkMatch_t startMatch;
+static serialTransferBenchmarkMatch_t endMatch;
+static uint64_t txBytes = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool serialTransferBenchmarkRun( bool query, int size );
+static void serialTransferBenchmarkFileWrite( int size );
+static bool serialTransferBenchmarkJournalWrite( int events );
+static void serialTransferBenchmarkMatchStart(
+    serialTransferBenchmarkMatch_t* match, const char* pattern );
+static void serialTransferBenchmarkMatchUpdate(
+    serialTransferBenchmarkMatch_t* match, char c );
+static void serialTransferBenchmarkUsbTx( void* context, char c );
+static void serialTransferBenchmarkDirectoryClear( const std::string& path );
+
+//=====[Main function, the program entry point]================================
+
+// The 'o' command showing a text file and the 'q' command printing the
+// events of a day, each run by the whole system on an empty card in its own
+// process. The throughput is that of the bytes on the line, from the first
+// one of the file or the query to its last. Each loop iteration is also
+// timed without its sleep, the longest is how long the transfer held the
+// loop. All times are simulated.
+int main( int argc, char* argv[] )
+{
+    bool quick = hostBenchmarkQuickRead( argc, argv );
+    int fileSize = quick ? SERIAL_TRANSFER_BENCHMARK_QUICK_FILE_SIZE :
+                           SERIAL_TRANSFER_BENCHMARK_FILE_SIZE;
+    int events = quick ? SERIAL_TRANSFER_BENCHMARK_QUICK_EVENTS :
+                         SERIAL_TRANSFER_BENCHMARK_EVENTS;
+    pid_t child;
+    int status;
+    int failures = 0;
+    int i;
+
+    printf( "Line rate: %.2f KB/s\n",
+            PC_SERIAL_COM_BAUD_RATE / 10 / 1024.0 );
+    printf( "  Transfer            Bytes     Time s   KB/s   Of line rate"
+            "   Longest loop ms\n" );
+    fflush( stdout );
+
+    for ( i = 0; i < 2; i++ ) {
+        child = fork();
+        if ( child == 0 ) {
+            status = serialTransferBenchmarkRun( i == 1, i == 1 ? events :
+                                                                  fileSize ) ?
+                     0 : 1;
+            fflush( stdout );
+            _exit( status );
+        }
+        if ( ( child < 0 ) || ( waitpid( child, &status, 0 ) != child ) ||
+             !WIFEXITED( status ) || ( WEXITSTATUS( status ) != 0 ) ) {
+            printf( "  Run failed\n" );
+            failures++;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+//=====[Implementations of private functions]==================================
+
+// size is the bytes of the file or the events of the query
+static bool serialTransferBenchmarkRun( bool query, int size )
+{
+    uint32_t seconds = (uint32_t) dateAndTimeToSeconds( 2026, 6, 1,
+                                                        0, 0, 0 );
+    tickSleepStats_t sleepStats;
+    uint64_t sleepUs;
+    uint64_t iterationUs;
+    uint64_t maxIterationUs = 0;
+    uint64_t startUs;
+    uint64_t endUs;
+    uint64_t bytes;
+    double transferSeconds;
+    const char* command;
+    char name[32];
+    pid_t child;
+    int status;
+
+    serialTransferBenchmarkDirectoryClear(
+        SERIAL_TRANSFER_BENCHMARK_SD_CARD_DIR );
+    mkdir( SERIAL_TRANSFER_BENCHMARK_SD_CARD_DIR, 0777 );
+    hostSdCardDirectorySet( SERIAL_TRANSFER_BENCHMARK_SD_CARD_DIR );
+    set_time( seconds );
+
+    // The journal is written by a process of its own, as by an earlier boot
+    if ( query ) {
+        child = fork();
+        if ( child == 0 ) {
+            _exit( serialTransferBenchmarkJournalWrite( size ) ? 0 : 1 );
+        }
+        if ( ( child < 0 ) || ( waitpid( child, &status, 0 ) != child ) ||
+             !WIFEXITED( status ) || ( WEXITSTATUS( status ) != 0 ) ) {
+            return false;
+        }
+        command = "q2026-06-01 00:00 2026-06-01 23:59\r";
+        serialTransferBenchmarkMatchStart( &startMatch, "Event = " );
+        serialTransferBenchmarkMatchStart( &endMatch,
+            SERIAL_TRANSFER_BENCHMARK_QUERY_END );
+        snprintf( name, sizeof(name), "'q', %d events", size );
+    } else {
+        serialTransferBenchmarkFileWrite( size );
+        command = "o" SERIAL_TRANSFER_BENCHMARK_FILE_NAME "\r";
+        serialTransferBenchmarkMatchStart( &startMatch,
+            SERIAL_TRANSFER_BENCHMARK_FILE_START );
+        serialTransferBenchmarkMatchStart( &endMatch,
+            SERIAL_TRANSFER_BENCHMARK_FILE_END );
+        snprintf( name, sizeof(name), "'o', %d KB file", size / 1024 );
+    }
+
+    hostSerialTxHandlerSet( USBTX, serialTransferBenchmarkUsbTx, NULL );
+    smartHomeSystemInit();
+    startUs = hostClockUsRead() + 1000000;
+    while ( hostClockUsRead() < startUs ) {
+        smartHomeSystemUpdate();
+    }
+
+    hostSerialRxWrite( USBTX, command, strlen( command ) );
+    endUs = startUs + SERIAL_TRANSFER_BENCHMARK_TIMEOUT_US;
+    while ( ( endMatch.us == 0 ) && ( hostClockUsRead() < endUs ) ) {
+        tickSleepStatsRead( &sleepStats );
+        sleepUs = sleepStats.sleepTimeUs;
+        iterationUs = hostClockUsRead();
+        smartHomeSystemUpdate();
+        tickSleepStatsRead( &sleepStats );
+        iterationUs = hostClockUsRead() - iterationUs -
+                      ( sleepStats.sleepTimeUs - sleepUs );
+        if ( ( startMatch.us != 0 ) && ( iterationUs > maxIterationUs ) ) {
+            maxIterationUs = iterationUs;
+        }
+    }
+    if ( ( startMatch.us == 0 ) || ( endMatch.us == 0 ) ) {
+        printf( "  %-16s  did not end\n", name );
+        return false;
+    }
+
+    bytes = endMatch.txBytes - startMatch.txBytes +
+            strlen( startMatch.pattern );
+    transferSeconds = ( endMatch.us - startMatch.us ) / 1e6;
+    printf( "  %-16s  %7llu  %9.3f  %5.2f  %12.0f%%  %16.1f\n", name,
+            (unsigned long long) bytes, transferSeconds,
+            bytes / 1024.0 / transferSeconds,
+            100.0 * bytes * 10 / PC_SERIAL_COM_BAUD_RATE / transferSeconds,
+            maxIterationUs / 1000.0 );
+    return true;
+}
+
+// Lines of text, as a text export
+static void serialTransferBenchmarkFileWrite( int size )
+{
+    std::string path = std::string( SERIAL_TRANSFER_BENCHMARK_SD_CARD_DIR ) +
+                       "/" + SERIAL_TRANSFER_BENCHMARK_FILE_NAME;
+    FILE* file = fopen( path.c_str(), "wb" );
+    int endSize = size - strlen( SERIAL_TRANSFER_BENCHMARK_FILE_END ) - 64;
+    int written;
+    int line = 0;
+
+    if ( file == NULL ) {
+        return;
+    }
+    written = fprintf( file, SERIAL_TRANSFER_BENCHMARK_FILE_START );
+    while ( written < endSize ) {
+        written = written + fprintf( file, "Line %6d of the transfer "
+                                           "benchmark file\r\n", line++ );
+    }
+    fprintf( file, SERIAL_TRANSFER_BENCHMARK_FILE_END );
+    fclose( file );
+}
+
+// One event every 10 s from midnight
+static bool serialTransferBenchmarkJournalWrite( int events )
+{
+    uint32_t seconds = (uint32_t) dateAndTimeToSeconds( 2026, 6, 1,
+                                                        0, 0, 0 );
+    int i;
+
+    if ( !sdCardInit() ) {
+        return false;
+    }
+    eventJournalBufferReset();
+    for ( i = 0; i < events; i++ ) {
+        eventJournalBufferAppend( i, seconds + i * 10,
+                                  i % EVENT_LOG_NUMBER_OF_ELEMENTS, i % 2 );
+        if ( ( eventJournalBufferNumberOfRecords() <
+               EVENT_LOG_MAX_STORAGE ) && ( i + 1 < events ) ) {
+            continue;
+        }
+        if ( !eventJournalFlushStart() ) {
+            return false;
+        }
+        while ( eventJournalFlushStep() == EVENT_JOURNAL_FLUSH_IN_PROGRESS ) {
+        }
+        eventJournalBufferReset();
+    }
+    return true;
+}
+
+static void serialTransferBenchmarkMatchStart(
+    serialTransferBenchmarkMatch_t* match, const char* pattern )
+{
+    match->pattern = pattern;
+    match->matched = 0;
+    match->us = 0;
+    match->txBytes = 0;
+}
+
+// Keeps the time and the byte count of the first full match
+static void serialTransferBenchmarkMatchUpdate(
+    serialTransferBenchmarkMatch_t* match, char c )
+{
+    if ( match->us != 0 ) {
+        return;
+    }
+    if ( c == match->pattern[match->matched] ) {
+        match->matched++;
+    } else {
+        match->matched = ( c == match->pattern[0] ) ? 1 : 0;
+    }
+    if ( match->pattern[match->matched] == '\0' ) {
+        match->us = hostClockUsRead();
+        match->txBytes = txBytes;
+    }
+}
+
+static void serialTransferBenchmarkUsbTx( void* context, char c )
+{
+    txBytes++;
+    serialTransferBenchmarkMatchUpdate( &startMatch, c );
+    if ( startMatch.us != 0 ) {
+        serialTransferBenchmarkMatchUpdate( &endMatch, c );
+    }
+}
+
+// The directory belongs to the benchmark, the files and the directories of
+// the previous run are removed
+static void serialTransferBenchmarkDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            serialTransferBenchmarkDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
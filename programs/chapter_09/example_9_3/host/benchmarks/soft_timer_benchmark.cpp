@@ -0,0 +1,219 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "host_benchmark.h"
+
+//=====[Declaration of private defines]========================================
+
+#define SOFT_TIMER_BENCHMARK_MAX_TIMERS   1000
+
+//=====[Declaration of private data types]=====================================
+
+// The sAPI delay before the wheel, every read compares against the tick
+typedef struct polledDelay {
+    tick_t startTime;
+    tick_t duration;
+    bool running;
+} polledDelay_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static polledDelay_t polledDelays[SOFT_TIMER_BENCHMARK_MAX_TIMERS];
+static delay_t delays[SOFT_TIMER_BENCHMARK_MAX_TIMERS];
+static softTimer_t timers[SOFT_TIMER_BENCHMARK_MAX_TIMERS];
+static tick_t periods[SOFT_TIMER_BENCHMARK_MAX_TIMERS];
+static uint32_t expiries = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool polledDelayRead( polledDelay_t* delay );
+static void softTimerBenchmarkCallback( void* params );
+static double clockBenchmark( tick_t ticks );
+static double polledDelayBenchmark( int count, tick_t ticks );
+static double delayBenchmark( int count, tick_t ticks );
+static double softTimerBenchmark( int count, tick_t ticks );
+static double softTimerTicklessBenchmark( int count, tick_t ticks,
+                                          uint32_t* wakeUps );
+
+//=====[Main function, the program entry point]================================
+
+// The periods are spread from 10 ms to 1 s, as the parser timeouts, the
+// Wi-Fi retries and the periodic tasks. The polled rows check every delay on
+// every tick, the wheel rows only touch the timers that expire.
+int main( int argc, char* argv[] )
+{
+    static const int counts[] = { 10, 100, 1000 };
+    tick_t ticks = hostBenchmarkQuickRead( argc, argv ) ? 10000 : 200000;
+    double clockNs;
+    double nanoseconds;
+    uint32_t wakeUps;
+    int i;
+
+    tickInit( 1 );
+    for ( i = 0; i < SOFT_TIMER_BENCHMARK_MAX_TIMERS; i++ ) {
+        periods[i] = 10 + ( i * 97 ) % 991;
+    }
+
+    clockNs = clockBenchmark( ticks );
+    printf( "Clock and loop only:            %8.1f ns per tick\n", clockNs );
+
+    for ( i = 0; i < (int)( sizeof( counts ) / sizeof( counts[0] ) ); i++ ) {
+        nanoseconds = polledDelayBenchmark( counts[i], ticks );
+        printf( "%d timers, %.0f expiries per simulated second\n", counts[i],
+                expiries * 1000.0 / ticks );
+        printf( "  Polled delays, every tick:    %8.1f ns per tick\n",
+                nanoseconds - clockNs );
+
+        nanoseconds = delayBenchmark( counts[i], ticks );
+        printf( "  delayRead(), every tick:      %8.1f ns per tick\n",
+                nanoseconds - clockNs );
+
+        nanoseconds = softTimerBenchmark( counts[i], ticks );
+        printf( "  Wheel, every tick:            %8.1f ns per tick\n",
+                nanoseconds - clockNs );
+
+        nanoseconds = softTimerTicklessBenchmark( counts[i], ticks, &wakeUps );
+        printf( "  Wheel, next deadline only:    %8.1f ns per tick, "
+                "%.0f wake-ups per simulated second\n",
+                nanoseconds, wakeUps * 1000.0 / ticks );
+    }
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static bool polledDelayRead( polledDelay_t* delay )
+{
+    bool timeArrived = false;
+
+    if ( !delay->running ) {
+        delay->startTime = tickRead();
+        delay->running = true;
+    } else if ( (tick_t)( tickRead() - delay->startTime ) >=
+                delay->duration ) {
+        timeArrived = true;
+        delay->running = false;
+    }
+    return timeArrived;
+}
+
+static void softTimerBenchmarkCallback( void* params )
+{
+    softTimer_t* timer = (softTimer_t*) params;
+
+    softTimerArm( timer, periods[timer - timers] );
+    expiries++;
+}
+
+static double clockBenchmark( tick_t ticks )
+{
+    hostBenchmarkTime_t start = hostBenchmarkNow();
+    tick_t end = tickRead() + ticks;
+
+    while ( tickRead() < end ) {
+        hostClockAdvance( 1000 );
+    }
+    return hostBenchmarkSecondsSince( start ) * 1e9 / ticks;
+}
+
+static double polledDelayBenchmark( int count, tick_t ticks )
+{
+    hostBenchmarkTime_t start;
+    tick_t end;
+    int i;
+
+    for ( i = 0; i < count; i++ ) {
+        polledDelays[i].duration = periods[i];
+        polledDelays[i].running = false;
+    }
+    expiries = 0;
+    start = hostBenchmarkNow();
+    end = tickRead() + ticks;
+    while ( tickRead() < end ) {
+        for ( i = 0; i < count; i++ ) {
+            if ( polledDelayRead( &polledDelays[i] ) ) {
+                expiries++;
+            }
+        }
+        hostClockAdvance( 1000 );
+    }
+    return hostBenchmarkSecondsSince( start ) * 1e9 / ticks;
+}
+
+static double delayBenchmark( int count, tick_t ticks )
+{
+    hostBenchmarkTime_t start;
+    tick_t end;
+    int i;
+
+    for ( i = 0; i < count; i++ ) {
+        delayInit( &delays[i], periods[i] );
+    }
+    start = hostBenchmarkNow();
+    end = tickRead() + ticks;
+    while ( tickRead() < end ) {
+        for ( i = 0; i < count; i++ ) {
+            delayRead( &delays[i] );
+        }
+        hostClockAdvance( 1000 );
+    }
+    for ( i = 0; i < count; i++ ) {
+        softTimerCancel( &delays[i].timer );
+    }
+    return hostBenchmarkSecondsSince( start ) * 1e9 / ticks;
+}
+
+static double softTimerBenchmark( int count, tick_t ticks )
+{
+    hostBenchmarkTime_t start;
+    tick_t end;
+    int i;
+
+    softTimerUpdate();
+    for ( i = 0; i < count; i++ ) {
+        softTimerInit( &timers[i], softTimerBenchmarkCallback, &timers[i] );
+        softTimerArm( &timers[i], periods[i] );
+    }
+    start = hostBenchmarkNow();
+    end = tickRead() + ticks;
+    while ( tickRead() < end ) {
+        softTimerUpdate();
+        hostClockAdvance( 1000 );
+    }
+    for ( i = 0; i < count; i++ ) {
+        softTimerCancel( &timers[i] );
+    }
+    return hostBenchmarkSecondsSince( start ) * 1e9 / ticks;
+}
+
+// Sleeps from one deadline to the next, as the idle loop does, so the cost
+// is per simulated tick although the loop only runs on the wake-ups
+static double softTimerTicklessBenchmark( int count, tick_t ticks,
+                                          uint32_t* wakeUps )
+{
+    hostBenchmarkTime_t start;
+    tick_t end;
+    tick_t deadline;
+    int i;
+
+    softTimerUpdate();
+    for ( i = 0; i < count; i++ ) {
+        softTimerInit( &timers[i], softTimerBenchmarkCallback, &timers[i] );
+        softTimerArm( &timers[i], periods[i] );
+    }
+    *wakeUps = 0;
+    start = hostBenchmarkNow();
+    end = tickRead() + ticks;
+    while ( tickRead() < end ) {
+        deadline = softTimerNextDeadlineRead();
+        hostClockAdvance( ( deadline - tickRead() ) * 1000 );
+        softTimerUpdate();
+        ( *wakeUps )++;
+    }
+    for ( i = 0; i < count; i++ ) {
+        softTimerCancel( &timers[i] );
+    }
+    return hostBenchmarkSecondsSince( start ) * 1e9 / ticks;
+}
@@ -0,0 +1,691 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "smart_home_system.h"
+#include "wifi_com.h"
+#include "wifi_module.h"
+#include "pc_serial_com.h"
+#include "esp8266_sim.h"
+
+#include "host_benchmark.h"
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+//=====[Declaration of private defines]========================================
+
+#define WIFI_LINK_BENCHMARK_UART_TX        D42
+#define WIFI_LINK_BENCHMARK_RUNS           10
+#define WIFI_LINK_BENCHMARK_QUICK_RUNS     2
+#define WIFI_LINK_BENCHMARK_REQUESTS       20
+#define WIFI_LINK_BENCHMARK_QUICK_REQUESTS 3
+#define WIFI_LINK_BENCHMARK_CONNECT_US     120000000ULL
+#define WIFI_LINK_BENCHMARK_POLL_US        100
+#define WIFI_LINK_BENCHMARK_ANSWER_US      1000000
+#define WIFI_LINK_BENCHMARK_SERVER_PORT    80
+#define WIFI_LINK_BENCHMARK_SERVER_ATTEMPTS 10
+#define WIFI_LINK_BENCHMARK_PAGE_BYTES     1024
+#define WIFI_LINK_BENCHMARK_RETRY_US       10000000ULL
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    WIFI_LINK_SIMULATED,   // wifi_com connects, then simulated clients
+    WIFI_LINK_LOOPBACK,    // wifi_com connects, then a real TCP client
+    WIFI_LINK_BLOCKING,    // The sequence of the first firmware connects
+} wifiLinkMode_t;
+
+// One command of the first wifi_module, sent when its wifi_com state was
+// entered. NULL is AT+CWJAP with the credentials. The message is what the
+// state wrote once the answer came.
+typedef struct wifiLinkBlockingStep {
+    const char* command;
+    const char* answer;
+    uint64_t timeoutUs;
+    const char* message;
+} wifiLinkBlockingStep_t;
+
+typedef enum {
+    WIFI_LINK_BLOCKING_RESET,
+    WIFI_LINK_BLOCKING_DETECT,
+    WIFI_LINK_BLOCKING_INIT,
+    WIFI_LINK_BLOCKING_CHECK_AP_CONNECTION,
+    WIFI_LINK_BLOCKING_CONNECT_AP,
+    WIFI_LINK_BLOCKING_IP_GET,
+    WIFI_LINK_BLOCKING_CONNECTED,
+} wifiLinkBlockingState_t;
+
+typedef struct wifiLinkScenario {
+    const char* name;
+    uint32_t latencyUs;
+    uint32_t dropOneIn;
+    uint32_t errorOneIn;
+} wifiLinkScenario_t;
+
+typedef struct wifiLinkResult {
+    bool connected;
+    uint64_t connectUs;
+    uint32_t retries;
+    uint32_t requests;
+    uint32_t failures;
+    uint64_t roundTripUs;
+    uint64_t maxRoundTripUs;
+} wifiLinkResult_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static const wifiLinkScenario_t wifiLinkScenarios[] = {
+    { "Clean link",              2000,    0,  0 },
+    { "Slow module, 20 ms",     20000,    0,  0 },
+    { "1 byte in 2000 dropped",  2000, 2000,  0 },
+    { "1 answer in 20 ERROR",    2000,    0, 20 },
+};
+
+// In the order of wifiLinkBlockingState_t, with the timeouts of the first
+// wifi_module. Its wifi_com never got the IP, AT+CIFSR is sent as
+// wifiModuleStartIpGet() did so both sequences end at the same point.
+static const wifiLinkBlockingStep_t wifiLinkBlockingSteps[] = {
+    { "AT+RST\r\n", "\r\nready\r\n", 10000000,
+      "Wi-Fi module detected.\r\n" },
+    { "AT\r\n", "\r\nOK\r\n", 50000, "Wi-Fi module detected.\r\n" },
+    { "AT+CWMODE=1\r\n", "\r\nOK\r\n", 50000,
+      "Wi-Fi module initialized.\r\n" },
+    { "AT+CIPSTATUS\r\n", "\r\nOK\r\n", 50000,
+      "Wi-Fi module is not connected.\r\n" },
+    { NULL, "\r\nOK\r\n", 20000000,
+      "Wi-Fi module is connected. IP = \r\n" },
+    { "AT+CIFSR\r\n", "\r\nOK\r\n", 50000, "" },
+};
+
+// As a browser sends it
+static const char* const wifiLinkRequest =
+    "GET / HTTP/1.1\r\nHost: 192.168.1.7\r\n"
+    "Connection: keep-alive\r\nUser-Agent: Mozilla/5.0 (X11; Linux x86_64)\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate\r\nAccept-Language: en-US,en;q=0.9\r\n"
+    "\r\n";
+
+// The module UART as wifi_module opens it. Once connected, the web server
+// below takes it over.
+static RawSerial uartEsp8266( D42, D41, 115200 );
+
+static std::string usbOutput;
+static std::string received;
+static std::string page;
+static std::string clientResponse;
+static bool clientClosed = false;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool wifiLinkBenchmarkRun( const wifiLinkScenario_t* scenario,
+                                  uint32_t seed, int requests,
+                                  wifiLinkMode_t mode,
+                                  wifiLinkResult_t* result );
+static bool wifiLinkBenchmarkFork( const wifiLinkScenario_t* scenario,
+                                   uint32_t seed, int requests,
+                                   wifiLinkMode_t mode,
+                                   wifiLinkResult_t* result );
+static void wifiLinkBenchmarkReport( const wifiLinkScenario_t* scenario,
+                                     int runs, int requests );
+static void wifiLinkBenchmarkConnectReport(
+    const wifiLinkScenario_t* scenario, int runs );
+static void wifiLinkBenchmarkLoopbackReport( int requests );
+
+static bool wifiLinkConnect( wifiLinkResult_t* result );
+static bool wifiLinkBlockingConnect( wifiLinkResult_t* result );
+static bool wifiLinkServerStart();
+static bool wifiLinkRequestServe( uint64_t timeoutUs );
+static void wifiLinkSimulatedRequest( wifiLinkResult_t* result );
+static void wifiLinkLoopbackClient( uint16_t port, int requests,
+                                    wifiLinkResult_t* result,
+                                    std::atomic<bool>* done );
+static bool wifiLinkCommand( const std::string& command, const char* answer );
+static bool wifiLinkWait( const char* answer, uint64_t timeoutUs );
+static void wifiLinkRoundTripAdd( wifiLinkResult_t* result, uint64_t us );
+
+static void wifiLinkRx();
+static void wifiLinkUsbTx( void* context, char c );
+static void wifiLinkClient( void* context, int linkId, const char* data,
+                            int length );
+
+//=====[Main function, the program entry point]================================
+
+// The firmware connects through the ESP8266 stand-in as it would at power
+// up, then a web server answers a page per request with the AT commands of
+// the book's chapter 11, which this tree does not build yet. Each run has
+// its own process, with the module dropping bytes or answering ERROR from
+// its own seed. The time to connected is then compared with that of the
+// blocking sequence of the first firmware, one command at a time. Times are
+// simulated, except on the loopback where the clock runs at wall speed and
+// a real TCP client makes the requests.
+int main( int argc, char* argv[] )
+{
+    bool quick = hostBenchmarkQuickRead( argc, argv );
+    int runs = quick ? WIFI_LINK_BENCHMARK_QUICK_RUNS :
+                       WIFI_LINK_BENCHMARK_RUNS;
+    int requests = quick ? WIFI_LINK_BENCHMARK_QUICK_REQUESTS :
+                           WIFI_LINK_BENCHMARK_REQUESTS;
+    size_t i;
+
+    printf( "%d power ups per link, then %d requests of a %d byte page:\n",
+            runs, requests, WIFI_LINK_BENCHMARK_PAGE_BYTES );
+    printf( "  Link                    Connected  Connect s mean/max  "
+            "Retries  Round trip ms mean/max  Failed\n" );
+    for ( i = 0; i < sizeof( wifiLinkScenarios ) /
+                     sizeof( wifiLinkScenarios[0] ); i++ ) {
+        wifiLinkBenchmarkReport( &wifiLinkScenarios[i], runs, requests );
+    }
+
+    printf( "Time to connected, %d power ups per link:\n", runs );
+    printf( "  Link                    Blocking s mean/max  Retries  "
+            "Queued s mean/max  Retries\n" );
+    for ( i = 0; i < sizeof( wifiLinkScenarios ) /
+                     sizeof( wifiLinkScenarios[0] ); i++ ) {
+        wifiLinkBenchmarkConnectReport( &wifiLinkScenarios[i], runs );
+    }
+    wifiLinkBenchmarkLoopbackReport( requests );
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void wifiLinkBenchmarkReport( const wifiLinkScenario_t* scenario,
+                                     int runs, int requests )
+{
+    wifiLinkResult_t total;
+    wifiLinkResult_t result;
+    uint64_t maxConnectUs = 0;
+    uint32_t connected = 0;
+    int run;
+
+    memset( &total, 0, sizeof(total) );
+    for ( run = 1; run <= runs; run++ ) {
+        if ( !wifiLinkBenchmarkFork( scenario, run, requests,
+                                     WIFI_LINK_SIMULATED, &result ) ||
+             !result.connected ) {
+            continue;
+        }
+        connected++;
+        total.connectUs = total.connectUs + result.connectUs;
+        if ( result.connectUs > maxConnectUs ) {
+            maxConnectUs = result.connectUs;
+        }
+        total.retries = total.retries + result.retries;
+        total.requests = total.requests + result.requests;
+        total.failures = total.failures + result.failures;
+        total.roundTripUs = total.roundTripUs + result.roundTripUs;
+        if ( result.maxRoundTripUs > total.maxRoundTripUs ) {
+            total.maxRoundTripUs = result.maxRoundTripUs;
+        }
+    }
+
+    printf( "  %-22s  %4u/%-4d  %8.2f / %6.2f  %7u  %10.1f / %8.1f  %6u\n",
+            scenario->name, connected, runs,
+            connected > 0 ? total.connectUs / 1e6 / connected : 0.0,
+            maxConnectUs / 1e6, total.retries,
+            total.requests > total.failures ?
+                total.roundTripUs / 1000.0 /
+                ( total.requests - total.failures ) : 0.0,
+            total.maxRoundTripUs / 1000.0, total.failures );
+    fflush( stdout );
+}
+
+// Both sequences on the same links, the module answers each of them the
+// same way for the same seed. Runs that did not connect are left out.
+static void wifiLinkBenchmarkConnectReport(
+    const wifiLinkScenario_t* scenario, int runs )
+{
+    wifiLinkResult_t result;
+    uint64_t totalUs[2] = { 0, 0 };
+    uint64_t maxUs[2] = { 0, 0 };
+    uint32_t retries[2] = { 0, 0 };
+    uint32_t connected[2] = { 0, 0 };
+    int run;
+    int i;
+
+    for ( run = 1; run <= runs; run++ ) {
+        for ( i = 0; i < 2; i++ ) {
+            if ( !wifiLinkBenchmarkFork( scenario, run, 0,
+                                         i == 0 ? WIFI_LINK_BLOCKING :
+                                                  WIFI_LINK_SIMULATED,
+                                         &result ) || !result.connected ) {
+                continue;
+            }
+            connected[i]++;
+            totalUs[i] = totalUs[i] + result.connectUs;
+            if ( result.connectUs > maxUs[i] ) {
+                maxUs[i] = result.connectUs;
+            }
+            retries[i] = retries[i] + result.retries;
+        }
+    }
+
+    printf( "  %-22s  %9.3f / %7.3f  %7u  %8.3f / %6.3f  %7u\n",
+            scenario->name,
+            connected[0] > 0 ? totalUs[0] / 1e6 / connected[0] : 0.0,
+            maxUs[0] / 1e6, retries[0],
+            connected[1] > 0 ? totalUs[1] / 1e6 / connected[1] : 0.0,
+            maxUs[1] / 1e6, retries[1] );
+    fflush( stdout );
+}
+
+// Only the round trips are timed on the loopback, the connection is made
+// with a short join so the wall clock wait stays short
+static void wifiLinkBenchmarkLoopbackReport( int requests )
+{
+    wifiLinkResult_t result;
+
+    printf( "Loopback TCP client, wall clock:\n" );
+    fflush( stdout );
+    if ( !wifiLinkBenchmarkFork( &wifiLinkScenarios[0], 1, requests,
+                                 WIFI_LINK_LOOPBACK, &result ) ||
+         !result.connected ) {
+        printf( "  Loopback forwarding unavailable\n" );
+        return;
+    }
+    printf( "  %u requests, round trip %.1f ms mean, %.1f ms max, "
+            "%u failed\n", result.requests,
+            result.requests > result.failures ?
+                result.roundTripUs / 1000.0 /
+                ( result.requests - result.failures ) : 0.0,
+            result.maxRoundTripUs / 1000.0, result.failures );
+}
+
+// The child process sends its result back through a pipe
+static bool wifiLinkBenchmarkFork( const wifiLinkScenario_t* scenario,
+                                   uint32_t seed, int requests,
+                                   wifiLinkMode_t mode,
+                                   wifiLinkResult_t* result )
+{
+    int pipeFds[2];
+    pid_t child;
+    int status;
+    bool resultRead;
+
+    if ( pipe( pipeFds ) != 0 ) {
+        return false;
+    }
+    fflush( stdout );
+    child = fork();
+    if ( child == 0 ) {
+        close( pipeFds[0] );
+        memset( result, 0, sizeof(*result) );
+        status = wifiLinkBenchmarkRun( scenario, seed, requests, mode,
+                                       result ) ? 0 : 1;
+        if ( write( pipeFds[1], result, sizeof(*result) ) !=
+             (ssize_t) sizeof(*result) ) {
+            status = 1;
+        }
+        fflush( stdout );
+        _exit( status );
+    }
+    close( pipeFds[1] );
+    resultRead = child > 0 &&
+              read( pipeFds[0], result, sizeof(*result) ) ==
+              (ssize_t) sizeof(*result);
+    close( pipeFds[0] );
+    if ( child < 0 || waitpid( child, &status, 0 ) != child ||
+         !WIFEXITED( status ) || WEXITSTATUS( status ) != 0 ) {
+        return false;
+    }
+    return resultRead;
+}
+
+static bool wifiLinkBenchmarkRun( const wifiLinkScenario_t* scenario,
+                                  uint32_t seed, int requests,
+                                  wifiLinkMode_t mode,
+                                  wifiLinkResult_t* result )
+{
+    bool loopback = mode == WIFI_LINK_LOOPBACK;
+    esp8266SimConfig_t config;
+    std::atomic<bool> done( false );
+    std::thread client;
+    int i;
+
+    esp8266SimConfigDefaultRead( &config );
+    config.ssid = wifiModuleGetAP_SSID();
+    config.password = wifiModuleGetAP_Password();
+    config.latencyUs = scenario->latencyUs;
+    config.dropOneIn = scenario->dropOneIn;
+    config.errorOneIn = scenario->errorOneIn;
+    config.seed = seed;
+    config.forward = loopback;
+    if ( loopback ) {
+        config.connectUs = 100000;
+        hostClockSpeedSet( 1.0 );
+    }
+    esp8266SimAttach( WIFI_LINK_BENCHMARK_UART_TX, &config );
+    esp8266SimClientHandlerSet( wifiLinkClient, NULL );
+    hostSerialTxHandlerSet( USBTX, wifiLinkUsbTx, NULL );
+    tickInit( 1 );
+    // Both sequences write their messages at the baud rate of the board
+    pcSerialComInit();
+
+    if ( mode == WIFI_LINK_BLOCKING ) {
+        wifiLinkBlockingConnect( result );
+        return true;
+    }
+    if ( !wifiLinkConnect( result ) ) {
+        return true;
+    }
+    uartEsp8266.attach( wifiLinkRx );
+    for ( i = 0; !wifiLinkServerStart(); i++ ) {
+        if ( i == WIFI_LINK_BENCHMARK_SERVER_ATTEMPTS ) {
+            result->requests = requests;
+            result->failures = requests;
+            return true;
+        }
+    }
+    page = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n"
+           "Connection: close\r\n\r\n<!doctype html><html><body><pre>";
+    page += std::string( WIFI_LINK_BENCHMARK_PAGE_BYTES - page.size() - 25,
+                         '.' );
+    page += "</pre></body></html>\r\n";
+
+    if ( !loopback ) {
+        for ( i = 0; i < requests; i++ ) {
+            wifiLinkSimulatedRequest( result );
+        }
+        return true;
+    }
+    client = std::thread( wifiLinkLoopbackClient,
+                          esp8266SimForwardPortRead(), requests, result,
+                          &done );
+    while ( !done ) {
+        wifiLinkRequestServe( WIFI_LINK_BENCHMARK_ANSWER_US );
+    }
+    client.join();
+    return true;
+}
+
+// The main loop runs wifi_com every SYSTEM_TIME_INCREMENT_MS until it
+// reports the connection, the retries are the module resets it made
+static bool wifiLinkConnect( wifiLinkResult_t* result )
+{
+    uint64_t startUs = hostClockUsRead();
+    size_t position = 0;
+
+    wifiComInit();
+    while ( hostClockUsRead() - startUs < WIFI_LINK_BENCHMARK_CONNECT_US ) {
+        wifiComUpdate();
+        if ( usbOutput.find( "Time to connected" ) != std::string::npos ) {
+            result->connected = true;
+            result->connectUs = hostClockUsRead() - startUs;
+            break;
+        }
+        hostClockAdvance( SYSTEM_TIME_INCREMENT_MS * 1000 );
+    }
+    while ( ( position = usbOutput.find( "Reseting", position ) ) !=
+            std::string::npos ) {
+        result->retries++;
+        position++;
+    }
+    return result->connected;
+}
+
+// The wifi_com states of the first firmware, each ran once per loop
+// iteration: a state sent its command when entered and read the answer in
+// the same call and the following ones. The next state was only entered on
+// the next iteration. A command that failed or timed out was retried with a
+// module reset WIFI_LINK_BENCHMARK_RETRY_US later, from the initialization.
+static bool wifiLinkBlockingConnect( wifiLinkResult_t* result )
+{
+    uint64_t startUs = hostClockUsRead();
+    uint64_t sentUs = 0;
+    uint64_t retryUs = 0;
+    wifiLinkBlockingState_t state = WIFI_LINK_BLOCKING_DETECT;
+    const wifiLinkBlockingStep_t* step;
+    bool sent = false;
+    bool failed;
+    size_t position;
+
+    uartEsp8266.baud( 115200 );
+    uartEsp8266.attach( wifiLinkRx );
+    while ( hostClockUsRead() - startUs < WIFI_LINK_BENCHMARK_CONNECT_US ) {
+        if ( retryUs != 0 && hostClockUsRead() >= retryUs ) {
+            retryUs = 0;
+            state = WIFI_LINK_BLOCKING_RESET;
+            result->retries++;
+        }
+        step = &wifiLinkBlockingSteps[state];
+        if ( retryUs == 0 && !sent ) {
+            received.clear();
+            if ( step->command != NULL ) {
+                uartEsp8266.puts( step->command );
+            } else {
+                pcSerialComStringWrite( "Wi-Fi try to connect with AP "
+                                        "SSID: " );
+                pcSerialComStringWrite( wifiModuleGetAP_SSID() );
+                pcSerialComStringWrite( "\r\n" );
+                uartEsp8266.puts( ( std::string( "AT+CWJAP=\"" ) +
+                                    wifiModuleGetAP_SSID() + "\",\"" +
+                                    wifiModuleGetAP_Password() +
+                                    "\"\r\n" ).c_str() );
+            }
+            sent = true;
+            sentUs = hostClockUsRead();
+        }
+        if ( sent ) {
+            position = received.find( step->answer );
+            failed = position == std::string::npos &&
+                     ( received.find( "ERROR" ) != std::string::npos ||
+                       received.find( "FAIL" ) != std::string::npos ||
+                       hostClockUsRead() - sentUs >= step->timeoutUs );
+            if ( failed ) {
+                sent = false;
+                retryUs = hostClockUsRead() + WIFI_LINK_BENCHMARK_RETRY_US;
+            } else if ( position != std::string::npos ) {
+                sent = false;
+                pcSerialComStringWrite( step->message );
+                if ( state == WIFI_LINK_BLOCKING_RESET ) {
+                    state = WIFI_LINK_BLOCKING_INIT;
+                } else if ( state == WIFI_LINK_BLOCKING_CHECK_AP_CONNECTION &&
+                            received.find( "STATUS:5" ) ==
+                            std::string::npos ) {
+                    state = WIFI_LINK_BLOCKING_IP_GET;
+                } else {
+                    state = (wifiLinkBlockingState_t)( state + 1 );
+                }
+                if ( state == WIFI_LINK_BLOCKING_CONNECTED ) {
+                    result->connected = true;
+                    result->connectUs = hostClockUsRead() - startUs;
+                    return true;
+                }
+            }
+        }
+        hostClockAdvance( SYSTEM_TIME_INCREMENT_MS * 1000 );
+    }
+    return false;
+}
+
+// A server left from an attempt whose answer was lost is deleted first
+static bool wifiLinkServerStart()
+{
+    wifiLinkCommand( "AT+CIPSERVER=0\r\n", "\r\nOK\r\n" );
+    return wifiLinkCommand( "AT+CIPMUX=1\r\n", "\r\nOK\r\n" ) &&
+           wifiLinkCommand( "AT+CIPSERVER=1," +
+                            std::to_string( WIFI_LINK_BENCHMARK_SERVER_PORT ) +
+                            "\r\n", "\r\nOK\r\n" );
+}
+
+// Reads one request from "+IPD", sends the page and closes the link. A
+// request that fails on the way has its link closed, with all others.
+static bool wifiLinkRequestServe( uint64_t timeoutUs )
+{
+    uint64_t startUs;
+    size_t colon;
+    int linkId;
+    int length;
+
+    if ( !wifiLinkWait( "+IPD,", timeoutUs ) ) {
+        return false;
+    }
+    startUs = hostClockUsRead();
+    while ( ( colon = received.find( ':' ) ) == std::string::npos &&
+            hostClockUsRead() - startUs < WIFI_LINK_BENCHMARK_ANSWER_US ) {
+        hostClockAdvance( WIFI_LINK_BENCHMARK_POLL_US );
+    }
+    if ( colon == std::string::npos ||
+         sscanf( received.c_str(), "%d,%d:", &linkId, &length ) != 2 ||
+         length <= 0 ) {
+        wifiLinkCommand( "AT+CIPCLOSE=5\r\n", "\r\nOK\r\n" );
+        return false;
+    }
+    received.erase( 0, colon + 1 );
+    while ( received.size() < (size_t) length &&
+            hostClockUsRead() - startUs < WIFI_LINK_BENCHMARK_ANSWER_US ) {
+        hostClockAdvance( WIFI_LINK_BENCHMARK_POLL_US );
+    }
+    if ( received.size() < (size_t) length ) {
+        wifiLinkCommand( "AT+CIPCLOSE=5\r\n", "\r\nOK\r\n" );
+        return false;
+    }
+    received.erase( 0, length );
+
+    if ( !wifiLinkCommand( "AT+CIPSEND=" + std::to_string( linkId ) + "," +
+                           std::to_string( page.size() ) + "\r\n", "> " ) ||
+         !wifiLinkCommand( page, "SEND OK\r\n" ) ||
+         !wifiLinkCommand( "AT+CIPCLOSE=" + std::to_string( linkId ) + "\r\n",
+                           "\r\nOK\r\n" ) ) {
+        wifiLinkCommand( "AT+CIPCLOSE=5\r\n", "\r\nOK\r\n" );
+        return false;
+    }
+    return true;
+}
+
+// From the request leaving the client to the link closed after the page
+static void wifiLinkSimulatedRequest( wifiLinkResult_t* result )
+{
+    uint64_t startUs;
+    int linkId;
+
+    result->requests++;
+    clientResponse.clear();
+    clientClosed = false;
+    linkId = esp8266SimClientConnect();
+    startUs = hostClockUsRead();
+    if ( linkId < 0 ||
+         !esp8266SimClientSend( linkId, wifiLinkRequest,
+                                strlen( wifiLinkRequest ) ) ||
+         !wifiLinkRequestServe( WIFI_LINK_BENCHMARK_ANSWER_US ) ||
+         !clientClosed || clientResponse != page ) {
+        result->failures++;
+        if ( linkId >= 0 && !clientClosed ) {
+            esp8266SimClientClose( linkId );
+        }
+        return;
+    }
+    wifiLinkRoundTripAdd( result, hostClockUsRead() - startUs );
+}
+
+// A real client on its own thread, it only touches its socket
+static void wifiLinkLoopbackClient( uint16_t port, int requests,
+                                    wifiLinkResult_t* result,
+                                    std::atomic<bool>* done )
+{
+    struct sockaddr_in address;
+    struct timeval timeout = { 5, 0 };
+    hostBenchmarkTime_t start;
+    std::string response;
+    char data[512];
+    ssize_t length;
+    int client;
+    int i;
+
+    memset( &address, 0, sizeof(address) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address.sin_port = htons( port );
+    for ( i = 0; i < requests; i++ ) {
+        result->requests++;
+        response.clear();
+        start = hostBenchmarkNow();
+        client = socket( AF_INET, SOCK_STREAM, 0 );
+        setsockopt( client, SOL_SOCKET, SO_RCVTIMEO, &timeout,
+                    sizeof(timeout) );
+        if ( connect( client, (struct sockaddr*) &address,
+                      sizeof(address) ) == 0 &&
+             send( client, wifiLinkRequest, strlen( wifiLinkRequest ),
+                   0 ) == (ssize_t) strlen( wifiLinkRequest ) ) {
+            while ( ( length = recv( client, data, sizeof(data), 0 ) ) > 0 ) {
+                response.append( data, length );
+            }
+        }
+        close( client );
+        if ( length != 0 || response != page ) {
+            result->failures++;
+        } else {
+            wifiLinkRoundTripAdd( result, (uint64_t)(
+                hostBenchmarkSecondsSince( start ) * 1e6 ) );
+        }
+    }
+    *done = true;
+}
+
+static bool wifiLinkCommand( const std::string& command, const char* answer )
+{
+    uartEsp8266.puts( command.c_str() );
+    return wifiLinkWait( answer, WIFI_LINK_BENCHMARK_ANSWER_US );
+}
+
+// Everything up to the answer is consumed, "ERROR" and "FAIL" end the wait
+static bool wifiLinkWait( const char* answer, uint64_t timeoutUs )
+{
+    uint64_t startUs = hostClockUsRead();
+    size_t position;
+
+    while ( true ) {
+        position = received.find( answer );
+        if ( position != std::string::npos ) {
+            received.erase( 0, position + strlen( answer ) );
+            return true;
+        }
+        if ( received.find( "ERROR" ) != std::string::npos ||
+             received.find( "FAIL" ) != std::string::npos ||
+             hostClockUsRead() - startUs >= timeoutUs ) {
+            received.clear();
+            return false;
+        }
+        hostClockAdvance( WIFI_LINK_BENCHMARK_POLL_US );
+    }
+}
+
+static void wifiLinkRoundTripAdd( wifiLinkResult_t* result, uint64_t us )
+{
+    result->roundTripUs = result->roundTripUs + us;
+    if ( us > result->maxRoundTripUs ) {
+        result->maxRoundTripUs = us;
+    }
+}
+
+static void wifiLinkRx()
+{
+    while ( uartEsp8266.readable() ) {
+        received += (char) uartEsp8266.getc();
+    }
+}
+
+static void wifiLinkUsbTx( void* context, char c )
+{
+    usbOutput += c;
+}
+
+static void wifiLinkClient( void* context, int linkId, const char* data,
+                            int length )
+{
+    if ( data == NULL ) {
+        clientClosed = true;
+    } else {
+        clientResponse.append( data, length );
+    }
+}
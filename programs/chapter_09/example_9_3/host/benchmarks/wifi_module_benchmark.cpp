@@ -0,0 +1,94 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "wifi_module.h"
+
+#include "host_benchmark.h"
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define WIFI_BENCHMARK_UART_TX       D42
+#define WIFI_BENCHMARK_BYTE_US       87      // 10 bits at 115200 bps
+#define WIFI_BENCHMARK_BURST_US      40000
+
+//=====[Declaration and initialization of private global variables]============
+
+static uint64_t payloadBytes = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static double wifiModuleBenchmark( const std::string& traffic,
+                                   uint64_t bursts );
+static void wifiBenchmarkData( int linkId, char const* data, int length );
+
+//=====[Main function, the program entry point]================================
+
+// Only the time spent in wifiModuleUpdate() is counted, the bytes reach the
+// RX buffer through the simulated UART between the updates
+int main( int argc, char* argv[] )
+{
+    uint64_t bursts = hostBenchmarkQuickRead( argc, argv ) ? 100 : 20000;
+    std::string statusLines;
+    std::string frames;
+    std::string payload( 1000, 'p' );
+    int i;
+
+    tickInit( 1 );
+    wifiModuleInit();
+    wifiModuleDataHandlerSet( wifiBenchmarkData );
+
+    for ( i = 0; i < 10; i++ ) {
+        statusLines += "+CIPSTATUS:0,\"TCP\",\"192.168.1.10\",80,1234,0\r\n";
+    }
+    frames = "\r\n+IPD,0,1000:" + payload + "\r\nOK\r\n";
+
+    printf( "Tokenizer, status lines:  %8.1f MB/s\n",
+            wifiModuleBenchmark( statusLines, bursts ) );
+    printf( "Tokenizer, +IPD payloads: %8.1f MB/s\n",
+            wifiModuleBenchmark( frames, bursts ) );
+    printf( "RX overflows: %lu, payload bytes: %llu\n",
+            (unsigned long) wifiModuleRxOverflowsRead(),
+            (unsigned long long) payloadBytes );
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static double wifiModuleBenchmark( const std::string& traffic,
+                                   uint64_t bursts )
+{
+    std::string line;
+    double seconds = 0.0;
+    uint64_t bytes = 0;
+    hostBenchmarkTime_t start;
+    size_t position = 0;
+    uint64_t i;
+    int length;
+
+    // Kept ahead of the clock, the UART never idles
+    for ( i = 0; i < bursts; i++ ) {
+        length = WIFI_BENCHMARK_BURST_US / WIFI_BENCHMARK_BYTE_US;
+        line.clear();
+        while ( (int) line.size() < length ) {
+            line += traffic[position];
+            position = ( position + 1 ) % traffic.size();
+        }
+        hostSerialRxWrite( WIFI_BENCHMARK_UART_TX, line.data(), line.size() );
+        hostClockAdvance( WIFI_BENCHMARK_BURST_US );
+        bytes = bytes + line.size();
+
+        start = hostBenchmarkNow();
+        wifiModuleUpdate();
+        seconds = seconds + hostBenchmarkSecondsSince( start );
+    }
+    return bytes / seconds / 1e6;
+}
+
+static void wifiBenchmarkData( int linkId, char const* data, int length )
+{
+    payloadBytes = payloadBytes + length;
+}
@@ -0,0 +1,780 @@
+//=====[Libraries]=============================================================
+
+#include "esp8266_sim.h"
+#include "host_sim.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+//=====[Declaration of private defines]========================================
+
+#define ESP8266_SIM_BITS_PER_BYTE        10
+#define ESP8266_SIM_MAX_LINE             256
+#define ESP8266_SIM_DEFAULT_SERVER_PORT  333
+#define ESP8266_SIM_FIRST_REMOTE_PORT    50000
+#define ESP8266_SIM_BOOT_GARBAGE_BYTES   64
+#define ESP8266_SIM_FORWARD_POLL_US      1000
+#define ESP8266_SIM_PROMPT               "\r\nOK\r\n> "
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    ESP8266_SIM_IDLE,
+    ESP8266_SIM_RESETTING,
+    ESP8266_SIM_CONNECTING,
+} esp8266SimBusy_t;
+
+typedef struct esp8266SimLink {
+    bool open;
+    int socket;              // -1: a simulated client
+    uint16_t remotePort;
+} esp8266SimLink_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static bool simAttached = false;
+static PinName simTx;
+static esp8266SimConfig_t simConfig;
+static esp8266SimStats_t simStats;
+static std::mt19937 simRandom;
+
+static std::string simLine;
+static esp8266SimBusy_t simBusy = ESP8266_SIM_IDLE;
+static uint64_t simBusyUntilUs = 0;
+static int simMode = 1;
+static bool simMux = false;
+static bool simServer = false;
+static uint16_t simServerPort = 0;
+static bool simStationConnected = false;
+static uint64_t simStationUpUs = 0;
+static esp8266SimLink_t simLinks[ESP8266_SIM_MAX_LINKS];
+static uint16_t simNextRemotePort = ESP8266_SIM_FIRST_REMOTE_PORT;
+
+static int simSendLink = -1;
+static int simSendRemaining = 0;
+static uint64_t simSendStartUs = 0;
+static std::string simSendData;
+
+static esp8266SimClientHandler_t simClientHandler = NULL;
+static void* simClientContext = NULL;
+
+static int simListenSocket = -1;
+static uint16_t simForwardPort = 0;
+static hostClockEvent_t simPollEvent;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void esp8266SimTx( void* context, char c );
+static void esp8266SimCommandRun( const std::string& line );
+static void esp8266SimResetRun();
+static void esp8266SimConnectRun( const std::vector<std::string>& arguments );
+static void esp8266SimStatusRun();
+static void esp8266SimIpRun();
+static void esp8266SimMuxRun( const std::vector<std::string>& arguments );
+static void esp8266SimServerRun( const std::vector<std::string>& arguments );
+static void esp8266SimSendRun( const std::vector<std::string>& arguments );
+static void esp8266SimSendComplete();
+static void esp8266SimCloseRun( const std::vector<std::string>& arguments );
+
+static bool esp8266SimArgumentsRead( const std::string& line,
+                                     const char* prefix,
+                                     std::vector<std::string>& arguments );
+static bool esp8266SimNumberRead( const std::string& text, int* number );
+static bool esp8266SimLinkValid( int linkId );
+static int esp8266SimLinkOpen( int socket );
+static void esp8266SimLinkClose( int linkId );
+static void esp8266SimLinkDeliver( int linkId, const char* data, int length );
+static void esp8266SimIpdWrite( int linkId, const char* data, int length );
+
+static bool esp8266SimListenStart();
+static void esp8266SimListenStop();
+static void esp8266SimForwardPoll( void* context );
+
+static uint64_t esp8266SimByteUs();
+static uint64_t esp8266SimAnswerUs();
+static void esp8266SimWrite( uint64_t delayUs, const std::string& text );
+static void esp8266SimAnswer( const std::string& text );
+
+//=====[Implementations of public functions]===================================
+
+void esp8266SimConfigDefaultRead( esp8266SimConfig_t* config )
+{
+    config->baud = 115200;
+    config->latencyUs = 2000;
+    config->resetUs = 500000;
+    config->connectUs = 3000000;
+    config->dropOneIn = 0;
+    config->errorOneIn = 0;
+    config->seed = 1;
+    config->echo = true;
+    config->ssid = "";
+    config->password = "";
+    config->ip = "192.168.1.7";
+    config->forward = false;
+    config->forwardPort = 0;
+}
+
+// The module powers up ready, in station mode and not connected
+void esp8266SimAttach( PinName tx, const esp8266SimConfig_t* config )
+{
+    int i;
+
+    if ( simAttached ) {
+        esp8266SimDetach();
+    }
+    simTx = tx;
+    simConfig = *config;
+    memset( &simStats, 0, sizeof(simStats) );
+    simRandom.seed( config->seed );
+    simLine.clear();
+    simBusy = ESP8266_SIM_IDLE;
+    simMode = 1;
+    simMux = false;
+    simServer = false;
+    simStationConnected = false;
+    simSendRemaining = 0;
+    for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+        simLinks[i].open = false;
+        simLinks[i].socket = -1;
+    }
+    simPollEvent.handler = esp8266SimForwardPoll;
+    simPollEvent.context = NULL;
+    hostSerialTxHandlerSet( tx, esp8266SimTx, NULL );
+    simAttached = true;
+}
+
+void esp8266SimDetach()
+{
+    int i;
+
+    if ( !simAttached ) {
+        return;
+    }
+    hostSerialTxHandlerSet( simTx, NULL, NULL );
+    for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+        if ( simLinks[i].open && simLinks[i].socket >= 0 ) {
+            close( simLinks[i].socket );
+        }
+        simLinks[i].open = false;
+        simLinks[i].socket = -1;
+    }
+    esp8266SimListenStop();
+    simAttached = false;
+}
+
+void esp8266SimStatsRead( esp8266SimStats_t* stats )
+{
+    *stats = simStats;
+}
+
+bool esp8266SimConnectedRead()
+{
+    return simStationConnected && hostClockUsRead() >= simStationUpUs;
+}
+
+int esp8266SimClientConnect()
+{
+    if ( !simAttached || !simServer || !esp8266SimConnectedRead() ) {
+        return -1;
+    }
+    return esp8266SimLinkOpen( -1 );
+}
+
+// The module hands the data to the board in "+IPD" frames of at most
+// ESP8266_SIM_MAX_IPD bytes, as it arrives in TCP segments
+bool esp8266SimClientSend( int linkId, const char* data, int length )
+{
+    if ( !esp8266SimLinkValid( linkId ) || length <= 0 ) {
+        return false;
+    }
+    esp8266SimIpdWrite( linkId, data, length );
+    return true;
+}
+
+void esp8266SimClientClose( int linkId )
+{
+    char text[16];
+
+    if ( !esp8266SimLinkValid( linkId ) ) {
+        return;
+    }
+    simLinks[linkId].open = false;
+    if ( simLinks[linkId].socket >= 0 ) {
+        close( simLinks[linkId].socket );
+        simLinks[linkId].socket = -1;
+    }
+    snprintf( text, sizeof(text), "%d,CLOSED\r\n", linkId );
+    esp8266SimWrite( simConfig.latencyUs, text );
+}
+
+void esp8266SimClientHandlerSet( esp8266SimClientHandler_t handler,
+                                 void* context )
+{
+    simClientHandler = handler;
+    simClientContext = context;
+}
+
+uint16_t esp8266SimForwardPortRead()
+{
+    return simListenSocket >= 0 ? simForwardPort : 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Runs as each byte leaves the board UART. During AT+CIPSEND the bytes are
+// data, before the prompt arrived they are lost as on the module.
+static void esp8266SimTx( void* context, char c )
+{
+    uint64_t nowUs = hostClockUsRead();
+
+    if ( hostSerialBaudRead( simTx ) != simConfig.baud ||
+         ( simBusy == ESP8266_SIM_RESETTING && nowUs < simBusyUntilUs ) ) {
+        simStats.garbageBytes++;
+        return;
+    }
+    if ( simSendRemaining > 0 ) {
+        if ( nowUs < simSendStartUs ) {
+            simStats.garbageBytes++;
+            return;
+        }
+        simSendData += c;
+        simSendRemaining--;
+        if ( simSendRemaining == 0 ) {
+            esp8266SimSendComplete();
+        }
+        return;
+    }
+
+    if ( simConfig.echo ) {
+        esp8266SimWrite( 0, c == '\n' ? std::string( "\r\n" ) :
+                                        std::string( 1, c ) );
+    }
+    if ( c == '\n' ) {
+        if ( !simLine.empty() && simLine[simLine.size() - 1] == '\r' ) {
+            simLine.erase( simLine.size() - 1 );
+        }
+        if ( !simLine.empty() ) {
+            esp8266SimCommandRun( simLine );
+        }
+        simLine.clear();
+    } else if ( simLine.size() < ESP8266_SIM_MAX_LINE ) {
+        simLine += c;
+    }
+}
+
+static void esp8266SimCommandRun( const std::string& line )
+{
+    std::vector<std::string> arguments;
+    int mode;
+
+    simStats.commands++;
+    if ( simBusy == ESP8266_SIM_CONNECTING &&
+         hostClockUsRead() < simBusyUntilUs ) {
+        esp8266SimAnswer( "busy p...\r\n" );
+        return;
+    }
+    simBusy = ESP8266_SIM_IDLE;
+    if ( simConfig.errorOneIn > 0 &&
+         simRandom() % simConfig.errorOneIn == 0 ) {
+        simStats.errorReplies++;
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+
+    if ( line == "AT" ) {
+        esp8266SimAnswer( "\r\nOK\r\n" );
+    } else if ( line == "AT+RST" ) {
+        esp8266SimResetRun();
+    } else if ( esp8266SimArgumentsRead( line, "AT+CWMODE=", arguments ) ) {
+        if ( arguments.size() == 1 && esp8266SimNumberRead( arguments[0],
+                                                            &mode ) &&
+             mode >= 1 && mode <= 3 ) {
+            simMode = mode;
+            esp8266SimAnswer( "\r\nOK\r\n" );
+        } else {
+            esp8266SimAnswer( "\r\nERROR\r\n" );
+        }
+    } else if ( esp8266SimArgumentsRead( line, "AT+CWJAP=", arguments ) ) {
+        esp8266SimConnectRun( arguments );
+    } else if ( line == "AT+CIPSTATUS" ) {
+        esp8266SimStatusRun();
+    } else if ( line == "AT+CIFSR" ) {
+        esp8266SimIpRun();
+    } else if ( esp8266SimArgumentsRead( line, "AT+CIPMUX=", arguments ) ) {
+        esp8266SimMuxRun( arguments );
+    } else if ( esp8266SimArgumentsRead( line, "AT+CIPSERVER=", arguments ) ) {
+        esp8266SimServerRun( arguments );
+    } else if ( esp8266SimArgumentsRead( line, "AT+CIPSEND=", arguments ) ) {
+        esp8266SimSendRun( arguments );
+    } else if ( line == "AT+CIPCLOSE" ) {
+        esp8266SimCloseRun( arguments );
+    } else if ( esp8266SimArgumentsRead( line, "AT+CIPCLOSE=", arguments ) ) {
+        esp8266SimCloseRun( arguments );
+    } else {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+    }
+}
+
+// The boot messages come at 74880 bps, garbage at the UART rate, before
+// "ready". Every link, the server and the station connection are lost.
+static void esp8266SimResetRun()
+{
+    std::string boot = "\r\n";
+    int i;
+
+    esp8266SimAnswer( "\r\nOK\r\n" );
+    for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+        if ( simLinks[i].open ) {
+            esp8266SimLinkClose( i );
+        }
+    }
+    esp8266SimListenStop();
+    simServer = false;
+    simMux = false;
+    simStationConnected = false;
+    simSendRemaining = 0;
+
+    for ( i = 0; i < ESP8266_SIM_BOOT_GARBAGE_BYTES; i++ ) {
+        boot += (char)( 0x80 | simRandom() % 0x80 );
+    }
+    boot += "\r\nready\r\n";
+    simBusy = ESP8266_SIM_RESETTING;
+    simBusyUntilUs = hostClockUsRead() + esp8266SimAnswerUs() +
+                     simConfig.resetUs;
+    esp8266SimWrite( esp8266SimAnswerUs() + simConfig.resetUs, boot );
+}
+
+// AT+CWJAP="ssid","password". The answer comes connectUs later and the
+// module is busy until then. The error codes are those of "+CWJAP:".
+static void esp8266SimConnectRun( const std::vector<std::string>& arguments )
+{
+    uint64_t answerUs = esp8266SimAnswerUs() + simConfig.connectUs;
+    std::string text;
+
+    if ( arguments.size() != 2 || simMode == 2 ) {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+    if ( simStationConnected ) {
+        text = "WIFI DISCONNECT\r\n";
+    }
+    simStationConnected = false;
+    if ( arguments[0] != simConfig.ssid ) {
+        text += "+CWJAP:3\r\n\r\nFAIL\r\n";
+    } else if ( arguments[1] != simConfig.password ) {
+        text += "+CWJAP:2\r\n\r\nFAIL\r\n";
+    } else {
+        text += "WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n";
+        simStationConnected = true;
+        simStationUpUs = hostClockUsRead() + answerUs;
+    }
+    simBusy = ESP8266_SIM_CONNECTING;
+    simBusyUntilUs = hostClockUsRead() + answerUs;
+    esp8266SimWrite( answerUs, text );
+}
+
+// STATUS:2 connected, 3 with links open, 5 not connected
+static void esp8266SimStatusRun()
+{
+    std::string text;
+    char line[80];
+    int status = 5;
+    int i;
+
+    if ( esp8266SimConnectedRead() ) {
+        status = 2;
+        for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+            if ( simLinks[i].open ) {
+                status = 3;
+            }
+        }
+    }
+    snprintf( line, sizeof(line), "STATUS:%d\r\n", status );
+    text = line;
+    for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+        if ( simLinks[i].open ) {
+            snprintf( line, sizeof(line),
+                      "+CIPSTATUS:%d,\"TCP\",\"%s\",%u,%u,1\r\n", i,
+                      simLinks[i].socket >= 0 ? "127.0.0.1" : "192.168.1.20",
+                      simLinks[i].remotePort, simServerPort );
+            text += line;
+        }
+    }
+    esp8266SimAnswer( text + "\r\nOK\r\n" );
+}
+
+static void esp8266SimIpRun()
+{
+    std::string ip = esp8266SimConnectedRead() ? simConfig.ip : "0.0.0.0";
+
+    esp8266SimAnswer( "+CIFSR:STAIP,\"" + ip + "\"\r\n"
+                      "+CIFSR:STAMAC,\"5c:cf:7f:00:00:01\"\r\n\r\nOK\r\n" );
+}
+
+// The mode can only change while the server is down and no link is open
+static void esp8266SimMuxRun( const std::vector<std::string>& arguments )
+{
+    int mux;
+    int i;
+
+    if ( arguments.size() != 1 || !esp8266SimNumberRead( arguments[0], &mux ) ||
+         mux < 0 || mux > 1 ) {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+    if ( simServer ) {
+        esp8266SimAnswer( "CIPSERVER must be 0\r\n\r\nERROR\r\n" );
+        return;
+    }
+    for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+        if ( simLinks[i].open ) {
+            esp8266SimAnswer( "link is builded\r\n\r\nERROR\r\n" );
+            return;
+        }
+    }
+    simMux = mux == 1;
+    esp8266SimAnswer( "\r\nOK\r\n" );
+}
+
+// AT+CIPSERVER=1[,port] needs AT+CIPMUX=1. The open links are kept when
+// the server is deleted.
+static void esp8266SimServerRun( const std::vector<std::string>& arguments )
+{
+    int mode;
+    int port = ESP8266_SIM_DEFAULT_SERVER_PORT;
+
+    if ( arguments.empty() || arguments.size() > 2 ||
+         !esp8266SimNumberRead( arguments[0], &mode ) || mode < 0 ||
+         mode > 1 || ( arguments.size() == 2 &&
+                       ( !esp8266SimNumberRead( arguments[1], &port ) ||
+                         port <= 0 || port > 65535 ) ) ) {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+    if ( mode == 0 ) {
+        esp8266SimListenStop();
+        simServer = false;
+        esp8266SimAnswer( "\r\nOK\r\n" );
+        return;
+    }
+    if ( !simMux || ( simConfig.forward && !esp8266SimListenStart() ) ) {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+    simServer = true;
+    simServerPort = (uint16_t) port;
+    esp8266SimAnswer( "\r\nOK\r\n" );
+}
+
+// AT+CIPSEND=<link>,<length> with AT+CIPMUX=1, AT+CIPSEND=<length> with
+// link 0 otherwise. The data is taken once the "> " prompt was written.
+static void esp8266SimSendRun( const std::vector<std::string>& arguments )
+{
+    int linkId = 0;
+    int length;
+
+    if ( arguments.size() != ( simMux ? 2u : 1u ) ||
+         ( simMux && !esp8266SimNumberRead( arguments[0], &linkId ) ) ||
+         !esp8266SimNumberRead( arguments.back(), &length ) ||
+         length <= 0 || length > ESP8266_SIM_MAX_SEND ) {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+    if ( !esp8266SimLinkValid( linkId ) ) {
+        esp8266SimAnswer( "link is not valid\r\n\r\nERROR\r\n" );
+        return;
+    }
+    simSendLink = linkId;
+    simSendRemaining = length;
+    simSendData.clear();
+    simSendStartUs = hostClockUsRead() + esp8266SimAnswerUs() +
+                     strlen( ESP8266_SIM_PROMPT ) * esp8266SimByteUs();
+    esp8266SimAnswer( ESP8266_SIM_PROMPT );
+}
+
+static void esp8266SimSendComplete()
+{
+    char text[48];
+
+    if ( !esp8266SimLinkValid( simSendLink ) ) {
+        esp8266SimAnswer( "\r\nSEND FAIL\r\n" );
+        return;
+    }
+    esp8266SimLinkDeliver( simSendLink, simSendData.data(),
+                           simSendData.size() );
+    snprintf( text, sizeof(text), "\r\nRecv %d bytes\r\n\r\nSEND OK\r\n",
+              (int) simSendData.size() );
+    esp8266SimAnswer( text );
+}
+
+// AT+CIPCLOSE=<link> with AT+CIPMUX=1, link 5 closes them all
+static void esp8266SimCloseRun( const std::vector<std::string>& arguments )
+{
+    char text[32];
+    int linkId = 0;
+    int i;
+
+    if ( arguments.size() != ( simMux ? 1u : 0u ) ||
+         ( simMux && !esp8266SimNumberRead( arguments[0], &linkId ) ) ) {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+    if ( simMux && linkId == ESP8266_SIM_MAX_LINKS ) {
+        for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+            if ( simLinks[i].open ) {
+                esp8266SimLinkClose( i );
+            }
+        }
+        esp8266SimAnswer( "\r\nOK\r\n" );
+        return;
+    }
+    if ( !esp8266SimLinkValid( linkId ) ) {
+        esp8266SimAnswer( "\r\nERROR\r\n" );
+        return;
+    }
+    esp8266SimLinkClose( linkId );
+    if ( simMux ) {
+        snprintf( text, sizeof(text), "%d,CLOSED\r\n\r\nOK\r\n", linkId );
+    } else {
+        snprintf( text, sizeof(text), "CLOSED\r\n\r\nOK\r\n" );
+    }
+    esp8266SimAnswer( text );
+}
+
+// Splits what follows the prefix at the commas, the quotes are removed
+static bool esp8266SimArgumentsRead( const std::string& line,
+                                     const char* prefix,
+                                     std::vector<std::string>& arguments )
+{
+    size_t length = strlen( prefix );
+    bool quoted = false;
+    size_t i;
+
+    if ( line.compare( 0, length, prefix ) != 0 ) {
+        return false;
+    }
+    arguments.assign( 1, "" );
+    for ( i = length; i < line.size(); i++ ) {
+        if ( line[i] == '"' ) {
+            quoted = !quoted;
+        } else if ( line[i] == ',' && !quoted ) {
+            arguments.push_back( "" );
+        } else {
+            arguments.back() += line[i];
+        }
+    }
+    return true;
+}
+
+static bool esp8266SimNumberRead( const std::string& text, int* number )
+{
+    char* end;
+    long value;
+
+    if ( text.empty() || text.size() > 6 ) {
+        return false;
+    }
+    value = strtol( text.c_str(), &end, 10 );
+    if ( *end != '\0' ) {
+        return false;
+    }
+    *number = (int) value;
+    return true;
+}
+
+static bool esp8266SimLinkValid( int linkId )
+{
+    return linkId >= 0 && linkId < ESP8266_SIM_MAX_LINKS &&
+           simLinks[linkId].open;
+}
+
+static int esp8266SimLinkOpen( int socket )
+{
+    char text[16];
+    int i;
+
+    for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+        if ( !simLinks[i].open ) {
+            simLinks[i].open = true;
+            simLinks[i].socket = socket;
+            simLinks[i].remotePort = simNextRemotePort++;
+            snprintf( text, sizeof(text), "%d,CONNECT\r\n", i );
+            esp8266SimWrite( simConfig.latencyUs, text );
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Closed by the board or by a reset, the client sees it at once
+static void esp8266SimLinkClose( int linkId )
+{
+    simLinks[linkId].open = false;
+    if ( simLinks[linkId].socket >= 0 ) {
+        close( simLinks[linkId].socket );
+        simLinks[linkId].socket = -1;
+    } else if ( simClientHandler != NULL ) {
+        simClientHandler( simClientContext, linkId, NULL, 0 );
+    }
+}
+
+static void esp8266SimLinkDeliver( int linkId, const char* data, int length )
+{
+    ssize_t sent;
+    int position = 0;
+
+    simStats.clientBytesReceived = simStats.clientBytesReceived + length;
+    if ( simLinks[linkId].socket < 0 ) {
+        if ( simClientHandler != NULL ) {
+            simClientHandler( simClientContext, linkId, data, length );
+        }
+        return;
+    }
+    while ( position < length ) {
+        sent = send( simLinks[linkId].socket, data + position,
+                     length - position, MSG_NOSIGNAL );
+        if ( sent > 0 ) {
+            position = position + sent;
+        } else if ( sent < 0 && errno != EAGAIN && errno != EINTR ) {
+            break;
+        }
+    }
+}
+
+static void esp8266SimIpdWrite( int linkId, const char* data, int length )
+{
+    char header[32];
+    int part;
+
+    simStats.clientBytesSent = simStats.clientBytesSent + length;
+    while ( length > 0 ) {
+        part = length < ESP8266_SIM_MAX_IPD ? length : ESP8266_SIM_MAX_IPD;
+        snprintf( header, sizeof(header), "\r\n+IPD,%d,%d:", linkId, part );
+        esp8266SimWrite( simConfig.latencyUs,
+                         std::string( header ) + std::string( data, part ) );
+        data = data + part;
+        length = length - part;
+    }
+}
+
+// The loopback clients are accepted and read on every poll, the poll
+// runs as an interrupt would on the virtual clock
+static bool esp8266SimListenStart()
+{
+    struct sockaddr_in address;
+    socklen_t addressLength = sizeof(address);
+    int enable = 1;
+
+    if ( simListenSocket >= 0 ) {
+        return true;
+    }
+    simListenSocket = socket( AF_INET, SOCK_STREAM, 0 );
+    if ( simListenSocket < 0 ) {
+        return false;
+    }
+    setsockopt( simListenSocket, SOL_SOCKET, SO_REUSEADDR, &enable,
+                sizeof(enable) );
+    memset( &address, 0, sizeof(address) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address.sin_port = htons( simConfig.forwardPort );
+    if ( bind( simListenSocket, (struct sockaddr*) &address,
+               sizeof(address) ) != 0 ||
+         listen( simListenSocket, ESP8266_SIM_MAX_LINKS ) != 0 ||
+         getsockname( simListenSocket, (struct sockaddr*) &address,
+                      &addressLength ) != 0 ) {
+        close( simListenSocket );
+        simListenSocket = -1;
+        return false;
+    }
+    fcntl( simListenSocket, F_SETFL, O_NONBLOCK );
+    simForwardPort = ntohs( address.sin_port );
+    hostClockEventArm( &simPollEvent, hostClockUsRead() +
+                       ESP8266_SIM_FORWARD_POLL_US,
+                       ESP8266_SIM_FORWARD_POLL_US );
+    return true;
+}
+
+static void esp8266SimListenStop()
+{
+    if ( simListenSocket >= 0 ) {
+        close( simListenSocket );
+        simListenSocket = -1;
+    }
+    hostClockEventDisarm( &simPollEvent );
+}
+
+// A client that finds no free link is turned away, a client that closes
+// its side closes the link
+static void esp8266SimForwardPoll( void* context )
+{
+    char data[ESP8266_SIM_MAX_IPD];
+    char text[16];
+    ssize_t received;
+    int client;
+    int i;
+
+    while ( ( client = accept( simListenSocket, NULL, NULL ) ) >= 0 ) {
+        fcntl( client, F_SETFL, O_NONBLOCK );
+        if ( !esp8266SimConnectedRead() || esp8266SimLinkOpen( client ) < 0 ) {
+            close( client );
+        }
+    }
+    for ( i = 0; i < ESP8266_SIM_MAX_LINKS; i++ ) {
+        if ( !simLinks[i].open || simLinks[i].socket < 0 ) {
+            continue;
+        }
+        received = recv( simLinks[i].socket, data, sizeof(data), 0 );
+        if ( received > 0 ) {
+            esp8266SimIpdWrite( i, data, received );
+        } else if ( received == 0 ||
+                    ( errno != EAGAIN && errno != EINTR ) ) {
+            esp8266SimLinkClose( i );
+            snprintf( text, sizeof(text), "%d,CLOSED\r\n", i );
+            esp8266SimWrite( simConfig.latencyUs, text );
+        }
+    }
+}
+
+static uint64_t esp8266SimByteUs()
+{
+    return (uint64_t) ESP8266_SIM_BITS_PER_BYTE * 1000000 / simConfig.baud;
+}
+
+// From the end of the last byte of the command
+static uint64_t esp8266SimAnswerUs()
+{
+    return esp8266SimByteUs() + simConfig.latencyUs;
+}
+
+static void esp8266SimWrite( uint64_t delayUs, const std::string& text )
+{
+    std::string kept;
+    size_t i;
+
+    for ( i = 0; i < text.size(); i++ ) {
+        if ( simConfig.dropOneIn > 0 &&
+             simRandom() % simConfig.dropOneIn == 0 ) {
+            simStats.droppedBytes++;
+        } else {
+            kept += text[i];
+        }
+    }
+    hostSerialRxDelayedWrite( simTx, delayUs, kept.data(), kept.size() );
+}
+
+static void esp8266SimAnswer( const std::string& text )
+{
+    esp8266SimWrite( esp8266SimAnswerUs(), text );
+}
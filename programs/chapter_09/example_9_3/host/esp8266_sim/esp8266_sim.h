@@ -0,0 +1,78 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _ESP8266_SIM_H_
+#define _ESP8266_SIM_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PinNames.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define ESP8266_SIM_MAX_LINKS       5
+#define ESP8266_SIM_MAX_SEND        2048
+#define ESP8266_SIM_MAX_IPD         1460
+
+//=====[Declaration of public data types]======================================
+
+// The module behind a board UART. Its answers go through the UART RX seam,
+// so they arrive at the baud rate of the UART after latencyUs. Bytes the
+// board sends at another baud rate than the module's are garbage to it.
+// A dropped byte never reaches the board, an error reply is "ERROR" in place
+// of the normal answer of a command, both drawn from the seed.
+typedef struct esp8266SimConfig {
+    int baud;
+    uint32_t latencyUs;
+    uint32_t resetUs;
+    uint32_t connectUs;
+    uint32_t dropOneIn;          // 0: no byte is dropped
+    uint32_t errorOneIn;         // 0: no error reply
+    uint32_t seed;
+    bool echo;
+    const char* ssid;
+    const char* password;
+    const char* ip;
+    bool forward;                // AT+CIPSERVER also listens on the loopback
+    uint16_t forwardPort;        // 0: any free port
+} esp8266SimConfig_t;
+
+typedef struct esp8266SimStats {
+    uint32_t commands;
+    uint32_t errorReplies;
+    uint32_t droppedBytes;
+    uint32_t garbageBytes;
+    uint32_t clientBytesSent;
+    uint32_t clientBytesReceived;
+} esp8266SimStats_t;
+
+// Called with the bytes the board sent to a client through AT+CIPSEND, and
+// with NULL data once the link is closed by either side
+typedef void (*esp8266SimClientHandler_t)( void* context, int linkId,
+                                           const char* data, int length );
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// The defaults are those of an ESP-01 with the AT firmware at 115200 bps
+void esp8266SimConfigDefaultRead( esp8266SimConfig_t* config );
+void esp8266SimAttach( PinName tx, const esp8266SimConfig_t* config );
+void esp8266SimDetach();
+void esp8266SimStatsRead( esp8266SimStats_t* stats );
+bool esp8266SimConnectedRead();
+
+// Simulated clients of the TCP server the board created. Each call returns
+// at once, what the module writes to the board is paced as its answers.
+int esp8266SimClientConnect();
+bool esp8266SimClientSend( int linkId, const char* data, int length );
+void esp8266SimClientClose( int linkId );
+void esp8266SimClientHandlerSet( esp8266SimClientHandler_t handler,
+                                 void* context );
+
+// The loopback port the server listens on while forwarding, 0 if none
+uint16_t esp8266SimForwardPortRead();
+
+//=====[#include guards - end]=================================================
+
+#endif // _ESP8266_SIM_H_
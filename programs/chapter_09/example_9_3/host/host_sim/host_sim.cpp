@@ -0,0 +1,1024 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "host_sim.h"
+#include "ff.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <deque>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+//=====[Declaration of private defines]========================================
+
+#define HOST_CLOCK_MAX_EVENTS         64
+#define HOST_SERIAL_RX_FIFO_SIZE      1     // the USART data register
+#define HOST_SERIAL_DEFAULT_BAUD      9600
+#define HOST_SERIAL_BITS_PER_BYTE     10    // start, 8 data and stop bits
+#define HOST_SD_CARD_SECTOR_SIZE      512
+#define HOST_SD_CARD_DEFAULT_SIZE     ( 64ULL * 1024 * 1024 )
+#define HOST_SD_CARD_DEFAULT_DIR      "sd_card"
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct hostSerialRxByte {
+    uint64_t arrivalUs;
+    char c;
+} hostSerialRxByte_t;
+
+struct hostSerial {
+    PinName tx;
+    int baud;
+    std::deque<hostSerialRxByte_t> rxLine;
+    std::deque<char> rxFifo;
+    hostClockEvent_t rxEvent;
+    void (*rxHandler)( void* context );
+    void* rxContext;
+    hostSerialTxHandler_t txHandler;
+    void* txContext;
+    hostClockEvent_t txEvent;
+    void (*txIrqHandler)( void* context );
+    void* txIrqContext;
+    uint32_t rxOverruns;
+    uint64_t txBytes;
+    uint64_t txIdleUs;
+    uint64_t txRemainderNs;
+};
+
+typedef struct hostPin {
+    int level;
+    bool driven;
+    float analog;
+    hostClockEvent_t edgeEvent;
+    bool edgeRising;
+    void (*edgeHandler)( void* context, bool rising );
+    void* edgeContext;
+} hostPin_t;
+
+typedef struct hostFileInfo {
+    bool written;
+    bool append;
+    long lastSector;
+} hostFileInfo_t;
+
+//=====[Declaration and initialization of private global variables]============
+
+static uint64_t clockUs = 0;
+static hostClockEvent_t* clockEvents[HOST_CLOCK_MAX_EVENTS];
+static int clockNumberOfEvents = 0;
+static int criticalSectionNesting = 0;
+static int eventNesting = 0;
+
+static double clockSpeed = 0.0;
+static std::chrono::steady_clock::time_point clockPaceWallStart;
+static uint64_t clockPaceStartUs = 0;
+
+static int64_t rtcBaseSeconds = 0;
+
+static hostPin_t pins[HOST_NUMBER_OF_PINS];
+
+static char sdCardDirectory[HOST_SD_CARD_PATH_MAX_LENGTH] =
+    HOST_SD_CARD_DEFAULT_DIR;
+static bool sdCardInserted = true;
+static hostSdCardTiming_t sdCardTiming = { 1500, 16, 250, 1000, 2000 };
+static uint64_t sdCardBusyUs = 0;
+static uint64_t spiBusyUs = 0;
+static uint64_t sdCardSize = HOST_SD_CARD_DEFAULT_SIZE;
+static char sdCardMountName[HOST_SD_CARD_PATH_MAX_LENGTH] = "";
+static bool sdCardMounted = false;
+static std::map<std::string, long> sdCardDirectoryEntries;
+static std::map<FILE*, hostFileInfo_t> sdCardFiles;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void clockRunUntil( uint64_t targetUs );
+static hostClockEvent_t* clockNextEventRead();
+static void clockEventFire( hostClockEvent_t* event );
+static void clockPace();
+static void timeZoneSet();
+
+static std::map<PinName, hostSerial_t*>& serialsRead();
+static hostSerial_t* serialFind( PinName tx );
+static uint64_t serialByteTimeUs( hostSerial_t* serial );
+static void serialRxEventHandler( void* context );
+static void serialRxEventArm( hostSerial_t* serial );
+static void serialTxEventHandler( void* context );
+
+static hostPin_t* pinRead( PinName pin );
+static void pinEdgeEventHandler( void* context );
+
+static bool sdCardPathTranslate( const char* path, std::string& hostPath );
+static void sdCardDirectoryScanCharge( const std::string& hostPath );
+static long& sdCardDirectoryEntriesRead( const std::string& hostDirectory );
+static long sdCardDirectoryEntriesCount( const std::string& hostDirectory );
+static std::string sdCardParentRead( const std::string& hostPath );
+
+//=====[Implementations of public functions]===================================
+
+void hostClockSpeedSet( double speed )
+{
+    clockSpeed = speed;
+    clockPaceWallStart = std::chrono::steady_clock::now();
+    clockPaceStartUs = clockUs;
+}
+
+uint64_t hostClockUsRead()
+{
+    return clockUs;
+}
+
+// Time spent by the running code, the interrupts that become due meanwhile
+// run at their deadline
+void hostClockAdvance( uint64_t us )
+{
+    clockRunUntil( clockUs + us );
+}
+
+// Runs the clock to the next event, or to the deadline if it comes first
+void hostClockSleepUntil( uint64_t deadlineUs )
+{
+    hostClockEvent_t* event = clockNextEventRead();
+
+    if ( ( event != NULL ) && ( event->deadlineUs < deadlineUs ) ) {
+        deadlineUs = event->deadlineUs;
+    }
+    if ( deadlineUs < clockUs ) {
+        deadlineUs = clockUs;
+    }
+    clockRunUntil( deadlineUs );
+}
+
+void hostClockEventArm( hostClockEvent_t* event, uint64_t deadlineUs,
+                        uint64_t periodUs )
+{
+    event->deadlineUs = deadlineUs;
+    event->periodUs = periodUs;
+    if ( !event->armed ) {
+        if ( clockNumberOfEvents == HOST_CLOCK_MAX_EVENTS ) {
+            fprintf( stderr, "host_sim: too many clock events\n" );
+            abort();
+        }
+        event->armed = true;
+        clockEvents[clockNumberOfEvents] = event;
+        clockNumberOfEvents++;
+    }
+}
+
+void hostClockEventDisarm( hostClockEvent_t* event )
+{
+    int i;
+
+    if ( !event->armed ) {
+        return;
+    }
+    event->armed = false;
+    for ( i = 0; i < clockNumberOfEvents; i++ ) {
+        if ( clockEvents[i] == event ) {
+            clockNumberOfEvents--;
+            clockEvents[i] = clockEvents[clockNumberOfEvents];
+            return;
+        }
+    }
+}
+
+// Like the Cortex-M WFI, a pending interrupt ends the sleep at once, also
+// inside a critical section where its handler only runs on leaving it
+void hostSleep()
+{
+    hostClockEvent_t* event = clockNextEventRead();
+
+    if ( event == NULL ) {
+        return;
+    }
+    if ( event->deadlineUs <= clockUs ) {
+        clockRunUntil( clockUs );
+    } else if ( criticalSectionNesting > 0 ) {
+        clockUs = event->deadlineUs;
+        clockPace();
+    } else {
+        clockRunUntil( event->deadlineUs );
+    }
+}
+
+void hostCriticalSectionEnter()
+{
+    criticalSectionNesting++;
+}
+
+void hostCriticalSectionExit()
+{
+    if ( criticalSectionNesting > 0 ) {
+        criticalSectionNesting--;
+    }
+    if ( criticalSectionNesting == 0 ) {
+        clockRunUntil( clockUs );
+    }
+}
+
+void hostRtcWrite( int64_t seconds )
+{
+    rtcBaseSeconds = seconds - (int64_t)( clockUs / 1000000 );
+}
+
+int64_t hostRtcRead()
+{
+    return rtcBaseSeconds + (int64_t)( clockUs / 1000000 );
+}
+
+void hostPinWrite( PinName pin, int value )
+{
+    hostPin_t* hostPin = pinRead( pin );
+    int level = value ? 1 : 0;
+
+    if ( hostPin == NULL ) {
+        return;
+    }
+    hostPin->driven = true;
+    if ( hostPin->level == level ) {
+        return;
+    }
+    hostPin->level = level;
+    if ( hostPin->edgeHandler != NULL ) {
+        hostPin->edgeRising = level;
+        hostClockEventArm( &hostPin->edgeEvent, clockUs, 0 );
+        clockRunUntil( clockUs );
+    }
+}
+
+int hostPinRead( PinName pin )
+{
+    hostPin_t* hostPin = pinRead( pin );
+    return hostPin != NULL ? hostPin->level : 0;
+}
+
+void hostAnalogWrite( PinName pin, float value )
+{
+    hostPin_t* hostPin = pinRead( pin );
+    if ( hostPin != NULL ) {
+        hostPin->analog = value;
+    }
+}
+
+float hostAnalogRead( PinName pin )
+{
+    hostPin_t* hostPin = pinRead( pin );
+    return hostPin != NULL ? hostPin->analog : 0.0f;
+}
+
+void hostSerialRxWrite( PinName tx, const char* data, int length )
+{
+    hostSerialRxDelayedWrite( tx, 0, data, length );
+}
+
+// Each byte takes its time on the line after the previous one, so a burst
+// arrives at the baud rate whatever the length
+void hostSerialRxDelayedWrite( PinName tx, uint64_t delayUs,
+                               const char* data, int length )
+{
+    hostSerial_t* serial = serialFind( tx );
+    uint64_t byteTimeUs = serialByteTimeUs( serial );
+    uint64_t arrivalUs = clockUs + delayUs;
+    int i;
+
+    if ( !serial->rxLine.empty() && serial->rxLine.back().arrivalUs > arrivalUs ) {
+        arrivalUs = serial->rxLine.back().arrivalUs;
+    }
+    for ( i = 0; i < length; i++ ) {
+        arrivalUs = arrivalUs + byteTimeUs;
+        serial->rxLine.push_back( { arrivalUs, data[i] } );
+    }
+    serialRxEventArm( serial );
+}
+
+void hostSerialTxHandlerSet( PinName tx, hostSerialTxHandler_t handler,
+                             void* context )
+{
+    hostSerial_t* serial = serialFind( tx );
+    serial->txHandler = handler;
+    serial->txContext = context;
+}
+
+int hostSerialBaudRead( PinName tx )
+{
+    return serialFind( tx )->baud;
+}
+
+uint32_t hostSerialRxOverrunsRead( PinName tx )
+{
+    return serialFind( tx )->rxOverruns;
+}
+
+uint64_t hostSerialTxBytesRead( PinName tx )
+{
+    return serialFind( tx )->txBytes;
+}
+
+void hostSpiBusyUsCharge( uint64_t us )
+{
+    spiBusyUs = spiBusyUs + us;
+    hostClockAdvance( us );
+}
+
+uint64_t hostSpiBusyUsRead()
+{
+    return spiBusyUs;
+}
+
+void hostSdCardDirectorySet( const char* path )
+{
+    sdCardDirectory[0] = '\0';
+    strncat( sdCardDirectory, path, sizeof(sdCardDirectory) - 1 );
+}
+
+const char* hostSdCardDirectoryRead()
+{
+    return sdCardDirectory;
+}
+
+void hostSdCardInsertedWrite( bool inserted )
+{
+    sdCardInserted = inserted;
+    if ( !inserted ) {
+        sdCardMounted = false;
+    }
+}
+
+void hostSdCardTimingWrite( const hostSdCardTiming_t* timing )
+{
+    sdCardTiming = *timing;
+}
+
+void hostSdCardTimingRead( hostSdCardTiming_t* timing )
+{
+    *timing = sdCardTiming;
+}
+
+uint64_t hostSdCardBusyUsRead()
+{
+    return sdCardBusyUs;
+}
+
+void hostSdCardBusyUsCharge( uint64_t us )
+{
+    sdCardBusyUs = sdCardBusyUs + us;
+    hostClockAdvance( us );
+}
+
+void hostSdCardSizeWrite( uint64_t bytes )
+{
+    sdCardSize = bytes;
+}
+
+uint64_t hostSdCardSizeRead()
+{
+    return sdCardSize;
+}
+
+hostSerial_t* hostSerialOpen( PinName tx )
+{
+    return serialFind( tx );
+}
+
+void hostSerialClose( hostSerial_t* serial )
+{
+    serial->rxHandler = NULL;
+    serial->rxContext = NULL;
+}
+
+void hostSerialBaudWrite( hostSerial_t* serial, int baud )
+{
+    serial->baud = baud;
+}
+
+void hostSerialRxHandlerSet( hostSerial_t* serial,
+                             void (*handler)( void* context ), void* context )
+{
+    serial->rxHandler = handler;
+    serial->rxContext = context;
+}
+
+// The TX interrupt is raised whenever the line is idle, right away if it
+// already is
+void hostSerialTxIrqHandlerSet( hostSerial_t* serial,
+                                void (*handler)( void* context ),
+                                void* context )
+{
+    serial->txIrqHandler = handler;
+    serial->txIrqContext = context;
+    if ( handler == NULL ) {
+        hostClockEventDisarm( &serial->txEvent );
+        return;
+    }
+    hostClockEventArm( &serial->txEvent,
+                       serial->txIdleUs > clockUs ? serial->txIdleUs : clockUs,
+                       0 );
+    clockRunUntil( clockUs );
+}
+
+bool hostSerialReadable( hostSerial_t* serial )
+{
+    return !serial->rxFifo.empty();
+}
+
+bool hostSerialWriteable( hostSerial_t* serial )
+{
+    return serial->txIdleUs <= clockUs;
+}
+
+int hostSerialGetc( hostSerial_t* serial )
+{
+    char c;
+
+    // A blocking read waits for the line
+    while ( serial->rxFifo.empty() ) {
+        if ( serial->rxLine.empty() ) {
+            return -1;
+        }
+        hostClockSleepUntil( serial->rxLine.front().arrivalUs );
+    }
+    c = serial->rxFifo.front();
+    serial->rxFifo.pop_front();
+    return (unsigned char) c;
+}
+
+// The write waits for the previous byte to leave the line, as the polled
+// Mbed UART write does, and then returns while its own byte is sent
+void hostSerialPutc( hostSerial_t* serial, int c )
+{
+    uint64_t byteTimeNs;
+
+    if ( serial->txIdleUs > clockUs ) {
+        hostClockAdvance( serial->txIdleUs - clockUs );
+    }
+    serial->txBytes++;
+    if ( serial->txHandler != NULL ) {
+        serial->txHandler( serial->txContext, (char) c );
+    }
+    byteTimeNs = (uint64_t) HOST_SERIAL_BITS_PER_BYTE * 1000000000ULL /
+                 serial->baud + serial->txRemainderNs;
+    serial->txRemainderNs = byteTimeNs % 1000;
+    serial->txIdleUs = clockUs + byteTimeNs / 1000;
+    if ( serial->txIrqHandler != NULL ) {
+        hostClockEventArm( &serial->txEvent, serial->txIdleUs, 0 );
+    }
+}
+
+void hostPinModeWrite( PinName pin, PinMode mode )
+{
+    hostPin_t* hostPin = pinRead( pin );
+
+    if ( ( hostPin != NULL ) && !hostPin->driven ) {
+        hostPin->level = ( mode == PullUp ) ? 1 : 0;
+    }
+}
+
+void hostPinOutputWrite( PinName pin, int value )
+{
+    hostPin_t* hostPin = pinRead( pin );
+    if ( hostPin != NULL ) {
+        hostPin->level = value ? 1 : 0;
+    }
+}
+
+void hostPinEdgeHandlerSet( PinName pin, void (*handler)( void* context,
+                                                          bool rising ),
+                            void* context )
+{
+    hostPin_t* hostPin = pinRead( pin );
+
+    if ( hostPin == NULL ) {
+        return;
+    }
+    hostPin->edgeHandler = handler;
+    hostPin->edgeContext = context;
+    hostPin->edgeEvent.handler = pinEdgeEventHandler;
+    hostPin->edgeEvent.context = hostPin;
+    if ( handler == NULL ) {
+        hostClockEventDisarm( &hostPin->edgeEvent );
+    }
+}
+
+//=====[Implementations of the retargeted C library calls]=====================
+
+FILE* hostFileOpen( const char* path, const char* mode )
+{
+    std::string hostPath;
+    bool exists;
+    FILE* file;
+
+    if ( !sdCardPathTranslate( path, hostPath ) ) {
+        return NULL;
+    }
+    sdCardDirectoryScanCharge( hostPath );
+    exists = access( hostPath.c_str(), F_OK ) == 0;
+    file = fopen( hostPath.c_str(), mode );
+    if ( file == NULL ) {
+        return NULL;
+    }
+    if ( !exists ) {
+        sdCardDirectoryEntriesRead( sdCardParentRead( hostPath ) )++;
+    }
+    sdCardFiles[file] = { false, strchr( mode, 'a' ) != NULL, -1 };
+    return file;
+}
+
+// Closing a written file flushes its last sector and updates its directory
+// entry
+int hostFileClose( FILE* file )
+{
+    std::map<FILE*, hostFileInfo_t>::iterator info = sdCardFiles.find( file );
+
+    if ( info != sdCardFiles.end() ) {
+        if ( info->second.written ) {
+            hostSdCardBusyUsCharge( sdCardTiming.closeUs );
+        }
+        sdCardFiles.erase( info );
+    }
+    return fclose( file );
+}
+
+// The sector in the file buffer is not read again
+size_t hostFileRead( void* buffer, size_t size, size_t n, FILE* file )
+{
+    long position = ftell( file );
+    size_t items = fread( buffer, size, n, file );
+    size_t bytes = items * size;
+    hostFileInfo_t& info = sdCardFiles[file];
+    long firstSector = position / HOST_SD_CARD_SECTOR_SIZE;
+    long lastSector;
+    long sectors;
+
+    if ( bytes == 0 ) {
+        return items;
+    }
+    lastSector = ( position + (long) bytes - 1 ) / HOST_SD_CARD_SECTOR_SIZE;
+    sectors = lastSector - firstSector + 1;
+    if ( firstSector == info.lastSector ) {
+        sectors--;
+    }
+    info.lastSector = lastSector;
+    hostSdCardBusyUsCharge( (uint64_t) sectors * sdCardTiming.sectorReadUs );
+    return items;
+}
+
+// Small writes fill the file buffer, a sector is only written once it is
+// full
+size_t hostFileWrite( const void* buffer, size_t size, size_t n, FILE* file )
+{
+    hostFileInfo_t& info = sdCardFiles[file];
+    long position;
+    size_t items;
+    long sectors;
+
+    if ( info.append ) {
+        fseek( file, 0, SEEK_END );
+    }
+    position = ftell( file );
+    items = fwrite( buffer, size, n, file );
+    sectors = ( position + (long)( items * size ) ) / HOST_SD_CARD_SECTOR_SIZE -
+              position / HOST_SD_CARD_SECTOR_SIZE;
+    info.written = true;
+    hostSdCardBusyUsCharge( (uint64_t) sectors * sdCardTiming.sectorWriteUs );
+    return items;
+}
+
+int hostFilePrintf( FILE* file, const char* format, ... )
+{
+    std::vector<char> text;
+    va_list args;
+    int length;
+
+    va_start( args, format );
+    length = vsnprintf( NULL, 0, format, args );
+    va_end( args );
+    if ( length <= 0 ) {
+        return length;
+    }
+    text.resize( length + 1 );
+    va_start( args, format );
+    vsnprintf( text.data(), text.size(), format, args );
+    va_end( args );
+    return (int) hostFileWrite( text.data(), 1, length, file );
+}
+
+int hostFileRemove( const char* path )
+{
+    std::string hostPath;
+
+    if ( !sdCardPathTranslate( path, hostPath ) ) {
+        return -1;
+    }
+    sdCardDirectoryScanCharge( hostPath );
+    if ( remove( hostPath.c_str() ) != 0 ) {
+        return -1;
+    }
+    sdCardDirectoryEntriesRead( sdCardParentRead( hostPath ) )--;
+    sdCardDirectoryEntries.erase( hostPath );
+    return 0;
+}
+
+int hostFileStat( const char* path, struct stat* fileStat )
+{
+    std::string hostPath;
+
+    if ( !sdCardPathTranslate( path, hostPath ) ) {
+        return -1;
+    }
+    sdCardDirectoryScanCharge( hostPath );
+    return stat( hostPath.c_str(), fileStat );
+}
+
+// The new directory takes an entry in its parent, written when it is made
+int hostDirCreate( const char* path, mode_t mode )
+{
+    std::string hostPath;
+
+    if ( !sdCardPathTranslate( path, hostPath ) ) {
+        return -1;
+    }
+    sdCardDirectoryScanCharge( hostPath );
+    if ( mkdir( hostPath.c_str(), mode ) != 0 ) {
+        return -1;
+    }
+    hostSdCardBusyUsCharge( sdCardTiming.closeUs );
+    sdCardDirectoryEntriesRead( sdCardParentRead( hostPath ) )++;
+    sdCardDirectoryEntries[hostPath] = 0;
+    return 0;
+}
+
+DIR* hostDirOpen( const char* path )
+{
+    std::string hostPath;
+
+    if ( !sdCardPathTranslate( path, hostPath ) ) {
+        return NULL;
+    }
+    hostSdCardBusyUsCharge( sdCardTiming.openUs );
+    return opendir( hostPath.c_str() );
+}
+
+// A FAT root directory has no "." and ".." entries
+struct dirent* hostDirRead( DIR* dir )
+{
+    struct dirent* entry;
+
+    do {
+        entry = readdir( dir );
+    } while ( ( entry != NULL ) && ( ( strcmp( entry->d_name, "." ) == 0 ) ||
+                                     ( strcmp( entry->d_name, ".." ) == 0 ) ) );
+    if ( entry != NULL ) {
+        hostSdCardBusyUsCharge( sdCardTiming.directoryEntryUs );
+    }
+    return entry;
+}
+
+int hostDirClose( DIR* dir )
+{
+    return closedir( dir );
+}
+
+//=====[Implementations of the FatFs directory calls]==========================
+
+// "0:/" is the root of the FATFileSystem volume
+FRESULT f_opendir( FATFS_DIR* dp, const TCHAR* path )
+{
+    std::string hostPath;
+
+    dp->dir = NULL;
+    if ( strncmp( path, "0:", 2 ) != 0 ) {
+        return FR_INVALID_DRIVE;
+    }
+    if ( !sdCardPathTranslate( ( std::string( "/" ) + sdCardMountName +
+                                 ( path + 2 ) ).c_str(), hostPath ) ) {
+        return FR_NOT_READY;
+    }
+    hostSdCardBusyUsCharge( sdCardTiming.openUs );
+    dp->dir = opendir( hostPath.c_str() );
+    if ( dp->dir == NULL ) {
+        return FR_NO_PATH;
+    }
+    dp->hostPath[0] = '\0';
+    strncat( dp->hostPath, hostPath.c_str(), sizeof(dp->hostPath) - 1 );
+    return FR_OK;
+}
+
+// The size, date and attributes are those kept in the directory entry, so
+// they cost no more than its name. An empty name is the end of the directory.
+FRESULT f_readdir( FATFS_DIR* dp, FILINFO* fno )
+{
+    struct dirent* entry;
+    struct stat fileStat;
+    struct tm* fileTime;
+    std::string entryPath;
+
+    fno->fname[0] = '\0';
+    if ( dp->dir == NULL ) {
+        return FR_DISK_ERR;
+    }
+    entry = hostDirRead( dp->dir );
+    if ( entry == NULL ) {
+        return FR_OK;
+    }
+    strncat( fno->fname, entry->d_name, sizeof(fno->fname) - 1 );
+    entryPath = std::string( dp->hostPath ) + "/" + entry->d_name;
+    if ( stat( entryPath.c_str(), &fileStat ) != 0 ) {
+        return FR_DISK_ERR;
+    }
+    fileTime = localtime( &fileStat.st_mtime );
+    fno->fsize = (uint32_t) fileStat.st_size;
+    fno->fdate = (uint16_t)( ( ( fileTime->tm_year - 80 ) << 9 ) |
+                             ( ( fileTime->tm_mon + 1 ) << 5 ) |
+                             fileTime->tm_mday );
+    fno->ftime = (uint16_t)( ( fileTime->tm_hour << 11 ) |
+                             ( fileTime->tm_min << 5 ) |
+                             ( fileTime->tm_sec / 2 ) );
+    fno->fattrib = S_ISDIR( fileStat.st_mode ) ? AM_DIR : 0;
+    return FR_OK;
+}
+
+FRESULT f_closedir( FATFS_DIR* dp )
+{
+    if ( dp->dir != NULL ) {
+        closedir( dp->dir );
+        dp->dir = NULL;
+    }
+    return FR_OK;
+}
+
+//=====[Implementations of the stand-in internals]=============================
+
+void hostSdCardMountNameWrite( const char* name )
+{
+    sdCardMountName[0] = '\0';
+    strncat( sdCardMountName, name, sizeof(sdCardMountName) - 1 );
+}
+
+bool hostSdCardMount()
+{
+    if ( !sdCardInserted ) {
+        return false;
+    }
+    mkdir( sdCardDirectory, 0777 );
+    sdCardDirectoryEntries.clear();
+    sdCardMounted = sdCardDirectoryEntriesRead( sdCardDirectory ) >= 0;
+    return sdCardMounted;
+}
+
+void hostSdCardUnmount()
+{
+    sdCardMounted = false;
+}
+
+bool hostSdCardReady()
+{
+    return sdCardInserted;
+}
+
+//=====[Implementations of private functions]==================================
+
+// Fires the events that are due up to the target in deadline order. Inside a
+// critical section or an event handler they wait, to be fired once it ends.
+static void clockRunUntil( uint64_t targetUs )
+{
+    hostClockEvent_t* event;
+
+    while ( ( criticalSectionNesting == 0 ) && ( eventNesting == 0 ) ) {
+        event = clockNextEventRead();
+        if ( ( event == NULL ) || ( event->deadlineUs > targetUs ) ) {
+            break;
+        }
+        if ( event->deadlineUs > clockUs ) {
+            clockUs = event->deadlineUs;
+            clockPace();
+        }
+        clockEventFire( event );
+    }
+    if ( targetUs > clockUs ) {
+        clockUs = targetUs;
+        clockPace();
+    }
+}
+
+static hostClockEvent_t* clockNextEventRead()
+{
+    hostClockEvent_t* next = NULL;
+    int i;
+
+    for ( i = 0; i < clockNumberOfEvents; i++ ) {
+        if ( ( next == NULL ) ||
+             ( clockEvents[i]->deadlineUs < next->deadlineUs ) ) {
+            next = clockEvents[i];
+        }
+    }
+    return next;
+}
+
+// The event may be freed by its handler, so it is not used after the call
+static void clockEventFire( hostClockEvent_t* event )
+{
+    void (*handler)( void* context ) = event->handler;
+    void* context = event->context;
+
+    if ( event->periodUs > 0 ) {
+        event->deadlineUs = event->deadlineUs + event->periodUs;
+    } else {
+        hostClockEventDisarm( event );
+    }
+    eventNesting++;
+    handler( context );
+    eventNesting--;
+}
+
+static void clockPace()
+{
+    if ( clockSpeed <= 0.0 ) {
+        return;
+    }
+    std::this_thread::sleep_until( clockPaceWallStart +
+        std::chrono::microseconds( (uint64_t)(
+            ( clockUs - clockPaceStartUs ) / clockSpeed ) ) );
+}
+
+// The RTC keeps UTC, as Mbed OS does
+static void timeZoneSet()
+{
+    setenv( "TZ", "UTC0", 1 );
+    tzset();
+}
+
+static struct hostTimeZoneInit {
+    hostTimeZoneInit() { timeZoneSet(); }
+} hostTimeZone;
+
+// Built on first use, the serials are constructed by static initializers.
+// The other state is plain data for the same reason.
+static std::map<PinName, hostSerial_t*>& serialsRead()
+{
+    static std::map<PinName, hostSerial_t*> serials;
+    return serials;
+}
+
+static hostSerial_t* serialFind( PinName tx )
+{
+    std::map<PinName, hostSerial_t*>& serials = serialsRead();
+    std::map<PinName, hostSerial_t*>::iterator found = serials.find( tx );
+    hostSerial_t* serial;
+
+    if ( found != serials.end() ) {
+        return found->second;
+    }
+    serial = new hostSerial_t();
+    serial->tx = tx;
+    serial->baud = HOST_SERIAL_DEFAULT_BAUD;
+    serial->rxEvent.armed = false;
+    serial->rxEvent.handler = serialRxEventHandler;
+    serial->rxEvent.context = serial;
+    serial->txEvent.armed = false;
+    serial->txEvent.handler = serialTxEventHandler;
+    serial->txEvent.context = serial;
+    serials[tx] = serial;
+    return serial;
+}
+
+static uint64_t serialByteTimeUs( hostSerial_t* serial )
+{
+    return (uint64_t) HOST_SERIAL_BITS_PER_BYTE * 1000000 / serial->baud;
+}
+
+// A byte that finds the data register full overruns and is lost
+static void serialRxEventHandler( void* context )
+{
+    hostSerial_t* serial = (hostSerial_t*) context;
+
+    while ( !serial->rxLine.empty() &&
+            serial->rxLine.front().arrivalUs <= clockUs ) {
+        if ( serial->rxFifo.size() < HOST_SERIAL_RX_FIFO_SIZE ) {
+            serial->rxFifo.push_back( serial->rxLine.front().c );
+        } else {
+            serial->rxOverruns++;
+        }
+        serial->rxLine.pop_front();
+    }
+    if ( ( serial->rxHandler != NULL ) && !serial->rxFifo.empty() ) {
+        serial->rxHandler( serial->rxContext );
+    }
+    serialRxEventArm( serial );
+}
+
+static void serialRxEventArm( hostSerial_t* serial )
+{
+    if ( !serial->rxLine.empty() ) {
+        hostClockEventArm( &serial->rxEvent, serial->rxLine.front().arrivalUs,
+                           0 );
+    }
+}
+
+// The line went idle. Unlike the real level triggered interrupt it is not
+// raised again if the handler writes nothing, it should disable it then.
+static void serialTxEventHandler( void* context )
+{
+    hostSerial_t* serial = (hostSerial_t*) context;
+
+    if ( serial->txIrqHandler != NULL ) {
+        serial->txIrqHandler( serial->txIrqContext );
+    }
+}
+
+static hostPin_t* pinRead( PinName pin )
+{
+    if ( ( pin < 0 ) || ( pin >= HOST_NUMBER_OF_PINS ) ) {
+        return NULL;
+    }
+    return &pins[pin];
+}
+
+static void pinEdgeEventHandler( void* context )
+{
+    hostPin_t* hostPin = (hostPin_t*) context;
+
+    if ( hostPin->edgeHandler != NULL ) {
+        hostPin->edgeHandler( hostPin->edgeContext, hostPin->edgeRising );
+    }
+}
+
+// Only the paths of the mounted volume are reached, anything else fails as
+// it would on the board
+static bool sdCardPathTranslate( const char* path, std::string& hostPath )
+{
+    std::string prefix = std::string( "/" ) + sdCardMountName;
+
+    if ( !sdCardMounted || !sdCardInserted ||
+         ( strncmp( path, prefix.c_str(), prefix.size() ) != 0 ) ||
+         ( ( path[prefix.size()] != '/' ) && ( path[prefix.size()] != '\0' ) ) ) {
+        errno = ENODEV;
+        return false;
+    }
+    hostPath = std::string( sdCardDirectory ) + "/" +
+               ( path[prefix.size()] == '/' ? path + prefix.size() + 1 : "" );
+    return true;
+}
+
+// Finding a file reads the entries of each directory on its path, from the
+// root down to the one that holds the name
+static void sdCardDirectoryScanCharge( const std::string& hostPath )
+{
+    std::string rootPath = std::string( sdCardDirectory ) + "/";
+    size_t separator = rootPath.size() - 1;
+    uint64_t entries = 0;
+    long directoryEntries;
+
+    while ( separator != std::string::npos ) {
+        directoryEntries = sdCardDirectoryEntriesRead(
+                               hostPath.substr( 0, separator ) );
+        if ( directoryEntries > 0 ) {
+            entries = entries + directoryEntries;
+        }
+        separator = hostPath.find( '/', separator + 1 );
+    }
+    hostSdCardBusyUsCharge( sdCardTiming.openUs +
+                            entries * sdCardTiming.directoryEntryUs );
+}
+
+// The entries are counted the first time the directory is used, then
+// followed as files are created and removed. A missing directory has -1.
+static long& sdCardDirectoryEntriesRead( const std::string& hostDirectory )
+{
+    std::map<std::string, long>::iterator entries =
+        sdCardDirectoryEntries.find( hostDirectory );
+
+    if ( entries == sdCardDirectoryEntries.end() ) {
+        entries = sdCardDirectoryEntries.insert( std::make_pair(
+                      hostDirectory,
+                      sdCardDirectoryEntriesCount( hostDirectory ) ) ).first;
+    }
+    return entries->second;
+}
+
+static long sdCardDirectoryEntriesCount( const std::string& hostDirectory )
+{
+    DIR* dir = opendir( hostDirectory.c_str() );
+    struct dirent* entry;
+    long entries = 0;
+
+    if ( dir == NULL ) {
+        return -1;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( ( strcmp( entry->d_name, "." ) != 0 ) &&
+             ( strcmp( entry->d_name, ".." ) != 0 ) ) {
+            entries++;
+        }
+    }
+    closedir( dir );
+    return entries;
+}
+
+static std::string sdCardParentRead( const std::string& hostPath )
+{
+    return hostPath.substr( 0, hostPath.rfind( '/' ) );
+}
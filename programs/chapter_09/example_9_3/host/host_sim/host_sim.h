@@ -0,0 +1,125 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _HOST_SIM_H_
+#define _HOST_SIM_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "PinNames.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define HOST_SD_CARD_PATH_MAX_LENGTH   256
+
+//=====[Declaration of public data types]======================================
+
+// Something that happens at a given virtual time: a Ticker, a Timeout, an
+// event queue entry or a byte arriving at a UART. The handler runs as an
+// interrupt would, as soon as the clock reaches the deadline outside a
+// critical section.
+typedef struct hostClockEvent {
+    uint64_t deadlineUs;
+    uint64_t periodUs;
+    bool armed;
+    void (*handler)( void* context );
+    void* context;
+} hostClockEvent_t;
+
+typedef void (*hostSerialTxHandler_t)( void* context, char c );
+
+// Virtual time charged for each SD card access, an access to a file in the
+// root directory scans it, so it also pays for every directory entry
+typedef struct hostSdCardTiming {
+    uint32_t openUs;
+    uint32_t directoryEntryUs;
+    uint32_t sectorReadUs;
+    uint32_t sectorWriteUs;
+    uint32_t closeUs;
+} hostSdCardTiming_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+// Virtual clock. It only moves when the code sleeps, waits or spends time in
+// a simulated peripheral, so it runs as fast as the CPU allows unless a speed
+// is set, then it is paced against the wall clock.
+void hostClockSpeedSet( double speed );
+uint64_t hostClockUsRead();
+void hostClockAdvance( uint64_t us );
+void hostClockSleepUntil( uint64_t deadlineUs );
+void hostClockEventArm( hostClockEvent_t* event, uint64_t deadlineUs,
+                        uint64_t periodUs );
+void hostClockEventDisarm( hostClockEvent_t* event );
+void hostSleep();
+void hostCriticalSectionEnter();
+void hostCriticalSectionExit();
+
+// Real time clock, follows the virtual clock
+void hostRtcWrite( int64_t seconds );
+int64_t hostRtcRead();
+
+// Pins, an input change runs the InterruptIn edge handlers
+void hostPinWrite( PinName pin, int value );
+int hostPinRead( PinName pin );
+void hostAnalogWrite( PinName pin, float value );
+float hostAnalogRead( PinName pin );
+
+// UARTs are found by their TX pin. The received bytes are paced at the baud
+// rate. A written byte waits for the previous one to leave the line, so a
+// writer is only blocked by the bytes it writes back to back.
+void hostSerialRxWrite( PinName tx, const char* data, int length );
+void hostSerialRxDelayedWrite( PinName tx, uint64_t delayUs,
+                               const char* data, int length );
+void hostSerialTxHandlerSet( PinName tx, hostSerialTxHandler_t handler,
+                             void* context );
+int hostSerialBaudRead( PinName tx );
+uint32_t hostSerialRxOverrunsRead( PinName tx );
+uint64_t hostSerialTxBytesRead( PinName tx );
+
+// SPI, a written word holds the writer for its time on the bus
+void hostSpiBusyUsCharge( uint64_t us );
+uint64_t hostSpiBusyUsRead();
+
+// SD card, the FAT volume is a host directory and the raw block device an
+// image file next to it, so nothing outside that directory is ever touched
+void hostSdCardDirectorySet( const char* path );
+const char* hostSdCardDirectoryRead();
+void hostSdCardInsertedWrite( bool inserted );
+void hostSdCardTimingWrite( const hostSdCardTiming_t* timing );
+void hostSdCardTimingRead( hostSdCardTiming_t* timing );
+uint64_t hostSdCardBusyUsRead();
+void hostSdCardBusyUsCharge( uint64_t us );
+void hostSdCardSizeWrite( uint64_t bytes );
+uint64_t hostSdCardSizeRead();
+
+// Used by the mbed stand-ins
+typedef struct hostSerial hostSerial_t;
+hostSerial_t* hostSerialOpen( PinName tx );
+void hostSerialClose( hostSerial_t* serial );
+void hostSerialBaudWrite( hostSerial_t* serial, int baud );
+void hostSerialRxHandlerSet( hostSerial_t* serial,
+                             void (*handler)( void* context ), void* context );
+void hostSerialTxIrqHandlerSet( hostSerial_t* serial,
+                                void (*handler)( void* context ),
+                                void* context );
+bool hostSerialReadable( hostSerial_t* serial );
+bool hostSerialWriteable( hostSerial_t* serial );
+int hostSerialGetc( hostSerial_t* serial );
+void hostSerialPutc( hostSerial_t* serial, int c );
+
+void hostPinModeWrite( PinName pin, PinMode mode );
+void hostPinOutputWrite( PinName pin, int value );
+void hostPinEdgeHandlerSet( PinName pin, void (*handler)( void* context,
+                                                          bool rising ),
+                            void* context );
+
+void hostSdCardMountNameWrite( const char* name );
+bool hostSdCardMount();
+void hostSdCardUnmount();
+bool hostSdCardReady();
+
+//=====[#include guards - end]=================================================
+
+#endif // _HOST_SIM_H_
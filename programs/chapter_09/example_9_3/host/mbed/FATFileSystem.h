@@ -0,0 +1,25 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _FAT_FILE_SYSTEM_H_
+#define _FAT_FILE_SYSTEM_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "ff.h"
+
+//=====[Declaration of public data types]======================================
+
+// The volume is the host directory set with hostSdCardDirectorySet(), it is
+// reached through the "/<name>/" paths translated in platform/mbed_retarget.h
+class FATFileSystem {
+public:
+    FATFileSystem( const char* name = NULL, BlockDevice* blockDevice = NULL );
+    ~FATFileSystem();
+    int mount( BlockDevice* blockDevice );
+    int unmount();
+};
+
+//=====[#include guards - end]=================================================
+
+#endif // _FAT_FILE_SYSTEM_H_
@@ -0,0 +1,75 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PIN_NAMES_H_
+#define _PIN_NAMES_H_
+
+//=====[Libraries]=============================================================
+
+//=====[Declaration of public defines]=========================================
+
+//=====[Declaration of public data types]======================================
+
+// The NUCLEO-F429ZI pins used by the modules, the ST Zio extended names in
+// st_zio_extended_pins.h are defined over these
+typedef enum {
+    PA_0, PA_4, PA_5, PA_6, PA_7, PA_15,
+    PB_0, PB_2, PB_3, PB_4, PB_5, PB_6, PB_10, PB_11, PB_12, PB_13, PB_15,
+    PC_6, PC_7, PC_8, PC_9, PC_10, PC_11, PC_12,
+    PD_0, PD_1, PD_3, PD_4, PD_5, PD_6, PD_7, PD_11, PD_12, PD_13, PD_14,
+    PE_0, PE_2, PE_3, PE_4, PE_5, PE_6, PE_7, PE_8, PE_10, PE_12, PE_14,
+    PE_15,
+    PF_0, PF_1, PF_2, PF_7, PF_8, PF_9,
+    PG_0, PG_1, PG_2, PG_3,
+    PA_3, PC_0, PC_3, PF_3, PF_5, PF_10, PF_12, PF_13, PF_14, PF_15, PG_9,
+    PG_14, PE_9, PE_11, PE_13, PB_7, PB_14, PB_8, PB_9, PD_8, PD_9,
+    HOST_NUMBER_OF_PINS,
+    NC = -1
+} PinName;
+
+typedef enum {
+    PullNone,
+    PullUp,
+    PullDown,
+} PinMode;
+
+// Arduino Uno connector names
+#define D0          PG_9
+#define D1          PG_14
+#define D2          PF_15
+#define D3          PE_13
+#define D4          PF_14
+#define D5          PE_11
+#define D6          PE_9
+#define D7          PF_13
+#define D8          PF_12
+#define D10         PD_14
+#define D11         PA_7
+#define D12         PA_6
+#define D13         PA_5
+#define D14         PB_9
+#define D15         PB_8
+
+#define A0          PA_3
+#define A1          PC_0
+#define A2          PC_3
+#define A3          PF_3
+#define A4          PF_5
+#define A5          PF_10
+
+#define LED1        PB_0
+#define LED2        PB_7
+#define LED3        PB_14
+
+#define USBTX       PD_8
+#define USBRX       PD_9
+
+#define SPI_MOSI    D11
+#define SPI_MISO    D12
+#define SPI_SCK     D13
+#define SPI_CS      D10
+
+#define PA_4_ALT0   PA_4
+
+//=====[#include guards - end]=================================================
+
+#endif // _PIN_NAMES_H_
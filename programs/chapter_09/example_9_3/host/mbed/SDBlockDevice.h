@@ -0,0 +1,30 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SD_BLOCK_DEVICE_H_
+#define _SD_BLOCK_DEVICE_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+//=====[Declaration of public data types]======================================
+
+// The card is an image file of hostSdCardSizeRead() bytes next to the FAT
+// volume directory, each sector access costs the card timing
+class SDBlockDevice : public BlockDevice {
+public:
+    SDBlockDevice( PinName mosi, PinName miso, PinName sclk, PinName cs,
+                   uint64_t hz = 1000000, bool crcOn = false ) {}
+    virtual ~SDBlockDevice();
+    virtual int init();
+    virtual int deinit();
+    virtual int read( void* buffer, uint64_t address, uint64_t size );
+    virtual int program( const void* buffer, uint64_t address, uint64_t size );
+    virtual uint64_t size() const;
+private:
+    FILE* image = NULL;
+};
+
+//=====[#include guards - end]=================================================
+
+#endif // _SD_BLOCK_DEVICE_H_
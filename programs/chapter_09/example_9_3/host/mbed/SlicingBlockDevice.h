@@ -0,0 +1,35 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SLICING_BLOCK_DEVICE_H_
+#define _SLICING_BLOCK_DEVICE_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+//=====[Declaration of public data types]======================================
+
+// A negative start or stop counts from the end of the underlying device and
+// a stop of 0 is its end, as in Mbed OS
+class SlicingBlockDevice : public BlockDevice {
+public:
+    SlicingBlockDevice( BlockDevice* blockDevice, int64_t start,
+                        int64_t stop = 0 )
+        : blockDevice( blockDevice ), start( start ), stop( stop ) {}
+    virtual int init();
+    virtual int deinit() { return blockDevice->deinit(); }
+    virtual int read( void* buffer, uint64_t address, uint64_t size );
+    virtual int program( const void* buffer, uint64_t address, uint64_t size );
+    virtual int sync() { return blockDevice->sync(); }
+    virtual uint64_t size() const;
+private:
+    uint64_t startRead() const;
+    uint64_t stopRead() const;
+    BlockDevice* blockDevice;
+    int64_t start;
+    int64_t stop;
+};
+
+//=====[#include guards - end]=================================================
+
+#endif // _SLICING_BLOCK_DEVICE_H_
@@ -0,0 +1,50 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _FF_H_
+#define _FF_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define AM_DIR       0x10
+
+//=====[Declaration of public data types]======================================
+
+// The part of the FatFs API, as shipped with Mbed OS, that reads directories.
+// The drive "0:" is the volume of the FATFileSystem, its entries come from
+// the host directory with the SD card time charged as for readdir().
+typedef char TCHAR;
+
+typedef enum {
+    FR_OK = 0,
+    FR_DISK_ERR = 1,
+    FR_NOT_READY = 3,
+    FR_NO_PATH = 5,
+    FR_INVALID_DRIVE = 11,
+} FRESULT;
+
+typedef struct {
+    DIR* dir;
+    char hostPath[256];
+} FATFS_DIR;
+
+typedef struct {
+    uint32_t fsize;
+    uint16_t fdate;
+    uint16_t ftime;
+    uint8_t fattrib;
+    TCHAR fname[256];
+} FILINFO;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+FRESULT f_opendir( FATFS_DIR* dp, const TCHAR* path );
+FRESULT f_readdir( FATFS_DIR* dp, FILINFO* fno );
+FRESULT f_closedir( FATFS_DIR* dp );
+
+//=====[#include guards - end]=================================================
+
+#endif // _FF_H_
@@ -0,0 +1,306 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "FATFileSystem.h"
+#include "SDBlockDevice.h"
+#include "SlicingBlockDevice.h"
+
+#include <unistd.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define EVENT_QUEUE_MAX_EVENTS   8
+
+//=====[Declaration and initialization of private global objects]==============
+
+static ticker_data_t usTickerData;
+
+//=====[Implementations of public functions]===================================
+
+uint32_t us_ticker_read()
+{
+    return (uint32_t) hostClockUsRead();
+}
+
+const ticker_data_t* get_us_ticker_data()
+{
+    return &usTickerData;
+}
+
+us_timestamp_t ticker_read_us( const ticker_data_t* ticker )
+{
+    return hostClockUsRead();
+}
+
+void wait( float seconds )
+{
+    hostClockAdvance( (uint64_t)( seconds * 1000000.0f ) );
+}
+
+void wait_ms( int ms )
+{
+    hostClockAdvance( (uint64_t) ms * 1000 );
+}
+
+void wait_us( int us )
+{
+    hostClockAdvance( us );
+}
+
+void sleep()
+{
+    hostSleep();
+}
+
+void set_time( time_t seconds )
+{
+    hostRtcWrite( seconds );
+}
+
+void core_util_critical_section_enter()
+{
+    hostCriticalSectionEnter();
+}
+
+void core_util_critical_section_exit()
+{
+    hostCriticalSectionExit();
+}
+
+// The C library time() reads the RTC, so the calendar follows the virtual
+// clock too
+extern "C" time_t time( time_t* timer ) noexcept
+{
+    time_t seconds = (time_t) hostRtcRead();
+
+    if ( timer != NULL ) {
+        *timer = seconds;
+    }
+    return seconds;
+}
+
+//=====[Implementations of the RTOS stand-ins]=================================
+
+EventQueue::~EventQueue()
+{
+    int i;
+
+    for ( i = 0; i < EVENT_QUEUE_MAX_EVENTS; i++ ) {
+        if ( events[i] != NULL ) {
+            hostClockEventDisarm( &events[i]->clockEvent );
+            delete events[i];
+        }
+    }
+}
+
+int EventQueue::call( std::function<void()> function )
+{
+    return post( function, 0, false );
+}
+
+int EventQueue::call_every( int ms, std::function<void()> function )
+{
+    return post( function, ms, true );
+}
+
+int EventQueue::post( std::function<void()> function, int ms, bool periodic )
+{
+    queueEvent* event;
+    int i;
+
+    for ( i = 0; i < EVENT_QUEUE_MAX_EVENTS; i++ ) {
+        if ( events[i] == NULL ) {
+            break;
+        }
+    }
+    if ( i == EVENT_QUEUE_MAX_EVENTS ) {
+        return 0;
+    }
+    event = new queueEvent();
+    event->function = function;
+    event->queue = this;
+    event->clockEvent.armed = false;
+    event->clockEvent.handler = eventHandler;
+    event->clockEvent.context = event;
+    events[i] = event;
+    hostClockEventArm( &event->clockEvent,
+                       hostClockUsRead() + (uint64_t) ms * 1000,
+                       periodic ? (uint64_t) ms * 1000 : 0 );
+    return i + 1;
+}
+
+// Nothing runs before a thread dispatches the queue, a periodic event just
+// misses its turn
+void EventQueue::eventHandler( void* context )
+{
+    queueEvent* event = (queueEvent*) context;
+    EventQueue* queue = event->queue;
+    int i;
+
+    if ( queue->dispatching ) {
+        event->function();
+    }
+    if ( !event->clockEvent.armed ) {
+        for ( i = 0; i < EVENT_QUEUE_MAX_EVENTS; i++ ) {
+            if ( queue->events[i] == event ) {
+                queue->events[i] = NULL;
+            }
+        }
+        delete event;
+    }
+}
+
+uint32_t EventFlags::wait_any( uint32_t flags, uint32_t millisec, bool clear )
+{
+    uint64_t deadlineUs = ( millisec == osWaitForever ) ? UINT64_MAX :
+                          hostClockUsRead() + (uint64_t) millisec * 1000;
+    uint32_t setFlags;
+
+    while ( ( this->flags & flags ) == 0 ) {
+        if ( hostClockUsRead() >= deadlineUs ) {
+            return osFlagsErrorTimeout;
+        }
+        hostClockSleepUntil( deadlineUs );
+    }
+    setFlags = this->flags;
+    if ( clear ) {
+        this->flags &= ~flags;
+    }
+    return setFlags;
+}
+
+//=====[Implementations of the storage stand-ins]==============================
+
+FATFileSystem::FATFileSystem( const char* name, BlockDevice* blockDevice )
+{
+    hostSdCardMountNameWrite( name );
+}
+
+FATFileSystem::~FATFileSystem()
+{
+    hostSdCardUnmount();
+}
+
+int FATFileSystem::mount( BlockDevice* blockDevice )
+{
+    return hostSdCardMount() ? 0 : -1;
+}
+
+int FATFileSystem::unmount()
+{
+    hostSdCardUnmount();
+    return 0;
+}
+
+SDBlockDevice::~SDBlockDevice()
+{
+    deinit();
+}
+
+int SDBlockDevice::init()
+{
+    std::string imageName = std::string( hostSdCardDirectoryRead() ) + ".img";
+
+    if ( image != NULL ) {
+        return 0;
+    }
+    if ( !hostSdCardReady() ) {
+        return -1;
+    }
+    image = fopen( imageName.c_str(), "r+b" );
+    if ( image == NULL ) {
+        image = fopen( imageName.c_str(), "w+b" );
+    }
+    if ( image == NULL ) {
+        return -1;
+    }
+    // A sparse file, only the written sectors take space
+    if ( ftruncate( fileno( image ), hostSdCardSizeRead() ) != 0 ) {
+        deinit();
+        return -1;
+    }
+    return 0;
+}
+
+int SDBlockDevice::deinit()
+{
+    if ( image != NULL ) {
+        fclose( image );
+        image = NULL;
+    }
+    return 0;
+}
+
+int SDBlockDevice::read( void* buffer, uint64_t address, uint64_t size )
+{
+    hostSdCardTiming_t timing;
+
+    if ( ( image == NULL ) || ( address + size > this->size() ) ||
+         ( fseek( image, address, SEEK_SET ) != 0 ) ||
+         ( fread( buffer, 1, size, image ) != size ) ) {
+        return -1;
+    }
+    hostSdCardTimingRead( &timing );
+    hostSdCardBusyUsCharge( ( size + 511 ) / 512 * timing.sectorReadUs );
+    return 0;
+}
+
+int SDBlockDevice::program( const void* buffer, uint64_t address,
+                            uint64_t size )
+{
+    hostSdCardTiming_t timing;
+
+    if ( ( image == NULL ) || ( address + size > this->size() ) ||
+         ( fseek( image, address, SEEK_SET ) != 0 ) ||
+         ( fwrite( buffer, 1, size, image ) != size ) ) {
+        return -1;
+    }
+    hostSdCardTimingRead( &timing );
+    hostSdCardBusyUsCharge( ( size + 511 ) / 512 * timing.sectorWriteUs );
+    return 0;
+}
+
+uint64_t SDBlockDevice::size() const
+{
+    return hostSdCardSizeRead();
+}
+
+int SlicingBlockDevice::init()
+{
+    return blockDevice->init();
+}
+
+int SlicingBlockDevice::read( void* buffer, uint64_t address, uint64_t size )
+{
+    if ( address + size > this->size() ) {
+        return -1;
+    }
+    return blockDevice->read( buffer, startRead() + address, size );
+}
+
+int SlicingBlockDevice::program( const void* buffer, uint64_t address,
+                                 uint64_t size )
+{
+    if ( address + size > this->size() ) {
+        return -1;
+    }
+    return blockDevice->program( buffer, startRead() + address, size );
+}
+
+uint64_t SlicingBlockDevice::size() const
+{
+    return stopRead() - startRead();
+}
+
+uint64_t SlicingBlockDevice::startRead() const
+{
+    return start < 0 ? blockDevice->size() + start : start;
+}
+
+uint64_t SlicingBlockDevice::stopRead() const
+{
+    return stop <= 0 ? blockDevice->size() + stop : stop;
+}
@@ -0,0 +1,360 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _MBED_H_
+#define _MBED_H_
+
+//=====[Libraries]=============================================================
+
+// Host stand-in for the part of Mbed OS 5 used by the modules. The
+// peripherals are simulated by host_sim over a virtual clock.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include <functional>
+
+#include "PinNames.h"
+#include "host_sim.h"
+
+//=====[Declaration of public defines]=========================================
+
+#define MBED_ALIGN(N)            __attribute__((aligned(N)))
+#define MBED_PACKED(struct)      struct __attribute__((packed))
+
+#define EVENTS_EVENT_SIZE        64
+
+#define osWaitForever            0xFFFFFFFFU
+#define osFlagsError             0x80000000U
+#define osFlagsErrorTimeout      0xFFFFFFFEU
+
+//=====[Declaration of public data types]======================================
+
+typedef uint64_t us_timestamp_t;
+
+typedef struct ticker_data {
+    int unused;
+} ticker_data_t;
+
+typedef enum {
+    osPriorityNormal = 24,
+    osPriorityRealtime = 48,
+} osPriority;
+
+template <typename F>
+F callback( F function )
+{
+    return function;
+}
+
+template <typename T, typename M>
+std::function<void()> callback( T* object, M method )
+{
+    return [object, method]() { (object->*method)(); };
+}
+
+class DigitalOut {
+public:
+    DigitalOut( PinName pin, int value = 0 ) : pin( pin )
+    {
+        write( value );
+    }
+    void write( int value ) { hostPinOutputWrite( pin, value ); }
+    int read() { return hostPinRead( pin ); }
+    DigitalOut& operator=( int value ) { write( value ); return *this; }
+    DigitalOut& operator=( DigitalOut& other )
+    {
+        write( other.read() );
+        return *this;
+    }
+    operator int() { return read(); }
+private:
+    PinName pin;
+};
+
+class DigitalIn {
+public:
+    DigitalIn( PinName pin ) : pin( pin ) {}
+    void mode( PinMode pull ) { hostPinModeWrite( pin, pull ); }
+    int read() { return hostPinRead( pin ); }
+    operator int() { return read(); }
+private:
+    PinName pin;
+};
+
+class InterruptIn {
+public:
+    InterruptIn( PinName pin ) : pin( pin )
+    {
+        hostPinEdgeHandlerSet( pin, edgeHandler, this );
+    }
+    ~InterruptIn() { hostPinEdgeHandlerSet( pin, NULL, NULL ); }
+    void mode( PinMode pull ) { hostPinModeWrite( pin, pull ); }
+    int read() { return hostPinRead( pin ); }
+    operator int() { return read(); }
+    void rise( std::function<void()> handler ) { riseHandler = handler; }
+    void fall( std::function<void()> handler ) { fallHandler = handler; }
+    void enable_irq() { enabled = true; }
+    void disable_irq() { enabled = false; }
+private:
+    static void edgeHandler( void* context, bool rising )
+    {
+        InterruptIn* in = (InterruptIn*) context;
+        std::function<void()>& handler = rising ? in->riseHandler :
+                                                  in->fallHandler;
+        if ( in->enabled && handler ) {
+            handler();
+        }
+    }
+    PinName pin;
+    bool enabled = true;
+    std::function<void()> riseHandler;
+    std::function<void()> fallHandler;
+};
+
+class AnalogIn {
+public:
+    AnalogIn( PinName pin ) : pin( pin ) {}
+    float read() { return hostAnalogRead( pin ); }
+    unsigned short read_u16() { return (unsigned short)( read() * 65535.0f ); }
+    operator float() { return read(); }
+private:
+    PinName pin;
+};
+
+class SerialBase {
+public:
+    enum IrqType {
+        RxIrq = 0,
+        TxIrq
+    };
+    SerialBase( PinName tx, PinName rx, int baud ) : serial( hostSerialOpen( tx ) )
+    {
+        hostSerialBaudWrite( serial, baud );
+    }
+    ~SerialBase() { hostSerialClose( serial ); }
+    void baud( int baudrate ) { hostSerialBaudWrite( serial, baudrate ); }
+    int readable() { return hostSerialReadable( serial ); }
+    int writeable() { return hostSerialWriteable( serial ); }
+    void attach( std::function<void()> handler, IrqType type = RxIrq )
+    {
+        if ( type == RxIrq ) {
+            rxHandler = handler;
+            hostSerialRxHandlerSet( serial, rxHandler ? rxIrq : NULL, this );
+        } else {
+            txHandler = handler;
+            hostSerialTxIrqHandlerSet( serial, txHandler ? txIrq : NULL, this );
+        }
+    }
+    int getc() { return hostSerialGetc( serial ); }
+    int putc( int c ) { hostSerialPutc( serial, c ); return c; }
+    int puts( const char* str )
+    {
+        while ( *str != '\0' ) {
+            putc( *str++ );
+        }
+        return 0;
+    }
+    int printf( const char* format, ... ) __attribute__((format(printf, 2, 3)))
+    {
+        char buffer[512];
+        va_list args;
+        int length;
+        int i;
+
+        va_start( args, format );
+        length = vsnprintf( buffer, sizeof(buffer), format, args );
+        va_end( args );
+        if ( length > (int) sizeof(buffer) - 1 ) {
+            length = sizeof(buffer) - 1;
+        }
+        for ( i = 0; i < length; i++ ) {
+            putc( buffer[i] );
+        }
+        return length;
+    }
+private:
+    static void rxIrq( void* context )
+    {
+        ( (SerialBase*) context )->rxHandler();
+    }
+    static void txIrq( void* context )
+    {
+        ( (SerialBase*) context )->txHandler();
+    }
+    hostSerial_t* serial;
+    std::function<void()> rxHandler;
+    std::function<void()> txHandler;
+};
+
+class Serial : public SerialBase {
+public:
+    Serial( PinName tx, PinName rx, int baud = 9600 )
+        : SerialBase( tx, rx, baud ) {}
+};
+
+class RawSerial : public SerialBase {
+public:
+    RawSerial( PinName tx, PinName rx, int baud = 9600 )
+        : SerialBase( tx, rx, baud ) {}
+};
+
+class SPI {
+public:
+    SPI( PinName mosi, PinName miso, PinName sclk ) {}
+    void format( int bits, int mode = 0 ) { this->bits = bits; }
+    void frequency( int hz ) { this->hz = hz; }
+    // Blocks for the time the word takes on the bus
+    int write( int value )
+    {
+        hostSpiBusyUsCharge( (uint64_t) bits * 1000000 / hz );
+        return 0;
+    }
+    void lock() {}
+    void unlock() {}
+private:
+    int bits = 8;
+    int hz = 1000000;
+};
+
+class TimerEvent {
+public:
+    TimerEvent()
+    {
+        event.armed = false;
+        event.handler = eventHandler;
+        event.context = this;
+    }
+    ~TimerEvent() { hostClockEventDisarm( &event ); }
+    void detach() { hostClockEventDisarm( &event ); }
+protected:
+    void arm( std::function<void()> function, us_timestamp_t us, bool periodic )
+    {
+        handler = function;
+        hostClockEventArm( &event, hostClockUsRead() + us, periodic ? us : 0 );
+    }
+private:
+    static void eventHandler( void* context )
+    {
+        ( (TimerEvent*) context )->handler();
+    }
+    hostClockEvent_t event;
+    std::function<void()> handler;
+};
+
+class Ticker : public TimerEvent {
+public:
+    void attach( std::function<void()> function, float seconds )
+    {
+        attach_us( function, (us_timestamp_t)( seconds * 1000000.0f ) );
+    }
+    void attach_us( std::function<void()> function, us_timestamp_t us )
+    {
+        arm( function, us, true );
+    }
+};
+
+class Timeout : public TimerEvent {
+public:
+    void attach( std::function<void()> function, float seconds )
+    {
+        attach_us( function, (us_timestamp_t)( seconds * 1000000.0f ) );
+    }
+    void attach_us( std::function<void()> function, us_timestamp_t us )
+    {
+        arm( function, us, false );
+    }
+};
+
+class BlockDevice {
+public:
+    virtual ~BlockDevice() {}
+    virtual int init() = 0;
+    virtual int deinit() = 0;
+    virtual int read( void* buffer, uint64_t address, uint64_t size ) = 0;
+    virtual int program( const void* buffer, uint64_t address,
+                         uint64_t size ) = 0;
+    virtual int erase( uint64_t address, uint64_t size ) { return 0; }
+    virtual int sync() { return 0; }
+    virtual uint64_t get_read_size() const { return 512; }
+    virtual uint64_t get_program_size() const { return 512; }
+    virtual uint64_t get_erase_size() const { return 512; }
+    virtual uint64_t size() const = 0;
+};
+
+// The queue is dispatched by the thread that runs dispatch_forever(). Its
+// events run at their deadline like an interrupt would, which is what a
+// higher priority thread looks like to the code it preempts.
+class EventQueue {
+public:
+    EventQueue( unsigned size = 32 * EVENTS_EVENT_SIZE ) {}
+    ~EventQueue();
+    int call( std::function<void()> function );
+    int call_every( int ms, std::function<void()> function );
+    void dispatch_forever() { dispatching = true; }
+    void dispatch( int ms = -1 ) { dispatching = true; }
+private:
+    struct queueEvent {
+        hostClockEvent_t clockEvent;
+        std::function<void()> function;
+        EventQueue* queue;
+    };
+    static void eventHandler( void* context );
+    int post( std::function<void()> function, int ms, bool periodic );
+    bool dispatching = false;
+    queueEvent* events[8] = {};
+};
+
+class Thread {
+public:
+    Thread( osPriority priority = osPriorityNormal, uint32_t stackSize = 0,
+            unsigned char* stackMemory = NULL, const char* name = NULL ) {}
+    int start( std::function<void()> task )
+    {
+        task();
+        return 0;
+    }
+};
+
+// Waiting runs the virtual clock, and so every interrupt and higher priority
+// thread, until a flag is set or the time is over
+class EventFlags {
+public:
+    uint32_t set( uint32_t flags ) { return this->flags |= flags; }
+    uint32_t clear( uint32_t flags = 0x7fffffff )
+    {
+        uint32_t previous = this->flags;
+        this->flags &= ~flags;
+        return previous;
+    }
+    uint32_t get() const { return flags; }
+    uint32_t wait_any( uint32_t flags, uint32_t millisec = osWaitForever,
+                       bool clear = true );
+private:
+    volatile uint32_t flags = 0;
+};
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+uint32_t us_ticker_read();
+const ticker_data_t* get_us_ticker_data();
+us_timestamp_t ticker_read_us( const ticker_data_t* ticker );
+
+void wait( float seconds );
+void wait_ms( int ms );
+void wait_us( int us );
+void sleep();
+void set_time( time_t seconds );
+
+void core_util_critical_section_enter();
+void core_util_critical_section_exit();
+
+//=====[#include guards - end]=================================================
+
+#endif // _MBED_H_
@@ -0,0 +1,45 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _MBED_RETARGET_H_
+#define _MBED_RETARGET_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+//=====[Declaration of public defines]=========================================
+
+// Mbed OS retargets the C library file calls to the mounted file systems.
+// Here the calls of the code that includes this header go to host_sim, which
+// translates the "/sd/" paths to the volume directory and charges the SD
+// card time.
+#define fopen( path, mode )             hostFileOpen( path, mode )
+#define fclose( file )                  hostFileClose( file )
+#define fread( buffer, size, n, file )  hostFileRead( buffer, size, n, file )
+#define fwrite( buffer, size, n, file ) hostFileWrite( buffer, size, n, file )
+#define fprintf( file, ... )            hostFilePrintf( file, __VA_ARGS__ )
+#define remove( path )                  hostFileRemove( path )
+#define stat( path, fileStat )          hostFileStat( path, fileStat )
+#define opendir( path )                 hostDirOpen( path )
+#define readdir( dir )                  hostDirRead( dir )
+#define closedir( dir )                 hostDirClose( dir )
+#define mkdir( path, mode )             hostDirCreate( path, mode )
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+FILE* hostFileOpen( const char* path, const char* mode );
+int hostFileClose( FILE* file );
+size_t hostFileRead( void* buffer, size_t size, size_t n, FILE* file );
+size_t hostFileWrite( const void* buffer, size_t size, size_t n, FILE* file );
+int hostFilePrintf( FILE* file, const char* format, ... )
+    __attribute__((format(printf, 2, 3)));
+int hostFileRemove( const char* path );
+int hostFileStat( const char* path, struct stat* fileStat );
+DIR* hostDirOpen( const char* path );
+struct dirent* hostDirRead( DIR* dir );
+int hostDirClose( DIR* dir );
+int hostDirCreate( const char* path, mode_t mode );
+
+//=====[#include guards - end]=================================================
+
+#endif // _MBED_RETARGET_H_
@@ -0,0 +1,144 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "smart_home_system.h"
+#include "wifi_module.h"
+#include "esp8266_sim.h"
+
+#include <chrono>
+
+//=====[Declaration of private defines]========================================
+
+#define SMART_HOME_SIM_DEFAULT_SECONDS   600
+#define SMART_HOME_SIM_SD_CARD_DIR       "smart_home_sim_sd"
+
+// 25 °C on the LM35, 10 mV/°C over the 3.3 V ADC range
+#define SMART_HOME_SIM_LM35_READING      ( 0.25f / 3.3f )
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct smartHomeSimOptions {
+    double seconds;
+    double speed;
+    const char* sdCardDirectory;
+    bool echo;
+    bool wifi;
+    const char* input;
+} smartHomeSimOptions_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static bool smartHomeSimOptionsParse( int argc, char* argv[],
+                                      smartHomeSimOptions_t* options );
+static void smartHomeSimUsbTx( void* context, char c );
+
+//=====[Main function, the program entry point]================================
+
+// Runs the real main loop over the simulated board for the given simulated
+// time, as fast as the CPU allows unless a speed is given, and reports how
+// fast the virtual clock ran
+int main( int argc, char* argv[] )
+{
+    smartHomeSimOptions_t options = { SMART_HOME_SIM_DEFAULT_SECONDS, 0.0,
+                                      SMART_HOME_SIM_SD_CARD_DIR, false,
+                                      false, NULL };
+    esp8266SimConfig_t esp8266Config;
+    std::chrono::steady_clock::time_point wallStart;
+    double wallSeconds;
+    double simulatedSeconds;
+    uint64_t endUs;
+    uint64_t startUs;
+    uint32_t loopIterations;
+
+    if ( !smartHomeSimOptionsParse( argc, argv, &options ) ) {
+        fprintf( stderr, "usage: %s [--seconds S] [--speed X] "
+                         "[--sd-card DIR] [--input TEXT] [--echo] [--wifi]\n",
+                 argv[0] );
+        return 2;
+    }
+
+    hostSdCardDirectorySet( options.sdCardDirectory );
+    hostAnalogWrite( A1, SMART_HOME_SIM_LM35_READING );
+    hostSerialTxHandlerSet( USBTX, smartHomeSimUsbTx, &options );
+
+    // An ESP8266 that knows the AP of the firmware credentials, only
+    // smart_home_sim_wifi connects to it at power up
+    if ( options.wifi ) {
+        esp8266SimConfigDefaultRead( &esp8266Config );
+        esp8266Config.ssid = wifiModuleGetAP_SSID();
+        esp8266Config.password = wifiModuleGetAP_Password();
+        esp8266SimAttach( D42, &esp8266Config );
+    }
+
+    wallStart = std::chrono::steady_clock::now();
+    hostClockSpeedSet( options.speed );
+    startUs = hostClockUsRead();
+
+    smartHomeSystemInit();
+    smartHomeSystemLoopIterationsReset();
+    if ( options.input != NULL ) {
+        hostSerialRxWrite( USBTX, options.input, strlen( options.input ) );
+    }
+
+    endUs = startUs + (uint64_t)( options.seconds * 1000000.0 );
+    while ( hostClockUsRead() < endUs ) {
+        smartHomeSystemUpdate();
+    }
+
+    loopIterations = smartHomeSystemLoopIterationsRead();
+    wallSeconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - wallStart ).count();
+    simulatedSeconds = ( hostClockUsRead() - startUs ) / 1000000.0;
+
+    printf( "\nSimulated time: %.3f s\n", simulatedSeconds );
+    printf( "Wall time: %.3f s\n", wallSeconds );
+    printf( "Simulated seconds per wall second: %.1f\n",
+            simulatedSeconds / wallSeconds );
+    printf( "Loop iterations: %lu, %.0f per wall second, "
+            "%.1f per simulated second\n", (unsigned long) loopIterations,
+            loopIterations / wallSeconds, loopIterations / simulatedSeconds );
+    printf( "SD card busy: %.3f s, UART bytes written: %llu\n",
+            hostSdCardBusyUsRead() / 1000000.0,
+            (unsigned long long) hostSerialTxBytesRead( USBTX ) );
+    return 0;
+}
+
+//=====[Implementations of private functions]==================================
+
+static bool smartHomeSimOptionsParse( int argc, char* argv[],
+                                      smartHomeSimOptions_t* options )
+{
+    int i;
+
+    for ( i = 1; i < argc; i++ ) {
+        if ( strcmp( argv[i], "--echo" ) == 0 ) {
+            options->echo = true;
+        } else if ( strcmp( argv[i], "--wifi" ) == 0 ) {
+            options->wifi = true;
+        } else if ( i + 1 >= argc ) {
+            return false;
+        } else if ( strcmp( argv[i], "--seconds" ) == 0 ) {
+            options->seconds = atof( argv[++i] );
+        } else if ( strcmp( argv[i], "--speed" ) == 0 ) {
+            options->speed = atof( argv[++i] );
+        } else if ( strcmp( argv[i], "--sd-card" ) == 0 ) {
+            options->sdCardDirectory = argv[++i];
+        } else if ( strcmp( argv[i], "--input" ) == 0 ) {
+            options->input = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options->seconds > 0.0;
+}
+
+static void smartHomeSimUsbTx( void* context, char c )
+{
+    smartHomeSimOptions_t* options = (smartHomeSimOptions_t*) context;
+
+    if ( options->echo ) {
+        putchar( c );
+    }
+}
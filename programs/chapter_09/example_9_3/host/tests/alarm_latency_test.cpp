@@ -0,0 +1,257 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "smart_home_system.h"
+#include "scheduler.h"
+#include "fire_alarm.h"
+#include "event_log.h"
+
+#include "host_test.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define ALARM_LATENCY_TEST_SECONDS        60
+#define ALARM_LATENCY_TEST_SD_CARD_DIR    "alarm_latency_test_sd"
+#define ALARM_LATENCY_TEST_FILES          20
+
+// 'l' lists the files with their sizes and dates, the next keys turn its
+// pages. Once it ends 'e' prints every stored event and 'w' flushes them to
+// the SD card. They come far faster than they are served.
+#define ALARM_LATENCY_TEST_COMMANDS       "lew"
+#define ALARM_LATENCY_TEST_COMMAND_US     20000
+
+// The gas input changes every 50 ms, each change is an event for the SD
+// card. It is checked one alarm period after each change, when it must
+// have been seen.
+#define ALARM_LATENCY_TEST_GAS_US         50000
+#define ALARM_LATENCY_TEST_GAS_CHECK_US   ( SYSTEM_TIME_INCREMENT_MS * 1000 + \
+                                            1000 )
+
+// Thirty times the default card timing
+#define ALARM_LATENCY_TEST_SD_CARD_SCALE  30
+
+//=====[Declaration and initialization of private global variables]============
+
+static hostClockEvent_t commandEvent;
+static hostClockEvent_t gasEvent;
+static hostClockEvent_t gasCheckEvent;
+static int gasLevel = 0;
+static uint32_t gasChanges = 0;
+static uint32_t gasChangesMissed = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void alarmLatencySdCardPrepare();
+static void alarmLatencyDirectoryClear( const std::string& path );
+static void alarmLatencyLoadStart();
+static void alarmLatencyLoadStop();
+static int alarmLatencyTaskFind( const char* name );
+static void alarmLatencyCommandSend( void* context );
+static void alarmLatencyGasToggle( void* context );
+static void alarmLatencyGasCheck( void* context );
+static void alarmLatencyUsbTx( void* context, char c );
+
+//=====[Main function, the program entry point]================================
+
+// The threaded configuration, with the main thread kept waiting on a slow
+// SD card and on a UART that is written all the time. The alarm task must
+// still run on every period and see every gas input change within one.
+int main()
+{
+    schedulerTaskStats_t alarmStats;
+    schedulerTaskStats_t uiStats;
+    uint64_t startUs;
+    uint64_t endUs;
+    uint64_t elapsedUs;
+    uint64_t sdCardBusyUs;
+    uint64_t txBytes;
+    uint64_t txCapacity;
+    uint64_t txBusyUs;
+    int alarmTaskId;
+    int uiTaskId;
+
+    alarmLatencySdCardPrepare();
+    hostSerialTxHandlerSet( USBTX, alarmLatencyUsbTx, NULL );
+
+    HOST_TEST_CHECK( SMART_HOME_SYSTEM_THREADED );
+    smartHomeSystemInit();
+    alarmTaskId = alarmLatencyTaskFind( "alarm" );
+    uiTaskId = alarmLatencyTaskFind( "ui" );
+    HOST_TEST_CHECK( alarmTaskId >= 0 && uiTaskId >= 0 );
+
+    schedulerStatsReset();
+    startUs = hostClockUsRead();
+    sdCardBusyUs = hostSdCardBusyUsRead();
+    txBytes = hostSerialTxBytesRead( USBTX );
+    alarmLatencyLoadStart();
+
+    endUs = startUs + ALARM_LATENCY_TEST_SECONDS * 1000000ULL;
+    while ( hostClockUsRead() < endUs ) {
+        smartHomeSystemUpdate();
+    }
+    alarmLatencyLoadStop();
+
+    elapsedUs = hostClockUsRead() - startUs;
+    sdCardBusyUs = hostSdCardBusyUsRead() - sdCardBusyUs;
+    txBytes = hostSerialTxBytesRead( USBTX ) - txBytes;
+    txCapacity = elapsedUs * hostSerialBaudRead( USBTX ) / 10 / 1000000;
+    txBusyUs = txBytes * elapsedUs / txCapacity;
+    schedulerTaskStatsRead( alarmTaskId, &alarmStats );
+    schedulerTaskStatsRead( uiTaskId, &uiStats );
+
+    printf( "%.1f s simulated: SD card busy %.0f%%, UART TX busy %.0f%%, "
+            "ui task max jitter %u ms\n",
+            elapsedUs / 1e6, 100.0 * sdCardBusyUs / elapsedUs,
+            100.0 * txBusyUs / elapsedUs, (unsigned) uiStats.maxJitterMs );
+    printf( "Alarm task: %u runs, %u overruns, max jitter %u ms, "
+            "%u of %u gas changes late, %u changes lost\n",
+            alarmStats.runs, alarmStats.overruns,
+            (unsigned) alarmStats.maxJitterMs, gasChangesMissed, gasChanges,
+            eventLogAlarmQueueOverflowsRead() );
+
+    // The main thread was kept waiting on the SD card or the UART most of
+    // the time, on each of them for a good share of it, and ran late
+    HOST_TEST_CHECK( sdCardBusyUs * 5 > elapsedUs );
+    HOST_TEST_CHECK( txBusyUs * 5 > elapsedUs );
+    HOST_TEST_CHECK( ( sdCardBusyUs + txBusyUs ) * 10 > elapsedUs * 7 );
+    HOST_TEST_CHECK( uiStats.maxJitterMs >= 500 );
+
+    // And the alarm kept its period
+    HOST_TEST_CHECK( alarmStats.runs + 1 >=
+                     elapsedUs / ( SYSTEM_TIME_INCREMENT_MS * 1000 ) );
+    HOST_TEST_CHECK( alarmStats.overruns == 0 );
+    HOST_TEST_CHECK( alarmStats.maxJitterMs == 0 );
+    HOST_TEST_CHECK( gasChanges > 0 && gasChangesMissed == 0 );
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+// The directory belongs to the test. The files of the previous run are
+// replaced by ALARM_LATENCY_TEST_FILES small ones, and the card is made ten
+// times slower than the default.
+static void alarmLatencySdCardPrepare()
+{
+    std::string path = ALARM_LATENCY_TEST_SD_CARD_DIR;
+    hostSdCardTiming_t timing;
+    char fileName[32];
+    FILE* file;
+    int i;
+
+    alarmLatencyDirectoryClear( path );
+    mkdir( path.c_str(), 0777 );
+    for ( i = 0; i < ALARM_LATENCY_TEST_FILES; i++ ) {
+        snprintf( fileName, sizeof(fileName), "/file_%02d.txt", i );
+        file = fopen( ( path + fileName ).c_str(), "w" );
+        if ( file != NULL ) {
+            fprintf( file, "%d\n", i );
+            fclose( file );
+        }
+    }
+    hostSdCardDirectorySet( path.c_str() );
+
+    hostSdCardTimingRead( &timing );
+    timing.openUs = timing.openUs * ALARM_LATENCY_TEST_SD_CARD_SCALE;
+    timing.directoryEntryUs = timing.directoryEntryUs *
+                              ALARM_LATENCY_TEST_SD_CARD_SCALE;
+    timing.sectorReadUs = timing.sectorReadUs *
+                          ALARM_LATENCY_TEST_SD_CARD_SCALE;
+    timing.sectorWriteUs = timing.sectorWriteUs *
+                           ALARM_LATENCY_TEST_SD_CARD_SCALE;
+    timing.closeUs = timing.closeUs * ALARM_LATENCY_TEST_SD_CARD_SCALE;
+    hostSdCardTimingWrite( &timing );
+}
+
+// Also empties and removes the directories in it, such as the month
+// directories of the event log
+static void alarmLatencyDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            alarmLatencyDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
+
+static void alarmLatencyLoadStart()
+{
+    commandEvent.handler = alarmLatencyCommandSend;
+    commandEvent.context = NULL;
+    hostClockEventArm( &commandEvent, hostClockUsRead(),
+                       ALARM_LATENCY_TEST_COMMAND_US );
+    gasEvent.handler = alarmLatencyGasToggle;
+    gasEvent.context = NULL;
+    hostClockEventArm( &gasEvent, hostClockUsRead() +
+                                  ALARM_LATENCY_TEST_GAS_US,
+                       ALARM_LATENCY_TEST_GAS_US );
+    gasCheckEvent.handler = alarmLatencyGasCheck;
+    gasCheckEvent.context = NULL;
+}
+
+static void alarmLatencyLoadStop()
+{
+    hostClockEventDisarm( &commandEvent );
+    hostClockEventDisarm( &gasEvent );
+    hostClockEventDisarm( &gasCheckEvent );
+}
+
+static int alarmLatencyTaskFind( const char* name )
+{
+    schedulerTaskStats_t stats;
+    int i;
+
+    for ( i = 0; i < schedulerNumberOfTasksRead(); i++ ) {
+        if ( schedulerTaskStatsRead( i, &stats ) &&
+             strcmp( stats.name, name ) == 0 ) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void alarmLatencyCommandSend( void* context )
+{
+    hostSerialRxWrite( USBTX, ALARM_LATENCY_TEST_COMMANDS,
+                       strlen( ALARM_LATENCY_TEST_COMMANDS ) );
+}
+
+static void alarmLatencyGasToggle( void* context )
+{
+    gasLevel = !gasLevel;
+    hostPinWrite( D2, gasLevel );
+    gasChanges++;
+    hostClockEventArm( &gasCheckEvent,
+                       hostClockUsRead() + ALARM_LATENCY_TEST_GAS_CHECK_US, 0 );
+}
+
+static void alarmLatencyGasCheck( void* context )
+{
+    if ( gasDetectorStateRead() != (bool) gasLevel ) {
+        gasChangesMissed++;
+    }
+}
+
+static void alarmLatencyUsbTx( void* context, char c )
+{
+}
@@ -0,0 +1,329 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "wifi_com.h"
+#include "wifi_module.h"
+#include "esp8266_sim.h"
+
+#include "host_test.h"
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define ESP8266_TEST_UART_TX      D42
+#define ESP8266_TEST_LOOP_US      10000
+#define ESP8266_TEST_ANSWER_US    20000
+
+//=====[Declaration and initialization of private global variables]============
+
+// The module UART as wifi_module opens it, the raw AT tests take it over
+static RawSerial uartEsp8266( D42, D41, 115200 );
+
+static std::string usbOutput;
+static std::string received;
+static std::string clientData;
+static bool clientClosed = false;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void esp8266WifiComTest();
+static void esp8266ServerTest();
+static void esp8266FaultsTest();
+static void esp8266ForwardTest();
+
+static void esp8266TestAttach( esp8266SimConfig_t* config );
+static bool esp8266TestWifiComRun( const char* text, uint64_t us );
+static std::string esp8266TestCommand( const char* command );
+static std::string esp8266TestJoin( const char* password );
+static void esp8266TestServerStart();
+static void esp8266TestRx();
+static void esp8266TestUsbTx( void* context, char c );
+static void esp8266TestClient( void* context, int linkId, const char* data,
+                               int length );
+
+//=====[Main function, the program entry point]================================
+
+int main()
+{
+    hostSerialTxHandlerSet( USBTX, esp8266TestUsbTx, NULL );
+    tickInit( 1 );
+
+    esp8266WifiComTest();
+    uartEsp8266.attach( esp8266TestRx );
+    esp8266ServerTest();
+    esp8266FaultsTest();
+    esp8266ForwardTest();
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+// wifi_com gives up on a wrong password and resets the module 10 s later,
+// by then the password of the AP is the one it sends
+static void esp8266WifiComTest()
+{
+    esp8266SimConfig_t config;
+
+    esp8266SimConfigDefaultRead( &config );
+    config.ssid = wifiModuleGetAP_SSID();
+    config.password = "wrong";
+    esp8266SimAttach( ESP8266_TEST_UART_TX, &config );
+    wifiComInit();
+    HOST_TEST_CHECK( esp8266TestWifiComRun( "Wrong password", 5000000 ) );
+    HOST_TEST_CHECK( !esp8266SimConnectedRead() );
+
+    esp8266TestAttach( &config );
+    HOST_TEST_CHECK( esp8266TestWifiComRun( "Time to connected", 20000000 ) );
+    HOST_TEST_CHECK( usbOutput.find( "Reseting Wi-Fi module" ) !=
+                     std::string::npos );
+    HOST_TEST_CHECK( usbOutput.find( "IP = 192.168.1.7" ) !=
+                     std::string::npos );
+    HOST_TEST_CHECK( esp8266SimConnectedRead() );
+    HOST_TEST_CHECK( strcmp( wifiModuleIpRead(), "192.168.1.7" ) == 0 );
+    HOST_TEST_CHECK( hostSerialRxOverrunsRead( ESP8266_TEST_UART_TX ) == 0 );
+}
+
+static void esp8266ServerTest()
+{
+    esp8266SimConfig_t config;
+    std::string answer;
+    int linkId;
+
+    esp8266TestAttach( &config );
+    config.connectUs = 0;
+    esp8266SimAttach( ESP8266_TEST_UART_TX, &config );
+
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+CIPSERVER=1,80\r\n" ).find(
+                         "ERROR" ) != std::string::npos );
+    esp8266TestServerStart();
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+CIPMUX=0\r\n" ).find(
+                         "ERROR" ) != std::string::npos );
+
+    // No client reaches the server before the module joined the AP
+    HOST_TEST_CHECK( esp8266TestJoin( "x" ).find(
+                         "+CWJAP:2\r\n\r\nFAIL\r\n" ) != std::string::npos );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+CIPSTATUS\r\n" ).find(
+                         "STATUS:5" ) != std::string::npos );
+    HOST_TEST_CHECK( esp8266SimClientConnect() < 0 );
+    HOST_TEST_CHECK( esp8266TestJoin( wifiModuleGetAP_Password() ).find(
+                         "WIFI GOT IP\r\n\r\nOK\r\n" ) != std::string::npos );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+CIPSTATUS\r\n" ).find(
+                         "STATUS:2" ) != std::string::npos );
+
+    received.clear();
+    linkId = esp8266SimClientConnect();
+    HOST_TEST_CHECK( linkId == 0 );
+    HOST_TEST_CHECK( esp8266SimClientSend( linkId, "GET /", 5 ) );
+    hostClockAdvance( ESP8266_TEST_ANSWER_US );
+    HOST_TEST_CHECK( received == "0,CONNECT\r\n\r\n+IPD,0,5:GET /" );
+
+    answer = esp8266TestCommand( "AT+CIPSTATUS\r\n" );
+    HOST_TEST_CHECK( answer.find( "STATUS:3\r\n+CIPSTATUS:0,\"TCP\"," ) !=
+                     std::string::npos );
+    HOST_TEST_CHECK( answer.find( ",80,1\r\n\r\nOK\r\n" ) !=
+                     std::string::npos );
+
+    // The data that comes before the prompt is lost
+    answer = esp8266TestCommand( "AT+CIPSEND=0,5\r\nlost" );
+    HOST_TEST_CHECK( answer == "AT+CIPSEND=0,5\r\r\n\r\nOK\r\n> " );
+    answer = esp8266TestCommand( "hello" );
+    HOST_TEST_CHECK( answer == "\r\nRecv 5 bytes\r\n\r\nSEND OK\r\n" );
+    HOST_TEST_CHECK( clientData == "hello" && !clientClosed );
+
+    answer = esp8266TestCommand( "AT+CIPCLOSE=0\r\n" );
+    HOST_TEST_CHECK( answer == "AT+CIPCLOSE=0\r\r\n0,CLOSED\r\n\r\nOK\r\n" );
+    HOST_TEST_CHECK( clientClosed );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+CIPSEND=0,5\r\n" ).find(
+                         "link is not valid" ) != std::string::npos );
+
+    // A client that closes its side
+    received.clear();
+    linkId = esp8266SimClientConnect();
+    esp8266SimClientClose( linkId );
+    hostClockAdvance( ESP8266_TEST_ANSWER_US );
+    HOST_TEST_CHECK( received == "0,CONNECT\r\n0,CLOSED\r\n" );
+
+    // A reset loses the server and the connection
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+RST\r\n" ) ==
+                     "AT+RST\r\r\n\r\nOK\r\n" );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT\r\n" ).empty() );
+    hostClockAdvance( config.resetUs );
+    HOST_TEST_CHECK( received.find( "\r\nready\r\n" ) != std::string::npos );
+    HOST_TEST_CHECK( esp8266SimClientConnect() < 0 );
+    HOST_TEST_CHECK( !esp8266SimConnectedRead() );
+}
+
+static void esp8266FaultsTest()
+{
+    esp8266SimConfig_t config;
+    esp8266SimStats_t stats;
+    uint64_t startUs;
+
+    // The answer starts latencyUs after the command and is paced at the
+    // baud rate, 87 us a byte at 115200 bps
+    esp8266TestAttach( &config );
+    config.echo = false;
+    config.latencyUs = 5000;
+    esp8266SimAttach( ESP8266_TEST_UART_TX, &config );
+    uartEsp8266.puts( "AT\r\n" );
+    startUs = hostClockUsRead();
+    received.clear();
+    while ( received.size() < 6 &&
+            hostClockUsRead() - startUs < ESP8266_TEST_ANSWER_US ) {
+        hostClockAdvance( 10 );
+    }
+    HOST_TEST_CHECK( received == "\r\nOK\r\n" );
+    HOST_TEST_CHECK( hostClockUsRead() - startUs >= 5000 + 5 * 86 );
+    HOST_TEST_CHECK( hostClockUsRead() - startUs <= 5000 + 8 * 87 + 10 );
+
+    config.latencyUs = 2000;
+    config.errorOneIn = 1;
+    esp8266SimAttach( ESP8266_TEST_UART_TX, &config );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT\r\n" ) == "\r\nERROR\r\n" );
+
+    config.errorOneIn = 0;
+    config.dropOneIn = 1;
+    esp8266SimAttach( ESP8266_TEST_UART_TX, &config );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT\r\n" ).empty() );
+    esp8266SimStatsRead( &stats );
+    HOST_TEST_CHECK( stats.droppedBytes == 6 && stats.commands == 1 );
+
+    // Bytes sent at another baud rate are garbage to the module
+    config.dropOneIn = 0;
+    esp8266SimAttach( ESP8266_TEST_UART_TX, &config );
+    uartEsp8266.baud( 9600 );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT\r\n" ).empty() );
+    uartEsp8266.baud( 115200 );
+    esp8266SimStatsRead( &stats );
+    HOST_TEST_CHECK( stats.garbageBytes == 4 && stats.commands == 0 );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT\r\n" ) == "\r\nOK\r\n" );
+}
+
+// A real TCP client on the loopback reaches the board through the module
+static void esp8266ForwardTest()
+{
+    esp8266SimConfig_t config;
+    struct sockaddr_in address;
+    struct timeval timeout = { 2, 0 };
+    char data[16];
+    ssize_t length;
+    int client;
+
+    esp8266TestAttach( &config );
+    config.connectUs = 0;
+    config.forward = true;
+    esp8266SimAttach( ESP8266_TEST_UART_TX, &config );
+    HOST_TEST_CHECK( esp8266TestJoin( wifiModuleGetAP_Password() ).find(
+                         "WIFI GOT IP\r\n\r\nOK\r\n" ) != std::string::npos );
+    esp8266TestServerStart();
+    HOST_TEST_CHECK( esp8266SimForwardPortRead() != 0 );
+
+    client = socket( AF_INET, SOCK_STREAM, 0 );
+    memset( &address, 0, sizeof(address) );
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+    address.sin_port = htons( esp8266SimForwardPortRead() );
+    HOST_TEST_CHECK( connect( client, (struct sockaddr*) &address,
+                              sizeof(address) ) == 0 );
+    setsockopt( client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout) );
+    HOST_TEST_CHECK( send( client, "ping", 4, 0 ) == 4 );
+    received.clear();
+    hostClockAdvance( ESP8266_TEST_ANSWER_US );
+    HOST_TEST_CHECK( received == "0,CONNECT\r\n\r\n+IPD,0,4:ping" );
+
+    esp8266TestCommand( "AT+CIPSEND=0,4\r\n" );
+    HOST_TEST_CHECK( esp8266TestCommand( "pong" ).find( "SEND OK" ) !=
+                     std::string::npos );
+    length = recv( client, data, sizeof(data), 0 );
+    HOST_TEST_CHECK( length == 4 && memcmp( data, "pong", 4 ) == 0 );
+    esp8266TestCommand( "AT+CIPCLOSE=0\r\n" );
+    HOST_TEST_CHECK( recv( client, data, sizeof(data), 0 ) == 0 );
+    close( client );
+    esp8266SimDetach();
+    HOST_TEST_CHECK( esp8266SimForwardPortRead() == 0 );
+}
+
+// A module with the credentials of wifi_module, connected in a few seconds
+static void esp8266TestAttach( esp8266SimConfig_t* config )
+{
+    esp8266SimConfigDefaultRead( config );
+    config->ssid = wifiModuleGetAP_SSID();
+    config->password = wifiModuleGetAP_Password();
+    esp8266SimAttach( ESP8266_TEST_UART_TX, config );
+    esp8266SimClientHandlerSet( esp8266TestClient, NULL );
+    clientData.clear();
+    clientClosed = false;
+}
+
+// The main loop, until the text is written to the PC
+static bool esp8266TestWifiComRun( const char* text, uint64_t us )
+{
+    uint64_t startUs = hostClockUsRead();
+
+    usbOutput.clear();
+    while ( hostClockUsRead() - startUs < us ) {
+        wifiComUpdate();
+        if ( usbOutput.find( text ) != std::string::npos ) {
+            return true;
+        }
+        hostClockAdvance( ESP8266_TEST_LOOP_US );
+    }
+    return false;
+}
+
+// What the module sent within ESP8266_TEST_ANSWER_US of the command
+static std::string esp8266TestCommand( const char* command )
+{
+    received.clear();
+    uartEsp8266.puts( command );
+    hostClockAdvance( ESP8266_TEST_ANSWER_US );
+    return received;
+}
+
+static std::string esp8266TestJoin( const char* password )
+{
+    std::string command = std::string( "AT+CWJAP=\"" ) +
+                          wifiModuleGetAP_SSID() + "\",\"" + password +
+                          "\"\r\n";
+
+    return esp8266TestCommand( command.c_str() );
+}
+
+static void esp8266TestServerStart()
+{
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+CIPMUX=1\r\n" ).find(
+                         "\r\nOK\r\n" ) != std::string::npos );
+    HOST_TEST_CHECK( esp8266TestCommand( "AT+CIPSERVER=1,80\r\n" ).find(
+                         "\r\nOK\r\n" ) != std::string::npos );
+}
+
+static void esp8266TestRx()
+{
+    while ( uartEsp8266.readable() ) {
+        received += (char) uartEsp8266.getc();
+    }
+}
+
+static void esp8266TestUsbTx( void* context, char c )
+{
+    usbOutput += c;
+}
+
+static void esp8266TestClient( void* context, int linkId, const char* data,
+                               int length )
+{
+    if ( data == NULL ) {
+        clientClosed = true;
+    } else {
+        clientData.append( data, length );
+    }
+}
@@ -0,0 +1,43 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _HOST_TEST_H_
+#define _HOST_TEST_H_
+
+//=====[Libraries]=============================================================
+
+#include <stdio.h>
+
+//=====[Declaration of public defines]=========================================
+
+// Reports a failed check and goes on, so one run shows every failure
+#define HOST_TEST_CHECK( condition ) \
+    hostTestCheck( (condition), #condition, __FILE__, __LINE__ )
+
+//=====[Declaration and initialization of private global variables]============
+
+static int hostTestChecks = 0;
+static int hostTestFailures = 0;
+
+//=====[Implementations of public functions]===================================
+
+static inline bool hostTestCheck( bool passed, const char* condition,
+                                  const char* file, int line )
+{
+    hostTestChecks++;
+    if ( !passed ) {
+        hostTestFailures++;
+        printf( "%s:%d: check failed: %s\n", file, line, condition );
+    }
+    return passed;
+}
+
+// The exit code of the test program
+static inline int hostTestResult()
+{
+    printf( "%d checks, %d failed\n", hostTestChecks, hostTestFailures );
+    return hostTestFailures == 0 ? 0 : 1;
+}
+
+//=====[#include guards - end]=================================================
+
+#endif // _HOST_TEST_H_
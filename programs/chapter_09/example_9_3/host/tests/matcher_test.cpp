@@ -0,0 +1,251 @@
+//=====[Libraries]=============================================================
+
+#include "sapi.h"
+
+#include "host_test.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+//=====[Declaration of private defines]========================================
+
+#define MATCHER_TEST_ADVERSARIAL_BYTES   2000000
+
+//=====[Declaration and initialization of private global variables]============
+
+// As wifi_module, in the order of its responses
+static char const* const esp8266Responses[] = {
+    "OK", "ERROR", "FAIL", "ready", "+CWJAP:", "STATUS:", "+CIFSR:STAIP,",
+    "+CIPSTATUS:", "+IPD,",
+};
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void matcherInitLimitsTest();
+static void matcherResetTest();
+static void matcherOverlapTest();
+static void matcherEsp8266AdversarialTest();
+static void matcherRandomPatternsTest();
+
+static bool matcherNaiveCompare( char const* const* patterns,
+                                 int numberOfPatterns,
+                                 const std::string& stream );
+static int matcherNaiveUpdate( char const* const* patterns,
+                               int numberOfPatterns,
+                               const char* received, size_t receivedLength );
+
+//=====[Main function, the program entry point]================================
+
+int main()
+{
+    matcherInitLimitsTest();
+    matcherResetTest();
+    matcherOverlapTest();
+    matcherEsp8266AdversarialTest();
+    matcherRandomPatternsTest();
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+static void matcherInitLimitsTest()
+{
+    static matcher_t matcher;
+    static char const* patterns[128];
+    char const* empty[] = { "OK", "" };
+    std::string longPattern( MATCHER_MAX_STATES - 1, 'a' );
+    std::string tooLongPattern( MATCHER_MAX_STATES, 'a' );
+    std::string classes;
+    std::string tooManyClasses;
+    char const* pattern;
+    int i;
+
+    for ( i = 0; i < MATCHER_MAX_CLASSES - 1; i++ ) {
+        classes += (char)( '0' + i );
+    }
+    tooManyClasses = classes + '~';
+
+    HOST_TEST_CHECK( matcherInit( &matcher, esp8266Responses, 9 ) );
+    HOST_TEST_CHECK( !matcherInit( &matcher, empty, 2 ) );
+
+    pattern = longPattern.c_str();
+    HOST_TEST_CHECK( matcherInit( &matcher, &pattern, 1 ) );
+    pattern = tooLongPattern.c_str();
+    HOST_TEST_CHECK( !matcherInit( &matcher, &pattern, 1 ) );
+    pattern = classes.c_str();
+    HOST_TEST_CHECK( matcherInit( &matcher, &pattern, 1 ) );
+    pattern = tooManyClasses.c_str();
+    HOST_TEST_CHECK( !matcherInit( &matcher, &pattern, 1 ) );
+
+    for ( i = 0; i < 128; i++ ) {
+        patterns[i] = "x";
+    }
+    HOST_TEST_CHECK( matcherInit( &matcher, patterns, 127 ) );
+    HOST_TEST_CHECK( matcherUpdate( &matcher, 'x' ) == 0 );
+    HOST_TEST_CHECK( !matcherInit( &matcher, patterns, 128 ) );
+
+    // A matcher that failed to build never reports a match
+    HOST_TEST_CHECK( matcherUpdate( &matcher, 'x' ) == MATCHER_NO_MATCH );
+    pattern = tooLongPattern.c_str();
+    matcherInit( &matcher, &pattern, 1 );
+    for ( i = 0; i < MATCHER_MAX_STATES + 10; i++ ) {
+        HOST_TEST_CHECK( matcherUpdate( &matcher, 'a' ) == MATCHER_NO_MATCH );
+    }
+}
+
+static void matcherResetTest()
+{
+    static matcher_t matcher;
+
+    matcherInit( &matcher, esp8266Responses, 9 );
+    matcherUpdate( &matcher, '+' );
+    matcherUpdate( &matcher, 'I' );
+    matcherUpdate( &matcher, 'P' );
+    matcherUpdate( &matcher, 'D' );
+    matcherReset( &matcher );
+    HOST_TEST_CHECK( matcherUpdate( &matcher, ',' ) == MATCHER_NO_MATCH );
+
+    matcherUpdate( &matcher, 'O' );
+    HOST_TEST_CHECK( matcherUpdate( &matcher, 'K' ) == 0 );
+}
+
+// Patterns that are prefixes and suffixes of each other, the longest one
+// ending on each byte is reported and a duplicate keeps the first index
+static void matcherOverlapTest()
+{
+    static matcher_t matcher;
+    char const* nested[] = { "a", "aa", "aaa", "aaaa" };
+    char const* classic[] = { "he", "she", "his", "hers" };
+    char const* periodic[] = { "abab", "bab", "b", "abab" };
+    char const* statusPatterns[] = { "STATUS:", "+CIPSTATUS:", "S:" };
+    int i;
+
+    HOST_TEST_CHECK( matcherInit( &matcher, nested, 4 ) );
+    HOST_TEST_CHECK( matcherNaiveCompare( nested, 4, "aaaaaaabaaaaba" ) );
+    matcherReset( &matcher );
+    for ( i = 0; i < 3; i++ ) {
+        matcherUpdate( &matcher, 'a' );
+    }
+    HOST_TEST_CHECK( matcherUpdate( &matcher, 'a' ) == 3 );
+    HOST_TEST_CHECK( matcherUpdate( &matcher, 'a' ) == 3 );
+    HOST_TEST_CHECK( matcherUpdate( &matcher, 'b' ) == MATCHER_NO_MATCH );
+    HOST_TEST_CHECK( matcherUpdate( &matcher, 'a' ) == 0 );
+
+    HOST_TEST_CHECK( matcherNaiveCompare( classic, 4, "ushershishehershe" ) );
+    HOST_TEST_CHECK( matcherNaiveCompare( periodic, 4, "abababbabbbababa" ) );
+    HOST_TEST_CHECK( matcherNaiveCompare( statusPatterns, 3,
+                                          "+CIPSTATUS:STATUS:S:+CIPS:" ) );
+}
+
+// Mostly near misses of the responses, cut short, repeated and chained,
+// mixed with bytes of no pattern, the NUL byte and bytes above 0x7F
+static void matcherEsp8266AdversarialTest()
+{
+    static const char* const pieces[] = {
+        "O", "OK", "OOK", "ERRO", "ERROR", "ERRORR", "FAI", "FAIL", "rea",
+        "ready", "+", "+C", "+CW", "+CWJA", "+CWJAP", "+CWJAP:", "STATU",
+        "STATUS", "STATUS:", "+CIFSR:STA", "+CIFSR:STAIP", "+CIFSR:STAIP,",
+        "+CIPSTATUS", "+CIPSTATUS:", "+CIPSTA", "+CIPS", "+IPD", "+IPD,",
+        "+CI", "+CIF", "+CIPSTATUS:STATUS:", "+C+CWJAP:", "\r\n", " ", ",",
+        ":", "0", "3",
+    };
+    const int numberOfPieces = sizeof( pieces ) / sizeof( pieces[0] );
+    std::mt19937 random( 21 );
+    std::string stream;
+
+    stream.reserve( MATCHER_TEST_ADVERSARIAL_BYTES + 32 );
+    while ( stream.size() < MATCHER_TEST_ADVERSARIAL_BYTES ) {
+        switch ( random() % 8 ) {
+        case 0:
+            stream += (char)( random() % 256 );
+            break;
+        case 1:
+            stream += '\0';
+            break;
+        default:
+            stream += pieces[random() % numberOfPieces];
+            break;
+        }
+    }
+    HOST_TEST_CHECK( matcherNaiveCompare( esp8266Responses, 9, stream ) );
+}
+
+// Random pattern sets over a small alphabet, so most bytes are near misses
+static void matcherRandomPatternsTest()
+{
+    static char const* patterns[16];
+    std::vector<std::string> storage( 16 );
+    std::mt19937 random( 4711 );
+    std::string stream;
+    bool matches = true;
+    int numberOfPatterns;
+    int length;
+    int round;
+    int i;
+    int j;
+
+    for ( round = 0; round < 200; round++ ) {
+        numberOfPatterns = 1 + random() % 16;
+        for ( i = 0; i < numberOfPatterns; i++ ) {
+            length = 1 + random() % 5;
+            storage[i].clear();
+            for ( j = 0; j < length; j++ ) {
+                storage[i] += (char)( 'a' + random() % 3 );
+            }
+            patterns[i] = storage[i].c_str();
+        }
+        stream.clear();
+        for ( j = 0; j < 2000; j++ ) {
+            stream += (char)( 'a' + random() % 4 );
+        }
+        if ( !matcherNaiveCompare( patterns, numberOfPatterns, stream ) ) {
+            matches = false;
+        }
+    }
+    HOST_TEST_CHECK( matches );
+}
+
+// Feeds the stream to a new matcher and to the naive search, byte by byte
+static bool matcherNaiveCompare( char const* const* patterns,
+                                 int numberOfPatterns,
+                                 const std::string& stream )
+{
+    static matcher_t matcher;
+    size_t i;
+
+    if ( !matcherInit( &matcher, patterns, numberOfPatterns ) ) {
+        return false;
+    }
+    for ( i = 0; i < stream.size(); i++ ) {
+        if ( matcherUpdate( &matcher, stream[i] ) !=
+             matcherNaiveUpdate( patterns, numberOfPatterns,
+                                 stream.data(), i + 1 ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The longest pattern the received bytes end with, the first one of equal
+// patterns
+static int matcherNaiveUpdate( char const* const* patterns,
+                               int numberOfPatterns,
+                               const char* received, size_t receivedLength )
+{
+    size_t longest = 0;
+    size_t length;
+    int found = MATCHER_NO_MATCH;
+    int i;
+
+    for ( i = 0; i < numberOfPatterns; i++ ) {
+        length = strlen( patterns[i] );
+        if ( length > longest && length <= receivedLength &&
+             memcmp( received + receivedLength - length, patterns[i],
+                     length ) == 0 ) {
+            longest = length;
+            found = i;
+        }
+    }
+    return found;
+}
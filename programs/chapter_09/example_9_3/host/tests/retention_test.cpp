@@ -0,0 +1,174 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "event_journal.h"
+#include "sd_card.h"
+#include "date_and_time.h"
+
+#include "host_test.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define RETENTION_TEST_SD_CARD_DIR    "retention_test_sd"
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void retentionTestDirectoryClear( const std::string& path );
+static void retentionTestFileWrite( const char* fileName, long size );
+static bool retentionTestFileExists( const char* fileName );
+static void retentionTestPassRun();
+
+//=====[Main function, the program entry point]================================
+
+// A retention pass over a card with the files of every firmware: the daily
+// journal files, the per-flush files of the older firmware and files that
+// are not the journal's
+int main()
+{
+    char fileName[SD_CARD_FILENAME_MAX_LENGTH];
+    int day;
+
+    retentionTestDirectoryClear( RETENTION_TEST_SD_CARD_DIR );
+    mkdir( RETENTION_TEST_SD_CARD_DIR, 0777 );
+    mkdir( RETENTION_TEST_SD_CARD_DIR "/2025_01", 0777 );
+    mkdir( RETENTION_TEST_SD_CARD_DIR "/2026_05", 0777 );
+    hostSdCardDirectorySet( RETENTION_TEST_SD_CARD_DIR );
+    set_time( dateAndTimeToSeconds( 2026, 6, 1, 12, 0, 0 ) );
+
+    // Older than EVENT_JOURNAL_MAX_AGE_DAYS, the daily files in the root are
+    // those of the journal before the month directories
+    retentionTestFileWrite( "2025_01_10_08_30_00.txt", 100 );
+    retentionTestFileWrite( "2025_01_11_09_00_05.log", 160 );
+    retentionTestFileWrite( "2025_01_12.log", 160 );
+    retentionTestFileWrite( "2025_01_12.idx", 8 );
+    for ( day = 1; day <= 31; day++ ) {
+        snprintf( fileName, sizeof(fileName), "2025_01/2025_01_%02d.log", day );
+        retentionTestFileWrite( fileName, 160 );
+        snprintf( fileName, sizeof(fileName), "2025_01/2025_01_%02d.idx", day );
+        retentionTestFileWrite( fileName, 8 );
+    }
+    // Recent
+    retentionTestFileWrite( "2026_05_30_10_00_00.txt", 100 );
+    retentionTestFileWrite( "2026_05/2026_05_31.log", 160 );
+    retentionTestFileWrite( "2026_05/2026_05_31.idx", 8 );
+    // Not the journal's, an export and files that only look like one
+    retentionTestFileWrite( "2025_01_12.txt", 100 );
+    retentionTestFileWrite( "2025_01_10_08_30_00.bak", 100 );
+    retentionTestFileWrite( "2025_01_10_08_30.txt", 100 );
+    retentionTestFileWrite( "notes.txt", 100 );
+
+    HOST_TEST_CHECK( sdCardInit() );
+    retentionTestPassRun();
+
+    HOST_TEST_CHECK( !retentionTestFileExists( "2025_01_10_08_30_00.txt" ) );
+    HOST_TEST_CHECK( !retentionTestFileExists( "2025_01_11_09_00_05.log" ) );
+    HOST_TEST_CHECK( !retentionTestFileExists( "2025_01_12.log" ) );
+    HOST_TEST_CHECK( !retentionTestFileExists( "2025_01_12.idx" ) );
+    HOST_TEST_CHECK( !retentionTestFileExists( "2025_01/2025_01_01.log" ) );
+    HOST_TEST_CHECK( !retentionTestFileExists( "2025_01/2025_01_31.idx" ) );
+    HOST_TEST_CHECK( eventJournalRetentionRemovedFilesRead() == 4 + 62 );
+
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_05_30_10_00_00.txt" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_05/2026_05_31.log" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_05/2026_05_31.idx" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2025_01_12.txt" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2025_01_10_08_30_00.bak" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2025_01_10_08_30.txt" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "notes.txt" ) );
+
+    // The first flush of a month creates its directory
+    HOST_TEST_CHECK( eventJournalBufferAppend( 0, (uint32_t) time(NULL), 0,
+                                               true ) );
+    HOST_TEST_CHECK( eventJournalFlushStart() );
+    while ( eventJournalFlushStep() == EVENT_JOURNAL_FLUSH_IN_PROGRESS ) {
+    }
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_06/2026_06_01.log" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_06/2026_06_01.idx" ) );
+
+    // A month directory left empty goes with the next pass
+    HOST_TEST_CHECK( retentionTestFileExists( "2025_01" ) );
+    retentionTestPassRun();
+    HOST_TEST_CHECK( !retentionTestFileExists( "2025_01" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_05" ) );
+
+    // Over EVENT_JOURNAL_MAX_TOTAL_SIZE the oldest go first, the files of
+    // the older firmware before the daily files of their day
+    retentionTestFileWrite( "2026_05_31_23_59_59.log",
+                            EVENT_JOURNAL_MAX_TOTAL_SIZE );
+    retentionTestPassRun();
+
+    HOST_TEST_CHECK( !retentionTestFileExists( "2026_05_30_10_00_00.txt" ) );
+    HOST_TEST_CHECK( !retentionTestFileExists( "2026_05_31_23_59_59.log" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_05/2026_05_31.log" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "2026_05/2026_05_31.idx" ) );
+    HOST_TEST_CHECK( retentionTestFileExists( "notes.txt" ) );
+
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+// Also empties and removes the directories in it
+static void retentionTestDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            retentionTestDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
+
+// A sparse file of the given size
+static void retentionTestFileWrite( const char* fileName, long size )
+{
+    std::string path = std::string( RETENTION_TEST_SD_CARD_DIR ) + "/" +
+                       fileName;
+    FILE* file = fopen( path.c_str(), "wb" );
+
+    if ( file == NULL ) {
+        return;
+    }
+    if ( ftruncate( fileno( file ), size ) != 0 ) {
+        printf( "%s could not be written\n", fileName );
+    }
+    fclose( file );
+}
+
+static bool retentionTestFileExists( const char* fileName )
+{
+    std::string path = std::string( RETENTION_TEST_SD_CARD_DIR ) + "/" +
+                       fileName;
+
+    return access( path.c_str(), F_OK ) == 0;
+}
+
+static void retentionTestPassRun()
+{
+    int steps = 0;
+
+    eventJournalRetentionStart();
+    while ( eventJournalRetentionStep() && ( steps < 10000 ) ) {
+        steps++;
+    }
+    HOST_TEST_CHECK( steps < 10000 );
+}
@@ -0,0 +1,288 @@
+//=====[Libraries]=============================================================
+
+#include "ring_buffer.h"
+
+#include "host_test.h"
+
+#include <deque>
+#include <random>
+#include <thread>
+
+//=====[Declaration of private defines]========================================
+
+#define RING_BUFFER_TEST_SIZE        100   // as EVENT_LOG_MAX_STORAGE
+#define SPSC_TEST_SIZE               8
+#define SPSC_TEST_THREADED_ITEMS     2000000
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void ringBufferPushOverwriteTest();
+static void ringBufferIndexWrapTest();
+static void ringBufferLostTest();
+static void ringBufferModelTest();
+static void spscPushPopTest();
+static void spscOverflowTest();
+static void spscPeekReleaseTest();
+static void spscThreadedTest();
+
+//=====[Main function, the program entry point]================================
+
+int main()
+{
+    ringBufferPushOverwriteTest();
+    ringBufferIndexWrapTest();
+    ringBufferLostTest();
+    ringBufferModelTest();
+    spscPushPopTest();
+    spscOverflowTest();
+    spscPeekReleaseTest();
+    spscThreadedTest();
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+static void ringBufferPushOverwriteTest()
+{
+    RingBuffer<int, 4> buffer;
+    int expected;
+    int i;
+
+    HOST_TEST_CHECK( buffer.isEmpty() );
+    HOST_TEST_CHECK( buffer.begin().absoluteIndex() ==
+                     buffer.end().absoluteIndex() );
+    for ( i = 0; i < 4; i++ ) {
+        buffer.push( i );
+    }
+    HOST_TEST_CHECK( buffer.isFull() );
+    HOST_TEST_CHECK( buffer[0] == 0 && buffer[3] == 3 );
+
+    // The oldest items are overwritten
+    buffer.push( 4 );
+    buffer.push( 5 );
+    HOST_TEST_CHECK( buffer.size() == 4 );
+    HOST_TEST_CHECK( buffer.oldestIndex() == 2 );
+    HOST_TEST_CHECK( buffer.endIndex() == 6 );
+    HOST_TEST_CHECK( buffer[0] == 2 && buffer[3] == 5 );
+    HOST_TEST_CHECK( buffer.at( 5 ) == 5 );
+
+    expected = 2;
+    for ( const int& item : buffer ) {
+        HOST_TEST_CHECK( item == expected );
+        expected++;
+    }
+    HOST_TEST_CHECK( expected == 6 );
+
+    buffer.clear( 10 );
+    HOST_TEST_CHECK( buffer.isEmpty() );
+    buffer.push( 7 );
+    HOST_TEST_CHECK( buffer.oldestIndex() == 10 && buffer.at( 10 ) == 7 );
+}
+
+// The absolute index wraps at 2^32, which N = 100 does not divide
+static void ringBufferIndexWrapTest()
+{
+    RingBuffer<uint32_t, RING_BUFFER_TEST_SIZE> buffer;
+    uint32_t start = 0xFFFFFFFFU - 150;
+    uint32_t index;
+    uint32_t i;
+    bool inOrder = true;
+
+    buffer.clear( start );
+    for ( i = 0; i < 300; i++ ) {
+        buffer.push( start + i );
+    }
+    HOST_TEST_CHECK( buffer.size() == RING_BUFFER_TEST_SIZE );
+    HOST_TEST_CHECK( buffer.endIndex() == start + 300 );
+    for ( index = buffer.oldestIndex(); index != buffer.endIndex(); index++ ) {
+        if ( buffer.at( index ) != index ) {
+            inOrder = false;
+        }
+    }
+    HOST_TEST_CHECK( inOrder );
+    HOST_TEST_CHECK( buffer[0] == start + 200 );
+}
+
+static void ringBufferLostTest()
+{
+    RingBuffer<int, 4> buffer;
+    uint32_t cursor = 0;
+    int i;
+
+    for ( i = 0; i < 3; i++ ) {
+        buffer.push( i );
+    }
+    HOST_TEST_CHECK( buffer.lost( cursor ) == 0 );
+    HOST_TEST_CHECK( buffer.firstIndex( cursor ) == 0 );
+
+    for ( i = 3; i < 10; i++ ) {
+        buffer.push( i );
+    }
+    HOST_TEST_CHECK( buffer.lost( cursor ) == 6 );
+    cursor = buffer.firstIndex( cursor );
+    HOST_TEST_CHECK( cursor == 6 && buffer.at( cursor ) == 6 );
+    HOST_TEST_CHECK( buffer.lost( cursor ) == 0 );
+
+    // A cursor past the newest item lost nothing
+    HOST_TEST_CHECK( buffer.lost( buffer.endIndex() ) == 0 );
+}
+
+// Random pushes and clears against a deque that keeps the last N items
+static void ringBufferModelTest()
+{
+    RingBuffer<uint32_t, 7> buffer;
+    std::deque<uint32_t> model;
+    std::mt19937 random( 2024 );
+    uint32_t nextIndex = 0;
+    bool matches = true;
+    uint32_t i;
+    int step;
+
+    for ( step = 0; step < 100000; step++ ) {
+        if ( random() % 500 == 0 ) {
+            nextIndex = random();
+            buffer.clear( nextIndex );
+            model.clear();
+        } else {
+            buffer.push( nextIndex );
+            model.push_back( nextIndex );
+            nextIndex++;
+            if ( model.size() > 7 ) {
+                model.pop_front();
+            }
+        }
+        if ( buffer.size() != model.size() ) {
+            matches = false;
+            break;
+        }
+        for ( i = 0; i < model.size(); i++ ) {
+            if ( buffer[i] != model[i] ||
+                 buffer.at( buffer.oldestIndex() + i ) != model[i] ) {
+                matches = false;
+            }
+        }
+    }
+    HOST_TEST_CHECK( matches );
+}
+
+static void spscPushPopTest()
+{
+    SpscRingBuffer<int, SPSC_TEST_SIZE> buffer;
+    bool inOrder = true;
+    int item = -1;
+    int round;
+    int i;
+
+    HOST_TEST_CHECK( buffer.isEmpty() );
+    HOST_TEST_CHECK( !buffer.pop( item ) );
+
+    // Many rounds, so the slots wrap around
+    for ( round = 0; round < 50; round++ ) {
+        for ( i = 0; i < 5; i++ ) {
+            buffer.push( round * 10 + i );
+        }
+        for ( i = 0; i < 5; i++ ) {
+            if ( !buffer.pop( item ) || item != round * 10 + i ) {
+                inOrder = false;
+            }
+        }
+    }
+    HOST_TEST_CHECK( inOrder );
+    HOST_TEST_CHECK( buffer.isEmpty() );
+    HOST_TEST_CHECK( buffer.overflowsRead() == 0 );
+    HOST_TEST_CHECK( buffer.highWaterMarkRead() == 5 );
+}
+
+static void spscOverflowTest()
+{
+    SpscRingBuffer<int, SPSC_TEST_SIZE> buffer;
+    int item = -1;
+    int i;
+
+    for ( i = 0; i < SPSC_TEST_SIZE; i++ ) {
+        HOST_TEST_CHECK( buffer.push( i ) );
+    }
+    // A full buffer drops the new items, the stored ones are kept
+    HOST_TEST_CHECK( !buffer.push( 100 ) );
+    HOST_TEST_CHECK( !buffer.push( 101 ) );
+    HOST_TEST_CHECK( buffer.overflowsRead() == 2 );
+    HOST_TEST_CHECK( buffer.size() == SPSC_TEST_SIZE );
+    HOST_TEST_CHECK( buffer.highWaterMarkRead() == SPSC_TEST_SIZE );
+    HOST_TEST_CHECK( buffer.pop( item ) && item == 0 );
+    HOST_TEST_CHECK( buffer.push( 102 ) );
+    for ( i = 1; i < SPSC_TEST_SIZE; i++ ) {
+        buffer.pop( item );
+    }
+    HOST_TEST_CHECK( item == SPSC_TEST_SIZE - 1 );
+    HOST_TEST_CHECK( buffer.pop( item ) && item == 102 );
+}
+
+static void spscPeekReleaseTest()
+{
+    SpscRingBuffer<char, SPSC_TEST_SIZE> buffer;
+    const char* data;
+    char item;
+    int i;
+
+    HOST_TEST_CHECK( buffer.peek() == NULL );
+    HOST_TEST_CHECK( buffer.contiguousSize() == 0 );
+
+    // Moves the tail to slot 5, so the next 6 items wrap after 3
+    for ( i = 0; i < 5; i++ ) {
+        buffer.push( 'x' );
+        buffer.pop( item );
+    }
+    for ( i = 0; i < 6; i++ ) {
+        buffer.push( 'a' + i );
+    }
+    HOST_TEST_CHECK( buffer.contiguousSize() == 3 );
+    HOST_TEST_CHECK( buffer.contiguousSize( 1 ) == 2 );
+    HOST_TEST_CHECK( buffer.contiguousSize( 3 ) == 3 );
+    HOST_TEST_CHECK( buffer.contiguousSize( 6 ) == 0 );
+    data = buffer.peek();
+    HOST_TEST_CHECK( data != NULL && memcmp( data, "abc", 3 ) == 0 );
+    HOST_TEST_CHECK( *buffer.peek( 4 ) == 'e' );
+    HOST_TEST_CHECK( buffer.peek( 6 ) == NULL );
+
+    buffer.release( 3 );
+    HOST_TEST_CHECK( buffer.size() == 3 );
+    HOST_TEST_CHECK( buffer.contiguousSize() == 3 );
+    data = buffer.peek();
+    HOST_TEST_CHECK( data != NULL && memcmp( data, "def", 3 ) == 0 );
+    buffer.release( 3 );
+    HOST_TEST_CHECK( buffer.isEmpty() );
+}
+
+// A producer and a consumer thread, as the UART interrupt and the main loop.
+// Overflows only make the producer retry, nothing may be lost or reordered.
+static void spscThreadedTest()
+{
+    SpscRingBuffer<uint32_t, 64> buffer;
+    uint32_t expected = 0;
+    uint32_t item;
+    bool inOrder = true;
+
+    std::thread producer( [&buffer]() {
+        uint32_t next = 0;
+        while ( next < SPSC_TEST_THREADED_ITEMS ) {
+            if ( buffer.push( next ) ) {
+                next++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    } );
+    while ( expected < SPSC_TEST_THREADED_ITEMS ) {
+        if ( buffer.pop( item ) ) {
+            if ( item != expected ) {
+                inOrder = false;
+            }
+            expected++;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    HOST_TEST_CHECK( inOrder );
+    HOST_TEST_CHECK( buffer.isEmpty() );
+}
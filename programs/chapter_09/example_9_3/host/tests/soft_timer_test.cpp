@@ -0,0 +1,485 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "host_test.h"
+
+#include <random>
+
+//=====[Declaration of private defines]========================================
+
+#define SOFT_TIMER_TEST_LEVEL_1       ( (tick_t) 1 << 6 )
+#define SOFT_TIMER_TEST_LEVEL_2       ( (tick_t) 1 << 12 )
+#define SOFT_TIMER_TEST_LEVEL_3       ( (tick_t) 1 << 18 )
+#define SOFT_TIMER_TEST_WHEEL_RANGE   ( (tick_t) 1 << 24 )
+
+#define SOFT_TIMER_TEST_NOT_FIRED     UINT64_MAX
+#define SOFT_TIMER_TEST_MODEL_TIMERS  64
+#define SOFT_TIMER_TEST_MODEL_STEPS   8000
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct softTimerTestRecord {
+    softTimer_t timer;
+    tick_t expiry;
+    tick_t firedTick;
+    int fired;
+    tick_t period;                        // Re-armed from the callback if set
+    struct softTimerTestRecord* other;    // Cancelled or re-armed if set
+    tick_t otherDuration;                 // 0 cancels the other timer
+} softTimerTestRecord_t;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void softTimerCascadeBoundaryTest();
+static void softTimerParkedTest();
+static void softTimerCallbackCancelTest();
+static void softTimerCallbackRearmTest();
+static void softTimerNextDeadlineTest();
+static void softTimerTicklessTest();
+static void softTimerModelTest();
+
+static void softTimerTestRecordInit( softTimerTestRecord_t* record );
+static void softTimerTestCallback( void* params );
+static void softTimerTestAdvance( tick_t ticks );
+static void softTimerTestAdvanceTo( tick_t tick );
+
+//=====[Main function, the program entry point]================================
+
+int main()
+{
+    tickInit( 1 );
+    softTimerCascadeBoundaryTest();
+    softTimerParkedTest();
+    softTimerCallbackCancelTest();
+    softTimerCallbackRearmTest();
+    softTimerNextDeadlineTest();
+    softTimerTicklessTest();
+    softTimerModelTest();
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+// Updated on every tick, each timer must fire on its expiry tick exactly,
+// also when armed one tick before or after a cascade boundary
+static void softTimerCascadeBoundaryTest()
+{
+    static const tick_t durations[] = {
+        1, 2, 63, 64, 65, 127, 128,
+        SOFT_TIMER_TEST_LEVEL_2 - 1, SOFT_TIMER_TEST_LEVEL_2,
+        SOFT_TIMER_TEST_LEVEL_2 + 1,
+        SOFT_TIMER_TEST_LEVEL_3 - 1, SOFT_TIMER_TEST_LEVEL_3,
+        SOFT_TIMER_TEST_LEVEL_3 + 1 };
+    static const tick_t offsets[] = { 0, 1, 37, 63 };
+    static softTimerTestRecord_t records[sizeof( durations ) /
+                                         sizeof( durations[0] )];
+    const int count = sizeof( durations ) / sizeof( durations[0] );
+    tick_t start;
+    tick_t end;
+    bool exact;
+    int o;
+    int i;
+
+    for ( o = 0; o < (int)( sizeof( offsets ) / sizeof( offsets[0] ) ); o++ ) {
+        softTimerUpdate();
+        start = ( tickRead() | ( SOFT_TIMER_TEST_LEVEL_3 - 1 ) ) + 1 +
+                offsets[o];
+        softTimerTestAdvanceTo( start );
+        softTimerUpdate();
+        for ( i = 0; i < count; i++ ) {
+            softTimerTestRecordInit( &records[i] );
+            records[i].expiry = start + durations[i];
+            softTimerArm( &records[i].timer, durations[i] );
+        }
+        end = start + SOFT_TIMER_TEST_LEVEL_3 + 2;
+        while ( tickRead() < end ) {
+            softTimerTestAdvance( 1 );
+            softTimerUpdate();
+        }
+        exact = true;
+        for ( i = 0; i < count; i++ ) {
+            if ( records[i].fired != 1 ||
+                 records[i].firedTick != records[i].expiry ||
+                 !softTimerExpiredRead( &records[i].timer ) ) {
+                exact = false;
+            }
+        }
+        HOST_TEST_CHECK( exact );
+        HOST_TEST_CHECK( softTimerNextDeadlineRead() ==
+                         SOFT_TIMER_NO_DEADLINE );
+    }
+}
+
+// Beyond 2^24 ticks the timers are parked in the last level and placed
+// again on each cascade, they must neither fire early nor be lost
+static void softTimerParkedTest()
+{
+    static const tick_t durations[] = {
+        SOFT_TIMER_TEST_WHEEL_RANGE - 1, SOFT_TIMER_TEST_WHEEL_RANGE,
+        SOFT_TIMER_TEST_WHEEL_RANGE + 1, SOFT_TIMER_TEST_WHEEL_RANGE + 4711,
+        2 * SOFT_TIMER_TEST_WHEEL_RANGE,
+        3 * SOFT_TIMER_TEST_WHEEL_RANGE + 12345 };
+    static softTimerTestRecord_t records[sizeof( durations ) /
+                                         sizeof( durations[0] )];
+    const int count = sizeof( durations ) / sizeof( durations[0] );
+    tick_t start;
+    int i;
+
+    softTimerUpdate();
+    start = tickRead() + 5;
+    softTimerTestAdvanceTo( start );
+    for ( i = 0; i < count; i++ ) {
+        softTimerTestRecordInit( &records[i] );
+        records[i].expiry = start + durations[i];
+        softTimerArm( &records[i].timer, durations[i] );
+    }
+
+    // One update just before and one on each expiry
+    for ( i = 0; i < count; i++ ) {
+        softTimerTestAdvanceTo( records[i].expiry - 1 );
+        softTimerUpdate();
+        HOST_TEST_CHECK( records[i].fired == 0 );
+        HOST_TEST_CHECK( softTimerIsArmed( &records[i].timer ) );
+        softTimerTestAdvance( 1 );
+        softTimerUpdate();
+        HOST_TEST_CHECK( records[i].fired == 1 &&
+                         records[i].firedTick == records[i].expiry );
+    }
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+
+    // Updated on every tick around the end of the wheel range
+    softTimerTestRecordInit( &records[0] );
+    start = tickRead();
+    records[0].expiry = start + SOFT_TIMER_TEST_WHEEL_RANGE + 3;
+    softTimerArm( &records[0].timer, SOFT_TIMER_TEST_WHEEL_RANGE + 3 );
+    softTimerTestAdvanceTo( records[0].expiry - 200 );
+    while ( records[0].fired == 0 && tickRead() < records[0].expiry + 10 ) {
+        softTimerUpdate();
+        softTimerTestAdvance( 1 );
+    }
+    HOST_TEST_CHECK( records[0].firedTick == records[0].expiry );
+}
+
+// Two timers of the same tick that cancel each other, only the first one
+// to run may fire
+static void softTimerCallbackCancelTest()
+{
+    static softTimerTestRecord_t first;
+    static softTimerTestRecord_t second;
+    static softTimerTestRecord_t later;
+
+    softTimerUpdate();
+    softTimerTestRecordInit( &first );
+    softTimerTestRecordInit( &second );
+    first.other = &second;
+    second.other = &first;
+    softTimerArm( &first.timer, 10 );
+    softTimerArm( &second.timer, 10 );
+    softTimerTestAdvance( 20 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( first.fired + second.fired == 1 );
+    HOST_TEST_CHECK( !softTimerIsArmed( &first.timer ) &&
+                     !softTimerIsArmed( &second.timer ) );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+
+    // Cancelling a timer of a later slot
+    softTimerTestRecordInit( &first );
+    softTimerTestRecordInit( &later );
+    first.other = &later;
+    softTimerArm( &first.timer, 5 );
+    softTimerArm( &later.timer, 5000 );
+    softTimerTestAdvance( 10000 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( first.fired == 1 && later.fired == 0 );
+    HOST_TEST_CHECK( !softTimerIsArmed( &later.timer ) );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+
+    // Cancelling itself from the callback only clears the expired flag
+    softTimerTestRecordInit( &first );
+    first.other = &first;
+    softTimerArm( &first.timer, 1 );
+    softTimerTestAdvance( 1 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( first.fired == 1 );
+    HOST_TEST_CHECK( !softTimerExpiredRead( &first.timer ) );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+}
+
+static void softTimerCallbackRearmTest()
+{
+    static softTimerTestRecord_t periodic;
+    static softTimerTestRecord_t first;
+    static softTimerTestRecord_t second;
+    tick_t start;
+    int i;
+
+    // A periodic timer re-armed from its callback, updated on every tick
+    softTimerUpdate();
+    start = tickRead();
+    softTimerTestRecordInit( &periodic );
+    periodic.period = 7;
+    periodic.expiry = start + 7;
+    softTimerArm( &periodic.timer, 7 );
+    for ( i = 0; i < 7000; i++ ) {
+        softTimerTestAdvance( 1 );
+        softTimerUpdate();
+    }
+    HOST_TEST_CHECK( periodic.fired == 1000 );
+    HOST_TEST_CHECK( periodic.firedTick == start + 7000 );
+    HOST_TEST_CHECK( softTimerIsArmed( &periodic.timer ) );
+
+    // Updated late, a periodic timer fires once and restarts from the
+    // current tick, it never loops within one update
+    periodic.fired = 0;
+    softTimerTestAdvance( 100 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( periodic.fired == 1 );
+    softTimerCancel( &periodic.timer );
+
+    // Re-arming a timer that expired in the same slot and did not run yet
+    softTimerTestRecordInit( &first );
+    softTimerTestRecordInit( &second );
+    first.other = &second;
+    first.otherDuration = 5;
+    second.other = &first;
+    second.otherDuration = 5;
+    softTimerArm( &first.timer, 3 );
+    softTimerArm( &second.timer, 3 );
+    start = tickRead();
+    softTimerTestAdvance( 3 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( first.fired + second.fired == 1 );
+    softTimerTestAdvance( 4 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( first.fired + second.fired == 1 );
+    softTimerTestAdvance( 1 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( first.fired == 1 && second.fired == 1 );
+    HOST_TEST_CHECK( first.firedTick + second.firedTick ==
+                     2 * start + 3 + 8 );
+
+    // Each re-arm moves the other timer of the pair again, forever
+    HOST_TEST_CHECK( softTimerIsArmed( &first.timer ) ||
+                     softTimerIsArmed( &second.timer ) );
+    softTimerCancel( &first.timer );
+    softTimerCancel( &second.timer );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+}
+
+static void softTimerNextDeadlineTest()
+{
+    static softTimerTestRecord_t near;
+    static softTimerTestRecord_t far;
+    tick_t start;
+
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+
+    softTimerUpdate();
+    start = ( tickRead() | ( SOFT_TIMER_TEST_LEVEL_1 - 1 ) ) + 1 + 5;
+    softTimerTestAdvanceTo( start );
+    softTimerUpdate();
+
+    // A timer of this lap is the deadline
+    softTimerTestRecordInit( &near );
+    softTimerArm( &near.timer, 10 );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == start + 10 );
+
+    // A timer of a higher level needs a wake-up at the end of the lap
+    softTimerTestRecordInit( &far );
+    softTimerArm( &far.timer, 5000 );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == start + 10 );
+    softTimerCancel( &near.timer );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() ==
+                     start - 5 + SOFT_TIMER_TEST_LEVEL_1 );
+
+    // Past the lap the cascade brings the timer down to its own tick
+    softTimerTestAdvanceTo( start - 5 + SOFT_TIMER_TEST_LEVEL_1 );
+    softTimerUpdate();
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() <= start + 5000 );
+    softTimerTestAdvanceTo( ( start + 5000 ) &
+                            ~( SOFT_TIMER_TEST_LEVEL_1 - 1 ) );
+    softTimerUpdate();
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == start + 5000 );
+    HOST_TEST_CHECK( far.fired == 0 );
+
+    softTimerCancel( &far.timer );
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+}
+
+// Sleeping from deadline to deadline, as the idle loop does, every timer
+// must fire on its own tick with few wake-ups
+static void softTimerTicklessTest()
+{
+    static softTimerTestRecord_t records[20];
+    std::mt19937 random( 13 );
+    tick_t start;
+    tick_t deadline;
+    tick_t farthest = 0;
+    tick_t earliest;
+    int wakeUps = 0;
+    bool exact = true;
+    bool neverLate = true;
+    int i;
+
+    softTimerUpdate();
+    start = tickRead();
+    for ( i = 0; i < 20; i++ ) {
+        softTimerTestRecordInit( &records[i] );
+        records[i].expiry = start + 1 + random() % 2000000;
+        softTimerArmAt( &records[i].timer, records[i].expiry );
+        if ( records[i].expiry > farthest ) {
+            farthest = records[i].expiry;
+        }
+    }
+
+    while ( ( deadline = softTimerNextDeadlineRead() ) !=
+            SOFT_TIMER_NO_DEADLINE ) {
+        earliest = SOFT_TIMER_NO_DEADLINE;
+        for ( i = 0; i < 20; i++ ) {
+            if ( records[i].fired == 0 && records[i].expiry < earliest ) {
+                earliest = records[i].expiry;
+            }
+        }
+        if ( deadline > earliest ) {
+            neverLate = false;
+        }
+        softTimerTestAdvanceTo( deadline );
+        softTimerUpdate();
+        wakeUps++;
+    }
+    for ( i = 0; i < 20; i++ ) {
+        if ( records[i].fired != 1 ||
+             records[i].firedTick != records[i].expiry ) {
+            exact = false;
+        }
+    }
+    HOST_TEST_CHECK( exact );
+    HOST_TEST_CHECK( neverLate );
+
+    // One wake-up per lap of each level at most, far from one per tick
+    HOST_TEST_CHECK( wakeUps <= (int)( 20 + ( farthest - start ) / 64 + 2 ) );
+}
+
+// Random arms, cancels and jumps of the clock against the expiries: after
+// each update every timer due has fired once and no other one has
+static void softTimerModelTest()
+{
+    static softTimerTestRecord_t records[SOFT_TIMER_TEST_MODEL_TIMERS];
+    static bool armed[SOFT_TIMER_TEST_MODEL_TIMERS];
+    std::mt19937_64 random( 2024 );
+    tick_t now;
+    tick_t duration;
+    bool matches = true;
+    int step;
+    int i;
+
+    softTimerUpdate();
+    for ( i = 0; i < SOFT_TIMER_TEST_MODEL_TIMERS; i++ ) {
+        softTimerTestRecordInit( &records[i] );
+        armed[i] = false;
+    }
+
+    for ( step = 0; step < SOFT_TIMER_TEST_MODEL_STEPS && matches; step++ ) {
+        i = random() % SOFT_TIMER_TEST_MODEL_TIMERS;
+        switch ( random() % 4 ) {
+        case 0:
+            softTimerCancel( &records[i].timer );
+            armed[i] = false;
+            break;
+        default:
+            switch ( random() % 4 ) {
+            case 0:  duration = random() % SOFT_TIMER_TEST_LEVEL_1; break;
+            case 1:  duration = random() % SOFT_TIMER_TEST_LEVEL_3; break;
+            case 2:
+                duration = random() % ( 2 * SOFT_TIMER_TEST_WHEEL_RANGE );
+                break;
+            default: duration = 1 + random() % 3; break;
+            }
+            if ( duration == 0 ) {
+                duration = 1;
+            }
+            records[i].expiry = tickRead() + duration;
+            records[i].fired = 0;
+            softTimerArm( &records[i].timer, duration );
+            armed[i] = true;
+            break;
+        }
+
+        switch ( random() % 4 ) {
+        case 0:  softTimerTestAdvance( random() % 3 ); break;
+        case 1:  softTimerTestAdvance( random() % 5000 ); break;
+        case 2:
+            softTimerTestAdvance( random() % SOFT_TIMER_TEST_LEVEL_3 );
+            break;
+        default:
+            softTimerTestAdvance( random() % SOFT_TIMER_TEST_WHEEL_RANGE );
+            break;
+        }
+        softTimerUpdate();
+
+        now = tickRead();
+        for ( i = 0; i < SOFT_TIMER_TEST_MODEL_TIMERS; i++ ) {
+            if ( !armed[i] ) {
+                continue;
+            }
+            if ( records[i].expiry <= now ) {
+                if ( records[i].fired != 1 || records[i].firedTick != now ) {
+                    matches = false;
+                }
+                armed[i] = false;
+            } else if ( records[i].fired != 0 ||
+                        !softTimerIsArmed( &records[i].timer ) ) {
+                matches = false;
+            }
+        }
+    }
+    HOST_TEST_CHECK( matches );
+
+    for ( i = 0; i < SOFT_TIMER_TEST_MODEL_TIMERS; i++ ) {
+        softTimerCancel( &records[i].timer );
+    }
+    HOST_TEST_CHECK( softTimerNextDeadlineRead() == SOFT_TIMER_NO_DEADLINE );
+}
+
+static void softTimerTestRecordInit( softTimerTestRecord_t* record )
+{
+    softTimerInit( &record->timer, softTimerTestCallback, record );
+    record->expiry = 0;
+    record->firedTick = SOFT_TIMER_TEST_NOT_FIRED;
+    record->fired = 0;
+    record->period = 0;
+    record->other = NULL;
+    record->otherDuration = 0;
+}
+
+static void softTimerTestCallback( void* params )
+{
+    softTimerTestRecord_t* record = (softTimerTestRecord_t*) params;
+
+    record->firedTick = tickRead();
+    record->fired++;
+    if ( record->period != 0 ) {
+        softTimerArm( &record->timer, record->period );
+    }
+    if ( record->other != NULL ) {
+        if ( record->otherDuration == 0 ) {
+            softTimerCancel( &record->other->timer );
+        } else {
+            softTimerArm( &record->other->timer, record->otherDuration );
+        }
+    }
+}
+
+static void softTimerTestAdvance( tick_t ticks )
+{
+    hostClockAdvance( ticks * 1000 );
+}
+
+static void softTimerTestAdvanceTo( tick_t tick )
+{
+    if ( tick > tickRead() ) {
+        softTimerTestAdvance( tick - tickRead() );
+    }
+}
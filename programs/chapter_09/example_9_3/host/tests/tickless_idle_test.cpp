@@ -0,0 +1,153 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "smart_home_system.h"
+#include "scheduler.h"
+
+#include "host_test.h"
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define TICKLESS_IDLE_TEST_SECONDS        60
+#define TICKLESS_IDLE_TEST_SD_CARD_DIR    "tickless_idle_test_sd"
+
+// A key that arrives between two task deadlines, 't' prints the date and
+// time
+#define TICKLESS_IDLE_TEST_KEY            "t"
+#define TICKLESS_IDLE_TEST_KEY_DELAY_US   3333
+
+//=====[Declaration and initialization of private global variables]============
+
+static uint64_t keyUs = UINT64_MAX;
+static uint64_t keyAnswerUs = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void ticklessIdleDirectoryClear( const std::string& path );
+static void ticklessIdleUsbTx( void* context, char c );
+
+//=====[Main function, the program entry point]================================
+
+// A simulated minute of the system with nothing to do: no key, no alarm and
+// no Wi-Fi module. The main loop must sleep between the task deadlines, and
+// wake up about as often as its tasks are due, not on every 1 ms tick.
+int main()
+{
+    schedulerTaskStats_t taskStats;
+    tickSleepStats_t sleepStats;
+    double taskDeadlinesPerSecond = 0.0;
+    uint64_t startUs;
+    uint64_t endUs;
+    double sleepRatio;
+    double wakeUpsPerSecond;
+    int i;
+
+    ticklessIdleDirectoryClear( TICKLESS_IDLE_TEST_SD_CARD_DIR );
+    mkdir( TICKLESS_IDLE_TEST_SD_CARD_DIR, 0777 );
+    hostSdCardDirectorySet( TICKLESS_IDLE_TEST_SD_CARD_DIR );
+    hostSerialTxHandlerSet( USBTX, ticklessIdleUsbTx, NULL );
+
+    smartHomeSystemInit();
+
+    // The boot messages have left the UART
+    startUs = hostClockUsRead() + 1000000;
+    while ( hostClockUsRead() < startUs ) {
+        smartHomeSystemUpdate();
+    }
+
+    tickSleepStatsReset();
+    smartHomeSystemLoopIterationsReset();
+    endUs = startUs + TICKLESS_IDLE_TEST_SECONDS * 1000000ULL;
+    while ( hostClockUsRead() < endUs ) {
+        smartHomeSystemUpdate();
+    }
+    tickSleepStatsRead( &sleepStats );
+
+    // The tasks have offsets of their own, each of their deadlines is a
+    // wake up
+    for ( i = 0; i < schedulerNumberOfTasksRead(); i++ ) {
+        if ( schedulerTaskStatsRead( i, &taskStats ) ) {
+            taskDeadlinesPerSecond = taskDeadlinesPerSecond +
+                                     1000.0 / taskStats.periodMs;
+        }
+    }
+
+    sleepRatio = sleepStats.sleepTimeUs / 1000.0 / sleepStats.elapsedMs;
+    wakeUpsPerSecond = sleepStats.wakeUps * 1000.0 / sleepStats.elapsedMs;
+    printf( "%.1f s simulated: asleep %.1f%% of the time, %.1f wake ups "
+            "and %.1f loop iterations per second, %.0f task deadlines per "
+            "second\n",
+            sleepStats.elapsedMs / 1000.0, 100.0 * sleepRatio,
+            wakeUpsPerSecond,
+            smartHomeSystemLoopIterationsRead() * 1000.0 /
+            sleepStats.elapsedMs, taskDeadlinesPerSecond );
+
+    HOST_TEST_CHECK( sleepStats.elapsedMs >=
+                     TICKLESS_IDLE_TEST_SECONDS * 1000 );
+    HOST_TEST_CHECK( sleepRatio > 0.95 );
+    // Deadlines due on the same tick share a wake up and the display pump
+    // adds a few, a 1 ms tick would be 1000 per second
+    HOST_TEST_CHECK( wakeUpsPerSecond >= taskDeadlinesPerSecond * 0.9 );
+    HOST_TEST_CHECK( wakeUpsPerSecond <= taskDeadlinesPerSecond * 1.1 );
+    HOST_TEST_CHECK( wakeUpsPerSecond < 1000.0 / 2 );
+
+    // A key press ends the sleep, it is answered long before the next task
+    // deadline would have woken the CPU
+    keyUs = hostClockUsRead() + TICKLESS_IDLE_TEST_KEY_DELAY_US;
+    hostSerialRxDelayedWrite( USBTX, TICKLESS_IDLE_TEST_KEY_DELAY_US,
+                              TICKLESS_IDLE_TEST_KEY,
+                              strlen( TICKLESS_IDLE_TEST_KEY ) );
+    endUs = keyUs + 100000;
+    while ( hostClockUsRead() < endUs ) {
+        smartHomeSystemUpdate();
+    }
+    printf( "Key answered %.3f ms after it was sent\n",
+            keyAnswerUs > keyUs ? ( keyAnswerUs - keyUs ) / 1000.0 : 0.0 );
+    HOST_TEST_CHECK( keyAnswerUs > keyUs );
+    HOST_TEST_CHECK( keyAnswerUs - keyUs <
+                     SYSTEM_TIME_INCREMENT_MS * 1000 / 2 );
+
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+// Also empties and removes the directories in it, such as the month
+// directories of the event log
+static void ticklessIdleDirectoryClear( const std::string& path )
+{
+    DIR* dir = opendir( path.c_str() );
+    struct dirent* entry;
+    std::string entryPath;
+
+    if ( dir == NULL ) {
+        return;
+    }
+    while ( ( entry = readdir( dir ) ) != NULL ) {
+        if ( entry->d_name[0] == '.' ) {
+            continue;
+        }
+        entryPath = path + "/" + entry->d_name;
+        if ( unlink( entryPath.c_str() ) != 0 ) {
+            ticklessIdleDirectoryClear( entryPath );
+            rmdir( entryPath.c_str() );
+        }
+    }
+    closedir( dir );
+}
+
+// The time of the first byte written after the key was sent
+static void ticklessIdleUsbTx( void* context, char c )
+{
+    if ( ( keyAnswerUs == 0 ) && ( hostClockUsRead() >= keyUs ) ) {
+        keyAnswerUs = hostClockUsRead();
+    }
+}
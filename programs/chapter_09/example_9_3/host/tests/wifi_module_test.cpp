@@ -0,0 +1,280 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+#include "wifi_module.h"
+
+#include "host_test.h"
+
+#include <random>
+#include <string>
+
+//=====[Declaration of private defines]========================================
+
+#define WIFI_TEST_UART_TX        D42
+#define WIFI_TEST_BYTE_US        87      // 10 bits at 115200 bps, rounded up
+#define WIFI_TEST_MAX_CHUNK      7
+#define WIFI_TEST_SPLIT_ROUNDS   200
+
+//=====[Declaration and initialization of private global variables]============
+
+static std::string sentCommands;
+static std::string receivedData;
+static int receivedDataLinkId = -1;
+static wifiModuleRequestResult_t lastResult = WIFI_MODULE_BUSY;
+static int results = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void wifiModuleSplitLinesTest();
+static void wifiModuleResponseErrorsTest();
+static void wifiModuleOverlongLineTest();
+static void wifiModuleIpdPayloadTest();
+static void wifiModuleTimeoutTest();
+
+static void wifiTestFeed( const std::string& text, unsigned int seed );
+static void wifiTestWait( uint64_t us );
+static void wifiTestTx( void* context, char c );
+static void wifiTestResult( wifiModuleRequestResult_t result );
+static void wifiTestData( int linkId, char const* data, int length );
+
+//=====[Main function, the program entry point]================================
+
+// Drives the module through its UART, the bytes arrive at 115200 bps and are
+// pushed to the RX buffer by the interrupt handler as on the board
+int main()
+{
+    uint32_t overflows;
+
+    hostSerialTxHandlerSet( WIFI_TEST_UART_TX, wifiTestTx, NULL );
+    tickInit( 1 );
+    wifiModuleInit();
+    wifiModuleDataHandlerSet( wifiTestData );
+
+    wifiModuleSplitLinesTest();
+    wifiModuleResponseErrorsTest();
+    HOST_TEST_CHECK( wifiModuleRxOverflowsRead() == 0 );
+    wifiModuleOverlongLineTest();
+    overflows = wifiModuleRxOverflowsRead();
+    wifiModuleIpdPayloadTest();
+    wifiModuleTimeoutTest();
+    HOST_TEST_CHECK( wifiModuleRxOverflowsRead() == overflows );
+    HOST_TEST_CHECK( hostSerialRxOverrunsRead( WIFI_TEST_UART_TX ) == 0 );
+    return hostTestResult();
+}
+
+//=====[Implementations of private functions]==================================
+
+// The same responses cut at random points, with echoed commands, "+IPD"
+// frames between and inside the response lines and payloads that hold
+// response lines themselves
+static void wifiModuleSplitLinesTest()
+{
+    bool statusMatches = true;
+    bool ipMatches = true;
+    bool dataMatches = true;
+    bool allScanned = true;
+    unsigned int seed;
+
+    for ( seed = 1; seed <= WIFI_TEST_SPLIT_ROUNDS; seed++ ) {
+        receivedData.clear();
+        sentCommands.clear();
+        results = 0;
+        wifiModuleStartIsConnectedWithAP( wifiTestResult );
+        wifiModuleStartIpGet( wifiTestResult );
+
+        wifiTestFeed( "AT+CIPSTATUS\r\r\n+IPD,1,12:hel\nlo\r\nOK\r\n\r\n"
+                      "STATUS:3\r\n"
+                      "+CIPSTATUS:0,\"TCP\",\"1.2.3.4\",80,1234,0\r\n"
+                      "+CIPSTATUS:2,\"TCP\",\"1.2.3.4\",80,1235,0\r\n"
+                      "\r\nOK\r\n", seed );
+        if ( results != 1 || lastResult != WIFI_MODULE_IS_CONNECTED ||
+             wifiModuleOpenLinksRead() != 0x05 ) {
+            statusMatches = false;
+        }
+        if ( receivedData != "hel\nlo\r\nOK\r\n" || receivedDataLinkId != 1 ) {
+            dataMatches = false;
+        }
+
+        wifiTestFeed( "AT+CIFSR\r\r\n+CIFSR:APIP,\"9.9.9.9\"\r\n"
+                      "+IPD,5:OKAY!\r\n"
+                      "+CIFSR:STAIP,\"192.168.100.200\"\r\nOKAY\r\nOK\r\n",
+                      seed );
+        if ( results != 2 || lastResult != WIFI_MODULE_IP_GET_COMPLETE ||
+             strcmp( wifiModuleIpRead(), "192.168.100.200" ) != 0 ) {
+            ipMatches = false;
+        }
+        if ( receivedData != "hel\nlo\r\nOK\r\nOKAY!" ||
+             receivedDataLinkId != 0 ) {
+            dataMatches = false;
+        }
+        if ( wifiModuleCharAvailable() ||
+             sentCommands != "AT+CIPSTATUS\r\nAT+CIFSR\r\n" ) {
+            allScanned = false;
+        }
+    }
+    HOST_TEST_CHECK( statusMatches );
+    HOST_TEST_CHECK( ipMatches );
+    HOST_TEST_CHECK( dataMatches );
+    HOST_TEST_CHECK( allScanned );
+}
+
+static void wifiModuleResponseErrorsTest()
+{
+    char ip[WIFI_MODULE_IP_MAX_LEN + 1];
+
+    // An IP that does not fit is ignored
+    strcpy( ip, wifiModuleIpRead() );
+    results = 0;
+    wifiModuleStartIpGet( wifiTestResult );
+    wifiTestFeed( "+CIFSR:STAIP,\"1234567890123456\"\r\nOK\r\n", 1 );
+    HOST_TEST_CHECK( results == 1 &&
+                     lastResult == WIFI_MODULE_IP_GET_COMPLETE );
+    HOST_TEST_CHECK( strcmp( wifiModuleIpRead(), ip ) == 0 );
+
+    // The error code comes from the digit after "+CWJAP:"
+    results = 0;
+    wifiModuleStartConnectWithAP( wifiTestResult );
+    wifiTestFeed( "WIFI DISCONNECT\r\n+CWJAP:3\r\n\r\nFAIL\r\n", 3 );
+    HOST_TEST_CHECK( results == 1 &&
+                     lastResult == WIFI_MODULE_CONNECT_AP_ERR_AP_NOT_FOUND );
+
+    // A response without fields must be the whole line
+    results = 0;
+    wifiModuleStartDetection( wifiTestResult );
+    wifiTestFeed( "OKAY\r\nNOT OK\r\nOK \r\n", 4 );
+    HOST_TEST_CHECK( results == 0 );
+    wifiTestFeed( "OK\r\n", 4 );
+    HOST_TEST_CHECK( results == 1 && lastResult == WIFI_MODULE_DETECTED );
+
+    // A malformed "+IPD" header is an ordinary line
+    results = 0;
+    receivedData.clear();
+    wifiModuleStartDetection( wifiTestResult );
+    wifiTestFeed( "+IPD,x:\r\n+IPD,1,:\r\nOK\r\n", 5 );
+    HOST_TEST_CHECK( results == 1 && lastResult == WIFI_MODULE_DETECTED );
+    HOST_TEST_CHECK( receivedData.empty() );
+}
+
+// A line longer than the RX buffer can never end, it is dropped once it
+// fills the buffer and the next lines are read again. Bytes that arrive
+// while the buffer is full are lost. AT+RST waits long enough for it all.
+static void wifiModuleOverlongLineTest()
+{
+    std::string garbage( 2000, 'x' );
+
+    results = 0;
+    wifiModuleStartReset( wifiTestResult );
+    wifiTestFeed( garbage + "ready\r\n\r\nready\r\n", 5 );
+    HOST_TEST_CHECK( results == 1 &&
+                     lastResult == WIFI_MODULE_RESET_COMPLETE );
+    HOST_TEST_CHECK( !wifiModuleCharAvailable() );
+
+    // A line that nearly fills the buffer is kept
+    results = 0;
+    wifiModuleStartDetection( wifiTestResult );
+    wifiTestFeed( std::string( 500, 'y' ) + "\r\nOK\r\n", 6 );
+    HOST_TEST_CHECK( results == 1 && lastResult == WIFI_MODULE_DETECTED );
+}
+
+// Payloads larger than the RX buffer stream through it, in pieces small
+// and large
+static void wifiModuleIpdPayloadTest()
+{
+    std::string payload( 1500, ' ' );
+    size_t i;
+
+    for ( i = 0; i < payload.size(); i++ ) {
+        payload[i] = 'a' + i % 26;
+    }
+    receivedData.clear();
+    wifiTestFeed( "+IPD,3,1500:" + payload, 7 );
+    HOST_TEST_CHECK( receivedData == payload && receivedDataLinkId == 3 );
+
+    // All at once, the main loop running every 10 ms
+    receivedData.clear();
+    std::string frame = "\r\n+IPD,1500:" + payload + "\r\nOK\r\n";
+    hostSerialRxWrite( WIFI_TEST_UART_TX, frame.data(), frame.size() );
+    for ( i = 0; i < 30; i++ ) {
+        wifiTestWait( 10000 );
+        wifiModuleUpdate();
+    }
+    HOST_TEST_CHECK( receivedData == payload && receivedDataLinkId == 0 );
+    HOST_TEST_CHECK( !wifiModuleCharAvailable() );
+}
+
+static void wifiModuleTimeoutTest()
+{
+    // No answer
+    results = 0;
+    wifiModuleStartDetection( wifiTestResult );
+    wifiModuleUpdate();
+    wifiTestWait( 49000 );
+    wifiModuleUpdate();
+    HOST_TEST_CHECK( results == 0 );
+    wifiTestWait( 2000 );
+    wifiModuleUpdate();
+    HOST_TEST_CHECK( results == 1 && lastResult == WIFI_MODULE_NOT_DETECTED );
+
+    // No answer to AT+CWJAP is a connection timeout, not a missing module
+    results = 0;
+    wifiModuleStartConnectWithAP( wifiTestResult );
+    wifiModuleUpdate();
+    wifiTestWait( 20001000 );
+    wifiModuleUpdate();
+    HOST_TEST_CHECK( results == 1 &&
+                     lastResult == WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT );
+
+    // An answer that arrived in time but is read late is not a timeout
+    results = 0;
+    wifiModuleStartDetection( wifiTestResult );
+    wifiModuleUpdate();
+    hostSerialRxWrite( WIFI_TEST_UART_TX, "OK\r\n", 4 );
+    wifiTestWait( 100000 );
+    wifiModuleUpdate();
+    HOST_TEST_CHECK( results == 1 && lastResult == WIFI_MODULE_DETECTED );
+}
+
+// Sends the text in pieces of 1 to WIFI_TEST_MAX_CHUNK bytes, the module is
+// updated once each piece was received
+static void wifiTestFeed( const std::string& text, unsigned int seed )
+{
+    std::mt19937 random( seed );
+    size_t position = 0;
+    size_t length;
+
+    while ( position < text.size() ) {
+        length = 1 + random() % WIFI_TEST_MAX_CHUNK;
+        if ( length > text.size() - position ) {
+            length = text.size() - position;
+        }
+        hostSerialRxWrite( WIFI_TEST_UART_TX, text.data() + position, length );
+        wifiTestWait( length * WIFI_TEST_BYTE_US );
+        wifiModuleUpdate();
+        position = position + length;
+    }
+    wifiModuleUpdate();
+}
+
+static void wifiTestWait( uint64_t us )
+{
+    hostClockAdvance( us );
+}
+
+static void wifiTestTx( void* context, char c )
+{
+    sentCommands += c;
+}
+
+static void wifiTestResult( wifiModuleRequestResult_t result )
+{
+    lastResult = result;
+    results++;
+}
+
+static void wifiTestData( int linkId, char const* data, int length )
+{
+    receivedData.append( data, length );
+    receivedDataLinkId = linkId;
+}
@@ -35,12 +35,16 @@ static void codeDeactivate();
 
 //=====[Implementations of public functions]===================================
 
+// The code is written by the main thread and compared by the alarm task,
+// the critical sections keep it from being compared half written
 void codeWrite( char* newCodeSequence )
 {
     int i;
+    core_util_critical_section_enter();
     for (i = 0; i < CODE_NUMBER_OF_KEYS; i++) {
         codeSequence[i] = newCodeSequence[i];
     }
+    core_util_critical_section_exit();
 }
 
 bool codeMatchFrom( codeOrigin_t codeOrigin )
@@ -67,11 +71,11 @@ bool codeMatchFrom( codeOrigin_t codeOrigin )
                 pcSerialComCodeCompleteWrite(false);
                 if ( codeIsCorrect ) {
                     codeDeactivate();
-                    pcSerialComStringWrite( "\r\nThe code is correct\r\n\r\n" );
+                    pcSerialComMessagePost( "\r\nThe code is correct\r\n\r\n" );
                 } else {
                     incorrectCodeStateWrite(ON);
                     numberOfIncorrectCodes++;
-                    pcSerialComStringWrite( "\r\nThe code is incorrect\r\n\r\n" );
+                    pcSerialComMessagePost( "\r\nThe code is incorrect\r\n\r\n" );
                 }
             }
 
@@ -91,13 +95,16 @@ bool codeMatchFrom( codeOrigin_t codeOrigin )
 
 static bool codeMatch( char* codeToCompare )
 {
+    bool codeIsCorrect = true;
     int i;
+    core_util_critical_section_enter();
     for (i = 0; i < CODE_NUMBER_OF_KEYS; i++) {
         if ( codeSequence[i] != codeToCompare[i] ) {
-            return false;
+            codeIsCorrect = false;
         }
     }
-    return true;
+    core_util_critical_section_exit();
+    return codeIsCorrect;
 }
 
 static void codeDeactivate()
@@ -29,6 +29,13 @@ char* dateAndTimeRead()
 
 void dateAndTimeWrite( int year, int month, int day, 
                        int hour, int minute, int second )
+{
+    set_time( dateAndTimeToSeconds( year, month, day, 
+                                    hour, minute, second ) );
+}
+
+time_t dateAndTimeToSeconds( int year, int month, int day, 
+                             int hour, int minute, int second )
 {
     struct tm rtcTime;
 
@@ -41,7 +48,7 @@ void dateAndTimeWrite( int year, int month, int day,
 
     rtcTime.tm_isdst = -1;
 
-    set_time( mktime( &rtcTime ) );
+    return mktime( &rtcTime );
 }
 
 //=====[Implementations of private functions]==================================
@@ -16,6 +16,9 @@ char* dateAndTimeRead();
 void dateAndTimeWrite( int year, int month, int day, 
                        int hour, int minute, int second );
 
+time_t dateAndTimeToSeconds( int year, int month, int day, 
+                             int hour, int minute, int second );
+
 //=====[#include guards - end]=================================================
 
 #endif // _DATE_AND_TIME_H_
\ No newline at end of file
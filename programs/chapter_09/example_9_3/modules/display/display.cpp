@@ -4,10 +4,36 @@
 #include "arm_book_lib.h"
 #include "display.h"
 
+#include "sapi.h"
+#include "ring_buffer.h"
+#include "profiler.h"
+
 //=====[Declaration of private defines]========================================
 
+#define DISPLAY_QUEUE_SIZE             128
+#define DISPLAY_PUMP_MAX_WRITES         32
+#define DISPLAY_BITMAP_WORDS           512   // 64 rows of 8 words of 16 pixels
+#define DISPLAY_BITMAP_SOURCES           4   // bitmaps waiting in the queue
+
+#define DISPLAY_CLEAR_DELAY_US        2000   // >1.6 ms
+#define DISPLAY_MODE_DELAY_US         1000
+
 //=====[Declaration of private data types]=====================================
 
+typedef enum {
+    DISPLAY_QUEUE_COMMAND,
+    DISPLAY_QUEUE_DATA,
+    DISPLAY_QUEUE_BITMAP,
+    DISPLAY_QUEUE_WAIT,
+} displayQueueEntryType_t;
+
+// The post delay is the time the controller needs before the next write
+typedef struct displayQueueEntry {
+    uint8_t type;
+    uint8_t value;
+    uint16_t postDelayUs;
+} displayQueueEntry_t;
+
 // SPI_1
 #define SPI1_MOSI   SPI_MOSI   // D11   PA_7
 #define SPI1_MISO   SPI_MISO   // D12   PA_6
@@ -28,39 +54,55 @@ uint8_t image[(128 * 64)/8];
 
 //=====[Declaration and initialization of private global variables]============
 
+// Every write goes through this queue and is sent by displayPump(), which
+// a soft timer calls while there is something to send. No call waits for
+// the display.
+static SpscRingBuffer<displayQueueEntry_t, DISPLAY_QUEUE_SIZE> displayQueue;
+static softTimer_t displayPumpTimer;
+static uint32_t displayQueueOverflows = 0;
+static int displayProfilerSectionId = -1;
+
+// Bitmaps waiting in the queue, each BITMAP entry holds the number of its
+// source. The one in front is sent word by word, and the words already on
+// the screen are kept in a shadow copy and skipped.
+static const uint8_t* displayBitmapSources[DISPLAY_BITMAP_SOURCES];
+static int displayBitmapsQueued = 0;
+static int displayBitmapLastSource = 0;
+static bool displayQueueLastIsBitmap = false;
+static int displayBitmapWordIndex = 0;
+static uint8_t displayBitmapShadow[(128 * 64)/8];
+static bool displayBitmapShadowValid = false;
+
 //=====[Declarations (prototypes) of private functions]========================
 
+static bool displayQueuePush( displayQueueEntryType_t type, uint8_t value,
+                              uint16_t postDelayUs );
+static void displayPump( void* params );
+static bool displayBitmapStep( const uint8_t* bitmap, int* writes );
+static void displaySpiCommandWrite( uint8_t command );
+static void displaySpiDataWrite( uint8_t data );
+
 uint8_t startRow, startCol, endRow, endCol; // coordinates of the dirty rectangle
 uint8_t numRows = 64;
 uint8_t numCols = 128;
 
 //=====[Implementations of public functions]===================================
 
+// Clear and return home need more time than the other commands
 displayStatus_t displayCommandWrite( uint8_t command )
 {
-    
-    spiDisplay.lock();
-    spiDisplaySS = 1;
-	spiDisplay.write(0xf8+(0<<1));  // send the SYNC + RS(0)
-	spiDisplay.write(command&0xf0);  // send the higher nibble first
-	spiDisplay.write((command<<4)&0xf0);  // send the lower nibble
-    spiDisplaySS = 0;
-    spiDisplay.unlock();
-    
+    uint16_t postDelayUs = 0;
+
+    if ( command == DISPLAY_CMD_CLEAR || command == DISPLAY_CMD_HOME ) {
+        postDelayUs = DISPLAY_CLEAR_DELAY_US;
+    }
+    displayQueuePush( DISPLAY_QUEUE_COMMAND, command, postDelayUs );
     return DISPLAY_NO_ERR;
 }
-    
 
 displayStatus_t displayDataWrite( uint8_t data )
 {
-    spiDisplay.lock();
-    spiDisplaySS = 1;
-	spiDisplay.write(0xf8+(1<<1));  // send the SYNC + RS(1)
-	spiDisplay.write(data&0xf0);  // send the higher nibble first
-	spiDisplay.write((data<<4)&0xf0);  // send the lower nibble
-    spiDisplaySS = 0;
-	spiDisplay.unlock();
-    
+    displayQueuePush( DISPLAY_QUEUE_DATA, data, 0 );
     return DISPLAY_NO_ERR;
 }
 
@@ -72,35 +114,25 @@ displayStatus_t displayInit( displayType_t type, displayConnection_t connection,
     
     spiDisplay.format(8,3);
     spiDisplay.frequency(1000000);
+    softTimerInit( &displayPumpTimer, displayPump, NULL );
+    displayProfilerSectionId = profilerSectionAdd( "display io" );
+
     //spiDisplayReset = OFF;  // RESET=0
-	delay(10);   // wait for 10ms
+	displayQueuePush( DISPLAY_QUEUE_WAIT, 0, 10000 );   // wait for 10ms
 	//spiDisplayReset = ON;  // RESET=1
 
-	delay(50);   //wait for >40 ms
-
-
-	displayCommandWrite(0x30);  // 8bit mode
-	wait_us(110);  //  >100us delay
-
-	displayCommandWrite(0x30);  // 8bit mode
-	wait_us(40);  // >37us delay
+	displayQueuePush( DISPLAY_QUEUE_WAIT, 0, 50000 );   //wait for >40 ms
 
-	displayCommandWrite(0x08);  // D=0, C=0, B=0
-	wait_us(110);  // >100us delay
-
-	displayCommandWrite(0x01);  // clear screen
-	delay(12);  // >10 ms delay
-
-	displayCommandWrite(0x06);  // cursor increment right no shift
-	delay(1);  // 1ms delay
+	displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x30, 110 );  // 8bit mode, >100us delay
+	displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x30, 40 );   // 8bit mode, >37us delay
+	displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x08, 110 );  // D=0, C=0, B=0, >100us delay
+	displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x01, 12000 );  // clear screen, >10 ms delay
+	displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x06, 1000 );  // cursor increment right no shift
 
     //initialization end
 
-	displayCommandWrite(0x0C);  // D=1, C=0, B=0
-    delay(3);  // 1ms delay
-
-	displayCommandWrite(0x02);  // return to home
-	delay(3);  // 1ms delay
+	displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x0C, 3000 );  // D=1, C=0, B=0
+	displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x02, 3000 );  // return to home
     
     return DISPLAY_NO_ERR;                            
 }
@@ -128,54 +160,54 @@ displayStatus_t displayModeWrite( displayMode_t mode )
 {
     if ( mode == DISPLAY_MODE_GRAPHIC )
 	{
-		displayCommandWrite(0x30);  // 8 bit mode
-		delay (1);
-		displayCommandWrite(0x34);  // switch to Extended instructions
-		delay (1);
-		displayCommandWrite(0x36);  // enable graphics
-		delay (1);
+		displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x30, DISPLAY_MODE_DELAY_US );  // 8 bit mode
+		displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x34, DISPLAY_MODE_DELAY_US );  // switch to Extended instructions
+		displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x36, DISPLAY_MODE_DELAY_US );  // enable graphics
 	}
 
 	else if ( mode == DISPLAY_MODE_CHAR )
 	{
-		displayCommandWrite(0x30);  // 8 bit mode
-		delay (1);
+		displayQueuePush( DISPLAY_QUEUE_COMMAND, 0x30, DISPLAY_MODE_DELAY_US );  // 8 bit mode
 	}
     
     return DISPLAY_NO_ERR;
 }
 
+// Only queues the bitmap, its words are sent a few at a time by the pump.
+// A new bitmap replaces the last queued one when nothing was queued after
+// it, otherwise it goes to the end of the queue like any other write. The
+// bitmap is not copied, it is read while it is sent: the buffer must stay
+// valid until then, and changes made to it before that are shown too.
 displayStatus_t displayBitmapWrite( uint8_t* bitmap )
 {
-    uint8_t x, y;
-	for(y = 0; y < 64; y++)
-	{
-		if(y < 32)
-		{
-			for(x = 0; x < 8; x++)							// Draws top half of the screen.
-			{												// In extended instruction mode, vertical and horizontal coordinates must be specified before sending data in.
-				displayCommandWrite(0x80 | y);				// Vertical coordinate of the screen is specified first. (0-31)
-				displayCommandWrite(0x80 | x);				// Then horizontal coordinate of the screen is specified. (0-8)
-				displayDataWrite(bitmap[2*x + 16*y]);		// Data to the upper byte is sent to the coordinate.
-				displayDataWrite(bitmap[2*x+1 + 16*y]);	// Data to the lower byte is sent to the coordinate.
-			}
-		}
-		else
-		{
-			for(x = 0; x < 8; x++)							// Draws bottom half of the screen.
-			{												// Actions performed as same as the upper half screen.
-				displayCommandWrite(0x80 | (y-32));			// Vertical coordinate must be scaled back to 0-31 as it is dealing with another half of the screen.
-				displayCommandWrite(0x88 | x);
-				displayDataWrite(bitmap[2*x + 16*y]);
-				displayDataWrite(bitmap[2*x+1 + 16*y]);
-			}
-		}
+    if ( displayQueueLastIsBitmap ) {
+        displayBitmapSources[displayBitmapLastSource] = bitmap;
+        // Only the front bitmap may be half sent, it starts over
+        if ( displayBitmapsQueued == 1 ) {
+            displayBitmapWordIndex = 0;
+        }
+        return DISPLAY_NO_ERR;
+    }
 
-	}
-    
+    if ( displayBitmapsQueued >= DISPLAY_BITMAP_SOURCES ) {
+        displayQueueOverflows++;
+        return DISPLAY_ERR_1;
+    }
+    displayBitmapLastSource = ( displayBitmapLastSource + 1 ) %
+                              DISPLAY_BITMAP_SOURCES;
+    displayBitmapSources[displayBitmapLastSource] = bitmap;
+    if ( !displayQueuePush( DISPLAY_QUEUE_BITMAP, displayBitmapLastSource, 0 ) ) {
+        return DISPLAY_ERR_1;
+    }
+    displayBitmapsQueued++;
     return DISPLAY_NO_ERR;
 }
 
+uint32_t displayQueueOverflowsRead()
+{
+    return displayQueueOverflows;
+}
+
 displayStatus_t displayPixelPositionWrite( int pixelPositionX, 
                                           int pixelPositionY,
                                           bool pixelValue )
@@ -198,4 +230,140 @@ displayStatus_t displayPixelPositionWrite( int pixelPositionX,
   return DISPLAY_NO_ERR;
 }
 
-//=====[Implementations of private functions]==================================
\ No newline at end of file
+//=====[Implementations of private functions]==================================
+
+static bool displayQueuePush( displayQueueEntryType_t type, uint8_t value,
+                              uint16_t postDelayUs )
+{
+    displayQueueEntry_t entry;
+
+    entry.type = type;
+    entry.value = value;
+    entry.postDelayUs = postDelayUs;
+    if ( !displayQueue.push( entry ) ) {
+        displayQueueOverflows++;
+        return false;
+    }
+    displayQueueLastIsBitmap = ( type == DISPLAY_QUEUE_BITMAP );
+    if ( !softTimerIsArmed( &displayPumpTimer ) ) {
+        softTimerArmUs( &displayPumpTimer, 0 );
+    }
+    return true;
+}
+
+// Sends up to DISPLAY_PUMP_MAX_WRITES writes and stops at the first post
+// delay, the timer is armed again for the end of that delay
+static void displayPump( void* params )
+{
+    const displayQueueEntry_t* entry;
+    uint32_t startCycles = profilerCyclesRead();
+    uint16_t postDelayUs = 0;
+    bool bitmapPending = false;
+    int writes = 0;
+
+    while ( ( writes < DISPLAY_PUMP_MAX_WRITES ) &&
+            ( ( entry = displayQueue.peek() ) != NULL ) ) {
+        switch ( entry->type ) {
+            case DISPLAY_QUEUE_COMMAND:
+                // Any command may change what the bitmap shadow stands for
+                displayBitmapShadowValid = false;
+                displaySpiCommandWrite( entry->value );
+                writes++;
+            break;
+            case DISPLAY_QUEUE_DATA:
+                displaySpiDataWrite( entry->value );
+                writes++;
+            break;
+            case DISPLAY_QUEUE_BITMAP:
+                if ( !displayBitmapStep( displayBitmapSources[entry->value],
+                                         &writes ) ) {
+                    bitmapPending = true;
+                    break;
+                }
+                displayBitmapWordIndex = 0;
+                displayBitmapsQueued--;
+                if ( displayBitmapsQueued == 0 ) {
+                    displayQueueLastIsBitmap = false;
+                }
+            break;
+            default:
+            break;
+        }
+        if ( bitmapPending ) {
+            break;
+        }
+        postDelayUs = entry->postDelayUs;
+        displayQueue.release( 1 );
+        if ( postDelayUs > 0 ) {
+            break;
+        }
+    }
+
+    if ( !displayQueue.isEmpty() ) {
+        softTimerArmUs( &displayPumpTimer, postDelayUs );
+    }
+    profilerSectionEnd( displayProfilerSectionId, startCycles );
+}
+
+// Returns true once the whole bitmap was sent
+static bool displayBitmapStep( const uint8_t* bitmap, int* writes )
+{
+    int index;
+    uint8_t x, y;
+
+    while ( displayBitmapWordIndex < DISPLAY_BITMAP_WORDS ) {
+        if ( *writes + 4 > DISPLAY_PUMP_MAX_WRITES ) {
+            return false;
+        }
+        index = 2 * displayBitmapWordIndex;
+        displayBitmapWordIndex++;
+
+        if ( displayBitmapShadowValid &&
+             displayBitmapShadow[index] == bitmap[index] &&
+             displayBitmapShadow[index + 1] == bitmap[index + 1] ) {
+            continue;
+        }
+        displayBitmapShadow[index] = bitmap[index];
+        displayBitmapShadow[index + 1] = bitmap[index + 1];
+
+        y = index / 16;
+        x = ( index % 16 ) / 2;
+        // In extended instruction mode, vertical and horizontal coordinates
+        // must be specified before sending data in. The bottom half of the
+        // screen is addressed as rows 0-31 from horizontal address 8.
+        if ( y < 32 ) {
+            displaySpiCommandWrite( 0x80 | y );
+            displaySpiCommandWrite( 0x80 | x );
+        } else {
+            displaySpiCommandWrite( 0x80 | ( y - 32 ) );
+            displaySpiCommandWrite( 0x88 | x );
+        }
+        displaySpiDataWrite( bitmap[index] );      // upper byte
+        displaySpiDataWrite( bitmap[index + 1] );  // lower byte
+        *writes = *writes + 4;
+    }
+    displayBitmapShadowValid = true;
+    return true;
+}
+
+static void displaySpiCommandWrite( uint8_t command )
+{
+    spiDisplay.lock();
+    spiDisplaySS = 1;
+	spiDisplay.write(0xf8+(0<<1));  // send the SYNC + RS(0)
+	spiDisplay.write(command&0xf0);  // send the higher nibble first
+	spiDisplay.write((command<<4)&0xf0);  // send the lower nibble
+    spiDisplaySS = 0;
+    spiDisplay.unlock();
+}
+
+static void displaySpiDataWrite( uint8_t data )
+{
+    spiDisplay.lock();
+    spiDisplaySS = 1;
+	spiDisplay.write(0xf8+(1<<1));  // send the SYNC + RS(1)
+	spiDisplay.write(data&0xf0);  // send the higher nibble first
+	spiDisplay.write((data<<4)&0xf0);  // send the lower nibble
+    spiDisplaySS = 0;
+	spiDisplay.unlock();
+}
@@ -125,6 +125,8 @@ displayStatus_t displayModeWrite( displayMode_t mode );
 
 displayStatus_t displayBitmapWrite( uint8_t* bitmap );
 
+uint32_t displayQueueOverflowsRead();
+
 displayStatus_t displayPixelPositionWrite( int pixelPositionX, 
                                           int pixelPositionY,
                                           bool pixelValue );
@@ -0,0 +1,1165 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "event_journal.h"
+
+#include "event_log.h"
+#include "sd_card.h"
+#include "date_and_time.h"
+#include "event_store.h"
+
+//=====[Declaration of private defines]========================================
+
+#define EVENT_JOURNAL_CRC16_INITIAL_VALUE   0xFFFF
+#define EVENT_JOURNAL_CRC16_POLYNOMIAL      0x1021
+
+#define EVENT_JOURNAL_INDEX_MAX_ENTRIES     ( EVENT_JOURNAL_BUFFER_SIZE / \
+                                              sizeof(eventJournalRecord_t) / \
+                                              EVENT_JOURNAL_INDEX_INTERVAL + 1 )
+
+#define EVENT_JOURNAL_STATE_FILE_NAME       "journal.dat"
+#define EVENT_JOURNAL_STATE_MAGIC           0x57A7
+#define EVENT_JOURNAL_NO_PART               -1
+
+#define EVENT_JOURNAL_LEGACY_TEXT_EXTENSION ".txt"
+#define EVENT_JOURNAL_LEGACY_PART           -1
+
+#define EVENT_JOURNAL_MONTH_NAME_LENGTH     8     // YYYY_MM
+#define EVENT_JOURNAL_RETENTION_MAX_VICTIMS 16
+
+//=====[Declaration of private data types]=====================================
+
+typedef enum {
+    EVENT_JOURNAL_FLUSH_STATE_IDLE,
+    EVENT_JOURNAL_FLUSH_STATE_OPEN_LOG,
+    EVENT_JOURNAL_FLUSH_STATE_WRITE_STATE,
+    EVENT_JOURNAL_FLUSH_STATE_WRITE_LOG,
+    EVENT_JOURNAL_FLUSH_STATE_CLOSE_LOG,
+    EVENT_JOURNAL_FLUSH_STATE_WRITE_INDEX,
+    EVENT_JOURNAL_FLUSH_STATE_WRITE_RAW,
+} eventJournalFlushState_t;
+
+// Names the two newest log files, so that the boot does not have to search
+// the SD card for them. Days are counted from the epoch.
+typedef struct eventJournalState {
+    uint16_t magic;
+    uint16_t crc;
+    uint32_t newestDay;
+    int32_t newestPart;
+    uint32_t previousDay;
+    int32_t previousPart;
+} eventJournalState_t;
+
+typedef enum {
+    EVENT_JOURNAL_RETENTION_IDLE,
+    EVENT_JOURNAL_RETENTION_SCAN,
+    EVENT_JOURNAL_RETENTION_REMOVE,
+} eventJournalRetentionState_t;
+
+// A file the retention pass may remove. Files go by day and part, and an
+// index before its log.
+typedef struct eventJournalRetentionFile {
+    char name[SD_CARD_FILENAME_MAX_LENGTH];
+    uint32_t daySeconds;
+    int part;
+    bool isLog;
+    uint32_t size;
+} eventJournalRetentionFile_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static eventJournalRecord_t journalBuffer[EVENT_JOURNAL_BUFFER_SIZE /
+                                          sizeof(eventJournalRecord_t)]
+                                          MBED_ALIGN(4);
+static int journalBufferNumberOfRecords = 0;
+
+static eventJournalIndexEntry_t flushIndexEntries[EVENT_JOURNAL_INDEX_MAX_ENTRIES];
+static int flushIndexNumberOfEntries = 0;
+
+static char flushFileName[SD_CARD_FILENAME_MAX_LENGTH];
+static sdCardFile_t flushFile = { NULL };
+static int flushBytesWritten = 0;
+static uint32_t flushDay = 0;
+static int flushPart = 0;
+static eventJournalFlushState_t flushState = EVENT_JOURNAL_FLUSH_STATE_IDLE;
+static bool flushMonthDirCreated = false;
+static uint32_t flushIndexMisses = 0;
+
+static eventJournalState_t journalState = { 0, 0, 0, EVENT_JOURNAL_NO_PART,
+                                            0, EVENT_JOURNAL_NO_PART };
+
+static sdCardFile_t exportJournalFile = { NULL };
+static sdCardFile_t exportTextFile = { NULL };
+
+static bool queryRunning = false;
+static uint32_t queryFromSeconds = 0;
+static uint32_t queryToSeconds = 0;
+static uint32_t queryDay = 0;
+static int queryPart = 0;
+static sdCardFile_t queryFile = { NULL };
+
+// One sector of records, read and used within a single query or export step
+static eventJournalRecord_t stepRecords[EVENT_JOURNAL_SECTOR_SIZE /
+                                        sizeof(eventJournalRecord_t)];
+
+static eventJournalRetentionState_t retentionState = EVENT_JOURNAL_RETENTION_IDLE;
+static sdCardDir_t retentionDir = { false };
+static sdCardDir_t retentionMonthDir = { false };
+static char retentionMonthName[EVENT_JOURNAL_MONTH_NAME_LENGTH];
+static int retentionMonthEntries = 0;
+static char retentionEmptyMonthName[EVENT_JOURNAL_MONTH_NAME_LENGTH];
+static uint32_t retentionTotalSize = 0;
+static eventJournalRetentionFile_t
+    retentionOldestFiles[EVENT_JOURNAL_RETENTION_MAX_VICTIMS];
+static int retentionNumberOfOldestFiles = 0;
+static int retentionOldestFilesRemoved = 0;
+static uint32_t retentionRemovedFiles = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static uint16_t eventJournalRecordCrc( const eventJournalRecord_t* record );
+static eventJournalFlushStatus_t eventJournalFlushFail();
+static void eventJournalIndexEntriesBuild( long logFileSize );
+static long eventJournalIndexLookup( const char* indexFileName,
+                                     uint32_t fromSeconds );
+static eventJournalStepStatus_t eventJournalExportEnd(
+    eventJournalStepStatus_t status );
+static eventJournalStepStatus_t eventJournalQueryEnd(
+    eventJournalStepStatus_t status );
+static bool eventJournalFileParse( const char* fileName,
+                                   const char* extension,
+                                   uint32_t* daySeconds, int* part );
+static bool eventJournalLegacyFileParse( const char* fileName,
+                                         uint32_t* daySeconds );
+static bool eventJournalMonthParse( const char* dirName,
+                                    uint32_t* monthSeconds );
+static void eventJournalMonthNameBuild( uint32_t seconds, char* dirName );
+static void eventJournalTailRead( const char* logFileName, int maxRecords );
+static void eventJournalTailFilesRead( int maxRecords );
+static bool eventJournalStateRead();
+static bool eventJournalStateWrite();
+static bool eventJournalStateRebuild();
+static uint16_t eventJournalStateCrc( const eventJournalState_t* state );
+static void eventJournalRetentionScanStep();
+static void eventJournalRetentionMonthScanStep();
+static void eventJournalRetentionFileAdd( const char* fileName,
+                                          uint32_t daySeconds, int part,
+                                          bool isLog, long size );
+static void eventJournalRetentionRemoveStep();
+static void eventJournalStateRebuildMonth( const char* monthName );
+
+//=====[Implementations of public functions]===================================
+
+void eventJournalBufferReset()
+{
+    journalBufferNumberOfRecords = 0;
+}
+
+bool eventJournalBufferAppend( uint32_t sequence, uint32_t seconds,
+                               uint8_t elementId, bool state )
+{
+    eventJournalRecord_t* record;
+
+    if ( journalBufferNumberOfRecords >=
+         (int)( sizeof(journalBuffer) / sizeof(journalBuffer[0]) ) ) {
+        return false;
+    }
+
+    // One file per day, a batch never spans two of them
+    if ( ( journalBufferNumberOfRecords > 0 ) &&
+         ( journalBuffer[0].seconds / EVENT_JOURNAL_SECONDS_PER_DAY !=
+           seconds / EVENT_JOURNAL_SECONDS_PER_DAY ) ) {
+        return false;
+    }
+
+    record = &journalBuffer[journalBufferNumberOfRecords];
+    memset( record, 0, sizeof(eventJournalRecord_t) );
+    record->magic = EVENT_JOURNAL_RECORD_MAGIC;
+    record->sequence = sequence;
+    record->seconds = seconds;
+    record->elementId = elementId;
+    record->flags = state ? EVENT_JOURNAL_RECORD_STATE_FLAG : 0;
+    record->crc = eventJournalRecordCrc( record );
+
+    journalBufferNumberOfRecords++;
+    return true;
+}
+
+int eventJournalBufferNumberOfRecords()
+{
+    return journalBufferNumberOfRecords;
+}
+
+const eventJournalRecord_t* eventJournalBufferRecordRead( int index )
+{
+    return &journalBuffer[index];
+}
+
+// The buffer must not be modified until the flush completes or fails. The
+// records are appended to the log file of the day they belong to, which is
+// split in parts of EVENT_JOURNAL_MAX_FILE_SIZE bytes and kept in the
+// directory of its month.
+bool eventJournalFlushStart()
+{
+    if ( ( flushState != EVENT_JOURNAL_FLUSH_STATE_IDLE ) ||
+         ( journalBufferNumberOfRecords == 0 ) ) {
+        return false;
+    }
+
+    if ( journalBuffer[0].seconds / EVENT_JOURNAL_SECONDS_PER_DAY != flushDay ) {
+        flushDay = journalBuffer[0].seconds / EVENT_JOURNAL_SECONDS_PER_DAY;
+        flushPart = 0;
+    }
+    flushBytesWritten = 0;
+    flushIndexNumberOfEntries = 0;
+    flushMonthDirCreated = false;
+#if EVENT_STORE_RAW_ENABLED
+    flushState = EVENT_JOURNAL_FLUSH_STATE_WRITE_RAW;
+#else
+    flushState = EVENT_JOURNAL_FLUSH_STATE_OPEN_LOG;
+#endif
+    return true;
+}
+
+// Every call does a bounded amount of work: it opens the log file, writes
+// at most one sector of the buffer, closes the file or appends the index.
+// A full part is only closed and the next one is opened by the next call.
+eventJournalFlushStatus_t eventJournalFlushStep()
+{
+    int bufferLength = journalBufferNumberOfRecords *
+                       sizeof(eventJournalRecord_t);
+    int bytesToWrite;
+    int indexLength;
+    int paddingLength;
+    long logFileSize;
+    uint8_t padding[sizeof(eventJournalRecord_t)];
+    char indexFileName[SD_CARD_FILENAME_MAX_LENGTH];
+    char monthName[EVENT_JOURNAL_MONTH_NAME_LENGTH];
+
+    switch( flushState ) {
+
+    case EVENT_JOURNAL_FLUSH_STATE_OPEN_LOG:
+        eventJournalFileNameBuild( journalBuffer[0].seconds, flushPart,
+                                   EVENT_JOURNAL_LOG_EXTENSION,
+                                   flushFileName );
+        if ( !sdCardFileOpen( &flushFile, flushFileName, "ab" ) ) {
+            // The first log file of a month also creates its directory
+            if ( flushMonthDirCreated ) {
+                return eventJournalFlushFail();
+            }
+            eventJournalMonthNameBuild( journalBuffer[0].seconds,
+                                        monthName );
+            if ( !sdCardDirCreate( monthName ) ) {
+                return eventJournalFlushFail();
+            }
+            flushMonthDirCreated = true;
+            return EVENT_JOURNAL_FLUSH_IN_PROGRESS;
+        }
+        logFileSize = sdCardFileSize( &flushFile );
+        if ( logFileSize >= EVENT_JOURNAL_MAX_FILE_SIZE ) {
+            sdCardFileClose( &flushFile );
+            flushPart++;
+            return EVENT_JOURNAL_FLUSH_IN_PROGRESS;
+        }
+        // A reset may have torn the last record, the padding keeps the new
+        // records aligned and the torn one fails its CRC check
+        paddingLength = logFileSize % sizeof(eventJournalRecord_t);
+        if ( paddingLength > 0 ) {
+            paddingLength = sizeof(eventJournalRecord_t) - paddingLength;
+            memset( padding, 0, sizeof(padding) );
+            if ( sdCardFileWrite( &flushFile, padding, paddingLength ) !=
+                 paddingLength ) {
+                return eventJournalFlushFail();
+            }
+            logFileSize = logFileSize + paddingLength;
+        }
+        eventJournalIndexEntriesBuild( logFileSize );
+        if ( ( journalState.newestPart == EVENT_JOURNAL_NO_PART ) ||
+             ( journalState.newestDay != flushDay ) ||
+             ( journalState.newestPart != flushPart ) ) {
+            flushState = EVENT_JOURNAL_FLUSH_STATE_WRITE_STATE;
+        } else {
+            flushState = EVENT_JOURNAL_FLUSH_STATE_WRITE_LOG;
+        }
+        return EVENT_JOURNAL_FLUSH_IN_PROGRESS;
+
+    // The log file changed, the state file names the new one before any
+    // record is written to it
+    case EVENT_JOURNAL_FLUSH_STATE_WRITE_STATE:
+        if ( journalState.newestPart != EVENT_JOURNAL_NO_PART ) {
+            journalState.previousDay = journalState.newestDay;
+            journalState.previousPart = journalState.newestPart;
+        }
+        journalState.newestDay = flushDay;
+        journalState.newestPart = flushPart;
+        if ( !eventJournalStateWrite() ) {
+            return eventJournalFlushFail();
+        }
+        flushState = EVENT_JOURNAL_FLUSH_STATE_WRITE_LOG;
+        return EVENT_JOURNAL_FLUSH_IN_PROGRESS;
+
+    case EVENT_JOURNAL_FLUSH_STATE_WRITE_LOG:
+        bytesToWrite = bufferLength - flushBytesWritten;
+        if ( bytesToWrite > EVENT_JOURNAL_SECTOR_SIZE ) {
+            bytesToWrite = EVENT_JOURNAL_SECTOR_SIZE;
+        }
+        if ( sdCardFileWrite( &flushFile,
+                              (uint8_t*) journalBuffer + flushBytesWritten,
+                              bytesToWrite ) != bytesToWrite ) {
+            return eventJournalFlushFail();
+        }
+        flushBytesWritten = flushBytesWritten + bytesToWrite;
+        if ( flushBytesWritten >= bufferLength ) {
+            flushState = EVENT_JOURNAL_FLUSH_STATE_CLOSE_LOG;
+        }
+        return EVENT_JOURNAL_FLUSH_IN_PROGRESS;
+
+    case EVENT_JOURNAL_FLUSH_STATE_CLOSE_LOG:
+        if ( !sdCardFileClose( &flushFile ) ) {
+            return eventJournalFlushFail();
+        }
+        flushState = EVENT_JOURNAL_FLUSH_STATE_WRITE_INDEX;
+        return EVENT_JOURNAL_FLUSH_IN_PROGRESS;
+
+    case EVENT_JOURNAL_FLUSH_STATE_WRITE_INDEX:
+        // The log records are already stored, so the flush completes anyway.
+        // A missing index entry only makes the queries of that day start
+        // reading earlier, it is counted apart.
+        flushState = EVENT_JOURNAL_FLUSH_STATE_IDLE;
+        journalBufferNumberOfRecords = 0;
+        if ( flushIndexNumberOfEntries > 0 ) {
+            eventJournalFileNameBuild( flushIndexEntries[0].seconds,
+                                       flushPart,
+                                       EVENT_JOURNAL_INDEX_EXTENSION,
+                                       indexFileName );
+            indexLength = flushIndexNumberOfEntries *
+                          sizeof(eventJournalIndexEntry_t);
+            if ( !sdCardWriteFileBlock( indexFileName, flushIndexEntries,
+                                        indexLength ) ) {
+                flushIndexMisses++;
+            }
+        }
+        return EVENT_JOURNAL_FLUSH_COMPLETE;
+
+    // The raw event store takes one sector of records per call
+    case EVENT_JOURNAL_FLUSH_STATE_WRITE_RAW:
+        bytesToWrite = bufferLength - flushBytesWritten;
+        if ( bytesToWrite > (int)( EVENT_STORE_RECORDS_PER_SECTOR *
+                                   sizeof(eventJournalRecord_t) ) ) {
+            bytesToWrite = EVENT_STORE_RECORDS_PER_SECTOR *
+                           sizeof(eventJournalRecord_t);
+        }
+        if ( !eventStoreSectorAppend( journalBuffer + flushBytesWritten /
+                                      sizeof(eventJournalRecord_t),
+                                      bytesToWrite /
+                                      sizeof(eventJournalRecord_t) ) ) {
+            return eventJournalFlushFail();
+        }
+        flushBytesWritten = flushBytesWritten + bytesToWrite;
+        if ( flushBytesWritten < bufferLength ) {
+            return EVENT_JOURNAL_FLUSH_IN_PROGRESS;
+        }
+        flushState = EVENT_JOURNAL_FLUSH_STATE_IDLE;
+        journalBufferNumberOfRecords = 0;
+        return EVENT_JOURNAL_FLUSH_COMPLETE;
+
+    case EVENT_JOURNAL_FLUSH_STATE_IDLE:
+    default:
+        return EVENT_JOURNAL_FLUSH_IDLE;
+    }
+}
+
+// Flushes whose records were stored but whose index entries were not
+uint32_t eventJournalIndexMissesRead()
+{
+    return flushIndexMisses;
+}
+
+bool eventJournalRecordIsValid( const eventJournalRecord_t* record )
+{
+    return ( record->magic == EVENT_JOURNAL_RECORD_MAGIC ) &&
+           ( record->crc == eventJournalRecordCrc( record ) );
+}
+
+bool eventJournalExportStart( const char* journalFileName,
+                              const char* textFileName )
+{
+    if ( exportJournalFile.fd != NULL ) {
+        return false;
+    }
+    if ( !sdCardFileOpen( &exportJournalFile, journalFileName, "rb" ) ) {
+        return false;
+    }
+    if ( !sdCardFileOpen( &exportTextFile, textFileName, "w" ) ) {
+        sdCardFileClose( &exportJournalFile );
+        return false;
+    }
+    return true;
+}
+
+// Converts one sector of records per call
+eventJournalStepStatus_t eventJournalExportStep()
+{
+    char eventStr[EVENT_STR_LENGTH];
+    time_t seconds;
+    int recordsRead;
+    int i;
+
+    if ( exportJournalFile.fd == NULL ) {
+        return EVENT_JOURNAL_STEP_ERROR;
+    }
+
+    recordsRead = sdCardFileRead( &exportJournalFile, stepRecords,
+                                  sizeof(stepRecords) ) /
+                  sizeof(eventJournalRecord_t);
+    for ( i = 0; i < recordsRead; i++ ) {
+        if ( !eventJournalRecordIsValid( &stepRecords[i] ) ) {
+            continue;
+        }
+        seconds = (time_t) stepRecords[i].seconds;
+        eventLogEventToString( seconds, stepRecords[i].elementId,
+                               stepRecords[i].flags &
+                               EVENT_JOURNAL_RECORD_STATE_FLAG,
+                               eventStr );
+        if ( sdCardFileWrite( &exportTextFile, eventStr, strlen(eventStr) ) !=
+             (int) strlen(eventStr) ) {
+            return eventJournalExportEnd( EVENT_JOURNAL_STEP_ERROR );
+        }
+    }
+    if ( recordsRead < (int)( sizeof(stepRecords) /
+                              sizeof(stepRecords[0]) ) ) {
+        return eventJournalExportEnd( EVENT_JOURNAL_STEP_COMPLETE );
+    }
+    return EVENT_JOURNAL_STEP_IN_PROGRESS;
+}
+
+// Daily files are named YYYY_MM_DD, or YYYY_MM_DD_N for the part N of a
+// day, followed by the given extension. They are kept in a YYYY_MM
+// directory, so no directory holds more than a month of them.
+void eventJournalFileNameBuild( uint32_t seconds, int part,
+                                const char* extension, char* fileName )
+{
+    time_t dayStart = (time_t)( seconds - seconds % EVENT_JOURNAL_SECONDS_PER_DAY );
+    char dayStr[SD_CARD_FILENAME_MAX_LENGTH];
+
+    strftime( dayStr, sizeof(dayStr), "%Y_%m/%Y_%m_%d", localtime(&dayStart) );
+    if ( part > 0 ) {
+        snprintf( fileName, SD_CARD_FILENAME_MAX_LENGTH, "%s_%d%s", dayStr,
+                  part, extension );
+    } else {
+        snprintf( fileName, SD_CARD_FILENAME_MAX_LENGTH, "%s%s", dayStr,
+                  extension );
+    }
+}
+
+// Only the daily files in the range are opened and each of them is entered
+// through its index, so the cost depends on the range and not on the
+// number of stored days. A previous query that was not finished is dropped.
+bool eventJournalQueryStart( uint32_t fromSeconds, uint32_t toSeconds )
+{
+    if ( queryFile.fd != NULL ) {
+        sdCardFileClose( &queryFile );
+    }
+    queryRunning = fromSeconds <= toSeconds;
+    queryFromSeconds = fromSeconds;
+    queryToSeconds = toSeconds;
+    queryDay = fromSeconds / EVENT_JOURNAL_SECONDS_PER_DAY;
+    queryPart = 0;
+    return queryRunning;
+}
+
+// Every call either opens the next file of the range and enters it through
+// its index, or reads up to maxRecords records, at most one sector, from it.
+// Records are delivered in file order, the query ends at the first one past
+// the range.
+eventJournalStepStatus_t eventJournalQueryStep( int maxRecords,
+    eventJournalQueryCallback_t recordCallback )
+{
+    char logFileName[SD_CARD_FILENAME_MAX_LENGTH];
+    char indexFileName[SD_CARD_FILENAME_MAX_LENGTH];
+    int recordsRead;
+    int i;
+
+    if ( !queryRunning ) {
+        return EVENT_JOURNAL_STEP_ERROR;
+    }
+
+    if ( queryFile.fd == NULL ) {
+        if ( queryDay > queryToSeconds / EVENT_JOURNAL_SECONDS_PER_DAY ) {
+            return eventJournalQueryEnd( EVENT_JOURNAL_STEP_COMPLETE );
+        }
+        eventJournalFileNameBuild( queryDay * EVENT_JOURNAL_SECONDS_PER_DAY,
+                                   queryPart, EVENT_JOURNAL_LOG_EXTENSION,
+                                   logFileName );
+        // The parts of a day are numbered one after the other
+        if ( !sdCardFileOpen( &queryFile, logFileName, "rb" ) ) {
+            queryDay++;
+            queryPart = 0;
+            return EVENT_JOURNAL_STEP_IN_PROGRESS;
+        }
+        eventJournalFileNameBuild( queryDay * EVENT_JOURNAL_SECONDS_PER_DAY,
+                                   queryPart, EVENT_JOURNAL_INDEX_EXTENSION,
+                                   indexFileName );
+        if ( !sdCardFileSeek( &queryFile,
+                              eventJournalIndexLookup( indexFileName,
+                                                       queryFromSeconds ) ) ) {
+            sdCardFileSeek( &queryFile, 0 );
+        }
+        return EVENT_JOURNAL_STEP_IN_PROGRESS;
+    }
+
+    if ( maxRecords > (int)( sizeof(stepRecords) / sizeof(stepRecords[0]) ) ) {
+        maxRecords = sizeof(stepRecords) / sizeof(stepRecords[0]);
+    }
+    recordsRead = sdCardFileRead( &queryFile, stepRecords,
+                                  maxRecords * sizeof(eventJournalRecord_t) ) /
+                  sizeof(eventJournalRecord_t);
+    for ( i = 0; i < recordsRead; i++ ) {
+        if ( !eventJournalRecordIsValid( &stepRecords[i] ) ) {
+            continue;
+        }
+        if ( stepRecords[i].seconds > queryToSeconds ) {
+            return eventJournalQueryEnd( EVENT_JOURNAL_STEP_COMPLETE );
+        }
+        if ( ( stepRecords[i].seconds >= queryFromSeconds ) &&
+             !recordCallback( &stepRecords[i] ) ) {
+            return eventJournalQueryEnd( EVENT_JOURNAL_STEP_ABORTED );
+        }
+    }
+    if ( recordsRead < maxRecords ) {
+        sdCardFileClose( &queryFile );
+        queryPart++;
+    }
+    return EVENT_JOURNAL_STEP_IN_PROGRESS;
+}
+
+// Loads the journal buffer with the newest valid records, oldest first, and
+// returns how many were loaded. Only the two newest log files are read, and
+// their tails are reached with a seek. Their names are taken from the state
+// file, the SD card is only searched when it is missing.
+int eventJournalTailRecover( int maxRecords )
+{
+    eventJournalBufferReset();
+    if ( maxRecords > (int)( sizeof(journalBuffer) / sizeof(journalBuffer[0]) ) ) {
+        maxRecords = sizeof(journalBuffer) / sizeof(journalBuffer[0]);
+    }
+
+#if EVENT_STORE_RAW_ENABLED
+    journalBufferNumberOfRecords = eventStoreTailRead( journalBuffer, maxRecords );
+#else
+    if ( eventJournalStateRead() || eventJournalStateRebuild() ) {
+        eventJournalTailFilesRead( maxRecords );
+    }
+#endif
+
+    return journalBufferNumberOfRecords;
+}
+
+// A retention pass walks the SD card root and the month directories one
+// entry per step. It adds up the size of the journal files, and of those
+// left in the root by the older firmware, and keeps the
+// EVENT_JOURNAL_RETENTION_MAX_VICTIMS oldest ones. Then it removes them,
+// oldest first, one per step while they are older than
+// EVENT_JOURNAL_MAX_AGE_DAYS or the files take more than
+// EVENT_JOURNAL_MAX_TOTAL_SIZE bytes. Only if all of them went the pass
+// walks the card again. A month directory found empty is removed too.
+void eventJournalRetentionStart()
+{
+    if ( retentionState != EVENT_JOURNAL_RETENTION_IDLE ) {
+        return;
+    }
+    if ( !sdCardDirOpen( &retentionDir, "" ) ) {
+        return;
+    }
+    retentionTotalSize = 0;
+    retentionNumberOfOldestFiles = 0;
+    retentionOldestFilesRemoved = 0;
+    retentionEmptyMonthName[0] = '\0';
+    retentionState = EVENT_JOURNAL_RETENTION_SCAN;
+}
+
+// Must not be called while a flush is in progress. Returns true while a
+// retention pass is running.
+bool eventJournalRetentionStep()
+{
+    switch( retentionState ) {
+        case EVENT_JOURNAL_RETENTION_SCAN:
+            eventJournalRetentionScanStep();
+        break;
+        case EVENT_JOURNAL_RETENTION_REMOVE:
+            eventJournalRetentionRemoveStep();
+        break;
+        case EVENT_JOURNAL_RETENTION_IDLE:
+        default:
+            retentionState = EVENT_JOURNAL_RETENTION_IDLE;
+        break;
+    }
+    return retentionState != EVENT_JOURNAL_RETENTION_IDLE;
+}
+
+uint32_t eventJournalRetentionRemovedFilesRead()
+{
+    return retentionRemovedFiles;
+}
+
+// CRC-16/CCITT-FALSE, bitwise to keep the flash footprint small
+uint16_t eventJournalCrc16( const uint8_t* data, int length )
+{
+    uint16_t crc = EVENT_JOURNAL_CRC16_INITIAL_VALUE;
+    int i = 0;
+    int bit = 0;
+
+    for( i=0; i<length; i++ ) {
+        crc ^= (uint16_t)data[i] << 8;
+        for( bit=0; bit<8; bit++ ) {
+            if ( crc & 0x8000 ) {
+                crc = ( crc << 1 ) ^ EVENT_JOURNAL_CRC16_POLYNOMIAL;
+            } else {
+                crc = crc << 1;
+            }
+        }
+    }
+    return crc;
+}
+
+//=====[Implementations of private functions]==================================
+
+// The CRC covers every field that follows it in the record
+static uint16_t eventJournalRecordCrc( const eventJournalRecord_t* record )
+{
+    const uint8_t* recordBytes = (const uint8_t*) record;
+    int crcEnd = sizeof(record->magic) + sizeof(record->crc);
+
+    return eventJournalCrc16( recordBytes + crcEnd,
+                              sizeof(eventJournalRecord_t) - crcEnd );
+}
+
+static eventJournalFlushStatus_t eventJournalFlushFail()
+{
+    if ( flushFile.fd != NULL ) {
+        sdCardFileClose( &flushFile );
+    }
+    flushState = EVENT_JOURNAL_FLUSH_STATE_IDLE;
+    return EVENT_JOURNAL_FLUSH_ERROR;
+}
+
+// Records are numbered from the start of the log file, so the entries keep
+// the same spacing across batches
+static void eventJournalIndexEntriesBuild( long logFileSize )
+{
+    long recordNumber;
+    int i;
+
+    flushIndexNumberOfEntries = 0;
+    if ( logFileSize < 0 ) {
+        return;
+    }
+
+    recordNumber = ( logFileSize + sizeof(eventJournalRecord_t) - 1 ) /
+                   sizeof(eventJournalRecord_t);
+    for( i=0; i<journalBufferNumberOfRecords; i++ ) {
+        if ( ( ( recordNumber + i ) % EVENT_JOURNAL_INDEX_INTERVAL == 0 ) &&
+             ( flushIndexNumberOfEntries < EVENT_JOURNAL_INDEX_MAX_ENTRIES ) ) {
+            flushIndexEntries[flushIndexNumberOfEntries].seconds =
+                journalBuffer[i].seconds;
+            flushIndexEntries[flushIndexNumberOfEntries].offset =
+                logFileSize + i * sizeof(eventJournalRecord_t);
+            flushIndexNumberOfEntries++;
+        }
+    }
+}
+
+// Binary search of the last index entry older than fromSeconds. Records of
+// the same second may be split across an entry, so equal ones are skipped.
+static long eventJournalIndexLookup( const char* indexFileName,
+                                     uint32_t fromSeconds )
+{
+    sdCardFile_t indexFile;
+    eventJournalIndexEntry_t entry;
+    long offset = 0;
+    long low = 0;
+    long high;
+    long middle;
+
+    if ( !sdCardFileOpen( &indexFile, indexFileName, "rb" ) ) {
+        return 0;
+    }
+
+    high = sdCardFileSize( &indexFile ) /
+           (long) sizeof(eventJournalIndexEntry_t);
+    while ( low < high ) {
+        middle = low + ( high - low ) / 2;
+        if ( !sdCardFileSeek( &indexFile, middle * sizeof(entry) ) ||
+             sdCardFileRead( &indexFile, &entry, sizeof(entry) ) !=
+             sizeof(entry) ) {
+            break;
+        }
+        if ( entry.seconds < fromSeconds ) {
+            offset = entry.offset;
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    sdCardFileClose( &indexFile );
+    return offset;
+}
+
+static eventJournalStepStatus_t eventJournalExportEnd(
+    eventJournalStepStatus_t status )
+{
+    sdCardFileClose( &exportJournalFile );
+    if ( !sdCardFileClose( &exportTextFile ) ) {
+        status = EVENT_JOURNAL_STEP_ERROR;
+    }
+    return status;
+}
+
+static eventJournalStepStatus_t eventJournalQueryEnd(
+    eventJournalStepStatus_t status )
+{
+    if ( queryFile.fd != NULL ) {
+        sdCardFileClose( &queryFile );
+    }
+    queryRunning = false;
+    return status;
+}
+
+// Walks the root, or the month directory being walked
+static void eventJournalRetentionScanStep()
+{
+    sdCardDirEntry_t entry;
+    uint32_t daySeconds;
+    int part;
+
+    if ( retentionMonthDir.open ) {
+        eventJournalRetentionMonthScanStep();
+        return;
+    }
+
+    if ( !sdCardDirNext( &retentionDir, &entry ) ) {
+        sdCardDirClose( &retentionDir );
+        retentionState = EVENT_JOURNAL_RETENTION_REMOVE;
+        return;
+    }
+
+    if ( entry.isDirectory ) {
+        if ( eventJournalMonthParse( entry.name, &daySeconds ) &&
+             sdCardDirOpen( &retentionMonthDir, entry.name ) ) {
+            strcpy( retentionMonthName, entry.name );
+            retentionMonthEntries = 0;
+        }
+    } else if ( eventJournalFileParse( entry.name,
+                                       EVENT_JOURNAL_LOG_EXTENSION,
+                                       &daySeconds, &part ) ) {
+        eventJournalRetentionFileAdd( entry.name, daySeconds, part, true,
+                                      entry.size );
+    } else if ( eventJournalFileParse( entry.name,
+                                       EVENT_JOURNAL_INDEX_EXTENSION,
+                                       &daySeconds, &part ) ) {
+        eventJournalRetentionFileAdd( entry.name, daySeconds, part, false,
+                                      entry.size );
+    } else if ( eventJournalLegacyFileParse( entry.name, &daySeconds ) ) {
+        eventJournalRetentionFileAdd( entry.name, daySeconds,
+                                      EVENT_JOURNAL_LEGACY_PART, true,
+                                      entry.size );
+    }
+}
+
+static void eventJournalRetentionMonthScanStep()
+{
+    sdCardDirEntry_t entry;
+    char fileName[SD_CARD_FILENAME_MAX_LENGTH];
+    uint32_t daySeconds;
+    int part;
+    bool isLog;
+
+    if ( !sdCardDirNext( &retentionMonthDir, &entry ) ) {
+        sdCardDirClose( &retentionMonthDir );
+        if ( retentionMonthEntries == 0 ) {
+            strcpy( retentionEmptyMonthName, retentionMonthName );
+        }
+        return;
+    }
+
+    retentionMonthEntries++;
+    if ( eventJournalFileParse( entry.name, EVENT_JOURNAL_LOG_EXTENSION,
+                                &daySeconds, &part ) ) {
+        isLog = true;
+    } else if ( eventJournalFileParse( entry.name,
+                                       EVENT_JOURNAL_INDEX_EXTENSION,
+                                       &daySeconds, &part ) ) {
+        isLog = false;
+    } else {
+        return;
+    }
+    snprintf( fileName, sizeof(fileName), "%s/%s", retentionMonthName,
+              entry.name );
+    eventJournalRetentionFileAdd( fileName, daySeconds, part, isLog,
+                                  entry.size );
+}
+
+// Keeps the oldest files sorted, oldest first. The names do not sort as
+// text, YYYY_MM_DD_10 would come before YYYY_MM_DD_2.
+static void eventJournalRetentionFileAdd( const char* fileName,
+                                          uint32_t daySeconds, int part,
+                                          bool isLog, long size )
+{
+    eventJournalRetentionFile_t* file;
+    int i;
+
+    if ( size > 0 ) {
+        retentionTotalSize = retentionTotalSize + size;
+    }
+
+    for ( i = retentionNumberOfOldestFiles; i > 0; i-- ) {
+        file = &retentionOldestFiles[i - 1];
+        if ( ( file->daySeconds < daySeconds ) ||
+             ( ( file->daySeconds == daySeconds ) &&
+               ( ( file->part < part ) ||
+                 ( ( file->part == part ) && ( !file->isLog || isLog ) ) ) ) ) {
+            break;
+        }
+    }
+    if ( i >= EVENT_JOURNAL_RETENTION_MAX_VICTIMS ) {
+        return;
+    }
+    if ( retentionNumberOfOldestFiles < EVENT_JOURNAL_RETENTION_MAX_VICTIMS ) {
+        retentionNumberOfOldestFiles++;
+    }
+    memmove( &retentionOldestFiles[i + 1], &retentionOldestFiles[i],
+             ( retentionNumberOfOldestFiles - 1 - i ) *
+             sizeof(eventJournalRetentionFile_t) );
+
+    file = &retentionOldestFiles[i];
+    snprintf( file->name, sizeof(file->name), "%s", fileName );
+    file->daySeconds = daySeconds;
+    file->part = part;
+    file->isLog = isLog;
+    file->size = size > 0 ? size : 0;
+}
+
+static void eventJournalRetentionRemoveStep()
+{
+    eventJournalRetentionFile_t* file;
+    uint32_t currentSeconds = (uint32_t) time(NULL);
+    bool expired;
+
+    if ( retentionEmptyMonthName[0] != '\0' ) {
+        sdCardFileRemove( retentionEmptyMonthName );
+        retentionEmptyMonthName[0] = '\0';
+        return;
+    }
+
+    // Every file kept was removed, there may be more to remove
+    if ( retentionOldestFilesRemoved >= retentionNumberOfOldestFiles ) {
+        retentionState = EVENT_JOURNAL_RETENTION_IDLE;
+        if ( retentionNumberOfOldestFiles ==
+             EVENT_JOURNAL_RETENTION_MAX_VICTIMS ) {
+            eventJournalRetentionStart();
+        }
+        return;
+    }
+
+    file = &retentionOldestFiles[retentionOldestFilesRemoved];
+    expired = ( currentSeconds > file->daySeconds ) &&
+              ( currentSeconds - file->daySeconds >=
+                (uint32_t) EVENT_JOURNAL_MAX_AGE_DAYS *
+                EVENT_JOURNAL_SECONDS_PER_DAY );
+    if ( ( !expired &&
+           ( retentionTotalSize <= EVENT_JOURNAL_MAX_TOTAL_SIZE ) ) ||
+         !sdCardFileRemove( file->name ) ) {
+        retentionState = EVENT_JOURNAL_RETENTION_IDLE;
+        return;
+    }
+    retentionRemovedFiles++;
+    retentionTotalSize = retentionTotalSize - file->size;
+    retentionOldestFilesRemoved++;
+}
+
+// Only the names built by eventJournalFileNameBuild() with the given
+// extension match, without their month directory
+static bool eventJournalFileParse( const char* fileName,
+                                   const char* extension,
+                                   uint32_t* daySeconds, int* part )
+{
+    char builtFileName[SD_CARD_FILENAME_MAX_LENGTH];
+    int year, month, day;
+
+    *part = 0;
+    if ( sscanf( fileName, "%4d_%2d_%2d_%d", &year, &month, &day, part ) < 3 ) {
+        return false;
+    }
+    *daySeconds = (uint32_t) dateAndTimeToSeconds( year, month, day, 0, 0, 0 );
+    eventJournalFileNameBuild( *daySeconds, *part, extension, builtFileName );
+    return strcmp( fileName, strchr( builtFileName, '/' ) + 1 ) == 0;
+}
+
+// Only the names built by eventJournalMonthNameBuild() match
+static bool eventJournalMonthParse( const char* dirName,
+                                    uint32_t* monthSeconds )
+{
+    char builtDirName[EVENT_JOURNAL_MONTH_NAME_LENGTH];
+    int year, month;
+
+    if ( sscanf( dirName, "%4d_%2d", &year, &month ) != 2 ) {
+        return false;
+    }
+    *monthSeconds = (uint32_t) dateAndTimeToSeconds( year, month, 1, 0, 0, 0 );
+    eventJournalMonthNameBuild( *monthSeconds, builtDirName );
+    return strcmp( dirName, builtDirName ) == 0;
+}
+
+static void eventJournalMonthNameBuild( uint32_t seconds, char* dirName )
+{
+    time_t dayStart = (time_t)( seconds - seconds % EVENT_JOURNAL_SECONDS_PER_DAY );
+
+    strftime( dirName, EVENT_JOURNAL_MONTH_NAME_LENGTH, "%Y_%m",
+              localtime(&dayStart) );
+}
+
+// The per-flush files of the older firmware, YYYY_MM_DD_HH_MM_SS.txt with
+// the events as text or .log with the journal records. They go by the day
+// in their name, before the daily files of that day.
+static bool eventJournalLegacyFileParse( const char* fileName,
+                                         uint32_t* daySeconds )
+{
+    char builtFileName[SD_CARD_FILENAME_MAX_LENGTH];
+    const char* extension;
+    int year, month, day, hour, minute, second;
+    time_t seconds;
+
+    if ( sscanf( fileName, "%4d_%2d_%2d_%2d_%2d_%2d", &year, &month, &day,
+                 &hour, &minute, &second ) != 6 ) {
+        return false;
+    }
+    seconds = dateAndTimeToSeconds( year, month, day, hour, minute, second );
+    strftime( builtFileName, sizeof(builtFileName), "%Y_%m_%d_%H_%M_%S",
+              localtime(&seconds) );
+    if ( strncmp( fileName, builtFileName, strlen(builtFileName) ) != 0 ) {
+        return false;
+    }
+    extension = fileName + strlen(builtFileName);
+    if ( ( strcmp( extension, EVENT_JOURNAL_LEGACY_TEXT_EXTENSION ) != 0 ) &&
+         ( strcmp( extension, EVENT_JOURNAL_LOG_EXTENSION ) != 0 ) ) {
+        return false;
+    }
+    *daySeconds = (uint32_t) dateAndTimeToSeconds( year, month, day, 0, 0, 0 );
+    return true;
+}
+
+// Appends the valid records among the last maxRecords ones of a log file.
+// A torn record at the end of the file is left out by the alignment.
+static void eventJournalTailRead( const char* logFileName, int maxRecords )
+{
+    sdCardFile_t logFile;
+    eventJournalRecord_t* tail = &journalBuffer[journalBufferNumberOfRecords];
+    long numberOfRecords;
+    long firstRecord;
+    int recordsRead;
+    int validRecords = 0;
+    int i;
+
+    if ( ( maxRecords <= 0 ) ||
+         !sdCardFileOpen( &logFile, logFileName, "rb" ) ) {
+        return;
+    }
+
+    numberOfRecords = sdCardFileSize( &logFile ) /
+                      (long) sizeof(eventJournalRecord_t);
+    firstRecord = numberOfRecords > maxRecords ?
+                  numberOfRecords - maxRecords : 0;
+    if ( ( numberOfRecords > 0 ) &&
+         sdCardFileSeek( &logFile, firstRecord * sizeof(eventJournalRecord_t) ) ) {
+        recordsRead = sdCardFileRead( &logFile, tail,
+                                      ( numberOfRecords - firstRecord ) *
+                                      sizeof(eventJournalRecord_t) ) /
+                      sizeof(eventJournalRecord_t);
+        for ( i = 0; i < recordsRead; i++ ) {
+            if ( eventJournalRecordIsValid( &tail[i] ) ) {
+                tail[validRecords] = tail[i];
+                validRecords++;
+            }
+        }
+        journalBufferNumberOfRecords = journalBufferNumberOfRecords +
+                                       validRecords;
+    }
+
+    sdCardFileClose( &logFile );
+}
+
+static void eventJournalTailFilesRead( int maxRecords )
+{
+    char newestFileName[SD_CARD_FILENAME_MAX_LENGTH];
+    char previousFileName[SD_CARD_FILENAME_MAX_LENGTH];
+    sdCardFile_t newestFile;
+    long newestRecords = 0;
+
+    flushDay = journalState.newestDay;
+    flushPart = journalState.newestPart;
+    eventJournalFileNameBuild( flushDay * EVENT_JOURNAL_SECONDS_PER_DAY,
+                               flushPart, EVENT_JOURNAL_LOG_EXTENSION,
+                               newestFileName );
+    if ( sdCardFileOpen( &newestFile, newestFileName, "rb" ) ) {
+        newestRecords = sdCardFileSize( &newestFile ) /
+                        (long) sizeof(eventJournalRecord_t);
+        sdCardFileClose( &newestFile );
+    }
+
+    if ( ( journalState.previousPart != EVENT_JOURNAL_NO_PART ) &&
+         ( newestRecords < maxRecords ) ) {
+        eventJournalFileNameBuild( journalState.previousDay *
+                                   EVENT_JOURNAL_SECONDS_PER_DAY,
+                                   journalState.previousPart,
+                                   EVENT_JOURNAL_LOG_EXTENSION,
+                                   previousFileName );
+        eventJournalTailRead( previousFileName, maxRecords - newestRecords );
+    }
+    eventJournalTailRead( newestFileName,
+                          maxRecords - journalBufferNumberOfRecords );
+}
+
+static bool eventJournalStateRead()
+{
+    sdCardFile_t stateFile;
+    eventJournalState_t state;
+    int bytesRead;
+
+    if ( !sdCardFileOpen( &stateFile, EVENT_JOURNAL_STATE_FILE_NAME, "rb" ) ) {
+        return false;
+    }
+    bytesRead = sdCardFileRead( &stateFile, &state, sizeof(state) );
+    sdCardFileClose( &stateFile );
+
+    if ( ( bytesRead != sizeof(state) ) ||
+         ( state.magic != EVENT_JOURNAL_STATE_MAGIC ) ||
+         ( state.crc != eventJournalStateCrc( &state ) ) ||
+         ( state.newestPart == EVENT_JOURNAL_NO_PART ) ) {
+        return false;
+    }
+    journalState = state;
+    return true;
+}
+
+static bool eventJournalStateWrite()
+{
+    sdCardFile_t stateFile;
+    int bytesWritten;
+
+    journalState.magic = EVENT_JOURNAL_STATE_MAGIC;
+    journalState.crc = eventJournalStateCrc( &journalState );
+    if ( !sdCardFileOpen( &stateFile, EVENT_JOURNAL_STATE_FILE_NAME, "wb" ) ) {
+        return false;
+    }
+    bytesWritten = sdCardFileWrite( &stateFile, &journalState,
+                                    sizeof(journalState) );
+    if ( !sdCardFileClose( &stateFile ) ) {
+        return false;
+    }
+    return bytesWritten == sizeof(journalState);
+}
+
+// Only needed when the state file is missing or torn, the two newest log
+// files are searched for in the two newest month directories and the state
+// file is written again
+static bool eventJournalStateRebuild()
+{
+    sdCardDir_t dir;
+    sdCardDirEntry_t entry;
+    char newestMonthName[EVENT_JOURNAL_MONTH_NAME_LENGTH] = "";
+    char previousMonthName[EVENT_JOURNAL_MONTH_NAME_LENGTH] = "";
+    uint32_t newestMonthSeconds = 0;
+    uint32_t previousMonthSeconds = 0;
+    uint32_t monthSeconds;
+
+    journalState.newestPart = EVENT_JOURNAL_NO_PART;
+    journalState.previousPart = EVENT_JOURNAL_NO_PART;
+    if ( !sdCardDirOpen( &dir, "" ) ) {
+        return false;
+    }
+    while ( sdCardDirNext( &dir, &entry ) ) {
+        if ( !entry.isDirectory ||
+             !eventJournalMonthParse( entry.name, &monthSeconds ) ) {
+            continue;
+        }
+        if ( ( newestMonthName[0] == '\0' ) ||
+             ( monthSeconds > newestMonthSeconds ) ) {
+            strcpy( previousMonthName, newestMonthName );
+            previousMonthSeconds = newestMonthSeconds;
+            strcpy( newestMonthName, entry.name );
+            newestMonthSeconds = monthSeconds;
+        } else if ( ( previousMonthName[0] == '\0' ) ||
+                    ( monthSeconds > previousMonthSeconds ) ) {
+            strcpy( previousMonthName, entry.name );
+            previousMonthSeconds = monthSeconds;
+        }
+    }
+    sdCardDirClose( &dir );
+
+    if ( previousMonthName[0] != '\0' ) {
+        eventJournalStateRebuildMonth( previousMonthName );
+    }
+    if ( newestMonthName[0] != '\0' ) {
+        eventJournalStateRebuildMonth( newestMonthName );
+    }
+
+    if ( journalState.newestPart == EVENT_JOURNAL_NO_PART ) {
+        return false;
+    }
+    eventJournalStateWrite();
+    return true;
+}
+
+static void eventJournalStateRebuildMonth( const char* monthName )
+{
+    sdCardDir_t dir;
+    sdCardDirEntry_t entry;
+    uint32_t daySeconds;
+    uint32_t day;
+    int part;
+
+    if ( !sdCardDirOpen( &dir, monthName ) ) {
+        return;
+    }
+    while ( sdCardDirNext( &dir, &entry ) ) {
+        if ( !eventJournalFileParse( entry.name, EVENT_JOURNAL_LOG_EXTENSION,
+                                     &daySeconds, &part ) ) {
+            continue;
+        }
+        day = daySeconds / EVENT_JOURNAL_SECONDS_PER_DAY;
+        if ( ( journalState.newestPart == EVENT_JOURNAL_NO_PART ) ||
+             ( day > journalState.newestDay ) ||
+             ( ( day == journalState.newestDay ) &&
+               ( part > journalState.newestPart ) ) ) {
+            journalState.previousDay = journalState.newestDay;
+            journalState.previousPart = journalState.newestPart;
+            journalState.newestDay = day;
+            journalState.newestPart = part;
+        } else if ( ( journalState.previousPart == EVENT_JOURNAL_NO_PART ) ||
+                    ( day > journalState.previousDay ) ||
+                    ( ( day == journalState.previousDay ) &&
+                      ( part > journalState.previousPart ) ) ) {
+            journalState.previousDay = day;
+            journalState.previousPart = part;
+        }
+    }
+    sdCardDirClose( &dir );
+}
+
+static uint16_t eventJournalStateCrc( const eventJournalState_t* state )
+{
+    const uint8_t* stateBytes = (const uint8_t*) state;
+    int crcEnd = sizeof(state->magic) + sizeof(state->crc);
+
+    return eventJournalCrc16( stateBytes + crcEnd,
+                              sizeof(eventJournalState_t) - crcEnd );
+}
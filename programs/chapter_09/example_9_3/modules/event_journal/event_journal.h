@@ -0,0 +1,100 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _EVENT_JOURNAL_H_
+#define _EVENT_JOURNAL_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "event_log.h"
+
+//=====[Declaration of public defines]=======================================
+
+#define EVENT_JOURNAL_SECTOR_SIZE          512
+#define EVENT_JOURNAL_RECORD_MAGIC         0xE71B
+#define EVENT_JOURNAL_RECORD_STATE_FLAG    0x01
+#define EVENT_JOURNAL_INDEX_INTERVAL       32
+#define EVENT_JOURNAL_SECONDS_PER_DAY      86400
+#define EVENT_JOURNAL_MAX_FILE_SIZE        ( 256 * 1024 )
+#define EVENT_JOURNAL_MAX_TOTAL_SIZE       ( 64 * 1024 * 1024 )
+#define EVENT_JOURNAL_MAX_AGE_DAYS         365
+#define EVENT_JOURNAL_LOG_EXTENSION        ".log"
+#define EVENT_JOURNAL_INDEX_EXTENSION      ".idx"
+#define EVENT_JOURNAL_BUFFER_SIZE          ( ( EVENT_LOG_MAX_STORAGE * \
+                                               sizeof(eventJournalRecord_t) + \
+                                               EVENT_JOURNAL_SECTOR_SIZE - 1 ) / \
+                                             EVENT_JOURNAL_SECTOR_SIZE * \
+                                             EVENT_JOURNAL_SECTOR_SIZE )
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    EVENT_JOURNAL_FLUSH_IDLE,
+    EVENT_JOURNAL_FLUSH_IN_PROGRESS,
+    EVENT_JOURNAL_FLUSH_COMPLETE,
+    EVENT_JOURNAL_FLUSH_ERROR,
+} eventJournalFlushStatus_t;
+
+// Result of one step of the operations that are done a bit per call
+typedef enum {
+    EVENT_JOURNAL_STEP_IN_PROGRESS,
+    EVENT_JOURNAL_STEP_COMPLETE,
+    EVENT_JOURNAL_STEP_ABORTED,
+    EVENT_JOURNAL_STEP_ERROR,
+} eventJournalStepStatus_t;
+
+// Fixed size binary record, 16 bytes long so 32 records fill one sector
+typedef struct eventJournalRecord {
+    uint16_t magic;
+    uint16_t crc;
+    uint32_t sequence;
+    uint32_t seconds;
+    uint8_t elementId;
+    uint8_t flags;
+    uint8_t reserved[2];
+} eventJournalRecord_t;
+
+// Sidecar index entry, written for every EVENT_JOURNAL_INDEX_INTERVAL-th
+// record of a daily log file
+typedef struct eventJournalIndexEntry {
+    uint32_t seconds;
+    uint32_t offset;
+} eventJournalIndexEntry_t;
+
+// Returns false to stop the query
+typedef bool (*eventJournalQueryCallback_t)( const eventJournalRecord_t* record );
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void eventJournalBufferReset();
+bool eventJournalBufferAppend( uint32_t sequence, uint32_t seconds,
+                               uint8_t elementId, bool state );
+int eventJournalBufferNumberOfRecords();
+const eventJournalRecord_t* eventJournalBufferRecordRead( int index );
+bool eventJournalFlushStart();
+eventJournalFlushStatus_t eventJournalFlushStep();
+uint32_t eventJournalIndexMissesRead();
+
+bool eventJournalRecordIsValid( const eventJournalRecord_t* record );
+bool eventJournalExportStart( const char* journalFileName,
+                              const char* textFileName );
+eventJournalStepStatus_t eventJournalExportStep();
+
+void eventJournalFileNameBuild( uint32_t seconds, int part,
+                                const char* extension, char* fileName );
+bool eventJournalQueryStart( uint32_t fromSeconds, uint32_t toSeconds );
+eventJournalStepStatus_t eventJournalQueryStep( int maxRecords,
+    eventJournalQueryCallback_t recordCallback );
+
+int eventJournalTailRecover( int maxRecords );
+
+void eventJournalRetentionStart();
+bool eventJournalRetentionStep();
+uint32_t eventJournalRetentionRemovedFilesRead();
+
+uint16_t eventJournalCrc16( const uint8_t* data, int length );
+
+//=====[#include guards - end]=================================================
+
+#endif // _EVENT_JOURNAL_H_
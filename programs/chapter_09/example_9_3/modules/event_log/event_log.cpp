@@ -12,17 +12,49 @@
 #include "pc_serial_com.h"
 #include "smartphone_ble_com.h"
 #include "sd_card.h"
+#include "event_journal.h"
+#include "event_store.h"
+#include "ring_buffer.h"
 
 //=====[Declaration of private defines]======================================
 
+#define EVENT_STATE_FLAG   0x01
+
+#define EVENT_LOG_SD_FLUSH_THRESHOLD_EVENTS   ( EVENT_JOURNAL_SECTOR_SIZE / \
+                                                sizeof(eventJournalRecord_t) )
+#define EVENT_LOG_SD_FLUSH_MAX_AGE_MS         60000
+#define EVENT_LOG_SD_RETENTION_PERIOD_MS      3600000
+#define EVENT_LOG_ALARM_QUEUE_SIZE            16
+
 //=====[Declaration of private data types]=====================================
 
-typedef struct systemEvent {
-    time_t seconds;
-    char typeOfEvent[EVENT_LOG_NAME_MAX_LENGTH];
-    bool storedInSd;
+typedef enum {
+    EVENT_LOG_SD_IDLE,
+    EVENT_LOG_SD_FLUSHING,
+} eventLogSdState_t;
+
+typedef enum {
+    EVENT_LOG_SD_EXPORT_NONE,
+    EVENT_LOG_SD_EXPORT_RAW,
+    EVENT_LOG_SD_EXPORT_JOURNAL,
+} eventLogSdExport_t;
+
+// 6 bytes per event, the text is only produced when the event is read
+typedef MBED_PACKED(struct) systemEvent {
+    uint32_t seconds;
+    uint8_t elementId;
+    uint8_t flags;
 } systemEvent_t;
 
+static_assert( sizeof(systemEvent_t) == 6, "systemEvent_t must stay packed" );
+
+// Alarm state change captured where the alarm runs, possibly another thread
+typedef struct eventLogAlarmChange {
+    uint32_t seconds;
+    eventLogElement_t element;
+    bool state;
+} eventLogAlarmChange_t;
+
 //=====[Declaration and initialization of public global objects]===============
 
 //=====[Declaration of external public global variables]=======================
@@ -31,87 +63,250 @@ typedef struct systemEvent {
 
 //=====[Declaration and initialization of private global variables]============
 
+static const char* const eventLogElementNames[EVENT_LOG_NUMBER_OF_ELEMENTS] = {
+    "ALARM",
+    "GAS_DET",
+    "OVER_TEMP",
+    "LED_IC",
+    "LED_SB",
+};
+
+// Only written by eventLogAlarmStatesCapture()
 static bool sirenLastState = OFF;
 static bool gasLastState   = OFF;
 static bool tempLastState  = OFF;
+static SpscRingBuffer<eventLogAlarmChange_t, EVENT_LOG_ALARM_QUEUE_SIZE>
+    alarmChanges;
+
 static bool ICLastState    = OFF;
 static bool SBLastState    = OFF;
-static int eventsIndex     = 0;
-static systemEvent_t arrayOfStoredEvents[EVENT_LOG_MAX_STORAGE];
+static RingBuffer<systemEvent_t, EVENT_LOG_MAX_STORAGE> storedEvents;
+static uint32_t sdCardCursor = 0;
+
+static eventLogSdState_t eventLogSdState = EVENT_LOG_SD_IDLE;
+static uint32_t sdCardFlushEndIndex = 0;
+static tick_t oldestPendingEventTime = 0;
+static bool sdCardFlushRequested = false;
+static bool sdCardFlushReportRequested = false;
+static uint32_t sdCardLostEvents = 0;
+static uint32_t sdCardMaxStallUs = 0;
+static uint32_t sdCardLastFlushUs = 0;
+static uint32_t sdCardFlushStartUs = 0;
+static bool sdCardRetentionPending = true;
+static tick_t sdCardLastRetentionTime = 0;
+static eventLogSdExport_t sdCardExport = EVENT_LOG_SD_EXPORT_NONE;
+static char sdCardExportFileName[SD_CARD_PATH_MAX_LENGTH];
+static uint32_t sdCardExportStartUs = 0;
 
 //=====[Declarations (prototypes) of private functions]========================
 
+static void eventLogAlarmChangeCapture( bool lastState, bool currentState,
+                                        eventLogElement_t element );
+static void eventLogEventStore( uint32_t seconds, bool currentState,
+                                eventLogElement_t element );
 static void eventLogElementStateUpdate( bool lastState,
                                         bool currentState,
-                                        const char* elementName );
+                                        eventLogElement_t element );
+static void eventLogSdCardUpdate();
+static bool eventLogSdCardFlushStart();
+static void eventLogSdCardRetentionUpdate();
+static bool eventLogSdCardExportUpdate();
 
 //=====[Implementations of public functions]===================================
 
 void eventLogUpdate()
+{
+    eventLogAlarmChange_t change;
+    bool currentState;
+
+    while ( alarmChanges.pop( change ) ) {
+        eventLogEventStore( change.seconds, change.state, change.element );
+    }
+
+    currentState = incorrectCodeStateRead();
+    eventLogElementStateUpdate( ICLastState, currentState, EVENT_LOG_ELEMENT_LED_IC );
+    ICLastState = currentState;
+
+    currentState = systemBlockedStateRead();
+    eventLogElementStateUpdate( SBLastState ,currentState, EVENT_LOG_ELEMENT_LED_SB );
+    SBLastState = currentState;
+
+    eventLogSdCardUpdate();
+}
+
+int eventLogNumberOfStoredEvents()
+{
+    return storedEvents.size();
+}
+
+// Index 0 is the oldest stored event
+void eventLogRead( int index, char* str )
+{
+    const systemEvent_t& event = storedEvents[index];
+    eventLogEventToString( event.seconds, event.elementId, 
+                           event.flags & EVENT_STATE_FLAG, str );
+}
+
+void eventLogEventToString( time_t seconds, uint8_t elementId, bool state,
+                            char* str )
+{
+    char eventAndStateStr[EVENT_LOG_NAME_MAX_LENGTH];
+
+    eventLogEventNameToString( elementId, state, eventAndStateStr );
+
+    snprintf( str, EVENT_STR_LENGTH, "Event = %s\r\nDate and Time = %s\r\n",
+              eventAndStateStr, ctime(&seconds) );
+}
+
+void eventLogEventNameToString( uint8_t elementId, bool state, char* str )
+{
+    const char* elementName = "UNKNOWN";
+
+    if ( elementId < EVENT_LOG_NUMBER_OF_ELEMENTS ) {
+        elementName = eventLogElementNames[elementId];
+    }
+
+    snprintf( str, EVENT_LOG_NAME_MAX_LENGTH, "%s%s", elementName,
+              state ? "_ON" : "_OFF" );
+}
+
+// Called right after the alarm update, from the alarm thread when the
+// system is threaded. The changes reach eventLogUpdate() through a lock free
+// queue, so no change is missed however late the event log runs.
+void eventLogAlarmStatesCapture()
 {
     bool currentState = sirenStateRead();
-    eventLogElementStateUpdate( sirenLastState, currentState, "ALARM" );
+    eventLogAlarmChangeCapture( sirenLastState, currentState, EVENT_LOG_ELEMENT_ALARM );
     sirenLastState = currentState;
 
     currentState = gasDetectorStateRead();
-    eventLogElementStateUpdate( gasLastState, currentState, "GAS_DET" );
+    eventLogAlarmChangeCapture( gasLastState, currentState, EVENT_LOG_ELEMENT_GAS_DET );
     gasLastState = currentState;
 
     currentState = overTemperatureDetectorStateRead();
-    eventLogElementStateUpdate( tempLastState, currentState, "OVER_TEMP" );
+    eventLogAlarmChangeCapture( tempLastState, currentState, EVENT_LOG_ELEMENT_OVER_TEMP );
     tempLastState = currentState;
+}
 
-    currentState = incorrectCodeStateRead();
-    eventLogElementStateUpdate( ICLastState, currentState, "LED_IC" );
-    ICLastState = currentState;
+uint32_t eventLogAlarmQueueOverflowsRead()
+{
+    return alarmChanges.overflowsRead();
+}
 
-    currentState = systemBlockedStateRead();
-    eventLogElementStateUpdate( SBLastState ,currentState, "LED_SB" );
-    SBLastState = currentState;
+void eventLogWrite( bool currentState, eventLogElement_t element )
+{
+    eventLogEventStore( (uint32_t) time(NULL), currentState, element );
 }
 
-int eventLogNumberOfStoredEvents()
+// Events are stored in the SD card by a write-behind stage updated from
+// eventLogUpdate(). This only asks for an immediate flush and reports it.
+bool eventLogSaveToSdCard()
+{
+    if ( ( storedEvents.endIndex() == sdCardCursor ) &&
+         ( eventLogSdState == EVENT_LOG_SD_IDLE ) ) {
+        pcSerialComStringWrite("No new events to store in SD card\r\n\r\n");
+        return true;
+    }
+
+    sdCardFlushRequested = true;
+    sdCardFlushReportRequested = true;
+    pcSerialComStringWrite("New events will be stored in SD card\r\n");
+    return true;
+}
+
+// Exports are advanced by the write-behind stage, one sector per update
+// while no flush is in progress, and reported when they end. Only one
+// export runs at a time.
+bool eventLogRawExportStart()
 {
-    return eventsIndex;
+    if ( ( sdCardExport != EVENT_LOG_SD_EXPORT_NONE ) ||
+         !eventStoreExportStart( EVENT_STORE_EXPORT_FILE_NAME ) ) {
+        return false;
+    }
+    sdCardExport = EVENT_LOG_SD_EXPORT_RAW;
+    strcpy( sdCardExportFileName, EVENT_STORE_EXPORT_FILE_NAME );
+    sdCardExportStartUs = us_ticker_read();
+    return true;
 }
 
-void eventLogRead( int index, char* str )
+bool eventLogJournalExportStart( const char* journalFileName,
+                                 const char* textFileName )
 {
-    str[0] = 0;
+    if ( ( sdCardExport != EVENT_LOG_SD_EXPORT_NONE ) ||
+         ( strlen(textFileName) >= sizeof(sdCardExportFileName) ) ||
+         !eventJournalExportStart( journalFileName, textFileName ) ) {
+        return false;
+    }
+    sdCardExport = EVENT_LOG_SD_EXPORT_JOURNAL;
+    strcpy( sdCardExportFileName, textFileName );
+    sdCardExportStartUs = us_ticker_read();
+    return true;
+}
+
+// Rebuilds the newest stored events from the SD card journal. The ring
+// indexes continue after the last stored sequence number, which is also
+// where the write-behind stage resumes.
+int eventLogRecoverFromSdCard()
+{
+    const eventJournalRecord_t* record;
+    systemEvent_t event;
+    int numberOfRecords;
+    int i;
+
+    numberOfRecords = eventJournalTailRecover( EVENT_LOG_MAX_STORAGE );
+    if ( numberOfRecords == 0 ) {
+        return 0;
+    }
 
-    strncat( str, "Event = ", strlen("Event = ") );
+    record = eventJournalBufferRecordRead( numberOfRecords - 1 );
+    storedEvents.clear( record->sequence + 1 - numberOfRecords );
+    for ( i = 0; i < numberOfRecords; i++ ) {
+        record = eventJournalBufferRecordRead( i );
+        event.seconds = record->seconds;
+        event.elementId = record->elementId;
+        event.flags = ( record->flags & EVENT_JOURNAL_RECORD_STATE_FLAG ) ?
+                      EVENT_STATE_FLAG : 0;
+        storedEvents.push( event );
+    }
+    sdCardCursor = storedEvents.endIndex();
+    sdCardFlushEndIndex = sdCardCursor;
+    eventJournalBufferReset();
 
-    strncat( str, arrayOfStoredEvents[index].typeOfEvent,
-             strlen(arrayOfStoredEvents[index].typeOfEvent) );
+    return numberOfRecords;
+}
 
-    strncat( str, "\r\nDate and Time = ", strlen("\r\nDate and Time = ") );
+//=====[Implementations of private functions]==================================
 
-    strncat( str, ctime(&arrayOfStoredEvents[index].seconds),
-             strlen(ctime(&arrayOfStoredEvents[index].seconds)) );
+static void eventLogAlarmChangeCapture( bool lastState, bool currentState,
+                                        eventLogElement_t element )
+{
+    eventLogAlarmChange_t change;
 
-    strncat( str, "\r\n", strlen("\r\n") );
+    if ( lastState != currentState ) {
+        change.seconds = (uint32_t) time(NULL);
+        change.element = element;
+        change.state = currentState;
+        alarmChanges.push( change );
+    }
 }
 
-void eventLogWrite( bool currentState, const char* elementName )
+static void eventLogEventStore( uint32_t seconds, bool currentState,
+                                eventLogElement_t element )
 {
     char eventAndStateStr[EVENT_LOG_NAME_MAX_LENGTH];
-    eventAndStateStr[0] = 0;
-    strncat( eventAndStateStr, elementName, strlen(elementName) );
-    if ( currentState ) {
-        strncat( eventAndStateStr, "_ON", strlen("_ON") );
-    } else {
-        strncat( eventAndStateStr, "_OFF", strlen("_OFF") );
+    systemEvent_t event;
+
+    event.seconds = seconds;
+    event.elementId = (uint8_t) element;
+    event.flags = currentState ? EVENT_STATE_FLAG : 0;
+    if ( storedEvents.endIndex() == 
+         ( eventLogSdState == EVENT_LOG_SD_FLUSHING ? sdCardFlushEndIndex :
+                                                      sdCardCursor ) ) {
+        oldestPendingEventTime = tickRead();
     }
+    storedEvents.push( event );
 
-    arrayOfStoredEvents[eventsIndex].seconds = time(NULL);
-    strcpy( arrayOfStoredEvents[eventsIndex].typeOfEvent, eventAndStateStr );
-    if ( eventsIndex < EVENT_LOG_MAX_STORAGE ) {
-        eventsIndex++;
-    } else {
-        eventsIndex = 0;
-    }
-    
-    arrayOfStoredEvents[eventsIndex].storedInSd = false;
+    eventLogEventNameToString( element, currentState, eventAndStateStr );
 
     pcSerialComStringWrite(eventAndStateStr);
     pcSerialComStringWrite("\r\n");
@@ -120,51 +315,177 @@ void eventLogWrite( bool currentState, const char* elementName )
     smartphoneBleComWrite("\r\n");
 }
 
-bool eventLogSaveToSdCard()
+static void eventLogElementStateUpdate( bool lastState,
+                                        bool currentState,
+                                        eventLogElement_t element )
+{
+    if ( lastState != currentState ) {        
+        eventLogWrite( currentState, element );       
+    }
+}
+
+// Starts a flush when enough events are pending or the oldest pending one
+// is too old, then advances it by one bounded step per call. Exports and
+// retention passes only advance while no flush is in progress.
+static void eventLogSdCardUpdate()
 {
-    char fileName[SD_CARD_FILENAME_MAX_LENGTH];
-    char eventStr[EVENT_STR_LENGTH];
-    bool eventsStored = false;
+    uint32_t stepStartUs = us_ticker_read();
+    uint32_t stepDurationUs;
+    uint32_t pendingEvents = storedEvents.endIndex() - 
+                             storedEvents.firstIndex( sdCardCursor );
 
-    time_t seconds;
-    int i;
+    switch( eventLogSdState ) {
 
-    seconds = time(NULL);
-    fileName[0] = 0;
-
-    strftime( fileName, SD_CARD_FILENAME_MAX_LENGTH, "%Y_%m_%d_%H_%M_%S", localtime(&seconds) );
-    strncat( fileName, ".txt", strlen(".txt") );
-
-    for (i = 0; i < eventLogNumberOfStoredEvents(); i++) {
-        if ( !arrayOfStoredEvents[i].storedInSd ) {
-            eventLogRead( i, eventStr );
-            if ( sdCardWriteFile( fileName, eventStr ) ){
-                arrayOfStoredEvents[i].storedInSd = true;
-                pcSerialComStringWrite("Storing event ");
-                pcSerialComIntWrite(i+1);
-                pcSerialComStringWrite(" in file ");
-                pcSerialComStringWrite(fileName);
-                pcSerialComStringWrite("\r\n");
-                eventsStored = true;
+    case EVENT_LOG_SD_IDLE:
+        if ( pendingEvents == 0 ) {
+            sdCardFlushRequested = false;
+        }
+        if ( ( pendingEvents > 0 ) &&
+             ( sdCardFlushRequested ||
+               pendingEvents >= EVENT_LOG_SD_FLUSH_THRESHOLD_EVENTS ||
+               (tick_t)( tickRead() - oldestPendingEventTime ) >= 
+               EVENT_LOG_SD_FLUSH_MAX_AGE_MS ) ) {
+            sdCardFlushRequested = false;
+            if ( eventLogSdCardFlushStart() ) {
+                sdCardFlushStartUs = stepStartUs;
+                eventLogSdState = EVENT_LOG_SD_FLUSHING;
             }
+        } else if ( !eventLogSdCardExportUpdate() ) {
+            eventLogSdCardRetentionUpdate();
         }
+        break;
+
+    case EVENT_LOG_SD_FLUSHING:
+        switch( eventJournalFlushStep() ) {
+            case EVENT_JOURNAL_FLUSH_COMPLETE:
+                sdCardCursor = sdCardFlushEndIndex;
+                sdCardLastFlushUs = us_ticker_read() - sdCardFlushStartUs;
+                eventLogSdState = EVENT_LOG_SD_IDLE;
+                if ( sdCardFlushReportRequested ) {
+                    pcSerialComStringWrite("New events successfully stored in SD card in ");
+                    pcSerialComIntWrite( sdCardLastFlushUs / 1000 );
+                    pcSerialComStringWrite(" ms\r\nMaximum main loop stall while storing events: ");
+                    pcSerialComIntWrite( sdCardMaxStallUs );
+                    pcSerialComStringWrite(" us\r\n");
+                    if ( sdCardLostEvents > 0 ) {
+                        pcSerialComIntWrite( sdCardLostEvents );
+                        pcSerialComStringWrite(" events were overwritten before being stored\r\n");
+                    }
+                    if ( eventJournalIndexMissesRead() > 0 ) {
+                        pcSerialComIntWrite( eventJournalIndexMissesRead() );
+                        pcSerialComStringWrite(" event log index entries could not be stored\r\n");
+                    }
+                    if ( eventJournalRetentionRemovedFilesRead() > 0 ) {
+                        pcSerialComIntWrite( eventJournalRetentionRemovedFilesRead() );
+                        pcSerialComStringWrite(" old event log files were removed\r\n");
+                    }
+                    pcSerialComStringWrite("\r\n");
+                    sdCardFlushReportRequested = false;
+                }
+            break;
+            case EVENT_JOURNAL_FLUSH_ERROR:
+                // The pending events are kept and retried after the max age
+                oldestPendingEventTime = tickRead();
+                eventLogSdState = EVENT_LOG_SD_IDLE;
+                if ( sdCardFlushReportRequested ) {
+                    pcSerialComStringWrite("Events could not be stored in SD card\r\n\r\n");
+                    sdCardFlushReportRequested = false;
+                }
+            break;
+            case EVENT_JOURNAL_FLUSH_IN_PROGRESS:
+            case EVENT_JOURNAL_FLUSH_IDLE:
+            default:
+            break;
+        }
+        break;
+
+    default:
+        eventLogSdState = EVENT_LOG_SD_IDLE;
+        break;
     }
 
-    if ( eventsStored ) {
-        pcSerialComStringWrite("New events successfully stored in SD card\r\n\r\n");
-    } else {
-        pcSerialComStringWrite("No new events to store in SD card\r\n\r\n");
+    stepDurationUs = us_ticker_read() - stepStartUs;
+    if ( stepDurationUs > sdCardMaxStallUs ) {
+        sdCardMaxStallUs = stepDurationUs;
     }
+}
 
-    return true;
+// Encodes the pending events in the journal buffer, this only uses RAM. A
+// batch stops at the end of a day and the rest is flushed right after it.
+static bool eventLogSdCardFlushStart()
+{
+    uint32_t eventIndex;
+
+    sdCardLostEvents = sdCardLostEvents + storedEvents.lost( sdCardCursor );
+
+    eventJournalBufferReset();
+    for ( eventIndex = storedEvents.firstIndex( sdCardCursor );
+          eventIndex != storedEvents.endIndex(); eventIndex++ ) {
+        const systemEvent_t& event = storedEvents.at( eventIndex );
+        if ( !eventJournalBufferAppend( eventIndex, event.seconds,
+                                        event.elementId,
+                                        event.flags & EVENT_STATE_FLAG ) ) {
+            sdCardFlushRequested = true;
+            break;
+        }
+    }
+    sdCardFlushEndIndex = eventIndex;
+
+    return eventJournalFlushStart();
 }
-//=====[Implementations of private functions]==================================
 
-static void eventLogElementStateUpdate( bool lastState,
-                                        bool currentState,
-                                        const char* elementName )
+// Old journal files are pruned at startup and then once per period
+static void eventLogSdCardRetentionUpdate()
 {
-    if ( lastState != currentState ) {        
-        eventLogWrite( currentState, elementName );       
+    if ( eventJournalRetentionStep() ) {
+        return;
     }
-}
\ No newline at end of file
+    if ( sdCardRetentionPending ||
+         (tick_t)( tickRead() - sdCardLastRetentionTime ) >=
+         EVENT_LOG_SD_RETENTION_PERIOD_MS ) {
+        sdCardRetentionPending = false;
+        sdCardLastRetentionTime = tickRead();
+        eventJournalRetentionStart();
+    }
+}
+
+// Returns true while an export is running
+static bool eventLogSdCardExportUpdate()
+{
+    eventJournalStepStatus_t status;
+
+    switch( sdCardExport ) {
+        case EVENT_LOG_SD_EXPORT_RAW:
+            status = eventStoreExportStep();
+        break;
+        case EVENT_LOG_SD_EXPORT_JOURNAL:
+            status = eventJournalExportStep();
+        break;
+        case EVENT_LOG_SD_EXPORT_NONE:
+        default:
+            return false;
+    }
+
+    switch( status ) {
+        case EVENT_JOURNAL_STEP_IN_PROGRESS:
+        break;
+        case EVENT_JOURNAL_STEP_COMPLETE:
+            pcSerialComStringWrite( sdCardExport == EVENT_LOG_SD_EXPORT_RAW ?
+                                    "Raw event store" : "Event log" );
+            pcSerialComStringWrite( " exported to file " );
+            pcSerialComStringWrite( sdCardExportFileName );
+            pcSerialComStringWrite( " in " );
+            pcSerialComIntWrite( ( us_ticker_read() - sdCardExportStartUs ) /
+                                 1000 );
+            pcSerialComStringWrite( " ms\r\n\r\n" );
+            sdCardExport = EVENT_LOG_SD_EXPORT_NONE;
+        break;
+        default:
+            pcSerialComStringWrite( sdCardExport == EVENT_LOG_SD_EXPORT_RAW ?
+                                    "Raw event store" : "Event log" );
+            pcSerialComStringWrite( " could not be exported\r\n\r\n" );
+            sdCardExport = EVENT_LOG_SD_EXPORT_NONE;
+        break;
+    }
+    return true;
+}
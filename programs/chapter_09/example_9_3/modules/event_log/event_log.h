@@ -5,6 +5,8 @@
 
 //=====[Libraries]=============================================================
 
+#include "mbed.h"
+
 //=====[Declaration of public defines]=======================================
 
 #define EVENT_LOG_MAX_STORAGE       100
@@ -21,13 +23,32 @@
 
 //=====[Declaration of public data types]======================================
 
+// The element id is stored in each event, new elements must be appended
+typedef enum {
+    EVENT_LOG_ELEMENT_ALARM,
+    EVENT_LOG_ELEMENT_GAS_DET,
+    EVENT_LOG_ELEMENT_OVER_TEMP,
+    EVENT_LOG_ELEMENT_LED_IC,
+    EVENT_LOG_ELEMENT_LED_SB,
+    EVENT_LOG_NUMBER_OF_ELEMENTS,
+} eventLogElement_t;
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 void eventLogUpdate();
 int eventLogNumberOfStoredEvents();
 void eventLogRead( int index, char* str );
-void eventLogWrite( bool currentState, const char* elementName );
+void eventLogEventToString( time_t seconds, uint8_t elementId, bool state,
+                            char* str );
+void eventLogEventNameToString( uint8_t elementId, bool state, char* str );
+void eventLogAlarmStatesCapture();
+uint32_t eventLogAlarmQueueOverflowsRead();
+void eventLogWrite( bool currentState, eventLogElement_t element );
 bool eventLogSaveToSdCard();
+bool eventLogRawExportStart();
+bool eventLogJournalExportStart( const char* journalFileName,
+                                 const char* textFileName );
+int eventLogRecoverFromSdCard();
 
 //=====[#include guards - end]=================================================
 
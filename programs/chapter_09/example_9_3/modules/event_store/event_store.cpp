@@ -0,0 +1,280 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "event_store.h"
+
+#include "event_journal.h"
+#include "event_log.h"
+#include "sd_card.h"
+
+//=====[Declaration of private defines]========================================
+
+//=====[Declaration of private data types]=====================================
+
+static_assert( sizeof(eventStoreSector_t) == EVENT_STORE_SECTOR_SIZE,
+               "eventStoreSector_t must fill exactly one sector" );
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static BlockDevice* storeBlockDevice = NULL;
+static uint32_t storeNumberOfSectors = 0;
+static uint32_t storeHeadSector = 0;
+static uint32_t storeNextSequence = 1;
+
+static eventStoreSector_t storeSector MBED_ALIGN(4);
+
+static sdCardFile_t exportFile = { NULL };
+static uint32_t exportFirstSector = 0;
+static uint32_t exportSectorIndex = 0;
+static uint32_t exportOldestSequence = 0;
+static uint32_t exportEndSequence = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static uint16_t eventStoreSectorCrc( const eventStoreSector_t* sector );
+static bool eventStoreSectorRead( uint32_t sectorNumber,
+                                  eventStoreSector_t* sector );
+static bool eventStoreSectorIsNewer( uint32_t sectorNumber,
+                                     uint32_t firstSequence );
+static eventJournalStepStatus_t eventStoreExportEnd(
+    eventJournalStepStatus_t status );
+
+//=====[Implementations of public functions]===================================
+
+// The region is a circular log of sectors with increasing sequence numbers,
+// so the newest sector is the last one whose sequence is not older than
+// the one of sector 0. It is found with a binary search that reads
+// O(log n) sectors, whatever the size of the region.
+bool eventStoreInit( BlockDevice* blockDevice )
+{
+    uint32_t firstSequence;
+    uint32_t low;
+    uint32_t high;
+    uint32_t middle;
+
+    storeBlockDevice = blockDevice;
+    storeNumberOfSectors = blockDevice->size() / EVENT_STORE_SECTOR_SIZE;
+    storeHeadSector = 0;
+    storeNextSequence = 1;
+
+    if ( storeNumberOfSectors == 0 ) {
+        storeBlockDevice = NULL;
+        return false;
+    }
+
+    if ( !eventStoreSectorRead( 0, &storeSector ) ) {
+        // Sector 0 is either unused or the head of a wrapped log that was
+        // torn by a reset, then the newest sector is the last one
+        if ( eventStoreSectorRead( storeNumberOfSectors - 1, &storeSector ) ) {
+            storeNextSequence = storeSector.header.sequence + 1;
+        }
+        return true;
+    }
+
+    firstSequence = storeSector.header.sequence;
+    low = 0;
+    high = storeNumberOfSectors;
+    while ( high - low > 1 ) {
+        middle = low + ( high - low ) / 2;
+        if ( eventStoreSectorIsNewer( middle, firstSequence ) ) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+
+    eventStoreSectorRead( low, &storeSector );
+    storeNextSequence = storeSector.header.sequence + 1;
+    storeHeadSector = ( low + 1 ) % storeNumberOfSectors;
+    return true;
+}
+
+// Every append programs the next sector, even when it is not full, so the
+// writes move around the whole region instead of rewriting one block
+bool eventStoreSectorAppend( const eventJournalRecord_t* records,
+                             int numberOfRecords )
+{
+    if ( ( storeBlockDevice == NULL ) || ( numberOfRecords <= 0 ) ||
+         ( numberOfRecords > (int) EVENT_STORE_RECORDS_PER_SECTOR ) ) {
+        return false;
+    }
+
+    memset( &storeSector, 0, sizeof(storeSector) );
+    storeSector.header.magic = EVENT_STORE_SECTOR_MAGIC;
+    storeSector.header.sequence = storeNextSequence;
+    storeSector.header.numberOfRecords = numberOfRecords;
+    memcpy( storeSector.records, records,
+            numberOfRecords * sizeof(eventJournalRecord_t) );
+    storeSector.header.crc = eventStoreSectorCrc( &storeSector );
+
+    if ( storeBlockDevice->program( &storeSector,
+                                    (uint64_t) storeHeadSector *
+                                    EVENT_STORE_SECTOR_SIZE,
+                                    EVENT_STORE_SECTOR_SIZE ) != 0 ) {
+        return false;
+    }
+
+    storeHeadSector = ( storeHeadSector + 1 ) % storeNumberOfSectors;
+    storeNextSequence++;
+    return true;
+}
+
+uint32_t eventStoreNextSequenceRead()
+{
+    return storeNextSequence;
+}
+
+// Walks back from the newest sector until maxRecords valid records are
+// found, then leaves them oldest first at the start of records
+int eventStoreTailRead( eventJournalRecord_t* records, int maxRecords )
+{
+    uint32_t oldestSequence;
+    uint32_t sectorNumber = storeHeadSector;
+    uint32_t i;
+    int record;
+    int numberOfRecords = 0;
+
+    if ( storeBlockDevice == NULL ) {
+        return 0;
+    }
+
+    oldestSequence = storeNextSequence > storeNumberOfSectors ?
+                     storeNextSequence - storeNumberOfSectors : 1;
+
+    for ( i = 0; ( i < storeNumberOfSectors ) &&
+                 ( numberOfRecords < maxRecords ); i++ ) {
+        sectorNumber = ( sectorNumber + storeNumberOfSectors - 1 ) %
+                       storeNumberOfSectors;
+        if ( !eventStoreSectorRead( sectorNumber, &storeSector ) ||
+             ( storeSector.header.sequence < oldestSequence ) ||
+             ( storeSector.header.sequence >= storeNextSequence ) ) {
+            break;
+        }
+        for ( record = storeSector.header.numberOfRecords - 1;
+              ( record >= 0 ) && ( numberOfRecords < maxRecords ); record-- ) {
+            if ( eventJournalRecordIsValid( &storeSector.records[record] ) ) {
+                numberOfRecords++;
+                records[maxRecords - numberOfRecords] =
+                    storeSector.records[record];
+            }
+        }
+    }
+
+    memmove( records, &records[maxRecords - numberOfRecords],
+             numberOfRecords * sizeof(eventJournalRecord_t) );
+    return numberOfRecords;
+}
+
+// Starts writing every stored event, oldest first, to a text file of the
+// FAT partition. Only the sectors stored up to now are exported, and the
+// ones left from an older lap of the log are skipped.
+bool eventStoreExportStart( const char* textFileName )
+{
+    if ( ( storeBlockDevice == NULL ) || ( exportFile.fd != NULL ) ) {
+        return false;
+    }
+    if ( !sdCardFileOpen( &exportFile, textFileName, "w" ) ) {
+        return false;
+    }
+
+    exportFirstSector = storeHeadSector;
+    exportSectorIndex = 0;
+    exportEndSequence = storeNextSequence;
+    exportOldestSequence = storeNextSequence > storeNumberOfSectors ?
+                           storeNextSequence - storeNumberOfSectors : 1;
+    return true;
+}
+
+// Exports one sector per call. The sectors appended meanwhile may overwrite
+// the oldest ones, their sequence is past the end of the export and they
+// are skipped.
+eventJournalStepStatus_t eventStoreExportStep()
+{
+    char eventStr[EVENT_STR_LENGTH];
+    int record;
+
+    if ( exportFile.fd == NULL ) {
+        return EVENT_JOURNAL_STEP_ERROR;
+    }
+    if ( exportSectorIndex >= storeNumberOfSectors ) {
+        return eventStoreExportEnd( EVENT_JOURNAL_STEP_COMPLETE );
+    }
+
+    if ( !eventStoreSectorRead( ( exportFirstSector + exportSectorIndex ) %
+                                storeNumberOfSectors, &storeSector ) ||
+         ( storeSector.header.sequence < exportOldestSequence ) ||
+         ( storeSector.header.sequence >= exportEndSequence ) ) {
+        exportSectorIndex++;
+        return EVENT_JOURNAL_STEP_IN_PROGRESS;
+    }
+    exportSectorIndex++;
+
+    for ( record = 0; record < storeSector.header.numberOfRecords; record++ ) {
+        const eventJournalRecord_t* journalRecord =
+            &storeSector.records[record];
+        if ( !eventJournalRecordIsValid( journalRecord ) ) {
+            continue;
+        }
+        eventLogEventToString( (time_t) journalRecord->seconds,
+                               journalRecord->elementId,
+                               journalRecord->flags &
+                               EVENT_JOURNAL_RECORD_STATE_FLAG,
+                               eventStr );
+        if ( sdCardFileWrite( &exportFile, eventStr, strlen(eventStr) ) !=
+             (int) strlen(eventStr) ) {
+            return eventStoreExportEnd( EVENT_JOURNAL_STEP_ERROR );
+        }
+    }
+    return EVENT_JOURNAL_STEP_IN_PROGRESS;
+}
+
+//=====[Implementations of private functions]==================================
+
+static uint16_t eventStoreSectorCrc( const eventStoreSector_t* sector )
+{
+    const uint8_t* sectorBytes = (const uint8_t*) sector;
+    int crcEnd = sizeof(sector->header.magic) + sizeof(sector->header.crc);
+
+    return eventJournalCrc16( sectorBytes + crcEnd,
+                              sizeof(eventStoreSector_t) - crcEnd );
+}
+
+static bool eventStoreSectorRead( uint32_t sectorNumber,
+                                  eventStoreSector_t* sector )
+{
+    if ( storeBlockDevice->read( sector, (uint64_t) sectorNumber *
+                                 EVENT_STORE_SECTOR_SIZE,
+                                 EVENT_STORE_SECTOR_SIZE ) != 0 ) {
+        return false;
+    }
+    return ( sector->header.magic == EVENT_STORE_SECTOR_MAGIC ) &&
+           ( sector->header.numberOfRecords <= EVENT_STORE_RECORDS_PER_SECTOR ) &&
+           ( sector->header.crc == eventStoreSectorCrc( sector ) );
+}
+
+// Sectors of the current lap have a sequence not older than sector 0
+static bool eventStoreSectorIsNewer( uint32_t sectorNumber,
+                                     uint32_t firstSequence )
+{
+    if ( !eventStoreSectorRead( sectorNumber, &storeSector ) ) {
+        return false;
+    }
+    return (int32_t)( storeSector.header.sequence - firstSequence ) >= 0;
+}
+
+static eventJournalStepStatus_t eventStoreExportEnd(
+    eventJournalStepStatus_t status )
+{
+    if ( !sdCardFileClose( &exportFile ) ) {
+        status = EVENT_JOURNAL_STEP_ERROR;
+    }
+    return status;
+}
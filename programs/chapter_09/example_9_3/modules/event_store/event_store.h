@@ -0,0 +1,59 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _EVENT_STORE_H_
+#define _EVENT_STORE_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "event_journal.h"
+
+//=====[Declaration of public defines]=======================================
+
+#ifdef MBED_CONF_APP_EVENT_STORE_RAW
+#define EVENT_STORE_RAW_ENABLED          MBED_CONF_APP_EVENT_STORE_RAW
+#define EVENT_STORE_RAW_SIZE             MBED_CONF_APP_EVENT_STORE_RAW_SIZE
+#else
+#define EVENT_STORE_RAW_ENABLED          0
+#define EVENT_STORE_RAW_SIZE             0
+#endif
+
+#define EVENT_STORE_SECTOR_SIZE          512
+#define EVENT_STORE_SECTOR_MAGIC         0x31535645 // "EVS1"
+#define EVENT_STORE_RECORDS_PER_SECTOR   ( ( EVENT_STORE_SECTOR_SIZE - \
+                                             sizeof(eventStoreSectorHeader_t) ) / \
+                                           sizeof(eventJournalRecord_t) )
+#define EVENT_STORE_EXPORT_FILE_NAME     "raw_events.txt"
+
+//=====[Declaration of public data types]======================================
+
+// The CRC covers every byte of the sector that follows it
+typedef struct eventStoreSectorHeader {
+    uint32_t magic;
+    uint16_t crc;
+    uint16_t numberOfRecords;
+    uint32_t sequence;
+    uint32_t reserved;
+} eventStoreSectorHeader_t;
+
+typedef struct eventStoreSector {
+    eventStoreSectorHeader_t header;
+    eventJournalRecord_t records[( EVENT_STORE_SECTOR_SIZE -
+                                   sizeof(eventStoreSectorHeader_t) ) /
+                                 sizeof(eventJournalRecord_t)];
+} eventStoreSector_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+bool eventStoreInit( BlockDevice* blockDevice );
+bool eventStoreSectorAppend( const eventJournalRecord_t* records,
+                             int numberOfRecords );
+uint32_t eventStoreNextSequenceRead();
+int eventStoreTailRead( eventJournalRecord_t* records, int maxRecords );
+bool eventStoreExportStart( const char* textFileName );
+eventJournalStepStatus_t eventStoreExportStep();
+
+//=====[#include guards - end]=================================================
+
+#endif // _EVENT_STORE_H_
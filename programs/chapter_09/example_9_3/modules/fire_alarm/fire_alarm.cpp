@@ -58,7 +58,7 @@ void fireAlarmUpdate()
 {
     fireAlarmActivationUpdate();
     fireAlarmDeactivationUpdate();
-    sirenIndicatorUpdate( fireAlarmBlinkTime() );
+    sirenBlinkTimeWrite( fireAlarmBlinkTime() );
 }
 
 bool gasDetectorStateRead()
@@ -85,7 +85,6 @@ bool overTemperatureDetectedRead()
 
 static void fireAlarmActivationUpdate()
 {
-    temperatureSensorUpdate();
     gasSensorUpdate();
 /*
     overTemperatureDetectorState = temperatureSensorReadCelsius() > 
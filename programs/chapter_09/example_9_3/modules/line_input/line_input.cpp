@@ -0,0 +1,93 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "line_input.h"
+
+//=====[Declaration of private defines]========================================
+
+#define LINE_INPUT_BACKSPACE   '\b'
+#define LINE_INPUT_DELETE      0x7F
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void lineInputEcho( lineInput_t* line, const char* str );
+
+//=====[Implementations of public functions]===================================
+
+// The whole line must be entered within timeoutMs. The buffer always holds
+// a null terminated string, at most size - 1 characters are kept.
+void lineInputInit( lineInput_t* line, char* buffer, int size,
+                    tick_t timeoutMs, lineInputEchoFunction_t echo )
+{
+    line->buffer = buffer;
+    line->size = size;
+    line->length = 0;
+    line->echo = echo;
+    line->buffer[0] = '\0';
+    delayInit( &line->timeout, timeoutMs );
+}
+
+// Takes at most one character per call, '\0' meaning that none was
+// received, so it never waits for the operator. The line ends with '\r' or
+// with '\n', a '\n' on an empty line is dropped so CR LF terminals work.
+lineInputStatus_t lineInputUpdate( lineInput_t* line, char receivedChar )
+{
+    if ( receivedChar == '\0' ) {
+        if ( delayRead( &line->timeout ) ) {
+            return LINE_INPUT_TIMEOUT;
+        }
+        return LINE_INPUT_IN_PROGRESS;
+    }
+
+    if ( receivedChar == '\r' ||
+         ( receivedChar == '\n' && line->length > 0 ) ) {
+        lineInputEcho( line, "\r\n" );
+        return LINE_INPUT_COMPLETE;
+    }
+
+    if ( receivedChar == LINE_INPUT_BACKSPACE ||
+         receivedChar == LINE_INPUT_DELETE ) {
+        if ( line->length > 0 ) {
+            line->length--;
+            line->buffer[line->length] = '\0';
+            lineInputEcho( line, "\b \b" );
+        }
+    } else if ( receivedChar >= ' ' && line->length < line->size - 1 ) {
+        line->buffer[line->length] = receivedChar;
+        line->length++;
+        line->buffer[line->length] = '\0';
+        if ( line->echo != NULL ) {
+            line->echo( receivedChar );
+        }
+    }
+
+    if ( delayRead( &line->timeout ) ) {
+        return LINE_INPUT_TIMEOUT;
+    }
+    return LINE_INPUT_IN_PROGRESS;
+}
+
+//=====[Implementations of private functions]==================================
+
+static void lineInputEcho( lineInput_t* line, const char* str )
+{
+    if ( line->echo == NULL ) {
+        return;
+    }
+    while ( *str != '\0' ) {
+        line->echo( *str );
+        str++;
+    }
+}
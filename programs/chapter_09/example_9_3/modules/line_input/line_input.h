@@ -0,0 +1,41 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _LINE_INPUT_H_
+#define _LINE_INPUT_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "sapi.h"
+
+//=====[Declaration of public defines]=======================================
+
+//=====[Declaration of public data types]======================================
+
+typedef enum {
+    LINE_INPUT_IN_PROGRESS,
+    LINE_INPUT_COMPLETE,
+    LINE_INPUT_TIMEOUT,
+} lineInputStatus_t;
+
+typedef void (*lineInputEchoFunction_t)( char c );
+
+// Like a delay, a line input must be zero initialized (static storage)
+// before the first lineInputInit()
+typedef struct lineInput {
+    char* buffer;
+    int size;
+    int length;
+    lineInputEchoFunction_t echo;
+    delay_t timeout;
+} lineInput_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void lineInputInit( lineInput_t* line, char* buffer, int size,
+                    tick_t timeoutMs, lineInputEchoFunction_t echo );
+lineInputStatus_t lineInputUpdate( lineInput_t* line, char receivedChar );
+
+//=====[#include guards - end]=================================================
+
+#endif // _LINE_INPUT_H_
@@ -6,6 +6,7 @@
 #include "matrix_keypad.h"
 
 #include "date_and_time.h"
+#include "sapi.h"
 
 //=====[Declaration of private defines]======================================
 
@@ -16,6 +17,7 @@
 //=====[Declaration of private data types]=====================================
 
 typedef enum {
+    MATRIX_KEYPAD_IDLE,
     MATRIX_KEYPAD_SCANNING,
     MATRIX_KEYPAD_DEBOUNCE,
     MATRIX_KEYPAD_KEY_HOLD_PRESSED
@@ -24,7 +26,7 @@ typedef enum {
 //=====[Declaration and initialization of public global objects]===============
 
 DigitalOut keypadRowPins[MATRIX_KEYPAD_NUMBER_OF_ROWS] = {D23, D22, D21, D20};
-DigitalIn keypadColPins[MATRIX_KEYPAD_NUMBER_OF_COLS]  = {D19, D18, D17, D16};
+InterruptIn keypadColPins[MATRIX_KEYPAD_NUMBER_OF_COLS] = {{D19}, {D18}, {D17}, {D16}};
 
 //=====[Declaration of external public global variables]=======================
 
@@ -33,28 +35,33 @@ DigitalIn keypadColPins[MATRIX_KEYPAD_NUMBER_OF_COLS]  = {D19, D18, D17, D16};
 //=====[Declaration and initialization of private global variables]============
 
 static matrixKeypadState_t matrixKeypadState;
-static int timeIncrement_ms = 0;
+
+// Set by the column interrupts while idle, with the time of the first edge
+static volatile bool matrixKeypadActivity = false;
+static volatile tick_t matrixKeypadActivityTime = 0;
 
 //=====[Declarations (prototypes) of private functions]========================
 
 static char matrixKeypadScan();
 static void matrixKeypadReset();
+static void matrixKeypadIdleEnter();
+static void matrixKeypadColumnIsr();
 
 //=====[Implementations of public functions]===================================
 
-void matrixKeypadInit( int updateTime_ms )
+void matrixKeypadInit()
 {
-    timeIncrement_ms = updateTime_ms;
-    matrixKeypadState = MATRIX_KEYPAD_SCANNING;
     int pinIndex = 0;
     for( pinIndex=0; pinIndex<MATRIX_KEYPAD_NUMBER_OF_COLS; pinIndex++ ) {
         (keypadColPins[pinIndex]).mode(PullUp);
+        (keypadColPins[pinIndex]).fall(matrixKeypadColumnIsr);
     }
+    matrixKeypadIdleEnter();
 }
 
 char matrixKeypadUpdate()
 {
-    static int accumulatedDebounceMatrixKeypadTime = 0;
+    static tick_t debounceMatrixKeypadStartTime = 0;
     static char matrixKeypadLastKeyPressed = '\0';
 
     char keyDetected = '\0';
@@ -62,27 +69,44 @@ char matrixKeypadUpdate()
 
     switch( matrixKeypadState ) {
 
+    // Nothing is scanned until a column interrupt reports a key edge
+    case MATRIX_KEYPAD_IDLE:
+        if( matrixKeypadActivity ) {
+            matrixKeypadActivity = false;
+            matrixKeypadState = MATRIX_KEYPAD_SCANNING;
+            keyDetected = matrixKeypadScan();
+            if( keyDetected != '\0' ) {
+                matrixKeypadLastKeyPressed = keyDetected;
+                // The debounce time counts from the edge, not from the scan
+                debounceMatrixKeypadStartTime = matrixKeypadActivityTime;
+                matrixKeypadState = MATRIX_KEYPAD_DEBOUNCE;
+            } else {
+                matrixKeypadIdleEnter();
+            }
+        }
+        break;
+
     case MATRIX_KEYPAD_SCANNING:
         keyDetected = matrixKeypadScan();
         if( keyDetected != '\0' ) {
             matrixKeypadLastKeyPressed = keyDetected;
-            accumulatedDebounceMatrixKeypadTime = 0;
+            debounceMatrixKeypadStartTime = tickRead();
             matrixKeypadState = MATRIX_KEYPAD_DEBOUNCE;
+        } else {
+            matrixKeypadIdleEnter();
         }
         break;
 
     case MATRIX_KEYPAD_DEBOUNCE:
-        if( accumulatedDebounceMatrixKeypadTime >=
+        if( tickRead() - debounceMatrixKeypadStartTime >=
             DEBOUNCE_BUTTON_TIME_MS ) {
             keyDetected = matrixKeypadScan();
             if( keyDetected == matrixKeypadLastKeyPressed ) {
                 matrixKeypadState = MATRIX_KEYPAD_KEY_HOLD_PRESSED;
             } else {
-                matrixKeypadState = MATRIX_KEYPAD_SCANNING;
+                matrixKeypadIdleEnter();
             }
         }
-        accumulatedDebounceMatrixKeypadTime =
-            accumulatedDebounceMatrixKeypadTime + timeIncrement_ms;
         break;
 
     case MATRIX_KEYPAD_KEY_HOLD_PRESSED:
@@ -90,8 +114,10 @@ char matrixKeypadUpdate()
         if( keyDetected != matrixKeypadLastKeyPressed ) {
             if( keyDetected == '\0' ) {
                 keyReleased = matrixKeypadLastKeyPressed;
+                matrixKeypadIdleEnter();
+            } else {
+                matrixKeypadState = MATRIX_KEYPAD_SCANNING;
             }
-            matrixKeypadState = MATRIX_KEYPAD_SCANNING;
         }
         break;
 
@@ -137,5 +163,42 @@ static char matrixKeypadScan()
 
 static void matrixKeypadReset()
 {
-    matrixKeypadState = MATRIX_KEYPAD_SCANNING;
+    matrixKeypadIdleEnter();
+}
+
+// All the rows are held low, so any key pulls its column low and the
+// falling edge wakes up the keypad. The column interrupts stay disabled
+// while scanning, since driving the rows also toggles the columns.
+static void matrixKeypadIdleEnter()
+{
+    int pinIndex = 0;
+
+    for( pinIndex=0; pinIndex<MATRIX_KEYPAD_NUMBER_OF_ROWS; pinIndex++ ) {
+        keypadRowPins[pinIndex] = OFF;
+    }
+    matrixKeypadActivity = false;
+    matrixKeypadState = MATRIX_KEYPAD_IDLE;
+
+    for( pinIndex=0; pinIndex<MATRIX_KEYPAD_NUMBER_OF_COLS; pinIndex++ ) {
+        (keypadColPins[pinIndex]).enable_irq();
+    }
+
+    // A key already held down gives no edge
+    for( pinIndex=0; pinIndex<MATRIX_KEYPAD_NUMBER_OF_COLS; pinIndex++ ) {
+        if( keypadColPins[pinIndex] == OFF ) {
+            matrixKeypadColumnIsr();
+        }
+    }
+}
+
+static void matrixKeypadColumnIsr()
+{
+    int pinIndex = 0;
+
+    for( pinIndex=0; pinIndex<MATRIX_KEYPAD_NUMBER_OF_COLS; pinIndex++ ) {
+        (keypadColPins[pinIndex]).disable_irq();
+    }
+    matrixKeypadActivityTime = tickRead();
+    matrixKeypadActivity = true;
+    tickWakeUpRequest();
 }
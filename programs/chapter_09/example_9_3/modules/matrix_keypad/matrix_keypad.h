@@ -11,7 +11,7 @@
 
 //=====[Declarations (prototypes) of public functions]=========================
 
-void matrixKeypadInit( int updateTime_ms );
+void matrixKeypadInit();
 char matrixKeypadUpdate();
 
 //=====[#include guards - end]=================================================
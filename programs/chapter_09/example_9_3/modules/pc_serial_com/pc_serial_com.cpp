@@ -13,13 +13,31 @@
 #include "gas_sensor.h"
 #include "event_log.h"
 #include "sd_card.h"
+#include "event_journal.h"
+#include "event_store.h"
 #include "sapi.h"
 #include "wifi_module.h"
+#include "scheduler.h"
+#include "ring_buffer.h"
+#include "profiler.h"
+#include "smart_home_system.h"
+#include "display.h"
+#include "line_input.h"
+
+#include <atomic>
 
 //=====[Declaration of private defines]========================================
 
 #define PC_SERIAL_AP_CREDENTIALS_TIMEOUT          15000 // 15000 ms or 15 seconds
 #define PC_SERIAL_AP_CREDENTIALS_BUFFER_MAX_LEN   WIFI_MODULE_CREDENTIAL_MAX_LEN + 20
+#define PC_SERIAL_LIST_FILES_PAGE_SIZE            20
+#define PC_SERIAL_RX_BUFFER_SIZE                  64
+#define PC_SERIAL_TX_BUFFER_SIZE                  256
+#define PC_SERIAL_TX_CHUNK_MIN_SIZE               64
+#define PC_SERIAL_MESSAGE_QUEUE_SIZE              8
+#define PC_SERIAL_LINE_INPUT_TIMEOUT              60000 // 60000 ms or 60 seconds
+#define PC_SERIAL_INPUT_LINE_MAX_LEN              40
+#define PC_SERIAL_DATE_AND_TIME_FIELDS            6
 
 //=====[Declaration of private data types]=====================================
 
@@ -28,7 +46,13 @@ typedef enum{
     PC_SERIAL_GET_CODE,
     PC_SERIAL_SAVE_NEW_CODE,
     PC_SERIAL_GET_FILE_NAME,
+    PC_SERIAL_SHOW_FILE,
+    PC_SERIAL_GET_EXPORT_FILE_NAME,
+    PC_SERIAL_GET_QUERY_RANGE,
+    PC_SERIAL_QUERY_EVENTS,
+    PC_SERIAL_LIST_FILES,
     PC_SERIAL_GET_WIFI_AP_CREDENTIALS,
+    PC_SERIAL_GET_DATE_AND_TIME,
 } pcSerialComMode_t;
 
 typedef enum{
@@ -37,13 +61,18 @@ typedef enum{
     SET_AP_CREDENTIALS_WAIT_PASSWORD,
 } setWiFiAPCredentials_t; 
 
+typedef struct dateAndTimeField {
+    const char* prompt;
+    int minValue;
+    int maxValue;
+} dateAndTimeField_t;
+
 //=====[Declaration and initialization of public global objects]===============
 
-Serial uartUsb( USBTX, USBRX );
+RawSerial uartUsb( USBTX, USBRX );
 
 //=====[Declaration of external public global variables]=======================
 
-extern char systemBuffer[EVENT_STR_LENGTH*EVENT_LOG_MAX_STORAGE];
 
 //=====[Declaration and initialization of public global variables]=============
 
@@ -53,27 +82,79 @@ char codeSequenceFromPcSerialCom[CODE_NUMBER_OF_KEYS];
 
 static pcSerialComMode_t pcSerialComMode = PC_SERIAL_COMMANDS;
 
-static bool codeComplete = false;
+// Read and cleared by the alarm task, which may run in another thread. The
+// code characters are written before the flag is set.
+static std::atomic<bool> codeComplete( false );
 static int numberOfCodeChars = 0;
-static int numberOfFileNameChar = 0;
 
-static char fileName[40];
+// Every prompt reads its answer through this line input, one character per
+// pcSerialComUpdate() call
+static lineInput_t lineInput;
+static char inputLine[PC_SERIAL_INPUT_LINE_MAX_LEN];
 
-static int credentialBufferIndex = 0;
 static char credentialBuffer[PC_SERIAL_AP_CREDENTIALS_BUFFER_MAX_LEN] = "";
-static parser_t parser;
 static setWiFiAPCredentials_t setWiFiAPCredentialsState;
 
-static bool wifiModuleDetectionMustBeChecked = false;
+static const dateAndTimeField_t dateAndTimeFields[PC_SERIAL_DATE_AND_TIME_FIELDS] = {
+    { "Enter the current year (YYYY): ",     1970, 2037 },
+    { "Enter the current month (1-12): ",    1,    12 },
+    { "Enter the current day (1-31): ",      1,    31 },
+    { "Enter the current hour (0-23): ",     0,    23 },
+    { "Enter the current minute (0-59): ",   0,    59 },
+    { "Enter the current second (0-59): ",   0,    59 },
+};
+static int dateAndTimeValues[PC_SERIAL_DATE_AND_TIME_FIELDS];
+static int dateAndTimeFieldIndex = 0;
+
+// Filled by the RX interrupt, so a key press wakes the CPU from sleep and
+// no character is lost while it is sleeping
+static SpscRingBuffer<char, PC_SERIAL_RX_BUFFER_SIZE> pcSerialComRxBuffer;
+
+// Messages posted by the alarm task, written to the UART by the main thread
+// so that the alarm thread never waits for it
+static SpscRingBuffer<const char*, PC_SERIAL_MESSAGE_QUEUE_SIZE>
+    pcSerialComMessages;
+
+// Filled by the file and query transfers and drained by the TX interrupt,
+// so a transfer never waits for the UART
+static SpscRingBuffer<char, PC_SERIAL_TX_BUFFER_SIZE> pcSerialComTxBuffer;
+static std::atomic<bool> txIrqEnabled( false );
+
+static sdCardDir_t listFilesDir = { false };
+static sdCardDir_t listFilesSubdir = { false };
+static char listFilesSubdirName[SD_CARD_PATH_MAX_LENGTH];
+static int listFilesNumberOfFiles = 0;
+static long listFilesTotalSize = 0;
+
+static uint32_t queryStartUs = 0;
+
+static sdCardFile_t showFile = { NULL };
 
 //=====[Declarations (prototypes) of private functions]========================
 
+static void pcSerialComRxIsr();
+static void pcSerialComTxIsr();
+static int pcSerialComTxBufferWrite( const char* data, int length );
+static int pcSerialComTxBufferFreeRead();
+static void pcSerialComTxBufferFlush();
+static void pcSerialComLineInputStart( char* buffer, int size,
+                                       tick_t timeoutMs );
 static void pcSerialComGetCodeUpdate( char receivedChar );
 static void pcSerialComSaveNewCodeUpdate( char receivedChar );
 static void pcSerialComGetFileName( char receivedChar );
+static void pcSerialComGetDateAndTime( char receivedChar );
+static bool pcSerialComDateAndTimeFieldIsValid( int field, int value );
 static void pcSerialComShowSdCardFile( char * readBuffer ) ;
+static void pcSerialComShowFileUpdate();
+static void pcSerialComExportSdCardFile( char* journalFileName );
+static void pcSerialComQuerySdCardEvents( char* rangeStr );
+static void pcSerialComQueryEventsUpdate();
+static bool pcSerialComQueryRecordWrite( const eventJournalRecord_t* record );
+static void pcSerialComListFilesUpdate( char receivedChar );
+static void pcSerialComListFilesPage();
+static bool pcSerialComListFilesEntryRead( sdCardDirEntry_t* entry );
 static void pcSerialComGetWiFiAPCredentials( char receivedChar );
-static void checkIfWiFiModuleIsDetected();
+static void pcSerialComWiFiModuleDetectionShow( wifiModuleRequestResult_t result );
 
 static void pcSerialComCommandUpdate( char receivedChar );
 
@@ -90,48 +171,71 @@ static void commandShowDateAndTime();
 static void commandShowStoredEvents();
 static void commandEventLogSaveToSdCard();
 static void commandGetFileName();
+static void commandGetExportFileName();
+static void commandGetQueryRange();
+static void commandExportRawEventStore();
 static void commandsdCardListFiles();
 static void commandSetAPWifiCredentials();
 static void commandCheckIfWifiModuleIsDetected();
+static void commandShowSchedulerStats();
+static void commandShowProfilerStats();
 
 //=====[Implementations of public functions]===================================
 
 void pcSerialComInit()
 {
     uartUsb.baud( PC_SERIAL_COM_BAUD_RATE );
+    uartUsb.attach( pcSerialComRxIsr, SerialBase::RxIrq );
     availableCommands();
 }
 
 char pcSerialComCharRead()
 {
     char receivedChar = '\0';
-    if( uartUsb.readable() ) {
-        receivedChar = uartUsb.getc();
-    }
+    pcSerialComRxBuffer.pop( receivedChar );
     return receivedChar;
 }
 
+bool pcSerialComCharAvailable()
+{
+    return !pcSerialComRxBuffer.isEmpty();
+}
+
 void pcSerialComCharWrite( char c )
 {
+    pcSerialComTxBufferFlush();
     uartUsb.putc(c);
 }
 
 void pcSerialComStringWrite( const char* str )
 {
+    pcSerialComTxBufferFlush();
     uartUsb.printf( "%s", str );
 }
 
 void pcSerialComIntWrite( int number )
 {
+    pcSerialComTxBufferFlush();
     uartUsb.printf( "%d", number );
 }
 
+// Only one task may post, the alarm task. The message must be a constant
+// string, it is written by pcSerialComUpdate().
+void pcSerialComMessagePost( const char* message )
+{
+    pcSerialComMessages.push( message );
+}
+
 void pcSerialComUpdate()
 {
-    if( wifiModuleDetectionMustBeChecked ) {
-        checkIfWiFiModuleIsDetected();
+    const char* message;
+    char receivedChar;
+
+    while ( pcSerialComMessages.pop( message ) ) {
+        pcSerialComStringWrite( message );
     }
-    char receivedChar = pcSerialComCharRead();
+
+    receivedChar = pcSerialComCharRead();
     switch ( pcSerialComMode ) {
         case PC_SERIAL_COMMANDS:
             if( receivedChar != '\0' ) {
@@ -152,8 +256,26 @@ void pcSerialComUpdate()
         break;
 
         case PC_SERIAL_GET_FILE_NAME:
+        case PC_SERIAL_GET_EXPORT_FILE_NAME:
+        case PC_SERIAL_GET_QUERY_RANGE:
+            pcSerialComGetFileName( receivedChar );
+        break;
+
+        case PC_SERIAL_GET_DATE_AND_TIME:
+            pcSerialComGetDateAndTime( receivedChar );
+        break;
+
+        case PC_SERIAL_QUERY_EVENTS:
+            pcSerialComQueryEventsUpdate();
+        break;
+
+        case PC_SERIAL_SHOW_FILE:
+            pcSerialComShowFileUpdate();
+        break;
+
+        case PC_SERIAL_LIST_FILES:
             if( receivedChar != '\0' ) {
-                pcSerialComGetFileName( receivedChar );
+                pcSerialComListFilesUpdate( receivedChar );
             }
         break;
 
@@ -179,6 +301,80 @@ void pcSerialComCodeCompleteWrite( bool state )
 
 //=====[Implementations of private functions]==================================
 
+static void pcSerialComRxIsr()
+{
+    while ( uartUsb.readable() ) {
+        pcSerialComRxBuffer.push( uartUsb.getc() );
+    }
+    tickWakeUpRequest();
+}
+
+// Writes the next bytes while the UART can take them, and turns itself off
+// once the TX buffer is empty
+static void pcSerialComTxIsr()
+{
+    char c;
+
+    while ( uartUsb.writeable() ) {
+        if ( !pcSerialComTxBuffer.pop( c ) ) {
+            txIrqEnabled = false;
+            uartUsb.attach( NULL, SerialBase::TxIrq );
+            return;
+        }
+        uartUsb.putc( c );
+    }
+}
+
+// Queues as much of the data as fits and returns how much that was
+static int pcSerialComTxBufferWrite( const char* data, int length )
+{
+    int freeSpace = pcSerialComTxBufferFreeRead();
+    int i;
+
+    if ( length > freeSpace ) {
+        length = freeSpace;
+    }
+    for ( i = 0; i < length; i++ ) {
+        pcSerialComTxBuffer.push( data[i] );
+    }
+
+    core_util_critical_section_enter();
+    if ( !txIrqEnabled && !pcSerialComTxBuffer.isEmpty() ) {
+        txIrqEnabled = true;
+        uartUsb.attach( pcSerialComTxIsr, SerialBase::TxIrq );
+    }
+    core_util_critical_section_exit();
+    return length;
+}
+
+static int pcSerialComTxBufferFreeRead()
+{
+    return pcSerialComTxBuffer.capacity() - pcSerialComTxBuffer.size();
+}
+
+// The blocking writes first send what is left in the TX buffer themselves,
+// so the output keeps its order
+static void pcSerialComTxBufferFlush()
+{
+    char c;
+
+    if ( txIrqEnabled ) {
+        core_util_critical_section_enter();
+        txIrqEnabled = false;
+        uartUsb.attach( NULL, SerialBase::TxIrq );
+        core_util_critical_section_exit();
+    }
+    while ( pcSerialComTxBuffer.pop( c ) ) {
+        uartUsb.putc( c );
+    }
+}
+
+static void pcSerialComLineInputStart( char* buffer, int size,
+                                       tick_t timeoutMs )
+{
+    lineInputInit( &lineInput, buffer, size, timeoutMs, pcSerialComCharWrite );
+}
+
 static void pcSerialComGetCodeUpdate( char receivedChar )
 {
     codeSequenceFromPcSerialCom[numberOfCodeChars] = receivedChar;
@@ -206,8 +402,10 @@ static void pcSerialComSaveNewCodeUpdate( char receivedChar )
     } 
 }
 
+// The commands write straight to the UART, after what a transfer left
 static void pcSerialComCommandUpdate( char receivedChar )
 {
+    pcSerialComTxBufferFlush();
     switch (receivedChar) {
         case '1': commandShowCurrentSirenState(); break;
         case '2': commandShowCurrentGasDetectorState(); break;
@@ -221,9 +419,14 @@ static void pcSerialComCommandUpdate( char receivedChar )
         case 'e': case 'E': commandShowStoredEvents(); break;
         case 'w': case 'W': commandEventLogSaveToSdCard(); break;
         case 'o': case 'O': commandGetFileName(); break;
+        case 'x': case 'X': commandGetExportFileName(); break;
+        case 'q': case 'Q': commandGetQueryRange(); break;
+        case 'r': case 'R': commandExportRawEventStore(); break;
         case 'l': case 'L': commandsdCardListFiles(); break;
         case 'a': case 'A': commandSetAPWifiCredentials(); break; 
         case 'd': case 'D': commandCheckIfWifiModuleIsDetected(); break;
+        case 'p': case 'P': commandShowSchedulerStats(); break;
+        case 'm': case 'M': commandShowProfilerStats(); break;
         default: availableCommands(); break;
     }
 }
@@ -243,9 +446,14 @@ static void availableCommands()
     uartUsb.printf( "Press 'e' or 'E' to get the stored events\r\n" );
     uartUsb.printf( "Press 'w' or 'W' to store new events in SD Card\r\n" );
     uartUsb.printf( "Press 'o' or 'O' to show an SD Card file contents\r\n" );
+    uartUsb.printf( "Press 'x' or 'X' to export an SD Card event log to text\r\n" );
+    uartUsb.printf( "Press 'q' or 'Q' to query the SD Card events between two dates\r\n" );
+    uartUsb.printf( "Press 'r' or 'R' to export the raw SD Card event store to text\r\n" );
     uartUsb.printf( "Press 'l' or 'L' to list all files in the SD Card\r\n" );
     uartUsb.printf( "Press 'a' or 'A' to set Wi-Fi AP credentials\r\n" );
     uartUsb.printf( "Press 'd' or 'D' to test if the Wi-Fi module is detected\r\n" );
+    uartUsb.printf( "Press 'p' or 'P' to get the task scheduler statistics\r\n" );
+    uartUsb.printf( "Press 'm' or 'M' to get the execution time of each module\r\n" );
     uartUsb.printf( "\r\n" );
 }
 
@@ -316,51 +524,29 @@ static void commandEventLogSaveToSdCard()
 
 static void commandsdCardListFiles()
 {
-    systemBuffer[0] = NULL;
-    sdCardListFiles( systemBuffer, 
-                     sizeof(systemBuffer) );
-    pcSerialComStringWrite( systemBuffer );
-    pcSerialComStringWrite( "\r\n" );
+    if ( !sdCardDirOpen( &listFilesDir, "" ) ) {
+        pcSerialComStringWrite("Insert an SD card and ");
+        pcSerialComStringWrite("reset the board.\r\n");
+        return;
+    }
+    listFilesNumberOfFiles = 0;
+    listFilesTotalSize = 0;
+    pcSerialComStringWrite("Printing all filenames:\r\n");
+    pcSerialComMode = PC_SERIAL_LIST_FILES;
+    pcSerialComListFilesPage();
 }
 
+// Either the whole date and time on a single line or, after an empty line,
+// one prompt per field. Nothing waits for the operator, the answers are
+// read by pcSerialComGetDateAndTime().
 static void commandSetDateAndTime()
 {
-    int year   = 0;
-    int month  = 0;
-    int day    = 0;
-    int hour   = 0;
-    int minute = 0;
-    int second = 0;
-    
-    uartUsb.printf("Enter the current year (YYYY): ");
-    uartUsb.scanf("%d", &year);
-    uartUsb.printf("%d\r\n", year);
-
-    uartUsb.printf("Enter the current month (1-12): ");
-    uartUsb.scanf("%d", &month);
-    uartUsb.printf("%d\r\n", month);
-
-    uartUsb.printf("Enter the current day (1-31): ");
-    uartUsb.scanf("%d", &day);
-    uartUsb.printf("%d\r\n", day);
-
-    uartUsb.printf("Enter the current hour (0-23): ");
-    uartUsb.scanf("%d", &hour);
-    uartUsb.printf("%d\r\n",hour);
-
-    uartUsb.printf("Enter the current minute (0-59): ");
-    uartUsb.scanf("%d", &minute);
-    uartUsb.printf("%d\r\n", minute);
-
-    uartUsb.printf("Enter the current second (0-59): ");
-    uartUsb.scanf("%d", &second);
-    uartUsb.printf("%d\r\n", second);
-
-    while ( uartUsb.readable() ) {
-        uartUsb.getc();
-    }
-
-    dateAndTimeWrite( year, month, day, hour, minute, second );
+    uartUsb.printf( "Enter the date and time as YYYY-MM-DD HH:MM:SS\r\n" );
+    uartUsb.printf( "or press the Enter key to enter each field: " );
+    dateAndTimeFieldIndex = -1;
+    pcSerialComMode = PC_SERIAL_GET_DATE_AND_TIME;
+    pcSerialComLineInputStart( inputLine, sizeof(inputLine),
+                               PC_SERIAL_LINE_INPUT_TIMEOUT );
 }
 
 static void commandShowDateAndTime()
@@ -382,32 +568,334 @@ static void commandGetFileName()
 {
     uartUsb.printf( "Please enter the file name \r\n" );
     pcSerialComMode = PC_SERIAL_GET_FILE_NAME ;
-    numberOfFileNameChar = 0;
+    pcSerialComLineInputStart( inputLine, sizeof(inputLine),
+                               PC_SERIAL_LINE_INPUT_TIMEOUT );
+}
+
+static void commandGetExportFileName()
+{
+    uartUsb.printf( "Please enter the event log file name \r\n" );
+    pcSerialComMode = PC_SERIAL_GET_EXPORT_FILE_NAME ;
+    pcSerialComLineInputStart( inputLine, sizeof(inputLine),
+                               PC_SERIAL_LINE_INPUT_TIMEOUT );
+}
+
+static void commandGetQueryRange()
+{
+    uartUsb.printf( "Please enter the range as " );
+    uartUsb.printf( "YYYY-MM-DD HH:MM YYYY-MM-DD HH:MM\r\n" );
+    pcSerialComMode = PC_SERIAL_GET_QUERY_RANGE ;
+    pcSerialComLineInputStart( inputLine, sizeof(inputLine),
+                               PC_SERIAL_LINE_INPUT_TIMEOUT );
+}
+
+// The export runs in the background, the event log reports when it ends
+static void commandExportRawEventStore()
+{
+    if ( eventLogRawExportStart() ) {
+        pcSerialComStringWrite( "Exporting the raw event store to file " );
+        pcSerialComStringWrite( EVENT_STORE_EXPORT_FILE_NAME );
+        pcSerialComStringWrite( "\r\n" );
+    } else {
+        pcSerialComStringWrite( "Raw event store could not be exported\r\n\r\n" );
+    }
 }
 
 static void pcSerialComGetFileName( char receivedChar )
 {
-    if ( receivedChar == '\r' ) {
+    pcSerialComMode_t mode = pcSerialComMode;
+
+    switch ( lineInputUpdate( &lineInput, receivedChar ) ) {
+        case LINE_INPUT_COMPLETE:
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+            if ( mode == PC_SERIAL_GET_EXPORT_FILE_NAME ) {
+                pcSerialComExportSdCardFile( inputLine );
+            } else if ( mode == PC_SERIAL_GET_QUERY_RANGE ) {
+                pcSerialComQuerySdCardEvents( inputLine );
+            } else {
+                pcSerialComShowSdCardFile( inputLine );
+            }
+        break;
+
+        case LINE_INPUT_TIMEOUT:
+            pcSerialComStringWrite( "\r\nA timeout occurred while waiting " );
+            pcSerialComStringWrite( "for the input.\r\n\r\n" );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+        break;
+
+        default:
+        break;
+    }
+}
+
+static void pcSerialComGetDateAndTime( char receivedChar )
+{
+    int* values = dateAndTimeValues;
+    char* end;
+    int field;
+
+    switch ( lineInputUpdate( &lineInput, receivedChar ) ) {
+        case LINE_INPUT_IN_PROGRESS:
+            return;
+
+        case LINE_INPUT_TIMEOUT:
+            pcSerialComStringWrite( "\r\nA timeout occurred while waiting for " );
+            pcSerialComStringWrite( "the date and time. Press 's' or 'S' to " );
+            pcSerialComStringWrite( "retry.\r\n\r\n" );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+            return;
+
+        default:
+        break;
+    }
+
+    if ( dateAndTimeFieldIndex < 0 && inputLine[0] != '\0' ) {
         pcSerialComMode = PC_SERIAL_COMMANDS;
-        fileName[numberOfFileNameChar] = NULL;
-        numberOfFileNameChar = 0;
-        pcSerialComShowSdCardFile( fileName );
-    } else {
-        fileName[numberOfFileNameChar] = receivedChar;
-        uartUsb.printf( "%c", receivedChar );
-        numberOfFileNameChar++;
+        if ( sscanf( inputLine, "%d-%d-%d%*[ T]%d:%d:%d",
+                     &values[0], &values[1], &values[2],
+                     &values[3], &values[4], &values[5] ) != 6 ) {
+            pcSerialComStringWrite( "Invalid date and time\r\n\r\n" );
+            return;
+        }
+        for ( field = 0; field < PC_SERIAL_DATE_AND_TIME_FIELDS; field++ ) {
+            if ( !pcSerialComDateAndTimeFieldIsValid( field, values[field] ) ) {
+                pcSerialComStringWrite( "Invalid date and time\r\n\r\n" );
+                return;
+            }
+        }
+        dateAndTimeWrite( values[0], values[1], values[2],
+                          values[3], values[4], values[5] );
+        return;
+    }
+
+    // A wrong answer asks for the same field again
+    if ( dateAndTimeFieldIndex >= 0 ) {
+        values[dateAndTimeFieldIndex] = (int) strtol( inputLine, &end, 10 );
+        if ( end == inputLine || *end != '\0' ||
+             !pcSerialComDateAndTimeFieldIsValid( dateAndTimeFieldIndex,
+                                    values[dateAndTimeFieldIndex] ) ) {
+            pcSerialComStringWrite( "Invalid value\r\n" );
+            dateAndTimeFieldIndex--;
+        }
+    }
+
+    dateAndTimeFieldIndex++;
+    if ( dateAndTimeFieldIndex >= PC_SERIAL_DATE_AND_TIME_FIELDS ) {
+        pcSerialComMode = PC_SERIAL_COMMANDS;
+        dateAndTimeWrite( values[0], values[1], values[2],
+                          values[3], values[4], values[5] );
+        return;
     }
+    pcSerialComStringWrite( dateAndTimeFields[dateAndTimeFieldIndex].prompt );
+    pcSerialComLineInputStart( inputLine, sizeof(inputLine),
+                               PC_SERIAL_LINE_INPUT_TIMEOUT );
+}
+
+static bool pcSerialComDateAndTimeFieldIsValid( int field, int value )
+{
+    return ( value >= dateAndTimeFields[field].minValue ) &&
+           ( value <= dateAndTimeFields[field].maxValue );
 }
 
 static void pcSerialComShowSdCardFile( char* fileName ) 
 {
-    systemBuffer[0] = NULL;
-    pcSerialComStringWrite( "\r\n" );
-    if ( sdCardReadFile( fileName, systemBuffer ) ) {
-        pcSerialComStringWrite( "The file content is:\r\n");
-        pcSerialComStringWrite( systemBuffer );
+    if ( sdCardReadFileStart( &showFile, fileName ) ) {
+        pcSerialComMode = PC_SERIAL_SHOW_FILE;
+    }
+}
+
+// Each update reads only what the TX buffer can take, so it never waits for
+// the UART and the SD card is read at the pace of the line
+static void pcSerialComShowFileUpdate()
+{
+    char chunk[PC_SERIAL_TX_BUFFER_SIZE];
+    int length = pcSerialComTxBufferFreeRead();
+
+    if ( length < PC_SERIAL_TX_CHUNK_MIN_SIZE ) {
+        return;
+    }
+    length = sdCardFileRead( &showFile, chunk, length );
+    if ( length > 0 ) {
+        pcSerialComTxBufferWrite( chunk, length );
+        return;
+    }
+    sdCardFileClose( &showFile );
+    pcSerialComTxBufferWrite( "\r\n", strlen("\r\n") );
+    pcSerialComMode = PC_SERIAL_COMMANDS;
+}
+
+// The text file takes the name of the event log file with a .txt
+// extension, a file that already has it is not exported over itself. FAT
+// names ignore case, so neither does the comparison.
+static void pcSerialComExportSdCardFile( char* journalFileName )
+{
+    char textFileName[SD_CARD_PATH_MAX_LENGTH];
+    char* extension;
+    int baseLength = strlen( journalFileName );
+
+    extension = strrchr( journalFileName, '.' );
+    if ( extension != NULL ) {
+        baseLength = extension - journalFileName;
+    }
+    snprintf( textFileName, sizeof(textFileName), "%.*s.txt", baseLength,
+              journalFileName );
+    if ( strcasecmp( textFileName, journalFileName ) == 0 ) {
+        pcSerialComStringWrite( "The event log file can not be a .txt " );
+        pcSerialComStringWrite( "file\r\n\r\n" );
+        return;
+    }
+
+    // The export runs in the background, the event log reports when it ends
+    if ( eventLogJournalExportStart( journalFileName, textFileName ) ) {
+        pcSerialComStringWrite( "Exporting the event log to file " );
+        pcSerialComStringWrite( textFileName );
+        pcSerialComStringWrite( "\r\n" );
+    } else {
+        pcSerialComStringWrite( "Event log could not be exported\r\n\r\n" );
+    }
+}
+
+static void pcSerialComQuerySdCardEvents( char* rangeStr )
+{
+    int fromYear, fromMonth, fromDay, fromHour, fromMinute;
+    int toYear, toMonth, toDay, toHour, toMinute;
+    time_t fromSeconds;
+    time_t toSeconds;
+
+    if ( sscanf( rangeStr, "%d-%d-%d %d:%d %d-%d-%d %d:%d",
+                 &fromYear, &fromMonth, &fromDay, &fromHour, &fromMinute,
+                 &toYear, &toMonth, &toDay, &toHour, &toMinute ) != 10 ) {
+        pcSerialComStringWrite( "Invalid range\r\n\r\n" );
+        return;
+    }
+
+    fromSeconds = dateAndTimeToSeconds( fromYear, fromMonth, fromDay,
+                                        fromHour, fromMinute, 0 );
+    toSeconds = dateAndTimeToSeconds( toYear, toMonth, toDay,
+                                      toHour, toMinute, 59 );
+
+    queryStartUs = us_ticker_read();
+    if ( eventJournalQueryStart( (uint32_t) fromSeconds,
+                                 (uint32_t) toSeconds ) ) {
+        pcSerialComMode = PC_SERIAL_QUERY_EVENTS;
+    } else {
+        pcSerialComStringWrite( "Invalid range\r\n\r\n" );
+    }
+}
+
+// Each update reads only as many records as the TX buffer can take once
+// printed, keeping room for one more for the closing message
+static void pcSerialComQueryEventsUpdate()
+{
+    char message[EVENT_STR_LENGTH];
+    int maxRecords = pcSerialComTxBufferFreeRead() / ( EVENT_STR_LENGTH ) - 1;
+
+    if ( maxRecords <= 0 ) {
+        return;
+    }
+    switch ( eventJournalQueryStep( maxRecords, pcSerialComQueryRecordWrite ) ) {
+        case EVENT_JOURNAL_STEP_IN_PROGRESS:
+        break;
+        case EVENT_JOURNAL_STEP_COMPLETE:
+            snprintf( message, sizeof(message),
+                      "Query completed in %d ms\r\n\r\n",
+                      (int)( ( us_ticker_read() - queryStartUs ) / 1000 ) );
+            pcSerialComTxBufferWrite( message, strlen( message ) );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+        break;
+        default:
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+        break;
+    }
+}
+
+static bool pcSerialComQueryRecordWrite( const eventJournalRecord_t* record )
+{
+    char eventStr[EVENT_STR_LENGTH];
+
+    eventLogEventToString( (time_t) record->seconds, record->elementId,
+                           record->flags & EVENT_JOURNAL_RECORD_STATE_FLAG,
+                           eventStr );
+    pcSerialComTxBufferWrite( eventStr, strlen( eventStr ) );
+    return true;
+}
+
+static void pcSerialComListFilesUpdate( char receivedChar )
+{
+    if ( receivedChar == 'q' || receivedChar == 'Q' ) {
+        sdCardDirClose( &listFilesSubdir );
+        sdCardDirClose( &listFilesDir );
         pcSerialComStringWrite( "\r\n" );
+        pcSerialComMode = PC_SERIAL_COMMANDS;
+    } else {
+        pcSerialComListFilesPage();
+    }
+}
+
+// Prints up to one page of entries straight from the directory, so the
+// listing needs no buffer whatever the number of files
+static void pcSerialComListFilesPage()
+{
+    sdCardDirEntry_t entry;
+    char mtimeStr[DATE_AND_TIME_STR_LENGTH + 3];
+    int i;
+
+    for ( i = 0; i < PC_SERIAL_LIST_FILES_PAGE_SIZE; i++ ) {
+        if ( !pcSerialComListFilesEntryRead( &entry ) ) {
+            sdCardDirClose( &listFilesDir );
+            uartUsb.printf( "%d files, %ld bytes\r\n\r\n",
+                            listFilesNumberOfFiles, listFilesTotalSize );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+            return;
+        }
+
+        if ( entry.mtime != 0 ) {
+            strftime( mtimeStr, sizeof(mtimeStr), "%Y-%m-%d %H:%M",
+                      localtime(&entry.mtime) );
+        } else {
+            strcpy( mtimeStr, "-" );
+        }
+        if ( entry.isDirectory ) {
+            uartUsb.printf( "%-32s %10s  %s\r\n", entry.name, "<DIR>",
+                            mtimeStr );
+            continue;
+        }
+        uartUsb.printf( "%-32s %10ld  %s\r\n", entry.name, entry.size,
+                        mtimeStr );
+
+        listFilesNumberOfFiles++;
+        if ( entry.size > 0 ) {
+            listFilesTotalSize = listFilesTotalSize + entry.size;
+        }
+    }
+    pcSerialComStringWrite( "Press any key for the next page or 'q' to stop\r\n" );
+}
+
+// The entries of a directory of the root, such as the month directories of
+// the event log, come right after it with their path
+static bool pcSerialComListFilesEntryRead( sdCardDirEntry_t* entry )
+{
+    sdCardDirEntry_t subdirEntry;
+
+    if ( listFilesSubdir.open ) {
+        if ( sdCardDirNext( &listFilesSubdir, &subdirEntry ) ) {
+            *entry = subdirEntry;
+            snprintf( entry->name, sizeof(entry->name), "%s/%s",
+                      listFilesSubdirName, subdirEntry.name );
+            return true;
+        }
+        sdCardDirClose( &listFilesSubdir );
+    }
+
+    if ( !sdCardDirNext( &listFilesDir, entry ) ) {
+        return false;
+    }
+    if ( entry->isDirectory &&
+         sdCardDirOpen( &listFilesSubdir, entry->name ) ) {
+        snprintf( listFilesSubdirName, sizeof(listFilesSubdirName), "%s",
+                  entry->name );
     }
+    return true;
 }
 
 static void commandSetAPWifiCredentials()
@@ -417,7 +905,7 @@ static void commandSetAPWifiCredentials()
     pcSerialComStringWrite("\r\nPlease provide the SSID and password of the "); 
     pcSerialComStringWrite("Wi-Fi Access Point.\r\nNote that:\r\n");
     pcSerialComStringWrite(" - You have 15 seconds to complete each operation.");
-    pcSerialComStringWrite("\r\n - Maximum length of SSID or password is 30");
+    pcSerialComStringWrite("\r\n - Maximum length of SSID or password is 100");
     pcSerialComStringWrite(" characters.\r\n");
 
     pcSerialComStringWrite("\r\nType the Wi-Fi SSID using the format:\r\n");
@@ -425,123 +913,120 @@ static void commandSetAPWifiCredentials()
     pcSerialComStringWrite("and press the Enter key.\r\n");
 
     setWiFiAPCredentialsState = SET_AP_CREDENTIALS_WAIT_SSID;
-    credentialBufferIndex = 0;
-    credentialBuffer[0] = '\0';
-
-    parserInit( &parser, "SSID:\r", strlen("SSID:\r"), 
-                PC_SERIAL_AP_CREDENTIALS_TIMEOUT );
+    pcSerialComLineInputStart( credentialBuffer, sizeof(credentialBuffer),
+                               PC_SERIAL_AP_CREDENTIALS_TIMEOUT );
 }
 
 static void pcSerialComGetWiFiAPCredentials( char receivedChar ) 
 {
-    parserStatus_t parserStatus;
+    lineInputStatus_t lineInputStatus;
+    char* credential;
+    int length;
 
-    if( receivedChar == '\r' ) {
-        pcSerialComStringWrite( "\r\n" );
-    } else {
-        pcSerialComCharWrite( receivedChar );
+    lineInputStatus = lineInputUpdate( &lineInput, receivedChar );
+    if ( lineInputStatus == LINE_INPUT_IN_PROGRESS ) {
+        return;
     }
 
     switch( setWiFiAPCredentialsState ) {
 
     case SET_AP_CREDENTIALS_WAIT_SSID:
-        // Update outputs
-        parserStatus = parserUpdate( &parser, receivedChar );
-        if( receivedChar != '\0' &&
-            credentialBufferIndex < PC_SERIAL_AP_CREDENTIALS_BUFFER_MAX_LEN ) {
-            credentialBuffer[credentialBufferIndex] = receivedChar;
-            credentialBufferIndex++;
+        if( lineInputStatus == LINE_INPUT_TIMEOUT ) {
+            pcSerialComStringWrite("\r\nA timeout occurred while waiting for a ");
+            pcSerialComStringWrite("SSID. Press 'a' or 'A' to retry.\r\n" );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
         }
-        // Check transition conditions or end the FSM execution
-        if( parserStatus == PARSER_PATTERN_MATCH ) {
-            credentialBuffer[credentialBufferIndex-1] = '\0'; // Reemplazo el '\r' del enter final que me mandaron por un '\0' (NULL)
- 
-            pcSerialComStringWrite("\r\nYour Wi-Fi SSID is ");
-            pcSerialComStringWrite( credentialBuffer + strlen("SSID:") ); // muestro solo el ssid del usuario esquivando "SSID:"
-            pcSerialComStringWrite("?\r\n");
-
-            pcSerialComStringWrite("Please type OK (uppercase) and press the"); 
-            pcSerialComStringWrite(" Enter key to confirm.\r\n");
-            pcSerialComStringWrite("If is not correct just wait until ");
-            pcSerialComStringWrite("timeout.\r\n");
-
-            setWiFiAPCredentialsState = SET_AP_CREDENTIALS_WAIT_SSID_CONFIRMATION;
-
-            parserInit( &parser, "OK\r", strlen("OK\r"), 
-                        PC_SERIAL_AP_CREDENTIALS_TIMEOUT );
+        credential = credentialBuffer + strlen("SSID:");
+        if ( strncmp( credentialBuffer, "SSID:", strlen("SSID:") ) != 0 ) {
+            pcSerialComStringWrite("\r\nThe SSID must be typed as SSID:myssid. ");
+            pcSerialComStringWrite("Press 'a' or 'A' to retry.\r\n" );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
         }
-        if ( credentialBufferIndex >= PC_SERIAL_AP_CREDENTIALS_BUFFER_MAX_LEN ) {
+        if ( strlen( credential ) >= WIFI_MODULE_CREDENTIAL_MAX_LEN ) {
             pcSerialComStringWrite("\r\n\r\nMaximum length of SSID is 100 ");
             pcSerialComStringWrite("characters. Press 'a' or 'A' to retry.\r\n" );
             pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
         }
-        if( parserStatus == PARSER_TIMEOUT ) {
-            pcSerialComStringWrite("\r\nA timeout occurred while waiting for a ");
-            pcSerialComStringWrite("SSID. Press 'a' or 'A' to retry.\r\n" );
-            pcSerialComMode = PC_SERIAL_COMMANDS;
-        }
+
+        pcSerialComStringWrite("\r\nYour Wi-Fi SSID is ");
+        pcSerialComStringWrite( credential );
+        pcSerialComStringWrite("?\r\n");
+
+        pcSerialComStringWrite("Please type OK (uppercase) and press the"); 
+        pcSerialComStringWrite(" Enter key to confirm.\r\n");
+        pcSerialComStringWrite("If it is not correct just press the ");
+        pcSerialComStringWrite("Enter key.\r\n");
+
+        setWiFiAPCredentialsState = SET_AP_CREDENTIALS_WAIT_SSID_CONFIRMATION;
+        pcSerialComLineInputStart( inputLine, sizeof(inputLine),
+                                   PC_SERIAL_AP_CREDENTIALS_TIMEOUT );
     break;
 
     case SET_AP_CREDENTIALS_WAIT_SSID_CONFIRMATION:
-        // Update outputs
-        parserStatus = parserUpdate( &parser, receivedChar );
-        // Check transition conditions or end the FSM execution
-        if( parserStatus == PARSER_PATTERN_MATCH ) {
-            wifiModuleSetAP_SSID( credentialBuffer + strlen("SSID:") ); // Guardo solo el ssid del usuario esquivando "SSID:"
-            credentialBufferIndex = 0;     // Reseteo las variables para guardar luego el password
-            credentialBuffer[0] = '\0';
-            pcSerialComStringWrite("\r\nSSID saved.\r\n\r\n");
-
-            pcSerialComStringWrite("Type the Wi-Fi password using the format:");
-            pcSerialComStringWrite("\r\nPASSWORD,\"mypassword\"\r\n");
-            pcSerialComStringWrite("and press the Enter key.\r\n");
-
-            setWiFiAPCredentialsState = SET_AP_CREDENTIALS_WAIT_PASSWORD;
-
-            parserInit( &parser, "PASSWORD,\"\"\r", 
-                        strlen("PASSWORD,\"\"\r"), 
-                        PC_SERIAL_AP_CREDENTIALS_TIMEOUT );
-        }
-        if( parserStatus == PARSER_TIMEOUT ) {
+        if( lineInputStatus == LINE_INPUT_TIMEOUT ) {
             pcSerialComStringWrite("\r\nA timeout occurred while waiting for ");
             pcSerialComStringWrite("confirmation. Press 'a' or 'A' to retry.");
             pcSerialComStringWrite("\r\n" );
             pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
+        }
+        if ( strcmp( inputLine, "OK" ) != 0 ) {
+            pcSerialComStringWrite("\r\nSSID not saved. Press 'a' or 'A' to ");
+            pcSerialComStringWrite("retry.\r\n" );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
         }
+        wifiModuleSetAP_SSID( credentialBuffer + strlen("SSID:") );
+        pcSerialComStringWrite("\r\nSSID saved.\r\n\r\n");
+
+        pcSerialComStringWrite("Type the Wi-Fi password using the format:");
+        pcSerialComStringWrite("\r\nPASSWORD,\"mypassword\"\r\n");
+        pcSerialComStringWrite("and press the Enter key.\r\n");
+
+        setWiFiAPCredentialsState = SET_AP_CREDENTIALS_WAIT_PASSWORD;
+        pcSerialComLineInputStart( credentialBuffer, sizeof(credentialBuffer),
+                                   PC_SERIAL_AP_CREDENTIALS_TIMEOUT );
     break;
 
     case SET_AP_CREDENTIALS_WAIT_PASSWORD:
-        // Update outputs
-        parserStatus = parserUpdate( &parser, receivedChar );   
-        if( receivedChar != '\0' &&
-            credentialBufferIndex < PC_SERIAL_AP_CREDENTIALS_BUFFER_MAX_LEN ) {
-            credentialBuffer[credentialBufferIndex] = receivedChar;
-            credentialBufferIndex++;
+        if( lineInputStatus == LINE_INPUT_TIMEOUT ) {
+            pcSerialComStringWrite("\r\nA timeout occurred while waiting for ");
+            pcSerialComStringWrite("password. Press 'a' or 'A' to retry.\r\n" );
+            pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
         }
-        // Check transition conditions or end the FSM execution
-        if( parserStatus == PARSER_PATTERN_MATCH ) {
-            credentialBuffer[credentialBufferIndex-2] = '\0'; // Reemplazo el '\"\r' del final que me mandaron por un '\0' (NULL)
-            wifiModuleSetAP_Password( credentialBuffer + strlen("PASSWORD,\"") ); // Guardo solo el password del usuario esquivando "PASSWORD,"
-
-            pcSerialComStringWrite("\r\nThe Wi-Fi credentials provided are:");
-            pcSerialComStringWrite("\r\n  SSID: ");
-            pcSerialComStringWrite( wifiModuleGetAP_SSID() );
-            pcSerialComStringWrite("\r\n  Password: ");
-            pcSerialComStringWrite( wifiModuleGetAP_Password() );
-            pcSerialComStringWrite("\r\n");
-
+        credential = credentialBuffer + strlen("PASSWORD,\"");
+        length = strlen( credentialBuffer );
+        if ( strncmp( credentialBuffer, "PASSWORD,\"",
+                      strlen("PASSWORD,\"") ) != 0 ||
+             length <= (int) strlen("PASSWORD,\"") ||
+             credentialBuffer[length - 1] != '"' ) {
+            pcSerialComStringWrite("\r\nThe password must be typed as ");
+            pcSerialComStringWrite("PASSWORD,\"mypassword\". ");
+            pcSerialComStringWrite("Press 'a' or 'A' to retry.\r\n" );
             pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
         }
-        if ( credentialBufferIndex >= PC_SERIAL_AP_CREDENTIALS_BUFFER_MAX_LEN ) {
-            pcSerialComStringWrite("\r\n\r\nMaximum length of password is 30");
+        credentialBuffer[length - 1] = '\0'; // Drops the closing quote
+        if ( strlen( credential ) >= WIFI_MODULE_CREDENTIAL_MAX_LEN ) {
+            pcSerialComStringWrite("\r\n\r\nMaximum length of password is 100");
             pcSerialComStringWrite(" characters. Press 'a' or 'A' to retry.\r\n" );
             pcSerialComMode = PC_SERIAL_COMMANDS;
+            break;
         }
-        if( parserStatus == PARSER_TIMEOUT ) {
-            pcSerialComStringWrite("\r\nA timeout occurred while waiting for ");
-            pcSerialComStringWrite("password. Press 'a' or 'A' to retry.\r\n" );
-            pcSerialComMode = PC_SERIAL_COMMANDS;
-        }        
+        wifiModuleSetAP_Password( credential );
+
+        pcSerialComStringWrite("\r\nThe Wi-Fi credentials provided are:");
+        pcSerialComStringWrite("\r\n  SSID: ");
+        pcSerialComStringWrite( wifiModuleGetAP_SSID() );
+        pcSerialComStringWrite("\r\n  Password: ");
+        pcSerialComStringWrite( wifiModuleGetAP_Password() );
+        pcSerialComStringWrite("\r\n");
+
+        pcSerialComMode = PC_SERIAL_COMMANDS;
     break;
 
     default:
@@ -552,28 +1037,96 @@ static void pcSerialComGetWiFiAPCredentials( char receivedChar )
 
 static void commandCheckIfWifiModuleIsDetected()
 {
-    switch( wifiModuleStartDetection() ) {
-        case WIFI_MODULE_DETECTION_STARTED:
-            wifiModuleDetectionMustBeChecked = true;
-        break;
-        case WIFI_MODULE_BUSY:
-        default:
-        break;
+    if( wifiModuleStartDetection( pcSerialComWiFiModuleDetectionShow ) ==
+        WIFI_MODULE_BUSY ) {
+        pcSerialComStringWrite( "Wi-Fi module busy, try again later.\r\n" );
     }
 }
 
-static void checkIfWiFiModuleIsDetected()
+// Called by the Wi-Fi module once the detection completes
+static void pcSerialComWiFiModuleDetectionShow( wifiModuleRequestResult_t result )
 {
-    switch( wifiModuleDetectionResponse() ) {
-        case WIFI_MODULE_DETECTED:
-            pcSerialComStringWrite( "Wi-Fi module detected.\r\n");
-            wifiModuleDetectionMustBeChecked = false;
-        break;
-        case WIFI_MODULE_NOT_DETECTED:
-            pcSerialComStringWrite( "Wi-Fi module not detected.\r\n");
-            wifiModuleDetectionMustBeChecked = false;
-        break;
-        default:
-        break;
+    if( result == WIFI_MODULE_DETECTED ) {
+        pcSerialComStringWrite( "Wi-Fi module detected.\r\n");
+    } else {
+        pcSerialComStringWrite( "Wi-Fi module not detected.\r\n");
     }
 }
+
+// The statistics are reset after being shown, so each report covers the
+// time since the previous one
+static void commandShowSchedulerStats()
+{
+    schedulerTaskStats_t stats;
+    tickSleepStats_t sleepStats;
+    int i;
+
+    uartUsb.printf( "Task        Period  Runs      Overruns  Max jitter  Max duration\r\n" );
+    for ( i = 0; i < schedulerNumberOfTasksRead(); i++ ) {
+        if ( schedulerTaskStatsRead( i, &stats ) ) {
+            uartUsb.printf( "%-10s %5d ms %-9lu %-9lu %5d ms   %7lu us\r\n",
+                            stats.name, (int) stats.periodMs,
+                            (unsigned long) stats.runs,
+                            (unsigned long) stats.overruns,
+                            (int) stats.maxJitterMs,
+                            (unsigned long) stats.maxDurationUs );
+        }
+    }
+    uartUsb.printf( "Idle time: %d %%\r\n", schedulerIdlePercentageRead() );
+    uartUsb.printf( "Alarm events lost: %lu\r\n",
+                    (unsigned long) eventLogAlarmQueueOverflowsRead() );
+    uartUsb.printf( "Display writes lost: %lu\r\n",
+                    (unsigned long) displayQueueOverflowsRead() );
+    uartUsb.printf( "Wi-Fi bytes lost: %lu, most bytes waiting: %lu\r\n",
+                    (unsigned long) wifiModuleRxOverflowsRead(),
+                    (unsigned long) wifiModuleRxHighWaterMarkRead() );
+
+    tickSleepStatsRead( &sleepStats );
+    if ( sleepStats.elapsedMs > 0 ) {
+        uartUsb.printf( "Loop iterations: %lu per second\r\n",
+                        (unsigned long)( (uint64_t)
+                            smartHomeSystemLoopIterationsRead() * 1000 /
+                            sleepStats.elapsedMs ) );
+        uartUsb.printf( "Duty cycle: %d %%, wake ups: %lu per second\r\n\r\n",
+                        100 - (int)( sleepStats.sleepTimeUs / 10 /
+                                     sleepStats.elapsedMs ),
+                        (unsigned long)( (uint64_t) sleepStats.wakeUps * 1000 /
+                                         sleepStats.elapsedMs ) );
+    }
+    schedulerStatsReset();
+    tickSleepStatsReset();
+    smartHomeSystemLoopIterationsReset();
+}
+
+// Cycles per call of each module, followed by the non empty bins of the
+// log2 histogram. The statistics are reset after being shown.
+static void commandShowProfilerStats()
+{
+    profilerStats_t stats;
+    uint32_t cyclesPerUs = profilerCyclesPerUsRead();
+    int i;
+    int bin;
+
+    uartUsb.printf( "Module      Calls     Min cyc   Mean cyc  Max cyc   Max us\r\n" );
+    for ( i = 0; i < profilerNumberOfSectionsRead(); i++ ) {
+        if ( !profilerStatsRead( i, &stats ) || ( stats.calls == 0 ) ) {
+            continue;
+        }
+        uartUsb.printf( "%-10s  %-9lu %-9lu %-9lu %-9lu %lu\r\n", stats.name,
+                        (unsigned long) stats.calls,
+                        (unsigned long) stats.minCycles,
+                        (unsigned long)( stats.totalCycles / stats.calls ),
+                        (unsigned long) stats.maxCycles,
+                        (unsigned long)( stats.maxCycles / cyclesPerUs ) );
+        uartUsb.printf( "           " );
+        for ( bin = 0; bin < PROFILER_HISTOGRAM_BINS; bin++ ) {
+            if ( stats.histogram[bin] > 0 ) {
+                uartUsb.printf( " 2^%d:%lu", bin,
+                                (unsigned long) stats.histogram[bin] );
+            }
+        }
+        uartUsb.printf( "\r\n" );
+    }
+    uartUsb.printf( "\r\n" );
+    profilerStatsReset();
+}
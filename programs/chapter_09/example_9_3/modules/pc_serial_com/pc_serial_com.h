@@ -15,9 +15,11 @@
 
 void pcSerialComInit();
 char pcSerialComCharRead();
+bool pcSerialComCharAvailable();
 void pcSerialComCharWrite( char c );
 void pcSerialComStringWrite( const char* str );
 void pcSerialComIntWrite( int number );
+void pcSerialComMessagePost( const char* message );
 void pcSerialComUpdate();
 bool pcSerialComCodeCompleteRead();
 void pcSerialComCodeCompleteWrite( bool state );
@@ -0,0 +1,158 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "profiler.h"
+
+#include <atomic>
+
+// On Cortex-M3 and above the DWT cycle counter is used, elsewhere (a host
+// build) the cycles are nanoseconds of the steady clock
+#if defined(DWT) && defined(CoreDebug)
+#define PROFILER_DWT_CYCLE_COUNTER
+#else
+#include <chrono>
+#endif
+
+//=====[Declaration of private defines]========================================
+
+//=====[Declaration of private data types]=====================================
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+// A section is only written by the thread that runs it. A reset is a
+// request that the section applies on its next end.
+static profilerStats_t profilerSections[PROFILER_MAX_SECTIONS];
+static std::atomic<bool> profilerResetRequested[PROFILER_MAX_SECTIONS];
+static int profilerNumberOfSections = 0;
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static void profilerSectionReset( profilerStats_t* section );
+static int profilerHistogramBin( uint32_t cycles );
+
+//=====[Implementations of public functions]===================================
+
+void profilerInit()
+{
+#ifdef PROFILER_DWT_CYCLE_COUNTER
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+}
+
+// Returns the id to pass to profilerSectionEnd(), or -1 if the table is full
+int profilerSectionAdd( const char* name )
+{
+    if ( profilerNumberOfSections >= PROFILER_MAX_SECTIONS ) {
+        return -1;
+    }
+    profilerSections[profilerNumberOfSections].name = name;
+    profilerSectionReset( &profilerSections[profilerNumberOfSections] );
+    profilerNumberOfSections++;
+    return profilerNumberOfSections - 1;
+}
+
+uint32_t profilerCyclesRead()
+{
+#ifdef PROFILER_DWT_CYCLE_COUNTER
+    return DWT->CYCCNT;
+#else
+    return (uint32_t) std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch() ).count();
+#endif
+}
+
+// Only a subtraction, a few additions and a count leading zeros, cheap
+// enough to stay enabled. The 32 bit counter wraps after about 24 s at
+// 180 MHz, far longer than any call.
+void profilerSectionEnd( int sectionId, uint32_t startCycles )
+{
+    uint32_t cycles = profilerCyclesRead() - startCycles;
+    profilerStats_t* section;
+
+    if ( ( sectionId < 0 ) || ( sectionId >= profilerNumberOfSections ) ) {
+        return;
+    }
+    section = &profilerSections[sectionId];
+
+    if ( profilerResetRequested[sectionId].load( std::memory_order_relaxed ) &&
+         profilerResetRequested[sectionId].exchange( false ) ) {
+        profilerSectionReset( section );
+    }
+    section->calls++;
+    section->totalCycles = section->totalCycles + cycles;
+    if ( cycles < section->minCycles ) {
+        section->minCycles = cycles;
+    }
+    if ( cycles > section->maxCycles ) {
+        section->maxCycles = cycles;
+    }
+    section->histogram[profilerHistogramBin( cycles )]++;
+}
+
+int profilerNumberOfSectionsRead()
+{
+    return profilerNumberOfSections;
+}
+
+bool profilerStatsRead( int sectionId, profilerStats_t* stats )
+{
+    if ( ( sectionId < 0 ) || ( sectionId >= profilerNumberOfSections ) ) {
+        return false;
+    }
+    *stats = profilerSections[sectionId];
+    if ( profilerResetRequested[sectionId] ) {
+        profilerSectionReset( stats );
+    }
+    return true;
+}
+
+uint32_t profilerCyclesPerUsRead()
+{
+#ifdef PROFILER_DWT_CYCLE_COUNTER
+    return SystemCoreClock / 1000000;
+#else
+    return 1000;
+#endif
+}
+
+void profilerStatsReset()
+{
+    int i;
+
+    for ( i = 0; i < profilerNumberOfSections; i++ ) {
+        profilerResetRequested[i] = true;
+    }
+}
+
+//=====[Implementations of private functions]==================================
+
+static void profilerSectionReset( profilerStats_t* section )
+{
+    int i;
+
+    section->calls = 0;
+    section->minCycles = UINT32_MAX;
+    section->maxCycles = 0;
+    section->totalCycles = 0;
+    for ( i = 0; i < PROFILER_HISTOGRAM_BINS; i++ ) {
+        section->histogram[i] = 0;
+    }
+}
+
+static int profilerHistogramBin( uint32_t cycles )
+{
+    if ( cycles == 0 ) {
+        return 0;
+    }
+    return 31 - __builtin_clz( cycles );
+}
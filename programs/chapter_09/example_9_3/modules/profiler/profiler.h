@@ -0,0 +1,43 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _PROFILER_H_
+#define _PROFILER_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+//=====[Declaration of public defines]=======================================
+
+#define PROFILER_MAX_SECTIONS      12
+#define PROFILER_HISTOGRAM_BINS    32
+
+//=====[Declaration of public data types]======================================
+
+// Bin i of the histogram counts the calls that took from 2^i to
+// 2^(i+1) - 1 cycles
+typedef struct profilerStats {
+    const char* name;
+    uint32_t calls;
+    uint32_t minCycles;
+    uint32_t maxCycles;
+    uint64_t totalCycles;
+    uint32_t histogram[PROFILER_HISTOGRAM_BINS];
+} profilerStats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+void profilerInit();
+int profilerSectionAdd( const char* name );
+
+uint32_t profilerCyclesRead();
+void profilerSectionEnd( int sectionId, uint32_t startCycles );
+
+int profilerNumberOfSectionsRead();
+bool profilerStatsRead( int sectionId, profilerStats_t* stats );
+uint32_t profilerCyclesPerUsRead();
+void profilerStatsReset();
+
+//=====[#include guards - end]=================================================
+
+#endif // _PROFILER_H_
@@ -0,0 +1,216 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _RING_BUFFER_H_
+#define _RING_BUFFER_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include <atomic>
+
+//=====[Declaration of public defines]=======================================
+
+//=====[Declaration of public data types]======================================
+
+// Fixed capacity ring buffer that overwrites the oldest item when it is full.
+// Items are addressed by an absolute index that grows with every push, so a
+// consumer can keep its own cursor and detect the items it has lost. The slot
+// of the newest item is tracked apart from its index, so any N works, also
+// when the index wraps or starts from a persisted sequence number.
+template <typename T, uint32_t N>
+class RingBuffer {
+public:
+    class ConstIterator {
+    public:
+        ConstIterator( const RingBuffer* ringBuffer, uint32_t index )
+            : ringBuffer( ringBuffer ), index( index ) {}
+        const T& operator*() const { return ringBuffer->at( index ); }
+        const T* operator->() const { return &ringBuffer->at( index ); }
+        ConstIterator& operator++() { index++; return *this; }
+        bool operator!=( const ConstIterator& other ) const
+        {
+            return index != other.index;
+        }
+        uint32_t absoluteIndex() const { return index; }
+    private:
+        const RingBuffer* ringBuffer;
+        uint32_t index;
+    };
+
+    RingBuffer() : head( 0 ), headSlot( 0 ), count( 0 ) {}
+
+    // O(1) append, the oldest item is overwritten when the buffer is full
+    T& push( const T& item )
+    {
+        T& slot = items[headSlot];
+        slot = item;
+        head++;
+        headSlot++;
+        if ( headSlot == N ) {
+            headSlot = 0;
+        }
+        if ( count < N ) {
+            count++;
+        }
+        return slot;
+    }
+
+    // Empties the buffer, the next pushed item gets the given absolute index
+    void clear( uint32_t nextIndex = 0 )
+    {
+        head = nextIndex;
+        headSlot = 0;
+        count = 0;
+    }
+
+    uint32_t size() const { return count; }
+    uint32_t capacity() const { return N; }
+    bool isEmpty() const { return count == 0; }
+    bool isFull() const { return count == N; }
+
+    // Absolute index of the oldest stored item and one past the newest one
+    uint32_t oldestIndex() const { return head - count; }
+    uint32_t endIndex() const { return head; }
+
+    // Clamps a consumer cursor to the oldest item still stored
+    uint32_t firstIndex( uint32_t cursor ) const
+    {
+        return lost( cursor ) > 0 ? oldestIndex() : cursor;
+    }
+
+    // Number of items overwritten before a consumer at cursor could read them
+    uint32_t lost( uint32_t cursor ) const
+    {
+        int32_t distance = (int32_t)( oldestIndex() - cursor );
+        return distance > 0 ? (uint32_t) distance : 0;
+    }
+
+    // Only the indexes from oldestIndex() to endIndex() - 1 are stored
+    const T& at( uint32_t absoluteIndex ) const
+    {
+        uint32_t distance = head - absoluteIndex;
+
+        return items[headSlot >= distance ? headSlot - distance :
+                                            headSlot + N - distance];
+    }
+
+    // Position 0 is the oldest stored item
+    const T& operator[]( uint32_t position ) const
+    {
+        return at( oldestIndex() + position );
+    }
+
+    ConstIterator begin() const { return ConstIterator( this, oldestIndex() ); }
+    ConstIterator end() const { return ConstIterator( this, endIndex() ); }
+
+private:
+    T items[N];
+    uint32_t head;
+    uint32_t headSlot;
+    uint32_t count;
+};
+
+// Single producer single consumer variant. The producer (an ISR or another
+// thread) only writes head and the consumer only writes tail, so no lock is
+// needed. When it is full new items are dropped and counted as overflows.
+// The free running indexes wrap at 2^32, which only keeps their slots in
+// order when N divides 2^32.
+template <typename T, uint32_t N>
+class SpscRingBuffer {
+    static_assert( ( N > 0 ) && ( ( N & ( N - 1 ) ) == 0 ),
+                   "SpscRingBuffer size must be a power of two" );
+public:
+    SpscRingBuffer() : head( 0 ), tail( 0 ), overflows( 0 ), highWaterMark( 0 ) {}
+
+    // Producer side
+    bool push( const T& item )
+    {
+        uint32_t currentHead = head.load( std::memory_order_relaxed );
+        uint32_t used = currentHead - tail.load( std::memory_order_acquire );
+
+        if ( used >= N ) {
+            overflows++;
+            return false;
+        }
+        items[currentHead % N] = item;
+        head.store( currentHead + 1, std::memory_order_release );
+
+        if ( used + 1 > highWaterMark ) {
+            highWaterMark = used + 1;
+        }
+        return true;
+    }
+
+    // Consumer side
+    bool pop( T& item )
+    {
+        uint32_t currentTail = tail.load( std::memory_order_relaxed );
+
+        if ( currentTail == head.load( std::memory_order_acquire ) ) {
+            return false;
+        }
+        item = items[currentTail % N];
+        tail.store( currentTail + 1, std::memory_order_release );
+        return true;
+    }
+
+    // Consumer side, the item stays valid until it is popped or released
+    const T* peek( uint32_t offset = 0 ) const
+    {
+        uint32_t currentTail = tail.load( std::memory_order_relaxed );
+
+        if ( head.load( std::memory_order_acquire ) - currentTail <= offset ) {
+            return NULL;
+        }
+        return &items[( currentTail + offset ) % N];
+    }
+
+    // Consumer side, number of items from offset on that are stored one
+    // after the other, so they can be read in place through peek( offset )
+    uint32_t contiguousSize( uint32_t offset = 0 ) const
+    {
+        uint32_t used = size();
+        uint32_t slot;
+
+        if ( used <= offset ) {
+            return 0;
+        }
+        slot = ( tail.load( std::memory_order_relaxed ) + offset ) % N;
+        if ( used - offset < N - slot ) {
+            return used - offset;
+        }
+        return N - slot;
+    }
+
+    // Consumer side, drops the given number of items already peeked
+    void release( uint32_t numberOfItems )
+    {
+        tail.store( tail.load( std::memory_order_relaxed ) + numberOfItems,
+                    std::memory_order_release );
+    }
+
+    uint32_t size() const
+    {
+        return head.load( std::memory_order_acquire ) -
+               tail.load( std::memory_order_acquire );
+    }
+    uint32_t capacity() const { return N; }
+    bool isEmpty() const { return size() == 0; }
+
+    uint32_t overflowsRead() const { return overflows; }
+    uint32_t highWaterMarkRead() const { return highWaterMark; }
+
+private:
+    T items[N];
+    std::atomic<uint32_t> head;
+    std::atomic<uint32_t> tail;
+    volatile uint32_t overflows;
+    volatile uint32_t highWaterMark;
+};
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+//=====[#include guards - end]=================================================
+
+#endif // _RING_BUFFER_H_
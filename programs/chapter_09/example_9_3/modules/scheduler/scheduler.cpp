@@ -0,0 +1,279 @@
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+#include "arm_book_lib.h"
+
+#include "scheduler.h"
+
+#include "sapi.h"
+#include "profiler.h"
+
+#include <atomic>
+
+//=====[Declaration of private defines]========================================
+
+//=====[Declaration of private data types]=====================================
+
+typedef struct schedulerTask {
+    const char* name;
+    schedulerTaskFunction_t function;
+    tick_t periodMs;
+    tick_t nextDeadline;
+    int priority;
+    int group;
+    uint32_t runs;
+    uint32_t overruns;
+    tick_t maxJitterMs;
+    uint32_t maxDurationUs;
+    int profilerSectionId;
+} schedulerTask_t;
+
+//=====[Declaration and initialization of public global objects]===============
+
+//=====[Declaration of external public global variables]=======================
+
+//=====[Declaration and initialization of public global variables]=============
+
+//=====[Declaration and initialization of private global variables]============
+
+static schedulerTask_t schedulerTasks[SCHEDULER_MAX_TASKS];
+static int schedulerNumberOfTasks = 0;
+static int schedulerSelectedGroup = SCHEDULER_GROUP_MAIN;
+
+// The statistics of a group are only written by the thread that runs it. A
+// reset is a request that each group applies on its next update.
+static uint64_t schedulerStatsStartUs = 0;
+static uint64_t schedulerBusyTimeUs[SCHEDULER_NUMBER_OF_GROUPS];
+static std::atomic<bool> schedulerStatsResetRequested[SCHEDULER_NUMBER_OF_GROUPS];
+
+//=====[Declarations (prototypes) of private functions]========================
+
+static int schedulerNextDueTask( int group, tick_t currentTime );
+static void schedulerTaskRun( schedulerTask_t* task, tick_t currentTime );
+static void schedulerGroupStatsReset( int group );
+
+//=====[Implementations of public functions]===================================
+
+// Tasks run for the first time offsetMs after they are added, the offsets
+// spread tasks with the same period over different ticks. A lower priority
+// number wins when two tasks have the same deadline.
+int schedulerTaskAdd( const char* name, schedulerTaskFunction_t function,
+                      tick_t periodMs, tick_t offsetMs, int priority )
+{
+    schedulerTask_t* task;
+
+    if ( ( schedulerNumberOfTasks >= SCHEDULER_MAX_TASKS ) ||
+         ( periodMs == 0 ) ) {
+        return -1;
+    }
+
+    if ( schedulerNumberOfTasks == 0 ) {
+        schedulerStatsReset();
+    }
+
+    task = &schedulerTasks[schedulerNumberOfTasks];
+    task->name = name;
+    task->function = function;
+    task->periodMs = periodMs;
+    task->nextDeadline = tickRead() + offsetMs;
+    task->priority = priority;
+    task->group = schedulerSelectedGroup;
+    task->runs = 0;
+    task->overruns = 0;
+    task->maxJitterMs = 0;
+    task->maxDurationUs = 0;
+    task->profilerSectionId = profilerSectionAdd( name );
+
+    schedulerNumberOfTasks++;
+    return schedulerNumberOfTasks - 1;
+}
+
+// The new period applies from the next deadline already scheduled
+void schedulerTaskPeriodWrite( int taskId, tick_t periodMs )
+{
+    if ( ( taskId < 0 ) || ( taskId >= schedulerNumberOfTasks ) ||
+         ( periodMs == 0 ) ) {
+        return;
+    }
+    schedulerTasks[taskId].periodMs = periodMs;
+}
+
+// Tasks added from now on belong to the given group, all the tasks belong to
+// SCHEDULER_GROUP_MAIN unless another group is selected
+void schedulerTaskGroupSelect( int group )
+{
+    schedulerSelectedGroup = group;
+}
+
+void schedulerUpdate()
+{
+    schedulerGroupUpdate( SCHEDULER_GROUP_MAIN );
+}
+
+// Runs every task of the group whose deadline has passed, earliest deadline
+// first. Each task runs at most once per call.
+void schedulerGroupUpdate( int group )
+{
+    tick_t currentTime = tickRead();
+    int taskId;
+
+    if ( schedulerStatsResetRequested[group].load( std::memory_order_relaxed ) &&
+         schedulerStatsResetRequested[group].exchange( false ) ) {
+        schedulerGroupStatsReset( group );
+    }
+
+    taskId = schedulerNextDueTask( group, currentTime );
+    while ( taskId >= 0 ) {
+        schedulerTaskRun( &schedulerTasks[taskId], currentTime );
+        currentTime = tickRead();
+        taskId = schedulerNextDueTask( group, currentTime );
+    }
+}
+
+// Earliest deadline of the SCHEDULER_GROUP_MAIN tasks
+tick_t schedulerNextDeadlineRead()
+{
+    tick_t nextDeadline = SOFT_TIMER_NO_DEADLINE;
+    int i;
+
+    for ( i = 0; i < schedulerNumberOfTasks; i++ ) {
+        if ( ( schedulerTasks[i].group == SCHEDULER_GROUP_MAIN ) &&
+             ( schedulerTasks[i].nextDeadline < nextDeadline ) ) {
+            nextDeadline = schedulerTasks[i].nextDeadline;
+        }
+    }
+    return nextDeadline;
+}
+
+int schedulerNumberOfTasksRead()
+{
+    return schedulerNumberOfTasks;
+}
+
+bool schedulerTaskStatsRead( int taskId, schedulerTaskStats_t* stats )
+{
+    schedulerTask_t* task;
+
+    if ( ( taskId < 0 ) || ( taskId >= schedulerNumberOfTasks ) ) {
+        return false;
+    }
+
+    task = &schedulerTasks[taskId];
+    stats->name = task->name;
+    stats->periodMs = task->periodMs;
+    stats->priority = task->priority;
+    if ( schedulerStatsResetRequested[task->group] ) {
+        stats->runs = 0;
+        stats->overruns = 0;
+        stats->maxJitterMs = 0;
+        stats->maxDurationUs = 0;
+        return true;
+    }
+    stats->runs = task->runs;
+    stats->overruns = task->overruns;
+    stats->maxJitterMs = task->maxJitterMs;
+    stats->maxDurationUs = task->maxDurationUs;
+    return true;
+}
+
+// Percentage of the time since the last reset not spent running tasks
+int schedulerIdlePercentageRead()
+{
+    uint64_t elapsedUs = tickReadUs() - schedulerStatsStartUs;
+    uint64_t busyTimeUs = 0;
+    int group;
+
+    for ( group = 0; group < SCHEDULER_NUMBER_OF_GROUPS; group++ ) {
+        if ( !schedulerStatsResetRequested[group] ) {
+            busyTimeUs = busyTimeUs + schedulerBusyTimeUs[group];
+        }
+    }
+
+    if ( elapsedUs == 0 ) {
+        return 100;
+    }
+    if ( busyTimeUs > elapsedUs ) {
+        return 0;
+    }
+    return 100 - (int)( busyTimeUs * 100 / elapsedUs );
+}
+
+void schedulerStatsReset()
+{
+    int group;
+
+    for ( group = 0; group < SCHEDULER_NUMBER_OF_GROUPS; group++ ) {
+        schedulerStatsResetRequested[group] = true;
+    }
+    schedulerStatsStartUs = tickReadUs();
+}
+
+//=====[Implementations of private functions]==================================
+
+static int schedulerNextDueTask( int group, tick_t currentTime )
+{
+    schedulerTask_t* task;
+    int nextTaskId = -1;
+    int i;
+
+    for ( i = 0; i < schedulerNumberOfTasks; i++ ) {
+        task = &schedulerTasks[i];
+        if ( ( task->group != group ) || ( task->nextDeadline > currentTime ) ) {
+            continue;
+        }
+        if ( ( nextTaskId < 0 ) ||
+             ( task->nextDeadline < schedulerTasks[nextTaskId].nextDeadline ) ||
+             ( ( task->nextDeadline == schedulerTasks[nextTaskId].nextDeadline ) &&
+               ( task->priority < schedulerTasks[nextTaskId].priority ) ) ) {
+            nextTaskId = i;
+        }
+    }
+    return nextTaskId;
+}
+
+// The next deadline is one period after the previous one, not after the
+// run, so late runs do not shift the schedule. Whole periods that already
+// went by are skipped and counted as overruns.
+static void schedulerTaskRun( schedulerTask_t* task, tick_t currentTime )
+{
+    tick_t jitterMs = currentTime - task->nextDeadline;
+    tick_t missedPeriods = jitterMs / task->periodMs;
+    uint32_t startUs;
+    uint32_t durationUs;
+    uint32_t startCycles;
+
+    if ( jitterMs > task->maxJitterMs ) {
+        task->maxJitterMs = jitterMs;
+    }
+    task->overruns = task->overruns + missedPeriods;
+    task->nextDeadline = task->nextDeadline +
+                         ( missedPeriods + 1 ) * task->periodMs;
+
+    startUs = us_ticker_read();
+    startCycles = profilerCyclesRead();
+    task->function();
+    profilerSectionEnd( task->profilerSectionId, startCycles );
+    durationUs = us_ticker_read() - startUs;
+
+    task->runs++;
+    schedulerBusyTimeUs[task->group] = schedulerBusyTimeUs[task->group] +
+                                       durationUs;
+    if ( durationUs > task->maxDurationUs ) {
+        task->maxDurationUs = durationUs;
+    }
+}
+
+static void schedulerGroupStatsReset( int group )
+{
+    int i;
+
+    for ( i = 0; i < schedulerNumberOfTasks; i++ ) {
+        if ( schedulerTasks[i].group == group ) {
+            schedulerTasks[i].runs = 0;
+            schedulerTasks[i].overruns = 0;
+            schedulerTasks[i].maxJitterMs = 0;
+            schedulerTasks[i].maxDurationUs = 0;
+        }
+    }
+    schedulerBusyTimeUs[group] = 0;
+}
@@ -0,0 +1,52 @@
+//=====[#include guards - begin]===============================================
+
+#ifndef _SCHEDULER_H_
+#define _SCHEDULER_H_
+
+//=====[Libraries]=============================================================
+
+#include "mbed.h"
+
+#include "sapi.h"
+
+//=====[Declaration of public defines]=======================================
+
+#define SCHEDULER_MAX_TASKS   8
+
+// Tasks of different groups can be run from different threads
+#define SCHEDULER_GROUP_MAIN    0
+#define SCHEDULER_GROUP_ALARM   1
+#define SCHEDULER_NUMBER_OF_GROUPS   2
+
+//=====[Declaration of public data types]======================================
+
+typedef void (*schedulerTaskFunction_t)( void );
+
+typedef struct schedulerTaskStats {
+    const char* name;
+    tick_t periodMs;
+    int priority;
+    uint32_t runs;
+    uint32_t overruns;
+    tick_t maxJitterMs;
+    uint32_t maxDurationUs;
+} schedulerTaskStats_t;
+
+//=====[Declarations (prototypes) of public functions]=========================
+
+int schedulerTaskAdd( const char* name, schedulerTaskFunction_t function,
+                      tick_t periodMs, tick_t offsetMs, int priority );
+void schedulerTaskPeriodWrite( int taskId, tick_t periodMs );
+void schedulerTaskGroupSelect( int group );
+void schedulerUpdate();
+void schedulerGroupUpdate( int group );
+tick_t schedulerNextDeadlineRead();
+
+int schedulerNumberOfTasksRead();
+bool schedulerTaskStatsRead( int taskId, schedulerTaskStats_t* stats );
+int schedulerIdlePercentageRead();
+void schedulerStatsReset();
+
+//=====[#include guards - end]=================================================
+
+#endif // _SCHEDULER_H_
@@ -7,10 +7,14 @@
 
 #include "FATFileSystem.h"
 #include "SDBlockDevice.h"
+#include "SlicingBlockDevice.h"
 
 #include "platform/mbed_retarget.h"
 
+#include <errno.h>
+
 #include "event_log.h"
+#include "event_store.h"
 #include "date_and_time.h"
 #include "pc_serial_com.h"
 
@@ -22,13 +26,25 @@
 #define SPI3_SCK    D45   // PC_10
 #define SPI3_CS     D24   // PA_4_ALT0
 
+// FatFs drive of fs, the only FAT volume and so the first one mounted
+#define SD_CARD_FAT_DRIVE   "0:"
+
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of public global objects]===============
 
 SDBlockDevice sd( SPI3_MOSI, SPI3_MISO, SPI3_SCK, SPI3_CS );
 
+#if EVENT_STORE_RAW_ENABLED
+// The last EVENT_STORE_RAW_SIZE bytes of the card hold the raw event log,
+// the card must be formatted with a FAT volume that leaves them out
+SlicingBlockDevice sdFatPartition( &sd, 0, -EVENT_STORE_RAW_SIZE );
+SlicingBlockDevice sdRawPartition( &sd, -EVENT_STORE_RAW_SIZE );
+
+FATFileSystem fs("sd", &sdFatPartition);
+#else
 FATFileSystem fs("sd", &sd);
+#endif
 
 //=====[Declaration of external public global variables]=======================
 
@@ -38,16 +54,38 @@ FATFileSystem fs("sd", &sd);
 
 //=====[Declarations (prototypes) of private functions]========================
 
+static void sdCardFullPathBuild( const char* fileName, char* fileNameSD );
+
 //=====[Implementations of public functions]===================================
 
 bool sdCardInit()
 {
+    uint32_t sdCardRecoveryStartUs;
+    int recoveredEvents;
+
     pcSerialComStringWrite("Looking for a filesystem... \r\n");
+#if EVENT_STORE_RAW_ENABLED
+    fs.mount(&sdFatPartition);
+#else
     fs.mount(&sd);
+#endif
     DIR *dir = opendir("/sd/");
     if ( dir != NULL ) {
         pcSerialComStringWrite("Filesystem mounted. \r\n");
         closedir(dir);
+#if EVENT_STORE_RAW_ENABLED
+        if ( sdRawPartition.init() != 0 || !eventStoreInit( &sdRawPartition ) ) {
+            pcSerialComStringWrite("Raw event store not available. \r\n");
+        }
+#endif
+        sdCardRecoveryStartUs = us_ticker_read();
+        recoveredEvents = eventLogRecoverFromSdCard();
+        if ( recoveredEvents > 0 ) {
+            pcSerialComIntWrite( recoveredEvents );
+            pcSerialComStringWrite(" events recovered in ");
+            pcSerialComIntWrite( ( us_ticker_read() - sdCardRecoveryStartUs ) / 1000 );
+            pcSerialComStringWrite(" ms\r\n");
+        }
         return true;
     } else {
         pcSerialComStringWrite("Filesystem not mounted. \r\n");
@@ -57,80 +95,165 @@ bool sdCardInit()
     }
 }
 
-bool sdCardWriteFile( const char* fileName, const char* writeBuffer )
+// The file is then read with sdCardFileRead() in pieces of the caller's
+// size, so files of any size use constant memory
+bool sdCardReadFileStart( sdCardFile_t* file, const char* fileName )
 {
-    char fileNameSD[80];
-    
-    fileNameSD[0] = 0;
-    strncat( fileNameSD, "/sd/", strlen("/sd/") );
-    strncat( fileNameSD, fileName, strlen(fileName) );
-
-    FILE *fd = fopen( fileNameSD, "a" );
-
-    if ( fd != NULL ) {
-        fprintf( fd, "%s", writeBuffer );                       
-        fclose( fd );
+    if ( sdCardFileOpen( file, fileName, "r" ) ) {
+        pcSerialComStringWrite( "Opening file: /sd/" );
+        pcSerialComStringWrite( fileName );
+        pcSerialComStringWrite( "\r\n" );
         return true;
     } else {
+        pcSerialComStringWrite( "File not found\r\n" );
         return false;
     }
 }
 
-bool sdCardReadFile( const char * fileName, char * readBuffer )
+// Writes the whole block with a single open/write/close, fclose() also
+// updates the FAT directory entry so this is the only metadata update
+bool sdCardWriteFileBlock( const char* fileName, const void* buffer, 
+                           int length )
 {
-    char fileNameSD[80];
-    int i;
-    
-    fileNameSD[0] = 0;
-    strncat( fileNameSD, "/sd/", strlen("/sd/") );
-    strncat( fileNameSD, fileName, strlen(fileName) );
-    
-    FILE *fd = fopen( fileNameSD, "r" );
-    
-    if ( fd != NULL ) {
-        pcSerialComStringWrite( "Opening file: " );
-        pcSerialComStringWrite( fileNameSD );
-        pcSerialComStringWrite( "\r\n" );
+    sdCardFile_t file;
+    int bytesWritten;
 
-        i = 0;
-        while (!feof(fd)) {
-           fread( &readBuffer[i], 1, 1, fd );
-           i++;
-        }
-        fclose( fd );
-        return true;
-    } else {
-        pcSerialComStringWrite( "File not found\r\n" );
+    if ( !sdCardFileOpen( &file, fileName, "ab" ) ) {
+        return false;
+    }
+    bytesWritten = sdCardFileWrite( &file, buffer, length );
+    if ( !sdCardFileClose( &file ) ) {
         return false;
     }
+    return bytesWritten == length;
 }
 
-bool sdCardListFiles( char* fileNamesBuffer, int fileNamesBufferSize )
+bool sdCardFileOpen( sdCardFile_t* file, const char* fileName, 
+                     const char* mode )
 {
-    int bufferNumberUsedBytes = 0;
-    struct dirent *de;
+    char fileNameSD[SD_CARD_PATH_MAX_LENGTH];
 
-    DIR *dir = opendir("/sd/");
+    sdCardFullPathBuild( fileName, fileNameSD );
+    file->fd = fopen( fileNameSD, mode );
 
-    if ( dir != NULL ) {
-        pcSerialComStringWrite("Printing all filenames:\r\n");
-        de = readdir(dir);
-        
-        while ( ( de != NULL ) && 
-                ( bufferNumberUsedBytes + strlen(de->d_name) < 
-                    fileNamesBufferSize) ) {
-            strncat( fileNamesBuffer, de->d_name, strlen(de->d_name) );
-            strncat( fileNamesBuffer, "\r\n", strlen("\r\n") );
-            bufferNumberUsedBytes = bufferNumberUsedBytes + strlen(de->d_name);
-            de = readdir(dir);
-        }
-        
-        closedir(dir);
-        
-        return true;
-    } else {
-        pcSerialComStringWrite("Insert an SD card and ");
-        pcSerialComStringWrite("reset the board.\r\n");
+    return file->fd != NULL;
+}
+
+int sdCardFileRead( sdCardFile_t* file, void* buffer, int length )
+{
+    if ( file->fd == NULL ) {
+        return 0;
+    }
+    return fread( buffer, 1, length, file->fd );
+}
+
+int sdCardFileWrite( sdCardFile_t* file, const void* buffer, int length )
+{
+    if ( file->fd == NULL ) {
+        return 0;
+    }
+    return fwrite( buffer, 1, length, file->fd );
+}
+
+bool sdCardFileSeek( sdCardFile_t* file, long offset )
+{
+    if ( file->fd == NULL ) {
+        return false;
+    }
+    return fseek( file->fd, offset, SEEK_SET ) == 0;
+}
+
+// Leaves the file position at the end of the file
+long sdCardFileSize( sdCardFile_t* file )
+{
+    if ( ( file->fd == NULL ) || ( fseek( file->fd, 0, SEEK_END ) != 0 ) ) {
+        return -1;
+    }
+    return ftell( file->fd );
+}
+
+bool sdCardFileClose( sdCardFile_t* file )
+{
+    int result;
+
+    if ( file->fd == NULL ) {
+        return false;
+    }
+    result = fclose( file->fd );
+    file->fd = NULL;
+
+    return result == 0;
+}
+
+bool sdCardFileRemove( const char* fileName )
+{
+    char fileNameSD[SD_CARD_PATH_MAX_LENGTH];
+
+    sdCardFullPathBuild( fileName, fileNameSD );
+    return remove( fileNameSD ) == 0;
+}
+
+// The directory is read through FatFs, as readdir() only gives the names and
+// a stat() of each of them would search the whole directory again. Like
+// every SD card access it must only be made from the main loop. An empty
+// name opens the root directory.
+bool sdCardDirOpen( sdCardDir_t* dir, const char* dirName )
+{
+    char dirNameFat[SD_CARD_PATH_MAX_LENGTH];
+
+    snprintf( dirNameFat, sizeof(dirNameFat), SD_CARD_FAT_DRIVE "/%s",
+              dirName );
+    dir->open = f_opendir( &dir->dir, dirNameFat ) == FR_OK;
+    return dir->open;
+}
+
+// Reads one directory entry per call, its size and date come with it, so a
+// listing uses constant memory and time proportional to the number of
+// entries. The modification time is 0 if the entry has no date.
+bool sdCardDirNext( sdCardDir_t* dir, sdCardDirEntry_t* entry )
+{
+    FILINFO fileInfo;
+
+    if ( !dir->open || ( f_readdir( &dir->dir, &fileInfo ) != FR_OK ) ||
+         ( fileInfo.fname[0] == '\0' ) ) {
         return false;
     }
+
+    snprintf( entry->name, sizeof(entry->name), "%s", fileInfo.fname );
+    entry->size = fileInfo.fsize;
+    entry->isDirectory = ( fileInfo.fattrib & AM_DIR ) != 0;
+    entry->mtime = 0;
+    if ( fileInfo.fdate != 0 ) {
+        entry->mtime = dateAndTimeToSeconds( ( fileInfo.fdate >> 9 ) + 1980,
+                                             ( fileInfo.fdate >> 5 ) & 0x0F,
+                                             fileInfo.fdate & 0x1F,
+                                             fileInfo.ftime >> 11,
+                                             ( fileInfo.ftime >> 5 ) & 0x3F,
+                                             ( fileInfo.ftime & 0x1F ) * 2 );
+    }
+    return true;
+}
+
+void sdCardDirClose( sdCardDir_t* dir )
+{
+    if ( dir->open ) {
+        f_closedir( &dir->dir );
+        dir->open = false;
+    }
+}
+
+// Succeeds if the directory already exists
+bool sdCardDirCreate( const char* dirName )
+{
+    char dirNameSD[SD_CARD_PATH_MAX_LENGTH];
+
+    sdCardFullPathBuild( dirName, dirNameSD );
+    return ( mkdir( dirNameSD, 0777 ) == 0 ) || ( errno == EEXIST );
+}
+
+//=====[Implementations of private functions]==================================
+
+static void sdCardFullPathBuild( const char* fileName, char* fileNameSD )
+{
+    snprintf( fileNameSD, SD_CARD_PATH_MAX_LENGTH, "/sd/%s", fileName );
 }
@@ -5,19 +5,53 @@
 
 //=====[Libraries]=============================================================
 
+#include "mbed.h"
+#include "FATFileSystem.h"
+
 #define SD_CARD_FILENAME_MAX_LENGTH 32
 
 //=====[Declaration of public defines]=======================================
 
+#define SD_CARD_PATH_MAX_LENGTH     80
+
 //=====[Declaration of public data types]======================================
 
+typedef struct sdCardFile {
+    FILE* fd;
+} sdCardFile_t;
+
+typedef struct sdCardDir {
+    bool open;
+    FATFS_DIR dir;
+} sdCardDir_t;
+
+typedef struct sdCardDirEntry {
+    char name[SD_CARD_PATH_MAX_LENGTH];
+    long size;
+    time_t mtime;
+    bool isDirectory;
+} sdCardDirEntry_t;
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 bool sdCardInit();
-bool sdCardWriteFile( const char* fileName, const char* writeBuffer );
-bool sdCardReadFile( const char * fileName, char * readBuffer );
-bool sdCardListFiles( char* fileNamesBuffer, int fileNamesBufferSize );
-
+bool sdCardReadFileStart( sdCardFile_t* file, const char* fileName );
+bool sdCardWriteFileBlock( const char* fileName, const void* buffer, 
+                           int length );
+
+bool sdCardFileOpen( sdCardFile_t* file, const char* fileName, 
+                     const char* mode );
+int sdCardFileRead( sdCardFile_t* file, void* buffer, int length );
+int sdCardFileWrite( sdCardFile_t* file, const void* buffer, int length );
+bool sdCardFileSeek( sdCardFile_t* file, long offset );
+long sdCardFileSize( sdCardFile_t* file );
+bool sdCardFileClose( sdCardFile_t* file );
+bool sdCardFileRemove( const char* fileName );
+
+bool sdCardDirOpen( sdCardDir_t* dir, const char* dirName );
+bool sdCardDirNext( sdCardDir_t* dir, sdCardDirEntry_t* entry );
+void sdCardDirClose( sdCardDir_t* dir );
+bool sdCardDirCreate( const char* dirName );
 
 //=====[#include guards - end]=================================================
 
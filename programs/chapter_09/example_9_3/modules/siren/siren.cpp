@@ -7,9 +7,12 @@
 
 #include "smart_home_system.h"
 #include "fire_alarm.h"
+#include "scheduler.h"
 
 //=====[Declaration of private defines]======================================
 
+#define SIREN_DEFAULT_BLINK_TIME_MS   100
+
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of public global objects]===============
@@ -23,14 +26,20 @@ DigitalOut alarmLed(LED1);
 //=====[Declaration and initialization of private global variables]============
 
 static bool sirenState = OFF;
+static int sirenBlinkTime = SIREN_DEFAULT_BLINK_TIME_MS;
+static int sirenTaskId = -1;
 
 //=====[Declarations (prototypes) of private functions]========================
 
+static void sirenIndicatorUpdate();
+
 //=====[Implementations of public functions]===================================
 
 void sirenInit()
 {
     alarmLed = OFF;
+    sirenTaskId = schedulerTaskAdd( "siren", sirenIndicatorUpdate,
+                                    sirenBlinkTime, 0, 1 );
 }
 
 bool sirenStateRead()
@@ -41,22 +50,29 @@ bool sirenStateRead()
 void sirenStateWrite( bool state )
 {
     sirenState = state;
+    if ( !sirenState ) {
+        alarmLed = OFF;
+    }
+}
+
+// The blink time is the period of the siren task, 0 keeps the current one
+void sirenBlinkTimeWrite( int blinkTime )
+{
+    if ( ( blinkTime > 0 ) && ( blinkTime != sirenBlinkTime ) ) {
+        sirenBlinkTime = blinkTime;
+        schedulerTaskPeriodWrite( sirenTaskId, sirenBlinkTime );
+    }
 }
 
-void sirenIndicatorUpdate( int blinkTime )
+//=====[Implementations of private functions]==================================
+
+// Scheduled every blink time
+static void sirenIndicatorUpdate()
 {
-    static int accumulatedTimeAlarm = 0;
-    accumulatedTimeAlarm = accumulatedTimeAlarm + SYSTEM_TIME_INCREMENT_MS;
-    
     if( sirenState ) {
-        if( accumulatedTimeAlarm >= blinkTime ) {
-            accumulatedTimeAlarm = 0;
-            alarmLed = !alarmLed;
-        }
+        alarmLed = !alarmLed;
     } else {
         alarmLed = OFF;
     }
 }
 
-//=====[Implementations of private functions]==================================
-
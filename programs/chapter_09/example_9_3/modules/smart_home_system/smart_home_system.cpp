@@ -12,46 +12,173 @@
 #include "sd_card.h"
 #include "sapi.h"
 #include "wifi_com.h"
+#include "scheduler.h"
+#include "wifi_module.h"
+#include "profiler.h"
 
 //=====[Declaration of private defines]======================================
 
+#define SMART_HOME_SYSTEM_ALARM_THREAD_STACK_SIZE   4096
+#define SMART_HOME_SYSTEM_WAKE_UP_FLAG              0x01
+#define SMART_HOME_SYSTEM_MAX_WAIT_MS               1000
+
 //=====[Declaration of private data types]=====================================
 
 //=====[Declaration and initialization of public global objects]===============
 
+//=====[Declaration and initialization of private global objects]==============
+
+#if SMART_HOME_SYSTEM_THREADED
+// The alarm runs with a hard period in its own thread, so a blocking SD
+// card, UART or display operation in the main thread cannot delay it
+static Thread alarmThread( osPriorityRealtime,
+                           SMART_HOME_SYSTEM_ALARM_THREAD_STACK_SIZE,
+                           NULL, "alarm" );
+static EventQueue alarmQueue( 4 * EVENTS_EVENT_SIZE );
+static EventFlags wakeUpFlags;
+#endif
+
 //=====[Declaration of external public global variables]=======================
 
 //=====[Declaration and initialization of public global variables]=============
 
-char systemBuffer[EVENT_STR_LENGTH*EVENT_LOG_MAX_STORAGE];
-static delay_t smartHomeSystemDelay;
 
 //=====[Declaration and initialization of private global variables]============
 
+static int pcSerialComProfilerSectionId = -1;
+static int wifiComProfilerSectionId = -1;
+static uint32_t loopIterations = 0;
+
 //=====[Declarations (prototypes) of private functions]========================
 
+static void smartHomeSystemAlarmUpdate();
+static void smartHomeSystemIdle();
+#if SMART_HOME_SYSTEM_THREADED
+static void smartHomeSystemAlarmGroupUpdate();
+static void smartHomeSystemWakeUp( void* params );
+#endif
+
 //=====[Implementations of public functions]===================================
 
 void smartHomeSystemInit()
 {
     tickInit(1);          // Set 1 ms tick counter
+    profilerInit();
     userInterfaceInit();
-    fireAlarmInit();
+
     pcSerialComInit();
     sdCardInit();
+    // Without the connection only the 'd' command talks to the module, a
+    // board with no ESP8266 fitted would otherwise reset it every 10 s
+#if SMART_HOME_SYSTEM_WIFI_CONNECT
     wifiComInit();
-    delayInit( &smartHomeSystemDelay, SYSTEM_TIME_INCREMENT_MS );
+#else
+    wifiModuleInit();
+#endif
+    schedulerTaskAdd( "ui", userInterfaceUpdate, SYSTEM_TIME_INCREMENT_MS,
+                      3, 2 );
+    schedulerTaskAdd( "event log", eventLogUpdate, SYSTEM_TIME_INCREMENT_MS,
+                      6, 3 );
+    pcSerialComProfilerSectionId = profilerSectionAdd( "pc serial" );
+    wifiComProfilerSectionId = profilerSectionAdd( "wifi" );
+
+    // The alarm tasks are added last, their first deadlines would otherwise
+    // be missed while the SD card is mounted and the journal recovered
+#if SMART_HOME_SYSTEM_THREADED
+    schedulerTaskGroupSelect( SCHEDULER_GROUP_ALARM );
+#endif
+    fireAlarmInit();
+    schedulerTaskAdd( "alarm", smartHomeSystemAlarmUpdate,
+                      SYSTEM_TIME_INCREMENT_MS, 0, 0 );
+    schedulerTaskGroupSelect( SCHEDULER_GROUP_MAIN );
+
+#if SMART_HOME_SYSTEM_THREADED
+    tickWakeUpCallbackSet( smartHomeSystemWakeUp, NULL );
+    // The first run is due now, the periodic ones start a period later
+    alarmQueue.call( smartHomeSystemAlarmGroupUpdate );
+    alarmQueue.call_every( SYSTEM_TIME_INCREMENT_MS,
+                           smartHomeSystemAlarmGroupUpdate );
+    alarmThread.start( callback( &alarmQueue, &EventQueue::dispatch_forever ) );
+#endif
 }
 
 void smartHomeSystemUpdate()
 {
-    if( delayRead(&smartHomeSystemDelay) ) {
-        userInterfaceUpdate();
-        fireAlarmUpdate();
-        eventLogUpdate();
-    }
+    uint32_t startCycles;
+
+    softTimerUpdate();
+    schedulerUpdate();
+
+    startCycles = profilerCyclesRead();
     pcSerialComUpdate();
+    profilerSectionEnd( pcSerialComProfilerSectionId, startCycles );
+
+    startCycles = profilerCyclesRead();
+#if SMART_HOME_SYSTEM_WIFI_CONNECT
     wifiComUpdate();
+#else
+    wifiModuleUpdate();
+#endif
+    profilerSectionEnd( wifiComProfilerSectionId, startCycles );
+
+    smartHomeSystemIdle();
+    loopIterations++;
+}
+
+uint32_t smartHomeSystemLoopIterationsRead()
+{
+    return loopIterations;
+}
+
+void smartHomeSystemLoopIterationsReset()
+{
+    loopIterations = 0;
 }
 
 //=====[Implementations of private functions]==================================
+
+static void smartHomeSystemAlarmUpdate()
+{
+    fireAlarmUpdate();
+    eventLogAlarmStatesCapture();
+}
+
+// Sleeps until the next task deadline or soft timer expiry, a received
+// character ends the sleep earlier. When threaded the main thread blocks
+// instead, so the alarm thread can run, and the RTOS idle thread sleeps.
+static void smartHomeSystemIdle()
+{
+    tick_t nextDeadline = schedulerNextDeadlineRead();
+    tick_t timerDeadline = softTimerNextDeadlineRead();
+
+    if ( timerDeadline < nextDeadline ) {
+        nextDeadline = timerDeadline;
+    }
+    if ( pcSerialComCharAvailable() || wifiModuleCharAvailable() ) {
+        return;
+    }
+#if SMART_HOME_SYSTEM_THREADED
+    tick_t currentTime = tickRead();
+    if ( nextDeadline > currentTime ) {
+        if ( nextDeadline - currentTime > SMART_HOME_SYSTEM_MAX_WAIT_MS ) {
+            nextDeadline = currentTime + SMART_HOME_SYSTEM_MAX_WAIT_MS;
+        }
+        wakeUpFlags.wait_any( SMART_HOME_SYSTEM_WAKE_UP_FLAG,
+                              (uint32_t)( nextDeadline - currentTime ) );
+    }
+#else
+    tickSleepUntil( nextDeadline );
+#endif
+}
+
+#if SMART_HOME_SYSTEM_THREADED
+static void smartHomeSystemAlarmGroupUpdate()
+{
+    schedulerGroupUpdate( SCHEDULER_GROUP_ALARM );
+}
+
+static void smartHomeSystemWakeUp( void* params )
+{
+    wakeUpFlags.set( SMART_HOME_SYSTEM_WAKE_UP_FLAG );
+}
+#endif
@@ -5,16 +5,32 @@
 
 //=====[Libraries]=============================================================
 
+#include "mbed.h"
+
 //=====[Declaration of public defines]=======================================
 
 #define SYSTEM_TIME_INCREMENT_MS   10
 
+#ifdef MBED_CONF_APP_THREADED
+#define SMART_HOME_SYSTEM_THREADED   MBED_CONF_APP_THREADED
+#else
+#define SMART_HOME_SYSTEM_THREADED   0
+#endif
+
+#ifdef MBED_CONF_APP_WIFI_CONNECT
+#define SMART_HOME_SYSTEM_WIFI_CONNECT   MBED_CONF_APP_WIFI_CONNECT
+#else
+#define SMART_HOME_SYSTEM_WIFI_CONNECT   0
+#endif
+
 //=====[Declaration of public data types]======================================
 
 //=====[Declarations (prototypes) of public functions]=========================
 
 void smartHomeSystemInit();
 void smartHomeSystemUpdate();
+uint32_t smartHomeSystemLoopIterationsRead();
+void smartHomeSystemLoopIterationsReset();
 
 //=====[#include guards - end]=================================================
 
@@ -5,6 +5,7 @@
 #include "temperature_sensor.h"
 
 #include "smart_home_system.h"
+#include "scheduler.h"
 
 //=====[Declaration of private defines]======================================
 
@@ -35,41 +36,37 @@ static void shiftLm35AvgReadingsArray();
 
 void temperatureSensorInit()
 {
-    return;
+    schedulerTaskAdd( "lm35", temperatureSensorUpdate, LM35_SAMPLE_TIME,
+                      1, 1 );
 }
 
+// Scheduled every LM35_SAMPLE_TIME ms
 void temperatureSensorUpdate()
 {
-    static int accumulatedTimeLm35 = 0;
     static int lm35SampleIndex     = 0;
     static float lm35ReadingsMovingAverage = 0.0;
 
-    accumulatedTimeLm35 = accumulatedTimeLm35 + SYSTEM_TIME_INCREMENT_MS;
+    if ( lm35SampleIndex < LM35_NUMBER_OF_AVG_SAMPLES ) {
+        lm35AvgReadingsArray[lm35SampleIndex] = lm35.read() / 
+                                                LM35_NUMBER_OF_AVG_SAMPLES;
+        lm35ReadingsMovingAverage = lm35ReadingsMovingAverage +
+                                    lm35AvgReadingsArray[lm35SampleIndex];
+        lm35SampleIndex++;
+    } else {
+        lm35ReadingsMovingAverage = lm35ReadingsMovingAverage -
+                                    lm35AvgReadingsArray[0];
 
-    if ( accumulatedTimeLm35 >= LM35_SAMPLE_TIME ) {
-        if ( lm35SampleIndex < LM35_NUMBER_OF_AVG_SAMPLES ) {
-            lm35AvgReadingsArray[lm35SampleIndex] = lm35.read() / 
-                                                    LM35_NUMBER_OF_AVG_SAMPLES;
-            lm35ReadingsMovingAverage = lm35ReadingsMovingAverage +
-                                        lm35AvgReadingsArray[lm35SampleIndex];
-            lm35SampleIndex++;
-        } else {
-            lm35ReadingsMovingAverage = lm35ReadingsMovingAverage -
-                                        lm35AvgReadingsArray[0];
+        shiftLm35AvgReadingsArray();
 
-            shiftLm35AvgReadingsArray();
+        lm35AvgReadingsArray[LM35_NUMBER_OF_AVG_SAMPLES-1] =
+            lm35.read() / LM35_NUMBER_OF_AVG_SAMPLES;
 
-            lm35AvgReadingsArray[LM35_NUMBER_OF_AVG_SAMPLES-1] =
-                lm35.read() / LM35_NUMBER_OF_AVG_SAMPLES;
+        lm35ReadingsMovingAverage =
+            lm35ReadingsMovingAverage +
+            lm35AvgReadingsArray[LM35_NUMBER_OF_AVG_SAMPLES-1];
 
-            lm35ReadingsMovingAverage =
-                lm35ReadingsMovingAverage +
-                lm35AvgReadingsArray[LM35_NUMBER_OF_AVG_SAMPLES-1];
-
-            lm35TemperatureC = analogReadingScaledWithTheLM35Formula(
-                            lm35ReadingsMovingAverage );
-        }
-        accumulatedTimeLm35 = 0;
+        lm35TemperatureC = analogReadingScaledWithTheLM35Formula(
+                        lm35ReadingsMovingAverage );
     }
 }
 
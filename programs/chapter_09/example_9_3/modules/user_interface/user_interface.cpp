@@ -15,6 +15,9 @@
 #include "matrix_keypad.h"
 #include "display.h"
 #include "GLCD_fire_alarm.h"
+#include "scheduler.h"
+
+#include <atomic>
 
 //=====[Declaration of private defines]======================================
 
@@ -44,11 +47,14 @@ char codeSequenceFromUserInterface[CODE_NUMBER_OF_KEYS];
 static displayState_t displayState = DISPLAY_REPORT_STATE;
 static int displayAlarmGraphicSequence = 0;
 static int displayRefreshTimeMs = DISPLAY_REFRESH_TIME_REPORT_MS;
+static int displayTaskId = -1;
 
-static bool incorrectCodeState = OFF;
-static bool systemBlockedState = OFF;
+// Shared with the alarm task, which may run in another thread. The code
+// characters are written before codeComplete is set.
+static std::atomic<bool> incorrectCodeState( OFF );
+static std::atomic<bool> systemBlockedState( OFF );
 
-static bool codeComplete = false;
+static std::atomic<bool> codeComplete( false );
 static int numberOfCodeChars = 0;
 
 //=====[Declarations (prototypes) of private functions]========================
@@ -70,7 +76,7 @@ void userInterfaceInit()
 {
     incorrectCodeLed = OFF;
     systemBlockedLed = OFF;
-    matrixKeypadInit( SYSTEM_TIME_INCREMENT_MS );
+    matrixKeypadInit();
     userInterfaceDisplayInit();
 }
 
@@ -79,7 +85,6 @@ void userInterfaceUpdate()
     userInterfaceMatrixKeypadUpdate();
     incorrectCodeIndicatorUpdate();
     systemBlockedIndicatorUpdate();
-    userInterfaceDisplayUpdate();
 }
 
 bool incorrectCodeStateRead()
@@ -148,11 +153,11 @@ static void userInterfaceDisplayReportStateInit()
 {
     displayState = DISPLAY_REPORT_STATE;
     displayRefreshTimeMs = DISPLAY_REFRESH_TIME_REPORT_MS;
+    schedulerTaskPeriodWrite( displayTaskId, displayRefreshTimeMs );
     
     displayModeWrite( DISPLAY_MODE_CHAR );
 
     displayCommandWrite(DISPLAY_CMD_CLEAR);
-    delay(2);
 
     displayCharPositionWrite ( 0,0 );
     displayStringWrite( "Temperature:" );
@@ -166,9 +171,10 @@ static void userInterfaceDisplayReportStateInit()
 
 static void userInterfaceDisplayReportStateUpdate()
 {
-    char temperatureString[2];
+    char temperatureString[4];
     
-    sprintf(temperatureString, "%.0f", temperatureSensorReadCelsius());
+    snprintf(temperatureString, sizeof(temperatureString), "%.0f",
+             temperatureSensorReadCelsius());
     displayCharPositionWrite ( 12,0 );
     displayStringWrite( temperatureString );
     displayCharPositionWrite ( 14,0 );
@@ -189,9 +195,9 @@ static void userInterfaceDisplayAlarmStateInit()
 {
     displayState = DISPLAY_ALARM_STATE;
     displayRefreshTimeMs = DISPLAY_REFRESH_TIME_ALARM_MS;
+    schedulerTaskPeriodWrite( displayTaskId, displayRefreshTimeMs );
 
     displayCommandWrite(DISPLAY_CMD_CLEAR);
-    delay(2);
 
     displayModeWrite( DISPLAY_MODE_GRAPHIC );
    
@@ -230,43 +236,34 @@ static void userInterfaceDisplayInit()
                         16, 4,
                         8, 16,
                         128, 64 );
+    displayTaskId = schedulerTaskAdd( "display", userInterfaceDisplayUpdate,
+                                      displayRefreshTimeMs, 5, 4 );
     userInterfaceDisplayReportStateInit();
 }
 
+// Scheduled every displayRefreshTimeMs
 static void userInterfaceDisplayUpdate()
 {
-    static int accumulatedDisplayTime = 0;
-    
-    if( accumulatedDisplayTime >=
-        displayRefreshTimeMs ) {
-
-        accumulatedDisplayTime = 0;
-
-        switch ( displayState ) {
-            case DISPLAY_REPORT_STATE:
-                userInterfaceDisplayReportStateUpdate();
+    switch ( displayState ) {
+        case DISPLAY_REPORT_STATE:
+            userInterfaceDisplayReportStateUpdate();
 
-                if ( sirenStateRead() ) {
-                    userInterfaceDisplayAlarmStateInit();
-                }
-            break;
-
-            case DISPLAY_ALARM_STATE:
-                userInterfaceDisplayAlarmStateUpdate();
+            if ( sirenStateRead() ) {
+                userInterfaceDisplayAlarmStateInit();
+            }
+        break;
 
-                if ( !sirenStateRead() ) {
-                    userInterfaceDisplayReportStateInit();
-                }
-            break;
+        case DISPLAY_ALARM_STATE:
+            userInterfaceDisplayAlarmStateUpdate();
 
-            default:
+            if ( !sirenStateRead() ) {
                 userInterfaceDisplayReportStateInit();
-            break;
-        }
+            }
+        break;
 
-   } else {
-        accumulatedDisplayTime =
-            accumulatedDisplayTime + SYSTEM_TIME_INCREMENT_MS;        
+        default:
+            userInterfaceDisplayReportStateInit();
+        break;
     }
 }
 
@@ -8,13 +8,14 @@
 
 //=====[Declaration of private defines]========================================
 
+#define WIFI_COM_RETRY_TIME_MS   10000
+
 //=====[Declaration of private data types]=====================================
 
 typedef enum{
     WIFI_STATE_MODULE_DETECT,
     WIFI_STATE_MODULE_NOT_DETECTED,
-    WIFI_STATE_MODULE_INIT,
-    WIFI_STATE_MODULE_CHECK_AP_CONNECTION,
+    WIFI_STATE_MODULE_RESET,
     WIFI_STATE_MODULE_NOT_CONNECTED,
     WIFI_STATE_COMMUNICATION,
 } wifiFsmComState_t;
@@ -28,16 +29,22 @@ typedef enum{
 //=====[Declaration and initialization of private global variables]============
 
 static wifiFsmComState_t wifiComFsmState;
+static delay_t wifiComRetryDelay;
+static uint64_t wifiComStartUs = 0;
 
 //=====[Declarations (prototypes) of private functions]========================
 
-static void runStateWifiModuleDetect();
-static void runStateWifiModuleNotDetected();
-
-static void runStateWifiModuleInit();
+static void wifiComConnectionStart();
+static void wifiComModuleResetStart();
+static void wifiComModuleNotDetectedEnter();
+static void wifiComModuleNotConnectedEnter();
 
-static void runStateWifiModuleCheckAPConnection();
-static void runStateWifiModuleNotConnected();
+static void wifiComModuleDetected( wifiModuleRequestResult_t result );
+static void wifiComModuleReset( wifiModuleRequestResult_t result );
+static void wifiComModuleInitialized( wifiModuleRequestResult_t result );
+static void wifiComAPConnectionChecked( wifiModuleRequestResult_t result );
+static void wifiComAPConnected( wifiModuleRequestResult_t result );
+static void wifiComIpReceived( wifiModuleRequestResult_t result );
 
 //=====[Implementations of public functions]===================================
 
@@ -45,300 +52,163 @@ static void runStateWifiModuleNotConnected();
 
 void wifiComInit()
 {
-    wifiComFsmState = WIFI_STATE_MODULE_DETECT;
     wifiModuleInit();
+    wifiComConnectionStart();
 }
 
+// The transitions are made by the result handlers, called from
+// wifiModuleUpdate(). Only the retries are timed here.
 void wifiComUpdate()
-{/*
+{
+    wifiModuleUpdate();
+
     switch ( wifiComFsmState ) {
-        case WIFI_STATE_MODULE_DETECT: 
-            runStateWifiModuleDetect();
-        break;
         case WIFI_STATE_MODULE_NOT_DETECTED:
-            runStateWifiModuleNotDetected();
-        break;
-        case WIFI_STATE_MODULE_INIT:
-            runStateWifiModuleInit();
-        break;
-        case WIFI_STATE_MODULE_CHECK_AP_CONNECTION:
-            runStateWifiModuleCheckAPConnection();
-        break;
         case WIFI_STATE_MODULE_NOT_CONNECTED:
-            runStateWifiModuleNotConnected();
+            if( delayRead( &wifiComRetryDelay ) ) {
+                wifiComModuleResetStart();
+            }
         break;
+        case WIFI_STATE_MODULE_DETECT:
+        case WIFI_STATE_MODULE_RESET:
         case WIFI_STATE_COMMUNICATION:
-            runStateWifiCommunication();
         break;
         default:
-            wifiComFsmState = WIFI_STATE_MODULE_DETECT;
+            wifiComConnectionStart();
         break;
-    }*/
+    }
 }
 
 //=====[Implementations of private functions]==================================
 
-// En este estado si detecta el modulo pasa al estado 
-// WIFI_STATE_MODULE_INIT.
-// Si no pasa al estado: WIFI_STATE_MODULE_NOT_DETECTED
-static void runStateWifiModuleDetect()
+// The detection, the initialization and the connection check are queued at
+// once and the module sends them back to back
+static void wifiComConnectionStart()
 {
-    static bool stateEntryFlag = false;
-    // ENTRY ----------------------------------------
-    if( stateEntryFlag == false ){
-        if( wifiModuleStartDetection() != WIFI_MODULE_DETECTION_STARTED ){
-            return;
-        }
-        stateEntryFlag = true;
-    }
+    wifiComFsmState = WIFI_STATE_MODULE_DETECT;
+    wifiComStartUs = tickReadUs();
+    wifiModuleStartDetection( wifiComModuleDetected );
+    wifiModuleStartInit( wifiComModuleInitialized );
+    wifiModuleStartIsConnectedWithAP( wifiComAPConnectionChecked );
+}
 
-    // CHECK TRANSITION CONDITIONS ------------------
-    switch( wifiModuleDetectionResponse() ) {
-        case WIFI_MODULE_DETECTED:
-            wifiComFsmState = WIFI_STATE_MODULE_INIT;
-            pcSerialComStringWrite( "Wi-Fi module detected.\r\n" );
-        break;
-        case WIFI_MODULE_NOT_DETECTED:
-            wifiComFsmState = WIFI_STATE_MODULE_NOT_DETECTED;
-        break;
-        case WIFI_MODULE_BUSY: // Module busy, not do anything
-        default:
-        break;
+// A failed reset goes back to WIFI_STATE_MODULE_NOT_DETECTED
+static void wifiComModuleResetStart()
+{
+    pcSerialComStringWrite( "Reseting Wi-Fi module..\r\n" );
+    if( wifiModuleStartReset( wifiComModuleReset ) ==
+        WIFI_MODULE_RESET_STARTED ) {
+        wifiComFsmState = WIFI_STATE_MODULE_RESET;
     }
+}
 
-    // EXIT ------------------------------------------
-    if( wifiComFsmState != WIFI_STATE_MODULE_DETECT ){
-        stateEntryFlag = false;
-    }
+// Pending requests are dropped and the module is reset after
+// WIFI_COM_RETRY_TIME_MS
+static void wifiComModuleNotDetectedEnter()
+{
+    wifiModulePendingRequestsCancel();
+    pcSerialComStringWrite( "\r\nERROR: Wi-Fi module not detected!\r\n" );
+    pcSerialComStringWrite( "It will re-intent automaticaly in 10 seconds...\r\n" );
+    delayInit( &wifiComRetryDelay, WIFI_COM_RETRY_TIME_MS );
+    wifiComFsmState = WIFI_STATE_MODULE_NOT_DETECTED;
 }
 
-// En este estado reintenta detectar el módulo Wi-Fi cada 10 segundos (lo resetea).
-// Cuando lo detecta pasa al estado WIFI_STATE_MODULE_INIT
-static void runStateWifiModuleNotDetected()
+static void wifiComModuleNotConnectedEnter()
 {
-    static bool stateEntryFlag = false;
-    static bool resetSended = false;
-    static delay_t reintentsDelay;
-    // ENTRY ----------------------------------------
-    if( stateEntryFlag == false ) {
-        pcSerialComStringWrite( "\r\nERROR: Wi-Fi module not detected!\r\n" );
-        pcSerialComStringWrite( "It will re-intent automaticaly in 10 seconds...\r\n" );
-        delayInit( &reintentsDelay, 10000 );
-        stateEntryFlag = true;
-    }
+    pcSerialComStringWrite( "Wi-Fi not connected!\r\n" );
+    pcSerialComStringWrite( "It will re-intent automaticaly in 10 " );
+    pcSerialComStringWrite( "seconds\r\nafter reseting the module...\r\n" );
+    delayInit( &wifiComRetryDelay, WIFI_COM_RETRY_TIME_MS );
+    wifiComFsmState = WIFI_STATE_MODULE_NOT_CONNECTED;
+}
 
-    // CHECK TRANSITION CONDITIONS ------------------
-    if( delayRead(&reintentsDelay) && !resetSended ) {
-        pcSerialComStringWrite( "Reseting Wi-Fi module..\r\n" );
-        if( wifiModuleStartReset() == WIFI_MODULE_RESET_STARTED ) {
-            resetSended = true;
-        }
-    }
-    if ( resetSended ) {            
-        switch( wifiModuleResetResponse() ) {
-            case WIFI_MODULE_RESET_COMPLETE:
-                wifiComFsmState = WIFI_STATE_MODULE_INIT;
-                pcSerialComStringWrite( "Wi-Fi module detected.\r\n" );
-            break;
-            case WIFI_MODULE_NOT_DETECTED:
-                wifiComFsmState = WIFI_STATE_MODULE_NOT_DETECTED;
-                stateEntryFlag = false; // Asi relanzo el entry de este estado   
-            break;
-            case WIFI_MODULE_BUSY: // Module busy, not do anything
-            default:
-            break;
-        }
-        resetSended = false;   
+static void wifiComModuleDetected( wifiModuleRequestResult_t result )
+{
+    if( result == WIFI_MODULE_DETECTED ) {
+        pcSerialComStringWrite( "Wi-Fi module detected.\r\n" );
+    } else {
+        wifiComModuleNotDetectedEnter();
     }
+}
 
-    // EXIT ------------------------------------------
-    if( wifiComFsmState != WIFI_STATE_MODULE_NOT_DETECTED ){
-        stateEntryFlag = false;
+static void wifiComModuleReset( wifiModuleRequestResult_t result )
+{
+    if( result == WIFI_MODULE_RESET_COMPLETE ) {
+        wifiComConnectionStart();
+    } else {
+        wifiComModuleNotDetectedEnter();
     }
 }
 
-// En este estado inicializa el modulo Wi-Fi para poder conectarse a un AP
-// Cuando termina la inicializacion pasa al estado
-// WIFI_STATE_MODULE_CHECK_AP_CONNECTION
-static void runStateWifiModuleInit()
+static void wifiComModuleInitialized( wifiModuleRequestResult_t result )
 {
-    static bool stateEntryFlag = false;
-    // ENTRY ----------------------------------------
-    if( stateEntryFlag == false ){
-        if( wifiModuleStartInit() != WIFI_MODULE_INIT_STARTED ){
-            return;
-        }
-        stateEntryFlag = true;
+    if( result == WIFI_MODULE_INIT_COMPLETE ) {
+        pcSerialComStringWrite( "Wi-Fi module initialized.\r\n" );
+    } else {
+        wifiComModuleNotDetectedEnter();
     }
+}
 
-    // CHECK TRANSITION CONDITIONS ------------------
-    switch( wifiModuleInitResponse() ) {
-        case WIFI_MODULE_INIT_COMPLETE:
-            pcSerialComStringWrite( "Wi-Fi module initialized.\r\n" );
-            wifiComFsmState = WIFI_STATE_MODULE_CHECK_AP_CONNECTION;
+static void wifiComAPConnectionChecked( wifiModuleRequestResult_t result )
+{
+    switch( result ) {
+        case WIFI_MODULE_IS_CONNECTED:
+            wifiModuleStartIpGet( wifiComIpReceived );
         break;
-        case WIFI_MODULE_NOT_DETECTED:
-            wifiComFsmState = WIFI_STATE_MODULE_NOT_DETECTED;
+        case WIFI_MODULE_IS_NOT_CONNECTED:
+            pcSerialComStringWrite( "Wi-Fi try to connect with AP SSID: " );
+            pcSerialComStringWrite( wifiModuleGetAP_SSID() );
+            pcSerialComStringWrite( "\r\n" );
+            wifiModuleStartConnectWithAP( wifiComAPConnected );
         break;
-        case WIFI_MODULE_BUSY: // Module busy, not do anything
         default:
+            wifiComModuleNotDetectedEnter();
         break;
     }
-
-    // EXIT ------------------------------------------
-    if( wifiComFsmState != WIFI_STATE_MODULE_INIT ){
-        stateEntryFlag = false;
-    }
 }
 
-// Chequea si esta conectado y tiene IP.
-// Si está conectado y tiene IP pasa al estado WIFI_STATE_COMMUNICATIONS_INIT
-// Si no está conectado pasa al estado: WIFI_STATE_MODULE_NOT_CONNECTED
-static void runStateWifiModuleCheckAPConnection()
+static void wifiComAPConnected( wifiModuleRequestResult_t result )
 {
-    static bool stateEntryFlag = false;
-    char ip[20] = ""; 
-    // ENTRY ----------------------------------------
-    if( stateEntryFlag == false ){
-        if( wifiModuleStartIsConnectedWithAP() != WIFI_MODULE_INIT_STARTED ){
-            return;
-        }
-        stateEntryFlag = true;
-    }
-
-    // CHECK TRANSITION CONDITIONS ------------------
-    switch( wifiModuleIsConnectedWithAPResponse() ) {  // ??????????????????????????????????
+    switch( result ) {
         case WIFI_MODULE_IS_CONNECTED:
-            pcSerialComStringWrite( "Wi-Fi module is connected. IP = " );
-            pcSerialComStringWrite( ip );
-            pcSerialComStringWrite( "\r\n" );
-            wifiComFsmState = WIFI_STATE_COMMUNICATION;
+            wifiModuleStartIpGet( wifiComIpReceived );
         break;
-        case WIFI_MODULE_IS_NOT_CONNECTED:
-            pcSerialComStringWrite( "Wi-Fi module is not connected.\r\n" );
-            wifiComFsmState = WIFI_STATE_MODULE_NOT_CONNECTED;
+        // Errors trying to connect
+        case WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT:
+            pcSerialComStringWrite( "\r\nERROR: Connection timeout. " );
+            wifiComModuleNotConnectedEnter();
+        break;
+        case WIFI_MODULE_CONNECT_AP_ERR_WRONG_PASS:
+            pcSerialComStringWrite( "\r\nERROR: Wrong password. " );
+            wifiComModuleNotConnectedEnter();
         break;
-        case WIFI_MODULE_NOT_DETECTED:
-            wifiComFsmState = WIFI_STATE_MODULE_NOT_DETECTED;
+        case WIFI_MODULE_CONNECT_AP_ERR_AP_NOT_FOUND:
+            pcSerialComStringWrite( "\r\nERROR: Cannot find the target AP. " );
+            wifiComModuleNotConnectedEnter();
+        break;
+        case WIFI_MODULE_CONNECT_AP_ERR_CONN_FAIL:
+            pcSerialComStringWrite( "\r\nERROR: Connection failed. " );
+            wifiComModuleNotConnectedEnter();
         break;
-        case WIFI_MODULE_BUSY: // Module busy, not do anything
         default:
+            pcSerialComStringWrite( "\r\nERROR: Connection failed. " );
+            wifiComModuleNotConnectedEnter();
         break;
     }
-
-    // EXIT ------------------------------------------
-    if( wifiComFsmState != WIFI_STATE_MODULE_CHECK_AP_CONNECTION ){
-        stateEntryFlag = false;
-    }
 }
 
-// Si no está conectado reintenta conectarse cada 10 segundos.
-// Si no detecta el módulo vuelve a: 
-//     WIFI_STATE_MODULE_NOT_DETECTED.
-static void runStateWifiModuleNotConnected()
+// The time to connected covers everything since the module was detected
+// or reset for the last time
+static void wifiComIpReceived( wifiModuleRequestResult_t result )
 {
-    static bool stateEntryFlag = false;
-    char ip[20] = ""; 
-    static bool isWaitingForNextTry = false;
-    static bool isWaitingForIp = false;
-    static delay_t reintentsDelay;
-    // ENTRY ----------------------------------------
-    if( stateEntryFlag == false ){
-        if( wifiModuleStartConnectWithAP() != WIFI_MODULE_CONNECT_AP_STARTED ){
-            return;
-        }        
-        pcSerialComStringWrite( "Wi-Fi try to connect with AP SSID: " );
-        pcSerialComStringWrite( wifiModuleGetAP_SSID() );
-        pcSerialComStringWrite( "\r\n" );
-        stateEntryFlag = true;
-    }
-
-    // CHECK TRANSITION CONDITIONS ------------------
-    if( isWaitingForNextTry ) {       
-        if( delayRead(&reintentsDelay) ) {
-            wifiComFsmState = WIFI_STATE_MODULE_NOT_DETECTED;
-            isWaitingForNextTry = false;            
-        }
+    if( result != WIFI_MODULE_IP_GET_COMPLETE ) {
+        wifiComModuleNotDetectedEnter();
         return;
-    } else{
-        switch( wifiModuleConnectWithAPResponse() ) {
-            case WIFI_MODULE_IS_CONNECTED:
-                isWaitingForIp = true;
-            break;
-            case WIFI_MODULE_NOT_DETECTED:
-                wifiComFsmState = WIFI_STATE_MODULE_NOT_DETECTED;          
-            break;                
-            // Errors trying to connect
-            case WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT:
-                pcSerialComStringWrite( "\r\nERROR: Connection timeout. " );
-                isWaitingForNextTry = true;
-            break;
-            case WIFI_MODULE_CONNECT_AP_ERR_WRONG_PASS:
-                pcSerialComStringWrite( "\r\nERROR: Wrong password. " );
-                isWaitingForNextTry = true;
-            break;
-            case WIFI_MODULE_CONNECT_AP_ERR_AP_NOT_FOUND:
-                pcSerialComStringWrite( "\r\nERROR: Cannot find the target AP. " );
-                isWaitingForNextTry = true;
-            break;
-            case WIFI_MODULE_CONNECT_AP_ERR_CONN_FAIL:
-                pcSerialComStringWrite( "\r\nERROR: Connection failed. " );
-                isWaitingForNextTry = true;
-            break;            
-            // Module busy, not do anything
-            case WIFI_MODULE_BUSY:
-            default:
-            break;
-        }
-        if( isWaitingForNextTry ) {
-            pcSerialComStringWrite( "Wi-Fi not connected!\r\n" );
-            pcSerialComStringWrite( "It will re-intent automaticaly in 10 " );
-            pcSerialComStringWrite( "secondsr\nafter restet the module...\r\n" );
-            delayInit( &reintentsDelay, 10000 );
-        }
-    }
-    if( isWaitingForIp ){
-        
-        // ... TODO: FALTA ------------------------------------------------ ????????????????????
-        
-        pcSerialComStringWrite( "Wi-Fi module is connected. IP = " );
-        pcSerialComStringWrite( ip );
-        pcSerialComStringWrite( "\r\n" );
-        wifiComFsmState = WIFI_STATE_COMMUNICATION;
-    }
-
-    // EXIT ------------------------------------------
-    if( wifiComFsmState != WIFI_STATE_MODULE_NOT_CONNECTED ){
-        stateEntryFlag = false;
-    }
-}
-
-// En este estado:
-//     embeddedServerInit(); // Chapter 9 y 10
-//     clientInit();         // Chapter 10
-//     Y  cuando termina pasa al estado:
-//        WIFI_STATE_COMMUNICATION_UPDATE
-// En este estado levanta el Server y se pasa al siguiente estado.
-// Si no detecta el módulo vuelve a: 
-//     WIFI_STATE_MODULE_NOT_DETECTED.
-// Si se pierde la conexión entre el módulo y el AP vuelve a: 
-//     WIFI_STATE_MODULE_WAIT_FOR_AP_CONNECTION
-static void runStateWifiCommunication()
-{
-    static bool stateEntryFlag = false;
-    // ENTRY ----------------------------------------
-    if( stateEntryFlag == false ){
-        stateEntryFlag = true;
-        pcSerialComStringWrite( "Check connection status\r\n" );
-    }
-
-    // UPDATE OUTPUTS -------------------------------
-
-
-    // CHECK TRANSITION CONDITIONS ------------------
-
-    // EXIT ------------------------------------------
-    if( wifiComFsmState != WIFI_STATE_COMMUNICATION ){
-        stateEntryFlag = false;
     }
+    pcSerialComStringWrite( "Wi-Fi module is connected. IP = " );
+    pcSerialComStringWrite( wifiModuleIpRead() );
+    pcSerialComStringWrite( "\r\nTime to connected: " );
+    pcSerialComIntWrite( (int)( ( tickReadUs() - wifiComStartUs ) / 1000 ) );
+    pcSerialComStringWrite( " ms\r\n" );
+    wifiComFsmState = WIFI_STATE_COMMUNICATION;
 }
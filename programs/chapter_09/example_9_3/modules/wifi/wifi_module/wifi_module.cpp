@@ -3,6 +3,7 @@
 #include "wifi_module.h"
 #include "wifi_default_credentials.h"
 #include "sapi.h"
+#include "ring_buffer.h"
 
 //=====[Declaration of private defines]========================================
 
@@ -10,6 +11,9 @@
 #define ESP8266_MOST_COMMON_AT_CMD_TIMEOUT   50
 #define ESP8266_AT_RST_CMD_TIMEOUT           10000
 #define ESP8266_AT_CWJAP_CMD_TIMEOUT         20000
+#define ESP8266_RX_BUFFER_SIZE               512   // About 44 ms at 115200 bps
+#define ESP8266_COMMAND_QUEUE_SIZE           8
+#define ESP8266_FIELD_MAX_DIGITS             5
 
 //=====[Declaration of private data types]=====================================
 
@@ -18,6 +22,21 @@ typedef enum{
     ESP8266_PROCESSING_AT_COMMAND,
 }esp8266State_t;
 
+// Every response the module can give, in the order of esp8266Responses[]
+typedef enum{
+    ESP8266_RESPONSE_NONE = MATCHER_NO_MATCH,
+    ESP8266_RESPONSE_OK,
+    ESP8266_RESPONSE_ERROR,
+    ESP8266_RESPONSE_FAIL,
+    ESP8266_RESPONSE_READY,
+    ESP8266_RESPONSE_CWJAP,
+    ESP8266_RESPONSE_STATUS,
+    ESP8266_RESPONSE_CIFSR_STAIP,
+    ESP8266_RESPONSE_CIPSTATUS,
+    ESP8266_RESPONSE_IPD,
+    ESP8266_NUMBER_OF_RESPONSES,
+}esp8266Response_t;
+
 // "AT+CIPSTATUS\r\n"
 // status of the ESP32 Station interface.
 typedef enum{
@@ -32,9 +51,56 @@ typedef enum{
                                          // connect to an AP.
 }esp8266StationStatus_t;
 
+// Received bytes that are still in the RX buffer, the offset counts from the
+// oldest byte not released yet
+typedef struct esp8266View{
+    uint32_t offset;
+    uint32_t length;
+}esp8266View_t;
+
+typedef enum{
+    ESP8266_TOKEN_LINE,
+    ESP8266_TOKEN_IPD,
+}esp8266TokenType_t;
+
+// A response line without its "\r\n" or the header of a "+IPD" frame. The
+// view holds the fields that follow the response the line starts with, or
+// the whole line if it starts with none. It stays valid until released.
+typedef struct esp8266Token{
+    esp8266TokenType_t type;
+    esp8266Response_t response;
+    esp8266View_t view;
+    uint32_t size;   // Bytes to release, "\r\n" included
+    int linkId;
+    uint32_t dataLength;
+}esp8266Token_t;
+
+// Sees every response line of its command, returns the result of the
+// command or WIFI_MODULE_BUSY
+typedef wifiModuleRequestResult_t (*esp8266ResponseHandler_t)(
+    esp8266Token_t const* token );
+
+// An AT command and how its end is recognized. Without a response handler
+// the command completes with resultMatch when response is received. A
+// timeout completes it with resultTimeout.
+typedef struct esp8266Command{
+    char const* cmd;
+    void (*cmdWrite)();   // Used instead of cmd when not NULL
+    esp8266Response_t response;
+    wifiModuleRequestResult_t resultMatch;
+    tick_t timeout;
+    wifiModuleRequestResult_t resultTimeout;
+    esp8266ResponseHandler_t responseHandler;
+}esp8266Command_t;
+
+typedef struct esp8266QueuedCommand{
+    esp8266Command_t const* command;
+    wifiModuleResultHandler_t resultHandler;
+}esp8266QueuedCommand_t;
+
 //=====[Declaration and initialization of public global objects]===============
 
-static Serial uartEsp8266( D42, D41 );
+static RawSerial uartEsp8266( D42, D41 );
 
 //=====[Declaration of external public global variables]=======================
 
@@ -45,35 +111,125 @@ static Serial uartEsp8266( D42, D41 );
 static char credential_ssid[WIFI_MODULE_CREDENTIAL_MAX_LEN] = WIFI_SSID; 
 static char credential_password[WIFI_MODULE_CREDENTIAL_MAX_LEN] = WIFI_PASSWORD;
 
-static parser_t parser;
-static parserStatus_t parserStatus;
-
-static parser_t parser2;
-static parserStatus_t parser2Status;
+static char const* const esp8266Responses[ESP8266_NUMBER_OF_RESPONSES] = {
+    "OK",
+    "ERROR",
+    "FAIL",
+    "ready",
+    "+CWJAP:",
+    "STATUS:",
+    "+CIFSR:STAIP,",
+    "+CIPSTATUS:",
+    "+IPD,",
+};
+
+// Responses followed by fields, the others must be the whole line
+static const bool esp8266ResponseHasFields[ESP8266_NUMBER_OF_RESPONSES] = {
+    false, false, false, false, true, true, true, true, true,
+};
+
+// Finds the response each line starts with while the line is scanned, it is
+// reset at every line start
+static matcher_t esp8266ResponseMatcher;
+static delay_t esp8266ResponseTimeout;
 
 static esp8266State_t esp8266State;
 
+// Filled by the RX interrupt, so no byte is lost however long the main loop
+// takes between two updates
+static SpscRingBuffer<char, ESP8266_RX_BUFFER_SIZE> esp8266RxBuffer;
+
+// Commands waiting to be sent, the head of the queue is the one running
+static SpscRingBuffer<esp8266QueuedCommand_t, ESP8266_COMMAND_QUEUE_SIZE>
+    esp8266CommandQueue;
+
+// Number of commands at the head of the queue to drop without sending them
+static uint32_t esp8266CancelledCommands = 0;
+
+// Tokenizer state, kept between updates so a line received in several
+// pieces is scanned only once
+static uint32_t esp8266ScanOffset = 0;
+static esp8266Response_t esp8266LineResponse = ESP8266_RESPONSE_NONE;
+
+// Payload of the "+IPD" frame being received
+static uint32_t esp8266DataRemaining = 0;
+static int esp8266DataLinkId = 0;
+static wifiModuleDataHandler_t esp8266DataHandler = NULL;
+
+// Fields read from the responses, cleared when a command is sent
+static esp8266StationStatus_t esp8266StationStatus;
+static wifiModuleRequestResult_t esp8266ConnectError;
+static uint8_t esp8266OpenLinksFound = 0;
+static uint8_t esp8266OpenLinks = 0;
+static char esp8266Ip[WIFI_MODULE_IP_MAX_LEN + 1] = "";
+
 //=====[Declarations (prototypes) of private functions]========================
 
-static bool esp8266UartByteRead( char* receivedByte );
+static void esp8266UartRxIsr();
 static void esp8266UartByteWrite( char byteToSend );
 static void esp8266UartStringWrite( char const* str );
 
-// Send commands that have only one valid response
-static wifiModuleRequestResult_t esp8266SendCommandWithResponse( 
-    char const* cmd, char const* cmdResponse,
-    wifiModuleRequestResult_t informResult,
-    tick_t timeout );
-
-// Check response for previously sended commands that only have one response
-static wifiModuleRequestResult_t
-esp8266CheckCommandResponse( wifiModuleRequestResult_t resultMatch );
-
-// Send commands that have two valid responses
-static wifiModuleRequestResult_t esp8266SendCommandWithTwoResponses( 
-    char const* cmd, char const* cmdResponse1, char const* cmdResponse2,
-    wifiModuleRequestResult_t informResult,
-    tick_t timeout );
+static wifiModuleRequestResult_t esp8266CommandSubmit(
+    esp8266Command_t const* command, wifiModuleRequestResult_t informResult,
+    wifiModuleResultHandler_t resultHandler );
+static void esp8266CommandSend( esp8266Command_t const* command );
+static wifiModuleRequestResult_t esp8266CommandTokenCheck(
+    esp8266Command_t const* command, esp8266Token_t const* token );
+
+static bool esp8266TokenRead( esp8266Token_t* token );
+static bool esp8266LineEnd( esp8266Token_t* token );
+static bool esp8266IpdHeaderEnd( esp8266Token_t* token );
+static void esp8266TokenRelease( esp8266Token_t const* token );
+static bool esp8266DataRead();
+
+static char esp8266ViewCharRead( esp8266View_t const* view, uint32_t index );
+static int esp8266ViewNumberRead( esp8266View_t const* view, uint32_t* index );
+static bool esp8266ViewQuotedCopy( esp8266View_t const* view, char* str,
+                                   uint32_t size );
+
+static void esp8266ConnectWithAPCommandWrite();
+static wifiModuleRequestResult_t esp8266IsConnectedWithAPResponse(
+    esp8266Token_t const* token );
+static wifiModuleRequestResult_t esp8266ConnectWithAPResponse(
+    esp8266Token_t const* token );
+static wifiModuleRequestResult_t esp8266IpGetResponse(
+    esp8266Token_t const* token );
+
+//=====[Declaration and initialization of private constants]===================
+
+static const esp8266Command_t esp8266DetectionCommand = {
+    "AT\r\n", NULL, ESP8266_RESPONSE_OK, WIFI_MODULE_DETECTED,
+    ESP8266_MOST_COMMON_AT_CMD_TIMEOUT, WIFI_MODULE_NOT_DETECTED, NULL
+};
+
+static const esp8266Command_t esp8266ResetCommand = {
+    "AT+RST\r\n", NULL, ESP8266_RESPONSE_READY, WIFI_MODULE_RESET_COMPLETE,
+    ESP8266_AT_RST_CMD_TIMEOUT, WIFI_MODULE_NOT_DETECTED, NULL
+};
+
+static const esp8266Command_t esp8266InitCommand = {
+    "AT+CWMODE=1\r\n", NULL, ESP8266_RESPONSE_OK, WIFI_MODULE_INIT_COMPLETE,
+    ESP8266_MOST_COMMON_AT_CMD_TIMEOUT, WIFI_MODULE_NOT_DETECTED, NULL
+};
+
+static const esp8266Command_t esp8266IsConnectedWithAPCommand = {
+    "AT+CIPSTATUS\r\n", NULL, ESP8266_RESPONSE_OK, WIFI_MODULE_BUSY,
+    ESP8266_MOST_COMMON_AT_CMD_TIMEOUT, WIFI_MODULE_NOT_DETECTED,
+    esp8266IsConnectedWithAPResponse
+};
+
+// The module was answering a moment ago, no answer in time is the AP's
+static const esp8266Command_t esp8266ConnectWithAPCommand = {
+    NULL, esp8266ConnectWithAPCommandWrite, ESP8266_RESPONSE_OK,
+    WIFI_MODULE_BUSY, ESP8266_AT_CWJAP_CMD_TIMEOUT,
+    WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT, esp8266ConnectWithAPResponse
+};
+
+static const esp8266Command_t esp8266IpGetCommand = {
+    "AT+CIFSR\r\n", NULL, ESP8266_RESPONSE_OK, WIFI_MODULE_BUSY,
+    ESP8266_MOST_COMMON_AT_CMD_TIMEOUT, WIFI_MODULE_NOT_DETECTED,
+    esp8266IpGetResponse
+};
 
 //=====[Implementations of public functions]===================================
 
@@ -82,13 +238,99 @@ static wifiModuleRequestResult_t esp8266SendCommandWithTwoResponses(
 void wifiModuleInit()
 {  
     uartEsp8266.baud(ESP8266_BAUD_RATE);
+    uartEsp8266.attach( esp8266UartRxIsr, SerialBase::RxIrq );
+    matcherInit( &esp8266ResponseMatcher, esp8266Responses,
+                 ESP8266_NUMBER_OF_RESPONSES );
     esp8266State = ESP8266_IDLE;
 }
 
 // Update module status -------------------------------------------------------
 
-void wifiModuleUpdate() {
-    //esp8266Update();
+// Runs the queued commands back to back: as soon as one completes its
+// result handler is called and the next one is sent, in the same call.
+// Every received line is tokenized here, also while no command is running,
+// and the "+IPD" payloads are handed to the data handler wherever they
+// arrive between the response lines.
+void wifiModuleUpdate()
+{
+    const esp8266QueuedCommand_t* queuedCommand;
+    esp8266QueuedCommand_t completedCommand;
+    wifiModuleRequestResult_t result;
+    esp8266Token_t token;
+
+    while( esp8266DataRead() ) {
+        queuedCommand = esp8266CommandQueue.peek();
+        if( queuedCommand != NULL && esp8266State == ESP8266_IDLE ) {
+            if( esp8266CancelledCommands > 0 ) {
+                esp8266CancelledCommands--;
+                esp8266CommandQueue.release( 1 );
+                continue;
+            }
+            esp8266CommandSend( queuedCommand->command );
+        }
+
+        result = WIFI_MODULE_BUSY;
+        if( esp8266TokenRead( &token ) ) {
+            if( token.type == ESP8266_TOKEN_IPD ) {
+                esp8266DataRemaining = token.dataLength;
+                esp8266DataLinkId = token.linkId;
+            } else if( queuedCommand != NULL ) {
+                result = esp8266CommandTokenCheck( queuedCommand->command,
+                                                   &token );
+            }
+            esp8266TokenRelease( &token );
+        } else {
+            // The timeout is only checked once every complete line was
+            // read, so a response that arrived in time is never reported
+            // as a timeout
+            if( queuedCommand == NULL ||
+                !delayRead( &esp8266ResponseTimeout ) ) {
+                return;
+            }
+            result = queuedCommand->command->resultTimeout;
+        }
+        if( result == WIFI_MODULE_BUSY ) {
+            continue;
+        }
+
+        // Released before the handler runs, so it can queue new commands
+        completedCommand = *queuedCommand;
+        esp8266CommandQueue.release( 1 );
+        esp8266State = ESP8266_IDLE;
+        if( completedCommand.resultHandler != NULL ) {
+            completedCommand.resultHandler( result );
+        }
+    }
+}
+
+// Only bytes that were not scanned yet are work for wifiModuleUpdate()
+bool wifiModuleCharAvailable()
+{
+    return esp8266RxBuffer.size() > esp8266ScanOffset;
+}
+
+// The command that is running is not cancelled, its handler is still called
+void wifiModulePendingRequestsCancel()
+{
+    esp8266CancelledCommands = esp8266CommandQueue.size();
+    if( esp8266State == ESP8266_PROCESSING_AT_COMMAND ) {
+        esp8266CancelledCommands--;
+    }
+}
+
+uint32_t wifiModuleRxOverflowsRead()
+{
+    return esp8266RxBuffer.overflowsRead();
+}
+
+uint32_t wifiModuleRxHighWaterMarkRead()
+{
+    return esp8266RxBuffer.highWaterMarkRead();
+}
+
+void wifiModuleDataHandlerSet( wifiModuleDataHandler_t dataHandler )
+{
+    esp8266DataHandler = dataHandler;
 }
 
 // Set/Get AP credentials -----------------------------------------------------
@@ -143,322 +385,425 @@ char const* wifiModuleGetAP_Password()
     return (char const*) credential_password;
 }
 
-// Detect module --------------------------------------------------------------
+// Requests -------------------------------------------------------------------
 
-// Responses:
-// WIFI_MODULE_DETECTION_STARTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleStartDetection()
+// Each request is queued and returns at once, with the _STARTED value or
+// WIFI_MODULE_BUSY if the queue is full. The result handler is called from
+// wifiModuleUpdate() once the command completes.
+
+// Results:
+// WIFI_MODULE_DETECTED
+// WIFI_MODULE_NOT_DETECTED
+wifiModuleRequestResult_t wifiModuleStartDetection(
+    wifiModuleResultHandler_t resultHandler )
 {
-    return esp8266SendCommandWithResponse(
-              "AT\r\n", "OK\r\n", 
-              WIFI_MODULE_DETECTION_STARTED,
-              ESP8266_MOST_COMMON_AT_CMD_TIMEOUT );
+    return esp8266CommandSubmit( &esp8266DetectionCommand,
+                                 WIFI_MODULE_DETECTION_STARTED,
+                                 resultHandler );
 }
 
-// Responses:
-// WIFI_MODULE_DETECTED
+// Results:
+// WIFI_MODULE_RESET_COMPLETE
 // WIFI_MODULE_NOT_DETECTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleDetectionResponse()
+wifiModuleRequestResult_t wifiModuleStartReset(
+    wifiModuleResultHandler_t resultHandler )
 {
-    return esp8266CheckCommandResponse( WIFI_MODULE_DETECTED );
+    return esp8266CommandSubmit( &esp8266ResetCommand,
+                                 WIFI_MODULE_RESET_STARTED, resultHandler );
 }
 
-// Reset module ---------------------------------------------------------------
+// Results:
+// WIFI_MODULE_INIT_COMPLETE
+// WIFI_MODULE_NOT_DETECTED
+wifiModuleRequestResult_t wifiModuleStartInit(
+    wifiModuleResultHandler_t resultHandler )
+{
+    return esp8266CommandSubmit( &esp8266InitCommand,
+                                 WIFI_MODULE_INIT_STARTED, resultHandler );
+}
 
-// Responses:
-// WIFI_MODULE_RESET_STARTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleStartReset()
+// Results:
+// WIFI_MODULE_IS_CONNECTED
+// WIFI_MODULE_IS_NOT_CONNECTED
+// WIFI_MODULE_NOT_DETECTED
+wifiModuleRequestResult_t wifiModuleStartIsConnectedWithAP(
+    wifiModuleResultHandler_t resultHandler )
 {
-    return esp8266SendCommandWithResponse( "AT+RST\r\n", "OK ready\r\n", 
-                                              WIFI_MODULE_RESET_STARTED,
-                                              ESP8266_AT_RST_CMD_TIMEOUT );
+    return esp8266CommandSubmit( &esp8266IsConnectedWithAPCommand,
+                                 WIFI_MODULE_IS_CONNECTED_AP_STARTED,
+                                 resultHandler );
 }
 
-// Responses:
-// WIFI_MODULE_RESET_COMPLETE
+// Results:
+// WIFI_MODULE_IS_CONNECTED
+// WIFI_MODULE_IS_NOT_CONNECTED
+// WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT, also when no answer came in time
+// WIFI_MODULE_CONNECT_AP_ERR_WRONG_PASS
+// WIFI_MODULE_CONNECT_AP_ERR_AP_NOT_FOUND
+// WIFI_MODULE_CONNECT_AP_ERR_CONN_FAIL
+wifiModuleRequestResult_t wifiModuleStartConnectWithAP(
+    wifiModuleResultHandler_t resultHandler )
+{
+    return esp8266CommandSubmit( &esp8266ConnectWithAPCommand,
+                                 WIFI_MODULE_CONNECT_AP_STARTED,
+                                 resultHandler );
+}
+
+// Results:
+// WIFI_MODULE_IP_GET_COMPLETE, the IP is read with wifiModuleIpRead()
 // WIFI_MODULE_NOT_DETECTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleResetResponse()
+wifiModuleRequestResult_t wifiModuleStartIpGet(
+    wifiModuleResultHandler_t resultHandler )
 {
-    return esp8266CheckCommandResponse( WIFI_MODULE_RESET_COMPLETE );
+    return esp8266CommandSubmit( &esp8266IpGetCommand,
+                                 WIFI_MODULE_IP_GET_STARTED, resultHandler );
 }
 
-// Initialize module ----------------------------------------------------------
+char const* wifiModuleIpRead()
+{
+    return esp8266Ip;
+}
 
-// Responses:
-// WIFI_MODULE_INIT_STARTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleStartInit()
+// One bit per link id, as reported by the last wifiModuleStartIsConnectedWithAP()
+uint8_t wifiModuleOpenLinksRead()
 {
-    return esp8266SendCommandWithResponse(
-              "AT+CWMODE=1\r\n", "OK\r\n", 
-              WIFI_MODULE_INIT_STARTED,
-              ESP8266_MOST_COMMON_AT_CMD_TIMEOUT );
+    return esp8266OpenLinks;
 }
 
-// Responses:
-// WIFI_MODULE_INIT_COMPLETE
-// WIFI_MODULE_NOT_DETECTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleInitResponse()
+//=====[Implementations of private functions]==================================
+
+static void esp8266UartRxIsr()
 {
-    return esp8266CheckCommandResponse( WIFI_MODULE_INIT_COMPLETE );
+    while( uartEsp8266.readable() ) {
+        esp8266RxBuffer.push( uartEsp8266.getc() );
+    }
+    tickWakeUpRequest();
 }
 
-// AP connection --------------------------------------------------------------
+static void esp8266UartByteWrite( char byteToSend )
+{
+    uartEsp8266.putc( byteToSend );
+}
 
-// Check if connected with AP
+static void esp8266UartStringWrite( char const* str )
+{
+    while ( *str != '\0' ) {
+        esp8266UartByteWrite( (uint8_t)*str );
+        str++;
+    }
+}
 
-// Responses:
-// WIFI_MODULE_IS_CONNECTED_AP_STARTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleStartIsConnectedWithAP()
+static wifiModuleRequestResult_t esp8266CommandSubmit(
+    esp8266Command_t const* command, wifiModuleRequestResult_t informResult,
+    wifiModuleResultHandler_t resultHandler )
 {
-    return esp8266SendCommandWithResponse(
-              "AT+CIPSTATUS", "STATUS:\r\n\r\nOK\r\n", 
-              WIFI_MODULE_IS_CONNECTED_AP_STARTED,
-              ESP8266_MOST_COMMON_AT_CMD_TIMEOUT );
+    esp8266QueuedCommand_t queuedCommand;
+
+    queuedCommand.command = command;
+    queuedCommand.resultHandler = resultHandler;
+    if( !esp8266CommandQueue.push( queuedCommand ) ) {
+        return WIFI_MODULE_BUSY;
+    }
+    return informResult;
 }
 
-// Responses:
-// WIFI_MODULE_IS_CONNECTED
-// WIFI_MODULE_IS_NOT_CONNECTED
-// WIFI_MODULE_NOT_DETECTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleIsConnectedWithAPResponse()
-{
-    static esp8266StationStatus_t status = ESP8266_STATUS_AP_NOT_CONNECTED;
-    char receivedChar = '\0';
-    // Leo un caracter desde la UART, si no hay nada para leer receivedChar queda en NULL como estaba inicializada
-    esp8266UartByteRead( &receivedChar );
-    // Si el caracter recibido es digito me lo guardo 
-    if( charIsDigit(receivedChar) ) {
-        status = (esp8266StationStatus_t) charDigitToIntDigit(receivedChar);
+// Lines left from the previous command are not dropped, a "+IPD" frame
+// among them would be cut
+static void esp8266CommandSend( esp8266Command_t const* command )
+{
+    esp8266StationStatus = ESP8266_STATUS_AP_NOT_CONNECTED;
+    esp8266ConnectError = WIFI_MODULE_IS_NOT_CONNECTED;
+    esp8266OpenLinksFound = 0;
+
+    delayInit( &esp8266ResponseTimeout, command->timeout );
+    esp8266State = ESP8266_PROCESSING_AT_COMMAND;
+    if( command->cmdWrite != NULL ) {
+        command->cmdWrite();
+    } else {
+        esp8266UartStringWrite( command->cmd );
     }
-    // Actualizao el parser pasandole el caracter recibido
-    parserStatus = parserUpdate( &parser, receivedChar );
-    // Actuo segun el estado del parser
-    switch( parserStatus ) {
-        case PARSER_PATTERN_MATCH:
-            esp8266State = ESP8266_IDLE;
-            if( status == ESP8266_STATUS_AP_NOT_CONNECTED ) {
-                status = ESP8266_STATUS_AP_NOT_CONNECTED;
-                return WIFI_MODULE_IS_NOT_CONNECTED;
-            } else {
-                status = ESP8266_STATUS_AP_NOT_CONNECTED;
-                return WIFI_MODULE_IS_CONNECTED;
-            }
-        break;
-        case PARSER_TIMEOUT:
-            esp8266State = ESP8266_IDLE;
-            return WIFI_MODULE_NOT_DETECTED;
-        break;
-        default:
-            return WIFI_MODULE_BUSY;
-        break;
+}
+
+static wifiModuleRequestResult_t esp8266CommandTokenCheck(
+    esp8266Command_t const* command, esp8266Token_t const* token )
+{
+    if( command->responseHandler != NULL ) {
+        return command->responseHandler( token );
     }
+    if( token->response == command->response ) {
+        return command->resultMatch;
+    }
+    return WIFI_MODULE_BUSY;
 }
 
-// Connect with AP
+// Scans the bytes received since the last call. Returns true once a whole
+// line or "+IPD" header is in the buffer, nothing is copied out of it.
+static bool esp8266TokenRead( esp8266Token_t* token )
+{
+    uint32_t available = esp8266RxBuffer.size();
+    int response;
+    char receivedChar;
 
-// Responses:
-// WIFI_MODULE_CONNECT_AP_STARTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleStartConnectWithAP()
-{
-    char cmd[100] = "AT+CWJAP=\"";
-    strcat( cmd, credential_ssid );
-    strcat( cmd, "\",\"" );
-    strcat( cmd, credential_password );
-    strcat( cmd, "\"\r\n" );    
-    // Form cmd = AT+CWJAP="userSSID","userPassword"
- 
-    return esp8266SendCommandWithTwoResponses(
-              cmd, "WIFI CONNECTED\r\nWIFI GOT IP\r\n",
-              "WIFI CONNECTED\r\nWIFI GOT IP\r\n",
-              WIFI_MODULE_CONNECT_AP_STARTED,
-              ESP8266_AT_CWJAP_CMD_TIMEOUT );
+    while( esp8266ScanOffset < available ) {
+        receivedChar = *esp8266RxBuffer.peek( esp8266ScanOffset );
+        esp8266ScanOffset++;
+
+        if( receivedChar == '\n' ) {
+            return esp8266LineEnd( token );
+        }
+        if( esp8266LineResponse == ESP8266_RESPONSE_IPD ) {
+            if( receivedChar == ':' ) {
+                return esp8266IpdHeaderEnd( token );
+            }
+        } else if( esp8266LineResponse == ESP8266_RESPONSE_NONE ) {
+            // Only a response that ends here and started with the line
+            // counts, the matcher reports the longest one
+            response = matcherUpdate( &esp8266ResponseMatcher, receivedChar );
+            if( response != MATCHER_NO_MATCH &&
+                strlen( esp8266Responses[response] ) == esp8266ScanOffset ) {
+                esp8266LineResponse = (esp8266Response_t) response;
+            }
+        }
+    }
+
+    // A line that fills the whole buffer can never end, it is dropped
+    if( esp8266ScanOffset >= esp8266RxBuffer.capacity() ) {
+        esp8266LineResponse = ESP8266_RESPONSE_NONE;
+        return esp8266LineEnd( token );
+    }
+    return false;
 }
 
-// Responses:
-// WIFI_MODULE_IS_CONNECTED
-// WIFI_MODULE_IS_NOT_CONNECTED
-// WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT
-// WIFI_MODULE_CONNECT_AP_ERR_WRONG_PASS
-// WIFI_MODULE_CONNECT_AP_ERR_AP_NOT_FOUND
-// WIFI_MODULE_CONNECT_AP_ERR_CONN_FAIL
-// WIFI_MODULE_NOT_DETECTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleConnectWithAPResponse()
-{
-    wifiModuleRequestResult_t status = WIFI_MODULE_IS_NOT_CONNECTED;
-    char receivedChar = '\0';
-    // Leo un caracter desde la UART, si no hay nada para leer receivedChar queda en NULL como estaba inicializada
-    esp8266UartByteRead( &receivedChar );
-    // Si el caracter recibido es digito me lo guardo 
-    if( charIsDigit(receivedChar) ) {
-        status = (wifiModuleRequestResult_t) charDigitToIntDigit(receivedChar);
+static bool esp8266LineEnd( esp8266Token_t* token )
+{
+    uint32_t lineLength = esp8266ScanOffset;
+    uint32_t fieldsOffset = 0;
+
+    if( lineLength > 0 &&
+        *esp8266RxBuffer.peek( lineLength - 1 ) == '\n' ) {
+        lineLength--;
     }
-    // Actualizo los 2 parsers pasándole a cada uno el mismo caracter que llego, por esto decimos que actua en paralelo
-    parserStatus = parserUpdate( &parser, receivedChar );
-    parser2Status = parserUpdate( &parser2, receivedChar );
-    // Actuo segun los resultados de ambos parsers
-    // Matcheo parser 1, entonces se conecto bien
-    if( parserStatus == PARSER_PATTERN_MATCH ) {
-        esp8266State = ESP8266_IDLE;
-        return WIFI_MODULE_IS_CONNECTED;
-    } else 
-    // Matcheo parser 2, entonces fallo al intentar conectar al AP, retorno la causa de falla
-    if( parser2Status == PARSER_PATTERN_MATCH ) {
-        esp8266State = ESP8266_IDLE;
-        if( status >= WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT &&
-                status <= WIFI_MODULE_CONNECT_AP_ERR_CONN_FAIL ) {
-            return status;
-        } else {
-            return WIFI_MODULE_IS_NOT_CONNECTED;
+    if( lineLength > 0 &&
+        *esp8266RxBuffer.peek( lineLength - 1 ) == '\r' ) {
+        lineLength--;
+    }
+    if( esp8266LineResponse != ESP8266_RESPONSE_NONE ) {
+        fieldsOffset = strlen( esp8266Responses[esp8266LineResponse] );
+        if( !esp8266ResponseHasFields[esp8266LineResponse] &&
+            fieldsOffset != lineLength ) {
+            esp8266LineResponse = ESP8266_RESPONSE_NONE;
+            fieldsOffset = 0;
         }
-     } else 
-     // Alguno de los 2 parser salio por timeout
-     if ( parserStatus == PARSER_TIMEOUT || parser2Status == PARSER_TIMEOUT ) {
-         esp8266State = ESP8266_IDLE;
-         return WIFI_MODULE_NOT_DETECTED;
-     } 
-     // Por defecto si ninguno de los parsers termino retorno que el modulo esta ocupado
-     else {
-         return WIFI_MODULE_BUSY; 
-     }
-}
+    }
 
+    token->type = ESP8266_TOKEN_LINE;
+    token->response = esp8266LineResponse;
+    token->view.offset = fieldsOffset;
+    token->view.length = lineLength - fieldsOffset;
+    token->size = esp8266ScanOffset;
+    return true;
+}
 
-// Get IP address
+// "+IPD,<link id>,<length>:" with several connections enabled, else
+// "+IPD,<length>:". The payload follows the ':' without a line end.
+static bool esp8266IpdHeaderEnd( esp8266Token_t* token )
+{
+    uint32_t fieldsOffset = strlen( esp8266Responses[ESP8266_RESPONSE_IPD] );
+    uint32_t index = 0;
+    int number;
+
+    token->type = ESP8266_TOKEN_IPD;
+    token->response = ESP8266_RESPONSE_IPD;
+    token->view.offset = fieldsOffset;
+    token->view.length = esp8266ScanOffset - 1 - fieldsOffset;
+    token->size = esp8266ScanOffset;
+    token->linkId = 0;
+
+    number = esp8266ViewNumberRead( &token->view, &index );
+    if( index < token->view.length &&
+        esp8266ViewCharRead( &token->view, index ) == ',' ) {
+        index++;
+        token->linkId = number;
+        number = esp8266ViewNumberRead( &token->view, &index );
+    }
+    if( number < 0 || index != token->view.length ) {
+        token->type = ESP8266_TOKEN_LINE;
+        token->response = ESP8266_RESPONSE_NONE;
+        number = 0;
+    }
+    token->dataLength = number;
+    return true;
+}
 
-// Responses:
-// WIFI_MODULE_IP_GET_STARTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleStartIpGet()
+static void esp8266TokenRelease( esp8266Token_t const* token )
 {
-    return esp8266SendCommandWithResponse(
-              "AT+CIFSR", "+CIFSR:STAIP,\"\"\r\n\r\nOK\r\n", 
-              WIFI_MODULE_IP_GET_STARTED,
-              ESP8266_MOST_COMMON_AT_CMD_TIMEOUT );
+    esp8266RxBuffer.release( token->size );
+    esp8266ScanOffset = 0;
+    esp8266LineResponse = ESP8266_RESPONSE_NONE;
+    matcherReset( &esp8266ResponseMatcher );
 }
 
-// Responses:
-// WIFI_MODULE_IP_GET_COMPLETE
-// WIFI_MODULE_NOT_DETECTED
-// WIFI_MODULE_BUSY
-wifiModuleRequestResult_t wifiModuleIpGetResponse( char* ip )
-{
-    static int i = 0;
-    char receivedChar = '\0';
-    // Leo un caracter desde la UART, si no hay nada para leer receivedChar queda en NULL como estaba inicializada
-    esp8266UartByteRead( &receivedChar );
-    // Si el caracter recibido es digito o un punto ('.') me lo guardo 
-    if( charIsDigit(receivedChar) || receivedChar == '.' ) {
-        ip[i] = receivedChar;
-        i++;
-    }
-    // Actualizao el parser pasandole el caracter recibido
-    parserStatus = parserUpdate( &parser, receivedChar );
-    // Actuo segun el estado del parser
-    switch( parserStatus ) {
-        case PARSER_PATTERN_MATCH:
-            esp8266State = ESP8266_IDLE;
-            ip[i] = '\0'; // Agrego el null para que la IP sea un string valido
-            i = 0;
-            return WIFI_MODULE_IP_GET_COMPLETE;
-        break;
-        case PARSER_TIMEOUT:
-            esp8266State = ESP8266_IDLE;
-            i = 0;
-            return WIFI_MODULE_NOT_DETECTED;
-        break;
-        default:
-            return WIFI_MODULE_BUSY;
-        break;
+// Hands the received part of the "+IPD" payload to the data handler straight
+// from the buffer, one call per contiguous run. Returns false while part of
+// the payload is still to come.
+static bool esp8266DataRead()
+{
+    uint32_t length;
+
+    while( esp8266DataRemaining > 0 ) {
+        length = esp8266RxBuffer.contiguousSize();
+        if( length == 0 ) {
+            return false;
+        }
+        if( length > esp8266DataRemaining ) {
+            length = esp8266DataRemaining;
+        }
+        if( esp8266DataHandler != NULL ) {
+            esp8266DataHandler( esp8266DataLinkId, esp8266RxBuffer.peek(),
+                                length );
+        }
+        esp8266RxBuffer.release( length );
+        esp8266DataRemaining = esp8266DataRemaining - length;
     }
+    return true;
 }
 
-//=====[Implementations of private functions]==================================
+static char esp8266ViewCharRead( esp8266View_t const* view, uint32_t index )
+{
+    return *esp8266RxBuffer.peek( view->offset + index );
+}
 
-static bool esp8266UartByteRead( char* receivedByte )
+// Reads the decimal number at index and moves index past it, -1 if there is
+// no digit there. Digits after the first ESP8266_FIELD_MAX_DIGITS are left.
+static int esp8266ViewNumberRead( esp8266View_t const* view, uint32_t* index )
 {
-    if( uartEsp8266.readable() ) {
-        *receivedByte = uartEsp8266.getc();
-        return true;
+    uint32_t start = *index;
+    int number = -1;
+    char c;
+
+    while( *index < view->length ) {
+        c = esp8266ViewCharRead( view, *index );
+        if( !charIsDigit(c) ||
+            *index - start >= ESP8266_FIELD_MAX_DIGITS ) {
+            break;
+        }
+        number = ( number < 0 ? 0 : number * 10 ) + charDigitToIntDigit(c);
+        (*index)++;
+    }
+    return number;
+}
+
+// Copies the text between the quotes the view starts with, false if it is
+// not quoted or does not fit in size - 1 characters
+static bool esp8266ViewQuotedCopy( esp8266View_t const* view, char* str,
+                                   uint32_t size )
+{
+    uint32_t i;
+    char c;
+
+    if( view->length < 2 || esp8266ViewCharRead( view, 0 ) != '"' ) {
+        return false;
+    }
+    for( i = 1; i < view->length && i <= size; i++ ) {
+        c = esp8266ViewCharRead( view, i );
+        if( c == '"' ) {
+            str[i - 1] = '\0';
+            return true;
+        }
+        if( i < size ) {
+            str[i - 1] = c;
+        }
     }
     return false;
 }
 
-static void esp8266UartByteWrite( char byteToSend )
+// AT+CWJAP="userSSID","userPassword"
+static void esp8266ConnectWithAPCommandWrite()
 {
-    uartEsp8266.putc( byteToSend );
+    esp8266UartStringWrite( "AT+CWJAP=\"" );
+    esp8266UartStringWrite( credential_ssid );
+    esp8266UartStringWrite( "\",\"" );
+    esp8266UartStringWrite( credential_password );
+    esp8266UartStringWrite( "\"\r\n" );
 }
 
-static void esp8266UartStringWrite( char const* str )
+// "STATUS:<station status>" comes first, then one
+// "+CIPSTATUS:<link id>,..." line per open link
+static wifiModuleRequestResult_t esp8266IsConnectedWithAPResponse(
+    esp8266Token_t const* token )
 {
-    while ( *str != NULL ) {
-        esp8266UartByteWrite( (uint8_t)*str );
-        str++;
+    uint32_t index = 0;
+    int number;
+
+    switch( token->response ) {
+        case ESP8266_RESPONSE_STATUS:
+            number = esp8266ViewNumberRead( &token->view, &index );
+            if( number >= 0 ) {
+                esp8266StationStatus = (esp8266StationStatus_t) number;
+            }
+        break;
+        case ESP8266_RESPONSE_CIPSTATUS:
+            number = esp8266ViewNumberRead( &token->view, &index );
+            if( number >= 0 && number < 8 ) {
+                esp8266OpenLinksFound |= 1 << number;
+            }
+        break;
+        case ESP8266_RESPONSE_OK:
+            esp8266OpenLinks = esp8266OpenLinksFound;
+            if( esp8266StationStatus == ESP8266_STATUS_AP_NOT_CONNECTED ) {
+                return WIFI_MODULE_IS_NOT_CONNECTED;
+            }
+            return WIFI_MODULE_IS_CONNECTED;
+        default:
+        break;
     }
+    return WIFI_MODULE_BUSY;
 }
 
-// Send commands that have only one valid response
-static wifiModuleRequestResult_t esp8266SendCommandWithResponse( 
-    char const* cmd, char const* cmdResponse,
-    wifiModuleRequestResult_t informResult,
-    tick_t timeout )
-{
-    if( esp8266State == ESP8266_IDLE ){
-        parserInit( &parser, cmdResponse, strlen(cmdResponse), timeout );
-        esp8266State = ESP8266_PROCESSING_AT_COMMAND;
-        esp8266UartStringWrite( cmd );
-        return informResult;
-    } else {        
-        return WIFI_MODULE_BUSY;   
-    }    
-}
-
-// Check response for previously sended commands that only have one response
-static wifiModuleRequestResult_t
-esp8266CheckCommandResponse( wifiModuleRequestResult_t resultMatch )
-{
-    char receivedChar = '\0';
-    esp8266UartByteRead( &receivedChar );    
-    parserStatus = parserUpdate( &parser, receivedChar );
-    switch( parserStatus ) {
-        case PARSER_PATTERN_MATCH:
-            esp8266State = ESP8266_IDLE;
-            return resultMatch;
-        break;
-        case PARSER_TIMEOUT:
-            esp8266State = ESP8266_IDLE;
-            return WIFI_MODULE_NOT_DETECTED;
+// "OK" comes after "WIFI GOT IP" once connected. A failure is
+// "+CWJAP:<error code>" followed by "FAIL".
+static wifiModuleRequestResult_t esp8266ConnectWithAPResponse(
+    esp8266Token_t const* token )
+{
+    uint32_t index = 0;
+    int number;
+
+    switch( token->response ) {
+        case ESP8266_RESPONSE_OK:
+            return WIFI_MODULE_IS_CONNECTED;
+        case ESP8266_RESPONSE_ERROR:
+            return WIFI_MODULE_IS_NOT_CONNECTED;
+        case ESP8266_RESPONSE_FAIL:
+            return esp8266ConnectError;
+        case ESP8266_RESPONSE_CWJAP:
+            number = esp8266ViewNumberRead( &token->view, &index );
+            if( number >= WIFI_MODULE_CONNECT_AP_ERR_TIMEOUT &&
+                number <= WIFI_MODULE_CONNECT_AP_ERR_CONN_FAIL ) {
+                esp8266ConnectError = (wifiModuleRequestResult_t) number;
+            }
         break;
         default:
-            return WIFI_MODULE_BUSY;
         break;
     }
+    return WIFI_MODULE_BUSY;
 }
 
-// Send commands that have two valid responses
-static wifiModuleRequestResult_t esp8266SendCommandWithTwoResponses( 
-    char const* cmd, char const* cmdResponse1, char const* cmdResponse2,
-    wifiModuleRequestResult_t informResult,
-    tick_t timeout )
-{
-    if( esp8266State == ESP8266_IDLE ){
-        // Lanzo 2 parsers en paralelo que buscan las 2 posibles respuestas,
-        // ambos con el mismo timeout (el peor de los 2 casos)
-        parserInit( &parser, cmdResponse1, strlen(cmdResponse1), timeout );
-        parserInit( &parser2, cmdResponse2, strlen(cmdResponse2), timeout );
-        esp8266State = ESP8266_PROCESSING_AT_COMMAND;
-        esp8266UartStringWrite( cmd );
-        return informResult;
-    } else {        
-        return WIFI_MODULE_BUSY;   
-    }    
+// "+CIFSR:STAIP,"<ip>"", an IP that does not fit is ignored
+static wifiModuleRequestResult_t esp8266IpGetResponse(
+    esp8266Token_t const* token )
+{
+    char ip[WIFI_MODULE_IP_MAX_LEN + 1];
+
+    switch( token->response ) {
+        case ESP8266_RESPONSE_CIFSR_STAIP:
+            if( esp8266ViewQuotedCopy( &token->view, ip, sizeof(ip) ) ) {
+                strcpy( esp8266Ip, ip );
+            }
+        break;
+        case ESP8266_RESPONSE_OK:
+            return WIFI_MODULE_IP_GET_COMPLETE;
+        default:
+        break;
+    }
+    return WIFI_MODULE_BUSY;
 }
@@ -5,9 +5,12 @@
 
 //=====[Libraries]=============================================================
 
+#include "mbed.h"
+
 //=====[Declaration of public defines]=========================================
 
 #define WIFI_MODULE_CREDENTIAL_MAX_LEN   101
+#define WIFI_MODULE_IP_MAX_LEN           15
 
 //=====[Declaration of public data types]======================================
 
@@ -44,13 +47,27 @@ typedef enum{
     
 } wifiModuleRequestResult_t;
 
+// Called with the result of a request once the module answered it
+typedef void (*wifiModuleResultHandler_t)( wifiModuleRequestResult_t result );
+
+// Called with the payload of each "+IPD" frame as it arrives, in one or more
+// parts. The data is read in place from the receive buffer and is only valid
+// during the call.
+typedef void (*wifiModuleDataHandler_t)( int linkId, char const* data,
+                                         int length );
+
 //=====[Declarations (prototypes) of public functions]=========================
 
 // Init module and status
 void wifiModuleInit();
 
-// Update module status
+// Run the queued requests
 void wifiModuleUpdate();
+bool wifiModuleCharAvailable();
+void wifiModulePendingRequestsCancel();
+uint32_t wifiModuleRxOverflowsRead();
+uint32_t wifiModuleRxHighWaterMarkRead();
+void wifiModuleDataHandlerSet( wifiModuleDataHandler_t dataHandler );
 
 // Set/Get AP credentials
 wifiModuleRequestResult_t wifiModuleSetAP_SSID( char const* ssid );
@@ -58,29 +75,21 @@ wifiModuleRequestResult_t wifiModuleSetAP_Password( char const* password );
 char const* wifiModuleGetAP_SSID();
 char const* wifiModuleGetAP_Password();
 
-// Detect module
-wifiModuleRequestResult_t wifiModuleStartDetection();
-wifiModuleRequestResult_t wifiModuleDetectionResponse();
-
-// Reset module
-wifiModuleRequestResult_t wifiModuleStartReset();
-wifiModuleRequestResult_t wifiModuleResetResponse();
-
-// Initialize module
-wifiModuleRequestResult_t wifiModuleStartInit();
-wifiModuleRequestResult_t wifiModuleInitResponse();
-
-// Check if connected with AP
-wifiModuleRequestResult_t wifiModuleStartIsConnectedWithAP();
-wifiModuleRequestResult_t wifiModuleIsConnectedWithAPResponse();
-
-// Connect with AP
-wifiModuleRequestResult_t wifiModuleStartConnectWithAP();
-wifiModuleRequestResult_t wifiModuleConnectWithAPResponse();
-
-// Get IP address
-wifiModuleRequestResult_t wifiModuleStartIpGet();
-wifiModuleRequestResult_t wifiModuleIpGetResponse( char* ip );
+// Requests, the module runs them in order
+wifiModuleRequestResult_t wifiModuleStartDetection(
+    wifiModuleResultHandler_t resultHandler );
+wifiModuleRequestResult_t wifiModuleStartReset(
+    wifiModuleResultHandler_t resultHandler );
+wifiModuleRequestResult_t wifiModuleStartInit(
+    wifiModuleResultHandler_t resultHandler );
+wifiModuleRequestResult_t wifiModuleStartIsConnectedWithAP(
+    wifiModuleResultHandler_t resultHandler );
+wifiModuleRequestResult_t wifiModuleStartConnectWithAP(
+    wifiModuleResultHandler_t resultHandler );
+wifiModuleRequestResult_t wifiModuleStartIpGet(
+    wifiModuleResultHandler_t resultHandler );
+char const* wifiModuleIpRead();
+uint8_t wifiModuleOpenLinksRead();
 
 //=====[#include guards - end]=================================================
 